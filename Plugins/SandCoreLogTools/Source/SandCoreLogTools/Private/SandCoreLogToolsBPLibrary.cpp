@@ -4,8 +4,11 @@
 
 DEFINE_LOG_CATEGORY(LogBPGame);
 
+LLM_DEFINE_TAG(SandCoreLogTools);
+
 FString USandCoreLogToolsBPLibrary::GetCallerContext(const UObject* WorldContextObject, const FString& Message, const TCHAR* Function)
 {
+	LLM_SCOPE_BYTAG(SandCoreLogTools);
 #if !(UE_BUILD_SHIPPING || UE_BUILD_TEST) || USE_LOGGING_IN_SHIPPING
 	if (WorldContextObject)
 	{
@@ -153,6 +156,7 @@ FString USandCoreLogToolsBPLibrary::BuildStackInfoWithLabel(const UObject* World
 
 void USandCoreLogToolsBPLibrary::SandCoreLogGame(const UObject* WorldContextObject, ESandCoreLogVerbosity Verbosity/*Log*/, const FText Message/*Hello*/)
 {
+	LLM_SCOPE_BYTAG(SandCoreLogTools);
 #if !(UE_BUILD_SHIPPING || UE_BUILD_TEST) || USE_LOGGING_IN_SHIPPING //~ Do not Print in Shipping or Test unless explicitly enabled.
 	// todo: test with USE_LOGGING_IN_SHIPPING
 	TStringBuilder<512> Result;
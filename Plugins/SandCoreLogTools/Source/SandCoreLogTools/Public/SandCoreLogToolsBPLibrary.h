@@ -2,11 +2,15 @@
 
 #pragma once
 
+#include "HAL/LowLevelMemTracker.h"
 #include "Kismet/BlueprintFunctionLibrary.h"
 #include "SandCoreLogToolsBPLibrary.generated.h"
 
 SANDCORELOGTOOLS_API DECLARE_LOG_CATEGORY_EXTERN(LogBPGame, Log, All);
 
+/** Memory tracker tag for the strings the log helpers build. */
+LLM_DECLARE_TAG_API(SandCoreLogTools, SANDCORELOGTOOLS_API);
+
 #if !NO_LOGGING
 /** Use like a normal UE_LOG. eg. INFO_LOG(LogTemp, Warning, TEXT("MyNum=%.2f IsCrouching=%s"), Num, *LexToString(bIsCrouching)); */
 #define INFO_LOG(CategoryName, Verbosity, Format, ...) \
@@ -0,0 +1,361 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratAISchedulerSubsystem.h"
+
+#include "StateTree.h"
+#include "StateTreeExecutionContext.h"
+#include "StratAISettings.h"
+#include "StratUnitStateTreeSchema.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Player/StratPlayerCameraPawn.h"
+#include "Units/StratUnitDefinition.h"
+#include "Units/StratUnitSimSubsystem.h"
+
+DEFINE_LOG_CATEGORY(LogStratAI);
+
+DECLARE_CYCLE_STAT(TEXT("Behaviors"), STAT_StratAI_Behaviors, STATGROUP_StratAI);
+DECLARE_CYCLE_STAT(TEXT("Tier Update"), STAT_StratAI_TierUpdate, STATGROUP_StratAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Brains"), STAT_StratAI_NumBrains, STATGROUP_StratAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ticked"), STAT_StratAI_NumTicked, STATGROUP_StratAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Deferred"), STAT_StratAI_NumDeferred, STATGROUP_StratAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Deferred Combat"), STAT_StratAI_NumDeferredCombat, STATGROUP_StratAI);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Max Lateness (ms)"), STAT_StratAI_MaxLateness, STATGROUP_StratAI);
+
+void UStratAISchedulerSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UnitSim = Collection.InitializeDependency<UStratUnitSimSubsystem>();
+}
+
+void UStratAISchedulerSubsystem::Deinitialize()
+{
+	for (FStratUnitBrain& Brain : Brains)
+	{
+		StopBrain(Brain);
+	}
+	Brains.Reset();
+	BrainIndices.Reset();
+
+	Super::Deinitialize();
+}
+
+void UStratAISchedulerSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (!UnitSim || InWorld.GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	//~ Behaviors are small assets. Loading them up front keeps hitches out of the first fight.
+	bool bAnyBehavior = false;
+	Behaviors.Reset();
+	for (int32 TypeId = 0; TypeId < UnitSim->GetTypeInfos().Num(); ++TypeId)
+	{
+		const UStratUnitDefinition* Definition = UnitSim->GetDefinition(static_cast<uint16>(TypeId));
+		const UStateTree* Behavior = Definition ? Definition->Behavior.LoadSynchronous() : nullptr;
+		Behaviors.Add(Behavior);
+		bAnyBehavior |= Behavior != nullptr;
+	}
+
+	if (UnitSim->IsLockstep())
+	{
+		UE_CLOG(bAnyBehavior, LogStratAI, Warning, TEXT("Unit behaviors don't run in lockstep."));
+		return;
+	}
+
+	bEnabled = bAnyBehavior;
+}
+
+void UStratAISchedulerSubsystem::Tick(const float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!bEnabled)
+	{
+		return;
+	}
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	if (Now >= NextTierUpdateTime)
+	{
+		NextTierUpdateTime = Now + GetDefault<UStratAISettings>()->TierUpdateInterval;
+		UpdateTiers(Now);
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_StratAI_Behaviors);
+	STRAT_SCOPED_SYSTEM_TIMING(AIBehaviors);
+
+	FrameStats = FStratAISchedulerStats();
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	const uint64 EndCycles = StartCycles + static_cast<uint64>(GetDefault<UStratAISettings>()->FrameBudgetMs / 1000.0 / FPlatformTime::GetSecondsPerCycle64());
+
+	for (int32 Tier = 0; Tier < TierBrains.Num(); ++Tier)
+	{
+		FrameStats.NumUnits[Tier] = TierBrains[Tier].Num();
+		RunTier(static_cast<EStratAITier>(Tier), Now, EndCycles);
+	}
+
+	FrameStats.UsedMs = static_cast<float>(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+	LastFrameStats = FrameStats;
+
+	int32 NumTicked = 0;
+	int32 NumDeferred = 0;
+	for (int32 Tier = 0; Tier < TierBrains.Num(); ++Tier)
+	{
+		NumTicked += FrameStats.NumTicked[Tier];
+		NumDeferred += FrameStats.NumDeferred[Tier];
+	}
+	SET_DWORD_STAT(STAT_StratAI_NumBrains, Brains.Num());
+	SET_DWORD_STAT(STAT_StratAI_NumTicked, NumTicked);
+	SET_DWORD_STAT(STAT_StratAI_NumDeferred, NumDeferred);
+	SET_DWORD_STAT(STAT_StratAI_NumDeferredCombat, FrameStats.NumDeferred[static_cast<int32>(EStratAITier::Combat)]);
+	SET_FLOAT_STAT(STAT_StratAI_MaxLateness, FrameStats.MaxLatenessMs);
+}
+
+TStatId UStratAISchedulerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UStratAISchedulerSubsystem, STATGROUP_StratAI);
+}
+
+bool UStratAISchedulerSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+SIZE_T UStratAISchedulerSubsystem::GetAllocatedSize() const
+{
+	SIZE_T Result = Behaviors.GetAllocatedSize() + Brains.GetAllocatedSize() + BrainIndices.GetAllocatedSize();
+	for (const TArray<int32>& Tier : TierBrains)
+	{
+		Result += Tier.GetAllocatedSize();
+	}
+	for (const FStratUnitBrain& Brain : Brains)
+	{
+		Result += Brain.InstanceData.GetEstimatedMemoryUsage();
+	}
+	return Result;
+}
+
+void UStratAISchedulerSubsystem::UpdateTiers(const double Now)
+{
+	SCOPE_CYCLE_COUNTER(STAT_StratAI_TierUpdate);
+
+	//~ The server's copy of every player's camera, the same locations unit replication prioritizes by.
+	TArray<FVector2D, TInlineAllocator<16>> CameraLocations;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PC = It->Get();
+		if (const AStratPlayerCameraPawn* Camera = PC ? Cast<AStratPlayerCameraPawn>(PC->GetPawn()) : nullptr)
+		{
+			CameraLocations.Add(FVector2D(Camera->GetSimpleRepMovement().Location));
+		}
+	}
+
+	const UStratAISettings* Settings = GetDefault<UStratAISettings>();
+	const double NearDistSq = FMath::Square(Settings->NearDistance);
+	const double MidDistSq = FMath::Square(Settings->MidDistance);
+
+	for (TArray<int32>& List : TierBrains)
+	{
+		List.Reset();
+	}
+
+	TBitArray<> Seen(false, Brains.Num());
+	UnitSim->ForEachChunk([&](const FStratUnitChunk& Chunk)
+	{
+		for (int32 Row = 0; Row < Chunk.Num; ++Row)
+		{
+			const UStateTree* Behavior = Behaviors.IsValidIndex(Chunk.TypeIds[Row]) ? Behaviors[Chunk.TypeIds[Row]].Get() : nullptr;
+			if (!Behavior)
+			{
+				continue;
+			}
+
+			const FStratUnitHandle Unit = Chunk.Handles[Row];
+			while (Unit.GetIndex() >= BrainIndices.Num())
+			{
+				BrainIndices.Add(INDEX_NONE);
+			}
+
+			int32& BrainIndex = BrainIndices[Unit.GetIndex()];
+			if (!Brains.IsValidIndex(BrainIndex) || Brains[BrainIndex].Unit != Unit)
+			{
+				BrainIndex = Brains.AddDefaulted();
+				Brains[BrainIndex].Unit = Unit;
+				Brains[BrainIndex].Behavior = Behavior;
+				Brains[BrainIndex].LastThinkTime = Now;
+				Brains[BrainIndex].NextThinkTime = Now;
+				Seen.Add(true);
+			}
+			else
+			{
+				Seen[BrainIndex] = true;
+			}
+
+			EStratAITier Tier = EStratAITier::Combat;
+			if (!EnumHasAnyFlags(Chunk.Flags[Row], EStratUnitFlags::InCombat))
+			{
+				double NearestDistSq = CameraLocations.IsEmpty() ? 0.0 : UE_BIG_NUMBER;
+				const FVector2D UnitLoc(Chunk.Positions[Row].X, Chunk.Positions[Row].Y);
+				for (const FVector2D& CameraLoc : CameraLocations)
+				{
+					NearestDistSq = FMath::Min(NearestDistSq, FVector2D::DistSquared(UnitLoc, CameraLoc));
+				}
+				Tier = NearestDistSq <= NearDistSq ? EStratAITier::Near : NearestDistSq <= MidDistSq ? EStratAITier::Mid : EStratAITier::Far;
+			}
+
+			//~ Moving up a tier shouldn't wait out the old, longer interval.
+			FStratUnitBrain& Brain = Brains[BrainIndex];
+			if (Tier < Brain.Tier)
+			{
+				Brain.NextThinkTime = FMath::Min(Brain.NextThinkTime, Brain.LastThinkTime + GetTierInterval(Tier));
+			}
+			Brain.Tier = Tier;
+		}
+	});
+
+	for (int32 Index = Brains.Num() - 1; Index >= 0; --Index)
+	{
+		if (Seen[Index])
+		{
+			continue;
+		}
+
+		StopBrain(Brains[Index]);
+		Brains.RemoveAtSwap(Index, EAllowShrinking::No);
+		if (Brains.IsValidIndex(Index))
+		{
+			BrainIndices[Brains[Index].Unit.GetIndex()] = Index;
+		}
+	}
+
+	for (int32 Index = 0; Index < Brains.Num(); ++Index)
+	{
+		TierBrains[static_cast<int32>(Brains[Index].Tier)].Add(Index);
+	}
+
+	for (int32 Tier = 0; Tier < TierBrains.Num(); ++Tier)
+	{
+		TierCursors[Tier] = TierBrains[Tier].IsEmpty() ? 0 : TierCursors[Tier] % TierBrains[Tier].Num();
+	}
+}
+
+void UStratAISchedulerSubsystem::RunTier(const EStratAITier Tier, const double Now, const uint64 EndCycles)
+{
+	const TArray<int32>& List = TierBrains[static_cast<int32>(Tier)];
+	int32& Cursor = TierCursors[static_cast<int32>(Tier)];
+	const int32 Num = List.Num();
+
+	for (int32 Step = 0; Step < Num; ++Step)
+	{
+		const int32 ListIndex = (Cursor + Step) % Num;
+		FStratUnitBrain& Brain = Brains[List[ListIndex]];
+		if (Brain.NextThinkTime > Now)
+		{
+			continue;
+		}
+
+		if (FPlatformTime::Cycles64() >= EndCycles)
+		{
+			//~ Out of budget. Count who had to wait, and start with them next frame.
+			//~ The unvisited ones are this brain and the Num - Step - 1 after it.
+			for (int32 Offset = 0; Offset < Num - Step; ++Offset)
+			{
+				FrameStats.NumDeferred[static_cast<int32>(Tier)] += Brains[List[(ListIndex + Offset) % Num]].NextThinkTime <= Now ? 1 : 0;
+			}
+			Cursor = ListIndex;
+			return;
+		}
+
+		FrameStats.MaxLatenessMs = FMath::Max(FrameStats.MaxLatenessMs, static_cast<float>((Now - Brain.NextThinkTime) * 1000.0));
+		Think(Brain, Now);
+		++FrameStats.NumTicked[static_cast<int32>(Tier)];
+	}
+}
+
+void UStratAISchedulerSubsystem::Think(FStratUnitBrain& Brain, const double Now)
+{
+	const float DeltaTime = static_cast<float>(Now - Brain.LastThinkTime);
+	Brain.LastThinkTime = Now;
+	Brain.NextThinkTime = Now + GetTierInterval(Brain.Tier);
+
+	//~ Died since the last tier update, which drops the brain.
+	int32 Row;
+	const FStratUnitChunk* Chunk = UnitSim->FindUnit(Brain.Unit, Row);
+	if (!Chunk || !Brain.Behavior)
+	{
+		return;
+	}
+
+	FStateTreeExecutionContext Context(*this, *Brain.Behavior, Brain.InstanceData);
+	if (!Context.IsValid())
+	{
+		return;
+	}
+	SetUnitContext(Context, Brain, Chunk->Factions[Row]);
+
+	if (!Brain.bStarted)
+	{
+		Brain.bStarted = Context.Start() == EStateTreeRunStatus::Running;
+		return;
+	}
+
+	//~ A finished behavior starts over on the next tick.
+	Brain.bStarted = Context.Tick(DeltaTime) == EStateTreeRunStatus::Running;
+}
+
+void UStratAISchedulerSubsystem::StopBrain(FStratUnitBrain& Brain)
+{
+	if (!Brain.bStarted || !Brain.Behavior)
+	{
+		return;
+	}
+
+	FStateTreeExecutionContext Context(*this, *Brain.Behavior, Brain.InstanceData);
+	if (Context.IsValid())
+	{
+		SetUnitContext(Context, Brain, 0);
+		Context.Stop();
+	}
+	Brain.bStarted = false;
+}
+
+void UStratAISchedulerSubsystem::SetUnitContext(FStateTreeExecutionContext& Context, const FStratUnitBrain& Brain, const uint8 Faction)
+{
+	//~ Copied into the instance data's bindings during the call, so a stack value is fine.
+	FStratUnitAIContext UnitContext;
+	UnitContext.Unit = Brain.Unit;
+	UnitContext.UnitSim = UnitSim;
+	UnitContext.Faction = Faction;
+	Context.SetContextDataByName(UStratUnitStateTreeSchema::UnitContextName, FStateTreeDataView(FStratUnitAIContext::StaticStruct(), reinterpret_cast<uint8*>(&UnitContext)));
+	Context.SetCollectExternalDataCallback(FOnCollectStateTreeExternalData::CreateUObject(this, &ThisClass::CollectExternalData));
+}
+
+bool UStratAISchedulerSubsystem::CollectExternalData(const FStateTreeExecutionContext& Context, const UStateTree* StateTree, TArrayView<const FStateTreeExternalDataDesc> ExternalDataDescs, TArrayView<FStateTreeDataView> OutDataViews)
+{
+	for (int32 Index = 0; Index < ExternalDataDescs.Num(); ++Index)
+	{
+		const UClass* Class = Cast<const UClass>(ExternalDataDescs[Index].Struct);
+		if (Class && Class->IsChildOf(UWorldSubsystem::StaticClass()))
+		{
+			OutDataViews[Index] = FStateTreeDataView(GetWorld()->GetSubsystemBase(const_cast<UClass*>(Class)));
+		}
+	}
+	return true;
+}
+
+float UStratAISchedulerSubsystem::GetTierInterval(const EStratAITier Tier) const
+{
+	const UStratAISettings* Settings = GetDefault<UStratAISettings>();
+	switch (Tier)
+	{
+	case EStratAITier::Combat: return Settings->CombatInterval;
+	case EStratAITier::Near: return Settings->NearInterval;
+	case EStratAITier::Mid: return Settings->MidInterval;
+	default: return Settings->FarInterval;
+	}
+}
@@ -0,0 +1,139 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StateTreeExecutionTypes.h"
+#include "StateTreeInstanceData.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Units/StratUnitTypes.h"
+#include "StratAISchedulerSubsystem.generated.h"
+
+class UStateTree;
+class UStratUnitSimSubsystem;
+struct FStateTreeExecutionContext;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogStratAI, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("StratAI"), STATGROUP_StratAI, STATCAT_Advanced);
+
+/** How often a unit's behavior ticks. Ordered by priority, the frame budget goes to lower values first. */
+enum class EStratAITier : uint8
+{
+	Combat,
+	Near,
+	Mid,
+	Far,
+
+	MAX
+};
+
+/** One unit's running behavior. */
+USTRUCT()
+struct FStratUnitBrain
+{
+	GENERATED_BODY()
+
+	FStratUnitHandle Unit;
+
+	UPROPERTY()
+	TObjectPtr<const UStateTree> Behavior;
+
+	UPROPERTY()
+	FStateTreeInstanceData InstanceData;
+
+	double LastThinkTime{0.0};
+	double NextThinkTime{0.0};
+	EStratAITier Tier{EStratAITier::Far};
+	bool bStarted{false};
+};
+
+/** What the scheduler did last frame, for debug displays. */
+struct FStratAISchedulerStats
+{
+	TStaticArray<int32, static_cast<int32>(EStratAITier::MAX)> NumUnits{InPlace, 0};
+	TStaticArray<int32, static_cast<int32>(EStratAITier::MAX)> NumTicked{InPlace, 0};
+
+	/** Due but left for a later frame because the budget ran out. */
+	TStaticArray<int32, static_cast<int32>(EStratAITier::MAX)> NumDeferred{InPlace, 0};
+
+	/** Longest a ticked unit waited past its due time, in milliseconds. */
+	float MaxLatenessMs{0.f};
+	float UsedMs{0.f};
+};
+
+/**
+ * Runs the StateTree behavior of every unit whose UStratUnitDefinition has one, time-sliced under
+ * UStratAISettings::FrameBudgetMs.
+ *
+ * Units are put in tiers by combat and by distance to the nearest player camera, using the camera pawns' replicated
+ * locations, and each tier ticks at its own interval. Due units run highest tier first. Whoever doesn't fit in the budget
+ * goes first next frame, and shows up as deferred in stat StratAI.
+ *
+ * Authority only. Not for lockstep, where behaviors would have to be deterministic to run on every peer.
+ */
+UCLASS()
+class UE_RTS_API UStratAISchedulerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	//~ Begin UWorldSubsystem interface
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	//~ End UWorldSubsystem interface
+
+	//~ Begin UTickableWorldSubsystem interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~ End UTickableWorldSubsystem interface
+
+	const FStratAISchedulerStats& GetLastFrameStats() const { return LastFrameStats; }
+
+	/** Includes every brain's StateTree instance data. */
+	SIZE_T GetAllocatedSize() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Adds brains for new units, drops dead ones and re-tiers everything. */
+	void UpdateTiers(double Now);
+
+	/** Ticks due brains of one tier from its cursor until the budget runs out. The rest are counted as deferred. */
+	void RunTier(EStratAITier Tier, double Now, uint64 EndCycles);
+
+	void Think(FStratUnitBrain& Brain, double Now);
+	void StopBrain(FStratUnitBrain& Brain);
+	void SetUnitContext(FStateTreeExecutionContext& Context, const FStratUnitBrain& Brain, uint8 Faction);
+	bool CollectExternalData(const FStateTreeExecutionContext& Context, const UStateTree* StateTree, TArrayView<const FStateTreeExternalDataDesc> ExternalDataDescs, TArrayView<FStateTreeDataView> OutDataViews);
+	float GetTierInterval(EStratAITier Tier) const;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratUnitSimSubsystem> UnitSim;
+
+	/** Behavior per unit type id. Null for types without one. */
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<const UStateTree>> Behaviors;
+
+	UPROPERTY(Transient)
+	TArray<FStratUnitBrain> Brains;
+
+	/** Where each unit's brain is in Brains, indexed by handle index. */
+	TArray<int32> BrainIndices;
+
+	/** Brain indices per tier, rebuilt by UpdateTiers. */
+	TStaticArray<TArray<int32>, static_cast<int32>(EStratAITier::MAX)> TierBrains;
+
+	/** Where each tier continues next frame, so the same units aren't always the ones left out. */
+	TStaticArray<int32, static_cast<int32>(EStratAITier::MAX)> TierCursors{InPlace, 0};
+
+	FStratAISchedulerStats FrameStats;
+	FStratAISchedulerStats LastFrameStats;
+
+	double NextTierUpdateTime{0.0};
+	bool bEnabled{false};
+};
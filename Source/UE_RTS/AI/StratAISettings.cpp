@@ -0,0 +1,8 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratAISettings.h"
+
+UStratAISettings::UStratAISettings()
+{
+	CategoryName = TEXT("Game");
+}
@@ -0,0 +1,46 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "StratAISettings.generated.h"
+
+/** Project settings for unit AI scheduling. Found under Project Settings > Game > Strat AI. */
+UCLASS(Config=Game, DefaultConfig, meta=(DisplayName="Strat AI"))
+class UE_RTS_API UStratAISettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UStratAISettings();
+
+	/** Game thread time per frame for unit behaviors. Units that are due but don't fit wait for the next frame. */
+	UPROPERTY(Config, EditAnywhere, Category="Scheduling", meta=(ClampMin="0.1", ClampMax="16.0", Units="ms"))
+	float FrameBudgetMs{2.f};
+
+	/** How often units are re-sorted into tiers by camera distance and combat. */
+	UPROPERTY(Config, EditAnywhere, Category="Scheduling", meta=(ClampMin="0.05", Units="s"))
+	float TierUpdateInterval{0.25f};
+
+	/** Units closer than this to any player's camera are in the Near tier. */
+	UPROPERTY(Config, EditAnywhere, Category="Tiers", meta=(ClampMin="0.0", Units="cm"))
+	float NearDistance{8000.f};
+
+	/** Units closer than this, but not near, are in the Mid tier. Everything further is Far. */
+	UPROPERTY(Config, EditAnywhere, Category="Tiers", meta=(ClampMin="0.0", Units="cm"))
+	float MidDistance{25000.f};
+
+	/** Seconds between behavior ticks of fighting units, wherever they are. Zero is every frame. */
+	UPROPERTY(Config, EditAnywhere, Category="Tiers", meta=(ClampMin="0.0", Units="s"))
+	float CombatInterval{0.f};
+
+	UPROPERTY(Config, EditAnywhere, Category="Tiers", meta=(ClampMin="0.0", Units="s"))
+	float NearInterval{0.1f};
+
+	UPROPERTY(Config, EditAnywhere, Category="Tiers", meta=(ClampMin="0.0", Units="s"))
+	float MidInterval{0.5f};
+
+	UPROPERTY(Config, EditAnywhere, Category="Tiers", meta=(ClampMin="0.0", Units="s"))
+	float FarInterval{2.f};
+};
@@ -0,0 +1,33 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratUnitStateTreeSchema.h"
+
+#include "StateTreeConditionBase.h"
+#include "StateTreeEvaluatorBase.h"
+#include "StateTreeTaskBase.h"
+#include "Subsystems/WorldSubsystem.h"
+
+const FName UStratUnitStateTreeSchema::UnitContextName(TEXT("Unit"));
+
+UStratUnitStateTreeSchema::UStratUnitStateTreeSchema()
+{
+	//~ The guid identifies the context in saved trees. Never change it.
+	ContextDataDescs.Emplace(UnitContextName, FStratUnitAIContext::StaticStruct(), FGuid(0x5A3C91E2, 0x4B7D4F08, 0x9E1A6C35, 0xD2F0B847));
+}
+
+bool UStratUnitStateTreeSchema::IsStructAllowed(const UScriptStruct* InScriptStruct) const
+{
+	return InScriptStruct->IsChildOf(FStateTreeConditionCommonBase::StaticStruct())
+		|| InScriptStruct->IsChildOf(FStateTreeEvaluatorCommonBase::StaticStruct())
+		|| InScriptStruct->IsChildOf(FStateTreeTaskCommonBase::StaticStruct());
+}
+
+bool UStratUnitStateTreeSchema::IsClassAllowed(const UClass* InClass) const
+{
+	return IsChildOfBlueprintBase(InClass);
+}
+
+bool UStratUnitStateTreeSchema::IsExternalItemAllowed(const UStruct& InStruct) const
+{
+	return InStruct.IsChildOf(UWorldSubsystem::StaticClass());
+}
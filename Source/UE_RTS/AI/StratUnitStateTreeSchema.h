@@ -0,0 +1,52 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StateTreeSchema.h"
+#include "Units/StratUnitTypes.h"
+#include "StratUnitStateTreeSchema.generated.h"
+
+class UStratUnitSimSubsystem;
+
+/** What a unit behavior runs for. Tasks bind to it to read the unit and order it through UnitSim. */
+USTRUCT(BlueprintType)
+struct FStratUnitAIContext
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=StratAI)
+	FStratUnitHandle Unit;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=StratAI)
+	TObjectPtr<UStratUnitSimSubsystem> UnitSim;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=StratAI)
+	uint8 Faction{0};
+};
+
+/**
+ * Schema for unit behaviors. Units are simulation rows, not actors, so a behavior gets the unit as context data instead of
+ * an actor, and world subsystems as external data.
+ */
+UCLASS(BlueprintType, EditInlineNew, CollapseCategories, meta=(DisplayName="Strat Unit", CommonSchema))
+class UE_RTS_API UStratUnitStateTreeSchema : public UStateTreeSchema
+{
+	GENERATED_BODY()
+
+public:
+	UStratUnitStateTreeSchema();
+
+	static const FName UnitContextName;
+
+	//~ Begin UStateTreeSchema interface
+	virtual bool IsStructAllowed(const UScriptStruct* InScriptStruct) const override;
+	virtual bool IsClassAllowed(const UClass* InClass) const override;
+	virtual bool IsExternalItemAllowed(const UStruct& InStruct) const override;
+	virtual TConstArrayView<FStateTreeExternalDataDesc> GetContextDataDescs() const override { return ContextDataDescs; }
+	//~ End UStateTreeSchema interface
+
+protected:
+	UPROPERTY()
+	TArray<FStateTreeExternalDataDesc> ContextDataDescs;
+};
@@ -0,0 +1,16 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratProjectileDefinition.h"
+
+#include "PhysicsEngine/PhysicsSettings.h"
+
+FStratProjectileTypeInfo UStratProjectileDefinition::MakeTypeInfo() const
+{
+	FStratProjectileTypeInfo Result;
+	Result.Speed = Speed;
+	Result.Gravity = GravityScale * UPhysicsSettings::Get()->DefaultGravityZ;
+	Result.HitRadius = HitRadius;
+	Result.Damage = Damage;
+	Result.MaxLifetime = MaxLifetime;
+	return Result;
+}
@@ -0,0 +1,60 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "StratProjectileDefinition.generated.h"
+
+class UMaterialInterface;
+class UStaticMesh;
+
+/** Read-only per type data for the projectile simulation. Flattened out of UStratProjectileDefinition so workers never touch UObjects. */
+struct FStratProjectileTypeInfo
+{
+	float Speed{6000.f};
+	float Gravity{0.f};
+	float HitRadius{10.f};
+	float Damage{10.f};
+	float MaxLifetime{5.f};
+};
+
+/** Designer facing description of a kind of projectile, like a rifle round, a tank shell or a rocket. */
+UCLASS(BlueprintType, meta=(PrioritizeCategories="User"))
+class UE_RTS_API UStratProjectileDefinition : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	FStratProjectileTypeInfo MakeTypeInfo() const;
+
+	/** Launch speed. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Options", meta=(ClampMin="1.0", Units="cm/s"))
+	float Speed{6000.f};
+
+	/** Multiplies the world's gravity. Zero flies straight, shells arc with one. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Options", meta=(ClampMin="0.0"))
+	float GravityScale{0.f};
+
+	/** Added to a unit's radius when testing for hits. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Options", meta=(ClampMin="0.0", Units="cm"))
+	float HitRadius{10.f};
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Options", meta=(ClampMin="0.0"))
+	float Damage{10.f};
+
+	/** Projectiles that hit nothing are dropped after this long. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Options", meta=(ClampMin="0.1", Units="s"))
+	float MaxLifetime{5.f};
+
+	/** Drawn as one instance per projectile, pointing along its flight. Every projectile of the type shares one component. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Presentation")
+	TSoftObjectPtr<UStaticMesh> Mesh;
+
+	/** Overrides the mesh's first material. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Presentation")
+	TSoftObjectPtr<UMaterialInterface> Material;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Presentation")
+	FVector MeshScale{FVector::OneVector};
+};
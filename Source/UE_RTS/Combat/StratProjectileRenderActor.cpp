@@ -0,0 +1,97 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratProjectileRenderActor.h"
+
+#include "StratProjectileDefinition.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Materials/MaterialInterface.h"
+
+AStratProjectileRenderActor::AStratProjectileRenderActor()
+{
+	PrimaryActorTick.bCanEverTick = false;
+	SetCanBeDamaged(false);
+
+	SceneRoot = CreateDefaultSubobject<USceneComponent>(TEXT("SceneRoot"));
+	SceneRoot->SetMobility(EComponentMobility::Movable);
+	RootComponent = SceneRoot;
+}
+
+void AStratProjectileRenderActor::InitTypes(const TConstArrayView<TObjectPtr<const UStratProjectileDefinition>> Definitions)
+{
+	TypeComps.SetNum(Definitions.Num());
+	for (int32 TypeId = 0; TypeId < Definitions.Num(); ++TypeId)
+	{
+		const UStratProjectileDefinition* Definition = Definitions[TypeId];
+		UStaticMesh* Mesh = Definition ? Definition->Mesh.LoadSynchronous() : nullptr;
+		if (!Mesh)
+		{
+			continue;
+		}
+
+		UInstancedStaticMeshComponent* Comp = NewObject<UInstancedStaticMeshComponent>(this, *FString::Printf(TEXT("ProjectilesComp_%d"), TypeId));
+		Comp->SetMobility(EComponentMobility::Movable);
+		Comp->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		Comp->SetGenerateOverlapEvents(false);
+		Comp->SetCanEverAffectNavigation(false);
+		Comp->SetCastShadow(false);
+		Comp->bReceivesDecals = false;
+		Comp->SetStaticMesh(Mesh);
+		if (UMaterialInterface* Material = Definition->Material.LoadSynchronous())
+		{
+			Comp->SetMaterial(0, Material);
+		}
+		Comp->SetupAttachment(SceneRoot);
+		Comp->RegisterComponent();
+		TypeComps[TypeId] = Comp;
+	}
+}
+
+void AStratProjectileRenderActor::UpdateInstances(const int32 TypeId, const TArray<FTransform>& Transforms)
+{
+	UInstancedStaticMeshComponent* Comp = TypeComps.IsValidIndex(TypeId) ? TypeComps[TypeId].Get() : nullptr;
+	if (!Comp)
+	{
+		return;
+	}
+
+	//~ The actor stays at the origin, so local space is world space and the component skips converting every transform.
+	const int32 NumOld = Comp->GetInstanceCount();
+	const int32 NumNew = Transforms.Num();
+	if (NumNew == 0)
+	{
+		if (NumOld > 0)
+		{
+			Comp->ClearInstances();
+		}
+		return;
+	}
+
+	if (NumNew < NumOld)
+	{
+		//~ Removing from the back never moves the instances that stay.
+		ToRemove.Reset();
+		for (int32 Index = NumOld - 1; Index >= NumNew; --Index)
+		{
+			ToRemove.Add(Index);
+		}
+		Comp->RemoveInstances(ToRemove, true);
+	}
+
+	//~ Projectiles are swap-removed, so an instance can show a different projectile than last frame. Teleport keeps motion
+	//~ blur from smearing between the two.
+	if (NumNew > NumOld)
+	{
+		Comp->AddInstances(TArray<FTransform>(&Transforms[NumOld], NumNew - NumOld), false, false, false);
+		if (NumOld > 0)
+		{
+			Comp->BatchUpdateInstancesTransforms(0, TArray<FTransform>(Transforms.GetData(), NumOld), false, false, true);
+		}
+	}
+	else
+	{
+		Comp->BatchUpdateInstancesTransforms(0, Transforms, false, false, true);
+	}
+
+	Comp->MarkRenderStateDirty();
+}
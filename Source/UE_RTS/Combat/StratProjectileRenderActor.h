@@ -0,0 +1,42 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "StratProjectileRenderActor.generated.h"
+
+class UInstancedStaticMeshComponent;
+class UStratProjectileDefinition;
+
+/**
+ * Local only. Draws every projectile as an instance of its type's instanced static mesh, so a volley of hundreds adds
+ * instances to a few components rather than an actor per projectile. Owned by UStratProjectileSubsystem.
+ */
+UCLASS(NotBlueprintable, NotPlaceable, Transient)
+class UE_RTS_API AStratProjectileRenderActor : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AStratProjectileRenderActor();
+
+	/** Adds a component per projectile type, indexed by type id. Types without a mesh get none and are never drawn. */
+	void InitTypes(TConstArrayView<TObjectPtr<const UStratProjectileDefinition>> Definitions);
+
+	/**
+	 * Makes the type's component show exactly Transforms, in world space. Existing instances are overwritten in place and only
+	 * the tail is added or removed, so a steady stream of projectiles never reallocates the instance buffer.
+	 */
+	void UpdateInstances(int32 TypeId, const TArray<FTransform>& Transforms);
+
+protected:
+	UPROPERTY(VisibleAnywhere, Category="User|Info")
+	TObjectPtr<USceneComponent> SceneRoot;
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UInstancedStaticMeshComponent>> TypeComps;
+
+	/** Scratch for removing the tail. */
+	TArray<int32> ToRemove;
+};
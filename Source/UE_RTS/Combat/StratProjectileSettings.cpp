@@ -0,0 +1,8 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratProjectileSettings.h"
+
+UStratProjectileSettings::UStratProjectileSettings()
+{
+	CategoryName = TEXT("Game");
+}
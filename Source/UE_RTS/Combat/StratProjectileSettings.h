@@ -0,0 +1,35 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "StratProjectileSettings.generated.h"
+
+class UStratProjectileDefinition;
+
+/** Project settings for projectiles. Found under Project Settings > Game > Strat Projectiles. */
+UCLASS(Config=Game, DefaultConfig, meta=(DisplayName="Strat Projectiles"))
+class UE_RTS_API UStratProjectileSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UStratProjectileSettings();
+
+	/** Every projectile type. The array index is the projectile's type id, so keep the order stable between server and clients. */
+	UPROPERTY(Config, EditAnywhere, Category="Projectiles")
+	TArray<TSoftObjectPtr<UStratProjectileDefinition>> ProjectileDefinitions;
+
+	/** Projectile slots allocated up front. Storage grows past this in a bigger fight and keeps the memory afterwards. */
+	UPROPERTY(Config, EditAnywhere, Category="Projectiles", meta=(ClampMin="0"))
+	int32 InitialCapacity{2048};
+
+	/** Projectiles per parallel task when integrating and testing hits. */
+	UPROPERTY(Config, EditAnywhere, Category="Projectiles", meta=(ClampMin="16"))
+	int32 ProjectilesPerTask{256};
+
+	/** Cell size of the unit grid hits are tested against. */
+	UPROPERTY(Config, EditAnywhere, Category="Projectiles", meta=(ClampMin="100.0", Units="cm"))
+	float GridCellSize{1000.f};
+};
@@ -0,0 +1,386 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratProjectileSubsystem.h"
+
+#include "StratProjectileRenderActor.h"
+#include "StratProjectileSettings.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "Events/StratEventBusSubsystem.h"
+#include "Faction/StratFactionSubsystem.h"
+#include "Memory/StratMemoryTags.h"
+#include "Units/StratUnitSimSubsystem.h"
+#include "World/StratTerrainSubsystem.h"
+
+DEFINE_LOG_CATEGORY(LogStratProjectiles);
+
+DECLARE_CYCLE_STAT(TEXT("Projectile Integrate"), STAT_StratProjectiles_Integrate, STATGROUP_StratUnits);
+DECLARE_CYCLE_STAT(TEXT("Projectile Impacts"), STAT_StratProjectiles_Impacts, STATGROUP_StratUnits);
+DECLARE_CYCLE_STAT(TEXT("Projectile Presentation"), STAT_StratProjectiles_Presentation, STATGROUP_StratUnits);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectiles"), STAT_StratProjectiles_Num, STATGROUP_StratUnits);
+
+namespace
+{
+	/** Launch velocity that lands on Delta away under Gravity. The low arc, since it arrives sooner. */
+	FVector3f ComputeLaunchVelocity(const FVector3f& Delta, const float Speed, const float Gravity)
+	{
+		const FVector2f Flat(Delta.X, Delta.Y);
+		const float Distance = Flat.Size();
+		if (Gravity >= 0.f || Distance < UE_KINDA_SMALL_NUMBER)
+		{
+			return Delta.GetSafeNormal() * Speed;
+		}
+
+		const float G = -Gravity;
+		const float SpeedSq = Speed * Speed;
+		const float Root = SpeedSq * SpeedSq - G * (G * Distance * Distance + 2.f * Delta.Z * SpeedSq);
+
+		//~ Out of reach. 45 degrees goes the farthest.
+		const float TanAngle = Root >= 0.f ? (SpeedSq - FMath::Sqrt(Root)) / (G * Distance) : 1.f;
+		const float Cos = 1.f / FMath::Sqrt(1.f + TanAngle * TanAngle);
+		const FVector2f Horizontal = Flat / Distance * (Cos * Speed);
+		return FVector3f(Horizontal.X, Horizontal.Y, TanAngle * Cos * Speed);
+	}
+}
+
+void UStratProjectileSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	LLM_SCOPE_BYTAG(StratUnits);
+
+	Super::Initialize(Collection);
+
+	UnitSim = Collection.InitializeDependency<UStratUnitSimSubsystem>();
+	Terrain = Collection.InitializeDependency<UStratTerrainSubsystem>();
+	Factions = Collection.InitializeDependency<UStratFactionSubsystem>();
+	EventBus = Collection.InitializeDependency<UStratEventBusSubsystem>();
+
+	if (UnitSim)
+	{
+		UnitSim->OnPostSimStep.AddUObject(this, &ThisClass::OnSimStepped);
+		UnitSim->OnSnapshotRead.AddUObject(this, &ThisClass::OnSnapshotRead);
+	}
+
+	const UStratProjectileSettings* Settings = GetDefault<UStratProjectileSettings>();
+	bPresentationEnabled = !IsRunningDedicatedServer();
+
+	//~ Meshes wait for the render actor, so dedicated servers never load them.
+	for (const TSoftObjectPtr<UStratProjectileDefinition>& SoftDefinition : Settings->ProjectileDefinitions)
+	{
+		const UStratProjectileDefinition* Definition = SoftDefinition.LoadSynchronous();
+		UE_CLOG(!Definition, LogStratProjectiles, Error, TEXT("Projectile definition %s failed to load. Its type id will fire default projectiles."), *SoftDefinition.ToString());
+
+		Definitions.Add(Definition);
+		TypeInfos.Add(Definition ? Definition->MakeTypeInfo() : FStratProjectileTypeInfo());
+	}
+	TypeTransforms.SetNum(TypeInfos.Num());
+
+	Projectiles.Reserve(Settings->InitialCapacity);
+	Impacts.Reserve(Settings->InitialCapacity);
+}
+
+void UStratProjectileSubsystem::Deinitialize()
+{
+	if (UnitSim)
+	{
+		UnitSim->OnPostSimStep.RemoveAll(this);
+		UnitSim->OnSnapshotRead.RemoveAll(this);
+	}
+
+	if (IsValid(RenderActor))
+	{
+		RenderActor->Destroy();
+	}
+	RenderActor = nullptr;
+
+	Projectiles.Empty();
+	Impacts.Empty();
+	TypeTransforms.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UStratProjectileSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UStratProjectileSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UStratProjectileSubsystem, STATGROUP_StratUnits);
+}
+
+SIZE_T UStratProjectileSubsystem::GetAllocatedSize() const
+{
+	SIZE_T Bytes = Projectiles.GetAllocatedSize() + Impacts.GetAllocatedSize() + Grid.GetAllocatedSize() + TypeInfos.GetAllocatedSize()
+		+ TypeTransforms.GetAllocatedSize();
+	for (const TArray<FTransform>& Transforms : TypeTransforms)
+	{
+		Bytes += Transforms.GetAllocatedSize();
+	}
+	return Bytes;
+}
+
+void UStratProjectileSubsystem::Fire(const uint16 TypeId, const FVector& Origin, const FVector& Velocity, const uint8 Faction, const FStratUnitHandle Instigator)
+{
+	checkSlow(IsInGameThread());
+	if (!TypeInfos.IsValidIndex(TypeId))
+	{
+		UE_LOG(LogStratProjectiles, Warning, TEXT("Projectile type %d isn't in Strat Projectiles settings. Nothing was fired."), TypeId);
+		return;
+	}
+
+	LLM_SCOPE_BYTAG(StratUnits);
+
+	Projectiles.Positions.Add(FVector3f(Origin));
+	Projectiles.Velocities.Add(FVector3f(Velocity));
+	Projectiles.Ages.Add(0.f);
+	Projectiles.EnemyMasks.Add(Factions->GetEnemyMask(Faction));
+	Projectiles.Instigators.Add(Instigator);
+	Projectiles.TypeIds.Add(TypeId);
+}
+
+bool UStratProjectileSubsystem::FireAtUnit(const uint16 TypeId, const FStratUnitHandle& Instigator, const FStratUnitHandle& Target)
+{
+	int32 Row;
+	const FStratUnitChunk* Chunk = UnitSim->FindUnit(Instigator, Row);
+	int32 TargetRow;
+	const FStratUnitChunk* TargetChunk = UnitSim->FindUnit(Target, TargetRow);
+	if (!Chunk || !TargetChunk || !TypeInfos.IsValidIndex(TypeId))
+	{
+		return false;
+	}
+
+	//~ Aim at the middle of the target's body, from the shooter's eyes.
+	const FVector3f Origin = Chunk->Positions[Row] + FVector3f(0.f, 0.f, UnitSim->GetTypeInfo(Chunk->TypeIds[Row]).EyeHeight);
+	const FVector3f Aim = TargetChunk->Positions[TargetRow] + FVector3f(0.f, 0.f, UnitSim->GetTypeInfo(TargetChunk->TypeIds[TargetRow]).EyeHeight * 0.5f);
+
+	const FStratProjectileTypeInfo& Type = TypeInfos[TypeId];
+	const FVector3f Velocity = ComputeLaunchVelocity(Aim - Origin, Type.Speed, Type.Gravity);
+	Fire(TypeId, FVector(Origin), FVector(Velocity), Chunk->Factions[Row], Instigator);
+	return true;
+}
+
+void UStratProjectileSubsystem::OnSimStepped(const float FixedDeltaTime)
+{
+	TimeSinceStep = 0.f;
+	StepDuration = FixedDeltaTime;
+
+	SET_DWORD_STAT(STAT_StratProjectiles_Num, Projectiles.Num());
+	if (Projectiles.Num() == 0)
+	{
+		return;
+	}
+
+	STRAT_SCOPED_SYSTEM_TIMING(Projectiles);
+	LLM_SCOPE_BYTAG(StratUnits);
+
+	Grid.Build(*UnitSim, GetDefault<UStratProjectileSettings>()->GridCellSize);
+	Integrate(FixedDeltaTime);
+	//~ Never in lockstep. Peers would disagree on what float paths hit.
+	ResolveImpacts(GetWorld()->GetNetMode() != NM_Client && !UnitSim->IsLockstep());
+}
+
+void UStratProjectileSubsystem::OnSnapshotRead()
+{
+	//~ Keeps the capacity. The render actor clears its instances on the next presentation update.
+	Projectiles.Reset();
+	Impacts.Reset();
+}
+
+void UStratProjectileSubsystem::Integrate(const float FixedDeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_StratProjectiles_Integrate);
+
+	const int32 NumProjectiles = Projectiles.Num();
+	Impacts.SetNumUninitialized(NumProjectiles);
+
+	const FStratHeightGrid* Heights = Terrain && Terrain->GetHeightGrid().IsValid() ? &Terrain->GetHeightGrid() : nullptr;
+	const int32 PerTask = GetDefault<UStratProjectileSettings>()->ProjectilesPerTask;
+	const int32 NumTasks = FMath::DivideAndRoundUp(NumProjectiles, PerTask);
+
+	//~ Each row only writes its own columns and impact, so the result doesn't depend on scheduling.
+	ParallelFor(NumTasks, [this, Heights, PerTask, NumProjectiles, FixedDeltaTime](const int32 TaskIndex)
+	{
+		const int32 End = FMath::Min((TaskIndex + 1) * PerTask, NumProjectiles);
+		for (int32 Row = TaskIndex * PerTask; Row < End; ++Row)
+		{
+			const FStratProjectileTypeInfo& Type = TypeInfos[Projectiles.TypeIds[Row]];
+			FVector3f& Velocity = Projectiles.Velocities[Row];
+			FVector3f& Position = Projectiles.Positions[Row];
+
+			const FVector3f Start = Position;
+			Velocity.Z += Type.Gravity * FixedDeltaTime;
+			Position += Velocity * FixedDeltaTime;
+			Projectiles.Ages[Row] += FixedDeltaTime;
+
+			FImpact& Impact = Impacts[Row];
+			Impact = FImpact();
+
+			//~ Swept against each unit as an upright cylinder, so fast rounds can't skip past a unit between steps. The
+			//~ earliest hit along the path wins, ties go to grid order.
+			const FVector2D Start2D(Start.X, Start.Y);
+			const FVector2D End2D(Position.X, Position.Y);
+			const FVector2f Path(Position.X - Start.X, Position.Y - Start.Y);
+			const float PathLengthSq = Path.SizeSquared();
+			const uint64 EnemyMask = Projectiles.EnemyMasks[Row];
+			const FStratUnitHandle Instigator = Projectiles.Instigators[Row];
+
+			float FirstHit = 2.f;
+			FBox2D PathBox(ForceInit);
+			PathBox += Start2D;
+			PathBox += End2D;
+			Grid.ForEachInBox(PathBox.ExpandBy(Grid.MaxRadius + Type.HitRadius), [&](const FStratUnitGrid::FEntry& Entry)
+			{
+				if ((EnemyMask & StratFaction::Bit(Entry.Faction)) == 0 || Entry.Unit == Instigator)
+				{
+					return;
+				}
+
+				const FVector2f ToUnit(Entry.Position.X - Start.X, Entry.Position.Y - Start.Y);
+				const float Alpha = PathLengthSq > UE_KINDA_SMALL_NUMBER ? FMath::Clamp((ToUnit | Path) / PathLengthSq, 0.f, 1.f) : 0.f;
+				if (Alpha >= FirstHit || (ToUnit - Path * Alpha).SizeSquared() > FMath::Square(Entry.Radius + Type.HitRadius))
+				{
+					return;
+				}
+
+				//~ EyeHeight stands in for the unit's height.
+				const float Z = Start.Z + (Position.Z - Start.Z) * Alpha;
+				if (Z < Entry.Position.Z - Type.HitRadius || Z > Entry.Position.Z + Entry.Height + Type.HitRadius)
+				{
+					return;
+				}
+
+				FirstHit = Alpha;
+				Impact.Outcome = EOutcome::HitUnit;
+				Impact.Unit = Entry.Unit;
+				Impact.Location = Start + (Position - Start) * Alpha;
+			});
+
+			if (Impact.Outcome != EOutcome::Flying)
+			{
+				continue;
+			}
+
+			//~ Only the end of the step is tested. A round clipping a ridge between two samples flies on through it.
+			if (Heights)
+			{
+				const float Ground = Heights->SampleHeight(End2D);
+				if (Position.Z <= Ground)
+				{
+					Impact.Outcome = EOutcome::HitGround;
+					Impact.Location = FVector3f(Position.X, Position.Y, Ground);
+					continue;
+				}
+			}
+
+			if (Projectiles.Ages[Row] >= Type.MaxLifetime)
+			{
+				Impact.Outcome = EOutcome::Expired;
+			}
+		}
+	});
+}
+
+void UStratProjectileSubsystem::ResolveImpacts(const bool bApplyDamage)
+{
+	SCOPE_CYCLE_COUNTER(STAT_StratProjectiles_Impacts);
+
+	//~ From the back, so the row swapped into a removed one was already resolved. Same order on every peer.
+	for (int32 Row = Projectiles.Num() - 1; Row >= 0; --Row)
+	{
+		const FImpact& Impact = Impacts[Row];
+		if (Impact.Outcome == EOutcome::Flying)
+		{
+			continue;
+		}
+
+		if (Impact.Outcome != EOutcome::Expired)
+		{
+			const uint16 TypeId = Projectiles.TypeIds[Row];
+			if (Impact.Outcome == EOutcome::HitUnit && bApplyDamage)
+			{
+				//~ Units can die earlier in this loop. Later rounds at them just stop.
+				UnitSim->ApplyDamage(Impact.Unit, TypeInfos[TypeId].Damage);
+			}
+
+			if (EventBus)
+			{
+				FStratProjectileImpactEvent Event;
+				Event.Location = Impact.Location;
+				Event.HitUnit = Impact.Unit;
+				Event.ProjectileType = TypeId;
+				EventBus->Raise(Event);
+			}
+		}
+
+		Projectiles.RemoveAtSwap(Row);
+	}
+}
+
+void UStratProjectileSubsystem::Tick(const float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TimeSinceStep += DeltaTime;
+	if (bPresentationEnabled)
+	{
+		UpdatePresentation();
+	}
+}
+
+void UStratProjectileSubsystem::UpdatePresentation()
+{
+	//~ Nothing was ever fired, so there's no actor to clear either.
+	if (Projectiles.Num() == 0 && !RenderActor)
+	{
+		return;
+	}
+
+	AStratProjectileRenderActor* Actor = GetOrSpawnRenderActor();
+	if (!Actor)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_StratProjectiles_Presentation);
+	LLM_SCOPE_BYTAG(StratUnits);
+
+	for (TArray<FTransform>& Transforms : TypeTransforms)
+	{
+		Transforms.Reset();
+	}
+
+	//~ Never past the next step, which will have moved them for real.
+	const float Extrapolate = FMath::Min(TimeSinceStep, StepDuration);
+	for (int32 Row = 0; Row < Projectiles.Num(); ++Row)
+	{
+		const FVector3f& Velocity = Projectiles.Velocities[Row];
+		const FVector Location(Projectiles.Positions[Row] + Velocity * Extrapolate);
+		const uint16 TypeId = Projectiles.TypeIds[Row];
+		TypeTransforms[TypeId].Emplace(FVector(Velocity).ToOrientationQuat(), Location, Definitions[TypeId] ? Definitions[TypeId]->MeshScale : FVector::OneVector);
+	}
+
+	for (int32 TypeId = 0; TypeId < TypeTransforms.Num(); ++TypeId)
+	{
+		Actor->UpdateInstances(TypeId, TypeTransforms[TypeId]);
+	}
+}
+
+AStratProjectileRenderActor* UStratProjectileSubsystem::GetOrSpawnRenderActor()
+{
+	if (IsValid(RenderActor))
+	{
+		return RenderActor;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+
+	RenderActor = GetWorld()->SpawnActor<AStratProjectileRenderActor>(FTransform::Identity, SpawnParams);
+	if (RenderActor)
+	{
+		RenderActor->InitTypes(Definitions);
+	}
+	return RenderActor;
+}
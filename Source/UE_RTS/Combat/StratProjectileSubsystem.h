@@ -0,0 +1,189 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StratProjectileDefinition.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Units/StratUnitGrid.h"
+#include "Units/StratUnitTypes.h"
+#include "StratProjectileSubsystem.generated.h"
+
+class AStratProjectileRenderActor;
+class UStratEventBusSubsystem;
+class UStratFactionSubsystem;
+class UStratTerrainSubsystem;
+class UStratUnitSimSubsystem;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogStratProjectiles, Log, All);
+
+/**
+ * Projectiles as rows of flat arrays, not actors. Firing appends a row and an impact swap-removes it, so a fight never
+ * spawns, destroys or garbage collects anything once the arrays have grown.
+ *
+ * Every sim step projectiles move in parallel tasks, each testing its path against an FStratUnitGrid of every unit and
+ * against the terrain height grid. Only enemies of the firing faction are hit. Impacts are then resolved serially in row
+ * order, raising FStratProjectileImpactEvent and applying damage. Damage is authority only. Flight is float math that
+ * differs across CPUs and compilers, so in lockstep projectiles are cosmetic on every peer, like on replicated clients,
+ * and damage is left to integer code in the simulation. Cosmetic projectiles stop where they hit.
+ *
+ * Projectiles aren't saved. Loads and replay seeks clear the ones in flight, which no longer match the restored units.
+ *
+ * Presentation is one instanced static mesh per projectile type on AStratProjectileRenderActor, rewritten every frame from
+ * the arrays, extrapolated past the last step so bullets don't move at the sim rate.
+ */
+UCLASS()
+class UE_RTS_API UStratProjectileSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	//~ Begin UTickableWorldSubsystem interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~ End UTickableWorldSubsystem interface
+
+	/** Launches a projectile. Velocity is in cm/s, the type's Speed isn't applied. Game thread only. */
+	void Fire(uint16 TypeId, const FVector& Origin, const FVector& Velocity, uint8 Faction, FStratUnitHandle Instigator = FStratUnitHandle());
+
+	/**
+	 * Fires from the instigator's eyes at where the target stands now, at the type's Speed. Arcing types take the low arc,
+	 * or 45 degrees when the target is out of reach. False if either unit is gone.
+	 */
+	bool FireAtUnit(uint16 TypeId, const FStratUnitHandle& Instigator, const FStratUnitHandle& Target);
+
+	int32 GetNumProjectiles() const { return Projectiles.Num(); }
+
+	SIZE_T GetAllocatedSize() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void OnSimStepped(float FixedDeltaTime);
+	void OnSnapshotRead();
+
+	/** Moves every projectile and writes what each one hit to Impacts. Parallel, only reads the grids. */
+	void Integrate(float FixedDeltaTime);
+
+	/** Applies Impacts and removes finished projectiles. */
+	void ResolveImpacts(bool bApplyDamage);
+
+	void UpdatePresentation();
+	AStratProjectileRenderActor* GetOrSpawnRenderActor();
+
+	/** One column per field, a row per projectile. Rows are unordered, removal swaps the last row in. */
+	struct FProjectiles
+	{
+		int32 Num() const { return Positions.Num(); }
+
+		void Reserve(const int32 Capacity)
+		{
+			Positions.Reserve(Capacity);
+			Velocities.Reserve(Capacity);
+			Ages.Reserve(Capacity);
+			EnemyMasks.Reserve(Capacity);
+			Instigators.Reserve(Capacity);
+			TypeIds.Reserve(Capacity);
+		}
+
+		void RemoveAtSwap(const int32 Row)
+		{
+			Positions.RemoveAtSwap(Row, EAllowShrinking::No);
+			Velocities.RemoveAtSwap(Row, EAllowShrinking::No);
+			Ages.RemoveAtSwap(Row, EAllowShrinking::No);
+			EnemyMasks.RemoveAtSwap(Row, EAllowShrinking::No);
+			Instigators.RemoveAtSwap(Row, EAllowShrinking::No);
+			TypeIds.RemoveAtSwap(Row, EAllowShrinking::No);
+		}
+
+		void Reset()
+		{
+			Positions.Reset();
+			Velocities.Reset();
+			Ages.Reset();
+			EnemyMasks.Reset();
+			Instigators.Reset();
+			TypeIds.Reset();
+		}
+
+		void Empty()
+		{
+			Positions.Empty();
+			Velocities.Empty();
+			Ages.Empty();
+			EnemyMasks.Empty();
+			Instigators.Empty();
+			TypeIds.Empty();
+		}
+
+		SIZE_T GetAllocatedSize() const
+		{
+			return Positions.GetAllocatedSize() + Velocities.GetAllocatedSize() + Ages.GetAllocatedSize() + EnemyMasks.GetAllocatedSize()
+				+ Instigators.GetAllocatedSize() + TypeIds.GetAllocatedSize();
+		}
+
+		TArray<FVector3f> Positions;
+		TArray<FVector3f> Velocities;
+		TArray<float> Ages;
+
+		/** Factions the projectile can hit, fixed when fired. */
+		TArray<uint64> EnemyMasks;
+		TArray<FStratUnitHandle> Instigators;
+		TArray<uint16> TypeIds;
+	};
+
+	enum class EOutcome : uint8
+	{
+		Flying,
+		HitUnit,
+		HitGround,
+		Expired,
+	};
+
+	struct FImpact
+	{
+		FVector3f Location{FVector3f::ZeroVector};
+		FStratUnitHandle Unit;
+		EOutcome Outcome{EOutcome::Flying};
+	};
+
+	FProjectiles Projectiles;
+
+	/** Per row, written by Integrate. */
+	TArray<FImpact> Impacts;
+
+	FStratUnitGrid Grid;
+	TArray<FStratProjectileTypeInfo> TypeInfos;
+
+	/** Presentation scratch, one transform list per type. */
+	TArray<TArray<FTransform>> TypeTransforms;
+
+	/** Real time since the last step, for extrapolating presentation. */
+	float TimeSinceStep{0.f};
+	float StepDuration{0.f};
+
+	bool bPresentationEnabled{false};
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<const UStratProjectileDefinition>> Definitions;
+
+	UPROPERTY(Transient)
+	TObjectPtr<AStratProjectileRenderActor> RenderActor;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratUnitSimSubsystem> UnitSim;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratTerrainSubsystem> Terrain;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratFactionSubsystem> Factions;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratEventBusSubsystem> EventBus;
+};
@@ -0,0 +1,8 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratTargetingSettings.h"
+
+UStratTargetingSettings::UStratTargetingSettings()
+{
+	CategoryName = TEXT("Game");
+}
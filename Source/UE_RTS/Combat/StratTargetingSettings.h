@@ -0,0 +1,33 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "StratTargetingSettings.generated.h"
+
+/** Project settings for automatic target acquisition. Found under Project Settings > Game > Strat Targeting. */
+UCLASS(Config=Game, DefaultConfig, meta=(DisplayName="Strat Targeting"))
+class UE_RTS_API UStratTargetingSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UStratTargetingSettings();
+
+	/** Off leaves every unit waiting for orders, whatever its AcquireRange. */
+	UPROPERTY(Config, EditAnywhere, Category="Targeting")
+	bool bAutoAcquire{true};
+
+	/** Each unit looks for a target once every this many sim steps, spread so each step handles an even share. 1 looks every step. */
+	UPROPERTY(Config, EditAnywhere, Category="Targeting", meta=(ClampMin="1", UIMax="8"))
+	int32 StaggerSteps{2};
+
+	/** Cell size of the grid candidates are gathered from. Around the common AcquireRange keeps each search to a few cells. */
+	UPROPERTY(Config, EditAnywhere, Category="Targeting", meta=(ClampMin="100.0", Units="cm"))
+	float GridCellSize{1500.f};
+
+	/** Searching units per parallel task. */
+	UPROPERTY(Config, EditAnywhere, Category="Targeting", meta=(ClampMin="1"))
+	int32 SeekersPerTask{64};
+};
@@ -0,0 +1,269 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratTargetingSubsystem.h"
+
+#include "StratTargetingSettings.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "Faction/StratFactionSubsystem.h"
+#include "Math/VectorRegister.h"
+#include "Memory/StratMemoryTags.h"
+#include "Units/StratUnitSimSubsystem.h"
+
+DEFINE_LOG_CATEGORY(LogStratTargeting);
+
+DECLARE_CYCLE_STAT(TEXT("Targeting Grid"), STAT_StratTargeting_Grid, STATGROUP_StratUnits);
+DECLARE_CYCLE_STAT(TEXT("Targeting Search"), STAT_StratTargeting_Search, STATGROUP_StratUnits);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Targeting Seekers"), STAT_StratTargeting_Seekers, STATGROUP_StratUnits);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Targets Acquired"), STAT_StratTargeting_Acquired, STATGROUP_StratUnits);
+
+namespace
+{
+	/** Pads candidate columns. Far enough to never win, near enough that its square stays finite. */
+	constexpr float PaddingCoordinate = 1.0e18f;
+
+	/**
+	 * Index of the nearest candidate closer than MaxDistSq, or INDEX_NONE. Measures four candidates per iteration. A batch with
+	 * nothing closer than the best so far costs one compare, only batches that improve on it are read lane by lane. Ties keep
+	 * the earlier candidate.
+	 */
+	int32 FindNearest(const FVector3f& From, const float* X, const float* Y, const float* Z, const int32 NumPadded, const float MaxDistSq)
+	{
+		const VectorRegister4Float FromX = VectorSetFloat1(From.X);
+		const VectorRegister4Float FromY = VectorSetFloat1(From.Y);
+		const VectorRegister4Float FromZ = VectorSetFloat1(From.Z);
+
+		float BestDistSq = MaxDistSq;
+		VectorRegister4Float Best = VectorSetFloat1(BestDistSq);
+		int32 BestIndex = INDEX_NONE;
+		for (int32 Index = 0; Index < NumPadded; Index += 4)
+		{
+			const VectorRegister4Float DX = VectorSubtract(VectorLoadAligned(X + Index), FromX);
+			const VectorRegister4Float DY = VectorSubtract(VectorLoadAligned(Y + Index), FromY);
+			const VectorRegister4Float DZ = VectorSubtract(VectorLoadAligned(Z + Index), FromZ);
+
+			//~ No fused multiply-add. It rounds differently per platform, and lockstep peers must pick the same target.
+			const VectorRegister4Float DistSq = VectorAdd(VectorAdd(VectorMultiply(DX, DX), VectorMultiply(DY, DY)), VectorMultiply(DZ, DZ));
+			if (VectorMaskBits(VectorCompareLT(DistSq, Best)) == 0)
+			{
+				continue;
+			}
+
+			alignas(16) float Lanes[4];
+			VectorStoreAligned(DistSq, Lanes);
+			for (int32 Lane = 0; Lane < 4; ++Lane)
+			{
+				if (Lanes[Lane] < BestDistSq)
+				{
+					BestDistSq = Lanes[Lane];
+					BestIndex = Index + Lane;
+				}
+			}
+			Best = VectorSetFloat1(BestDistSq);
+		}
+		return BestIndex;
+	}
+}
+
+void UStratTargetingSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UnitSim = Collection.InitializeDependency<UStratUnitSimSubsystem>();
+	Factions = Collection.InitializeDependency<UStratFactionSubsystem>();
+
+	if (UnitSim)
+	{
+		UnitSim->OnPostSimStep.AddUObject(this, &ThisClass::OnSimStepped);
+	}
+}
+
+void UStratTargetingSubsystem::Deinitialize()
+{
+	if (UnitSim)
+	{
+		UnitSim->OnPostSimStep.RemoveAll(this);
+	}
+
+	Seekers.Empty();
+	Targets.Empty();
+	Acquired.Empty();
+	TaskCandidates.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UStratTargetingSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+SIZE_T UStratTargetingSubsystem::GetAllocatedSize() const
+{
+	SIZE_T Bytes = Grid.GetAllocatedSize() + Seekers.GetAllocatedSize() + Targets.GetAllocatedSize() + Acquired.GetAllocatedSize() + TaskCandidates.GetAllocatedSize();
+	for (const FCandidates& Candidates : TaskCandidates)
+	{
+		Bytes += Candidates.GetAllocatedSize();
+	}
+	return Bytes;
+}
+
+void UStratTargetingSubsystem::OnSimStepped(const float FixedDeltaTime)
+{
+	if (!GetDefault<UStratTargetingSettings>()->bAutoAcquire || (GetWorld()->GetNetMode() == NM_Client && !UnitSim->IsLockstep()))
+	{
+		return;
+	}
+
+	STRAT_SCOPED_SYSTEM_TIMING(Targeting);
+	LLM_SCOPE_BYTAG(StratUnits);
+
+	GatherSeekers();
+	SET_DWORD_STAT(STAT_StratTargeting_Seekers, Seekers.Num());
+	if (Seekers.IsEmpty())
+	{
+		SET_DWORD_STAT(STAT_StratTargeting_Acquired, 0);
+		return;
+	}
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_StratTargeting_Grid);
+		Grid.Build(*UnitSim, GetDefault<UStratTargetingSettings>()->GridCellSize);
+	}
+
+	FindTargets();
+	ApplyTargets();
+
+	SET_DWORD_STAT(STAT_StratTargeting_Acquired, Acquired.Num());
+	UE_LOG(LogStratTargeting, VeryVerbose, TEXT("Step %u: %d units searched, %d found a target."), UnitSim->GetSimFrame(), Seekers.Num(), Acquired.Num());
+}
+
+void UStratTargetingSubsystem::GatherSeekers()
+{
+	Seekers.Reset();
+
+	//~ Slot indices are dense, so taking one residue per step splits the units evenly. The sim frame is the same on every peer.
+	const uint32 StaggerSteps = static_cast<uint32>(FMath::Max(1, GetDefault<UStratTargetingSettings>()->StaggerSteps));
+	const uint32 Phase = UnitSim->GetSimFrame() % StaggerSteps;
+
+	const TConstArrayView<FStratUnitTypeInfo> Types = UnitSim->GetTypeInfos();
+	UnitSim->ForEachChunk([this, Types, StaggerSteps, Phase](const FStratUnitChunk& Chunk)
+	{
+		for (int32 Row = 0; Row < Chunk.Num; ++Row)
+		{
+			const float Range = Types[Chunk.TypeIds[Row]].AcquireRange;
+			const EStratUnitOrderType OrderType = Chunk.Orders[Row].Type;
+			if (Range <= 0.f || (OrderType != EStratUnitOrderType::None && OrderType != EStratUnitOrderType::Hold))
+			{
+				continue;
+			}
+
+			//~ Just finished an order. Queued orders and flight legs start from it first, the unit can search next step.
+			if (EnumHasAnyFlags(Chunk.Flags[Row], EStratUnitFlags::OrderCompleted))
+			{
+				continue;
+			}
+
+			if (static_cast<uint32>(Chunk.Handles[Row].GetIndex()) % StaggerSteps != Phase)
+			{
+				continue;
+			}
+
+			const uint64 EnemyMask = Factions->GetEnemyMask(Chunk.Factions[Row]);
+			if (EnemyMask != 0)
+			{
+				Seekers.Add({Chunk.Handles[Row], Chunk.Positions[Row], Range, EnemyMask});
+			}
+		}
+	});
+}
+
+void UStratTargetingSubsystem::FindTargets()
+{
+	SCOPE_CYCLE_COUNTER(STAT_StratTargeting_Search);
+
+	const int32 SeekersPerTask = FMath::Max(1, GetDefault<UStratTargetingSettings>()->SeekersPerTask);
+	const int32 NumTasks = FMath::DivideAndRoundUp(Seekers.Num(), SeekersPerTask);
+	if (TaskCandidates.Num() < NumTasks)
+	{
+		TaskCandidates.SetNum(NumTasks);
+	}
+	Targets.SetNumUninitialized(Seekers.Num());
+
+	//~ Every task only reads the grid and writes its own seekers' slots in Targets, so the result doesn't depend on scheduling.
+	const TConstArrayView<FStratUnitTypeInfo> Types = UnitSim->GetTypeInfos();
+	ParallelFor(NumTasks, [this, Types, SeekersPerTask](const int32 TaskIndex)
+	{
+		FCandidates& Candidates = TaskCandidates[TaskIndex];
+		const int32 End = FMath::Min((TaskIndex + 1) * SeekersPerTask, Seekers.Num());
+		for (int32 SeekerIndex = TaskIndex * SeekersPerTask; SeekerIndex < End; ++SeekerIndex)
+		{
+			const FSeeker& Seeker = Seekers[SeekerIndex];
+			const FVector2D Center(Seeker.Position.X, Seeker.Position.Y);
+
+			Candidates.Reset();
+			Grid.ForEachInBox(FBox2D(Center, Center).ExpandBy(Seeker.Range), [&Candidates, &Seeker, Types](const FStratUnitGrid::FEntry& Entry)
+			{
+				if ((Seeker.EnemyMask & StratFaction::Bit(Entry.Faction)) == 0 || !StratActions::HasAction(Types[Entry.TypeId].TargetActions, EStratUnitAction::Attack))
+				{
+					return;
+				}
+
+				Candidates.X.Add(Entry.Position.X);
+				Candidates.Y.Add(Entry.Position.Y);
+				Candidates.Z.Add(Entry.Position.Z);
+				Candidates.Units.Add(Entry.Unit);
+			});
+
+			const int32 NumCandidates = Candidates.Units.Num();
+			const int32 NumPadded = Align(NumCandidates, 4);
+			for (int32 Pad = NumCandidates; Pad < NumPadded; ++Pad)
+			{
+				Candidates.X.Add(PaddingCoordinate);
+				Candidates.Y.Add(PaddingCoordinate);
+				Candidates.Z.Add(PaddingCoordinate);
+			}
+
+			const int32 Nearest = FindNearest(Seeker.Position, Candidates.X.GetData(), Candidates.Y.GetData(), Candidates.Z.GetData(), NumPadded, FMath::Square(Seeker.Range));
+			Targets[SeekerIndex] = Nearest != INDEX_NONE ? Candidates.Units[Nearest] : FStratUnitHandle();
+		}
+	});
+}
+
+void UStratTargetingSubsystem::ApplyTargets()
+{
+	Acquired.Reset();
+	for (int32 Index = 0; Index < Seekers.Num(); ++Index)
+	{
+		const FStratUnitHandle Unit = Seekers[Index].Unit;
+		int32 Row;
+		FStratUnitChunk* Chunk = UnitSim->FindUnit(Unit, Row);
+		if (!Chunk)
+		{
+			continue;
+		}
+
+		const FStratUnitHandle Target = Targets[Index];
+		if (!Target.IsValid())
+		{
+			EnumRemoveFlags(Chunk->Flags[Row], EStratUnitFlags::InCombat);
+			continue;
+		}
+
+		EnumAddFlags(Chunk->Flags[Row], EStratUnitFlags::InCombat);
+		if (Chunk->Orders[Row].Type == EStratUnitOrderType::None)
+		{
+			//~ The order system fills in the target's position at the start of the next step.
+			FStratUnitOrder Order;
+			Order.Type = EStratUnitOrderType::Attack;
+			Order.TargetUnit = Target;
+			UnitSim->SetCurrentOrder(Unit, Order);
+		}
+		Acquired.Add({Unit, Target});
+	}
+
+	if (!Acquired.IsEmpty())
+	{
+		OnTargetsAcquired.Broadcast(Acquired);
+	}
+}
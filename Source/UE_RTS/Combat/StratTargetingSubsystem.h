@@ -0,0 +1,105 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Units/StratUnitGrid.h"
+#include "Units/StratUnitTypes.h"
+#include "StratTargetingSubsystem.generated.h"
+
+class UStratFactionSubsystem;
+class UStratUnitSimSubsystem;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogStratTargeting, Log, All);
+
+/** A unit and the enemy it picked. */
+struct FStratTargetResult
+{
+	FStratUnitHandle Unit;
+	FStratUnitHandle Target;
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnStratTargetsAcquired, TConstArrayView<FStratTargetResult> /*Results*/);
+
+/**
+ * Finds targets for units that have none, all of them in one batch per sim step instead of an overlap per unit.
+ *
+ * Every step it gathers the idle and holding units with an AcquireRange, buckets all units into an FStratUnitGrid once, and
+ * for each searching unit copies the hostile candidates near it into flat arrays. A SIMD kernel then measures four candidates
+ * at a time and keeps the nearest. Searching units run in parallel tasks since they only read the grid. Idle units are
+ * ordered to attack what they found, holding units keep holding and only get InCombat.
+ *
+ * Runs on the authority, or on every peer in lockstep. Positions there are rewritten from fixed point every step, and the
+ * kernel is plain subtract, multiply and add with ties going to grid order, so every peer picks the same targets.
+ */
+UCLASS()
+class UE_RTS_API UStratTargetingSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	/** Targets found this step, after the orders were given. Empty steps aren't broadcast. */
+	FOnStratTargetsAcquired OnTargetsAcquired;
+
+	SIZE_T GetAllocatedSize() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void OnSimStepped(float FixedDeltaTime);
+
+	/** Units searching this step. */
+	void GatherSeekers();
+
+	/** Nearest target per seeker, written to Targets at the seeker's index. */
+	void FindTargets();
+
+	void ApplyTargets();
+
+	struct FSeeker
+	{
+		FStratUnitHandle Unit;
+		FVector3f Position{FVector3f::ZeroVector};
+		float Range{0.f};
+		uint64 EnemyMask{0};
+	};
+
+	/** One task's candidates, a column per axis so the kernel loads four at once. Padded to a multiple of four. */
+	struct FCandidates
+	{
+		void Reset()
+		{
+			X.Reset();
+			Y.Reset();
+			Z.Reset();
+			Units.Reset();
+		}
+
+		SIZE_T GetAllocatedSize() const { return X.GetAllocatedSize() * 3 + Units.GetAllocatedSize(); }
+
+		TArray<float, TAlignedHeapAllocator<16>> X;
+		TArray<float, TAlignedHeapAllocator<16>> Y;
+		TArray<float, TAlignedHeapAllocator<16>> Z;
+		TArray<FStratUnitHandle> Units;
+	};
+
+	FStratUnitGrid Grid;
+	TArray<FSeeker> Seekers;
+	TArray<FStratUnitHandle> Targets;
+	TArray<FStratTargetResult> Acquired;
+
+	/** Scratch per task, kept so searching doesn't allocate once warm. */
+	TArray<FCandidates> TaskCandidates;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratUnitSimSubsystem> UnitSim;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratFactionSubsystem> Factions;
+};
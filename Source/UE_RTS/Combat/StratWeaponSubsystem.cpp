@@ -0,0 +1,148 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratWeaponSubsystem.h"
+
+#include "StratProjectileDefinition.h"
+#include "StratProjectileSettings.h"
+#include "StratProjectileSubsystem.h"
+#include "Engine/World.h"
+#include "Faction/StratFactionSubsystem.h"
+#include "Units/StratUnitDefinition.h"
+#include "Units/StratUnitSettings.h"
+#include "Units/StratUnitSimSubsystem.h"
+
+DEFINE_LOG_CATEGORY(LogStratWeapons);
+
+DECLARE_CYCLE_STAT(TEXT("Weapons"), STAT_StratWeapons, STATGROUP_StratUnits);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Weapon Shots"), STAT_StratWeapons_Shots, STATGROUP_StratUnits);
+
+void UStratWeaponSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UnitSim = Collection.InitializeDependency<UStratUnitSimSubsystem>();
+	Projectiles = Collection.InitializeDependency<UStratProjectileSubsystem>();
+	Factions = Collection.InitializeDependency<UStratFactionSubsystem>();
+	if (!UnitSim)
+	{
+		return;
+	}
+	UnitSim->OnPostSimStep.AddUObject(this, &ThisClass::OnSimStepped);
+
+	const TArray<TSoftObjectPtr<UStratProjectileDefinition>>& ProjectileDefinitions = GetDefault<UStratProjectileSettings>()->ProjectileDefinitions;
+	const int32 SimTickRate = FMath::Max(GetDefault<UStratUnitSettings>()->SimTickRate, 1);
+	for (int32 TypeId = 0; TypeId < UnitSim->GetTypeInfos().Num(); ++TypeId)
+	{
+		FWeaponInfo& Weapon = Weapons.AddDefaulted_GetRef();
+		const UStratUnitDefinition* Definition = UnitSim->GetDefinition(static_cast<uint16>(TypeId));
+		if (!Definition || Definition->Projectile.IsNull())
+		{
+			continue;
+		}
+
+		Weapon.ProjectileType = ProjectileDefinitions.IndexOfByKey(Definition->Projectile);
+		const UStratProjectileDefinition* Projectile = Definition->Projectile.LoadSynchronous();
+		if (Weapon.ProjectileType == INDEX_NONE || !Projectile)
+		{
+			UE_LOG(LogStratWeapons, Error, TEXT("%s fires %s, which isn't in Strat Projectiles settings. It won't fire."), *Definition->GetName(), *Definition->Projectile.ToString());
+			Weapon.ProjectileType = INDEX_NONE;
+			continue;
+		}
+
+		//~ Same reach the movement system stops attackers at.
+		const FStratUnitTypeInfo& Type = UnitSim->GetTypeInfo(static_cast<uint16>(TypeId));
+		Weapon.Damage = Projectile->Damage;
+		Weapon.Range = FMath::Max(Type.Radius * 2.f, Type.AttackRange);
+		Weapon.FixedRange = FStratFixed::FromFloat(Weapon.Range);
+		Weapon.IntervalSteps = static_cast<uint32>(FMath::Max(1, FMath::RoundToInt32(Definition->FireInterval * SimTickRate)));
+	}
+}
+
+void UStratWeaponSubsystem::Deinitialize()
+{
+	if (UnitSim)
+	{
+		UnitSim->OnPostSimStep.RemoveAll(this);
+	}
+	Weapons.Empty();
+	Shots.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UStratWeaponSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UStratWeaponSubsystem::OnSimStepped(const float FixedDeltaTime)
+{
+	//~ Replicated clients don't know orders. Their rounds would be guesses.
+	const bool bLockstep = UnitSim->IsLockstep();
+	if (GetWorld()->GetNetMode() == NM_Client && !bLockstep)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_StratWeapons);
+
+	const uint32 SimFrame = UnitSim->GetSimFrame();
+	Shots.Reset();
+	UnitSim->ForEachChunk([this, bLockstep, SimFrame](const FStratUnitChunk& Chunk)
+	{
+		const bool bIsFlying = Chunk.Archetype == EStratUnitArchetype::Flying;
+		for (int32 Row = 0; Row < Chunk.Num; ++Row)
+		{
+			const FStratUnitOrder& Order = Chunk.Orders[Row];
+			const FWeaponInfo& Weapon = Weapons[Chunk.TypeIds[Row]];
+			const FStratUnitHandle Unit = Chunk.Handles[Row];
+			if (Order.Type != EStratUnitOrderType::Attack || Weapon.ProjectileType == INDEX_NONE || (SimFrame + Unit.GetValue()) % Weapon.IntervalSteps != 0)
+			{
+				continue;
+			}
+
+			int32 TargetRow;
+			const FStratUnitChunk* TargetChunk = UnitSim->FindUnit(Order.TargetUnit, TargetRow);
+			if (!TargetChunk || (Factions->GetEnemyMask(Chunk.Factions[Row]) & StratFaction::Bit(TargetChunk->Factions[TargetRow])) == 0)
+			{
+				continue;
+			}
+
+			//~ Measured like the movement system measures arrival, flying units on the ground plane.
+			bool bInRange;
+			if (bLockstep)
+			{
+				FStratFixedVector ToTarget = TargetChunk->FixedPositions[TargetRow] - Chunk.FixedPositions[Row];
+				ToTarget.Z = bIsFlying ? FStratFixed() : ToTarget.Z;
+				bInRange = ToTarget.Size() <= Weapon.FixedRange;
+			}
+			else
+			{
+				FVector3f ToTarget = TargetChunk->Positions[TargetRow] - Chunk.Positions[Row];
+				ToTarget.Z = bIsFlying ? 0.f : ToTarget.Z;
+				bInRange = ToTarget.Size() <= Weapon.Range;
+			}
+
+			if (bInRange)
+			{
+				Shots.Add({Unit, Order.TargetUnit, Chunk.TypeIds[Row]});
+			}
+		}
+	});
+
+	SET_DWORD_STAT(STAT_StratWeapons_Shots, Shots.Num());
+	for (const FShot& Shot : Shots)
+	{
+		const FWeaponInfo& Weapon = Weapons[Shot.TypeId];
+		if (Projectiles)
+		{
+			Projectiles->FireAtUnit(static_cast<uint16>(Weapon.ProjectileType), Shot.Unit, Shot.Target);
+		}
+
+		//~ In chunk order, the same on every peer. Later shots at a unit that died just miss.
+		if (bLockstep)
+		{
+			UnitSim->ApplyDamage(Shot.Target, Weapon.Damage);
+		}
+	}
+}
@@ -0,0 +1,72 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Units/StratFixedPoint.h"
+#include "Units/StratUnitTypes.h"
+#include "StratWeaponSubsystem.generated.h"
+
+class UStratFactionSubsystem;
+class UStratProjectileSubsystem;
+class UStratUnitSimSubsystem;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogStratWeapons, Log, All);
+
+/**
+ * Fires each unit's UStratUnitDefinition::Projectile at the target of its Attack order once the target is in range, every
+ * FireInterval. Attack orders come from players and from UStratTargetingSubsystem acquiring targets for idle units.
+ *
+ * Runs after every sim step on the authority, or on every peer in lockstep. A unit fires on the steps where the sim frame
+ * plus its handle is a multiple of its interval, so volleys are staggered and the cadence needs no state to save or hash.
+ * Outside lockstep the projectile deals the damage where it hits. In lockstep projectiles are cosmetic, so the shot deals
+ * its damage when fired, with the range measured in fixed point, and every peer kills the same units on the same step.
+ */
+UCLASS()
+class UE_RTS_API UStratWeaponSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void OnSimStepped(float FixedDeltaTime);
+
+	/** Per unit type. Types without a projectile have ProjectileType INDEX_NONE. */
+	struct FWeaponInfo
+	{
+		int32 ProjectileType{INDEX_NONE};
+		float Damage{0.f};
+		float Range{0.f};
+		FStratFixed FixedRange;
+		uint32 IntervalSteps{1};
+	};
+
+	struct FShot
+	{
+		FStratUnitHandle Unit;
+		FStratUnitHandle Target;
+		int32 TypeId{0};
+	};
+
+	TArray<FWeaponInfo> Weapons;
+
+	/** This step's shots, gathered before any is fired since a lockstep shot can destroy units. */
+	TArray<FShot> Shots;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratUnitSimSubsystem> UnitSim;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratProjectileSubsystem> Projectiles;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratFactionSubsystem> Factions;
+};
@@ -0,0 +1,34 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratEconomyComponent.h"
+
+#include "Net/UnrealNetwork.h"
+
+UStratEconomyComponent::UStratEconomyComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	SetIsReplicatedByDefault(true);
+}
+
+void UStratEconomyComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	//~ Other players' stockpiles are none of their business.
+	DOREPLIFETIME_CONDITION(UStratEconomyComponent, Economy, COND_OwnerOnly);
+}
+
+void UStratEconomyComponent::SetEconomy(const FStratFactionEconomy& NewEconomy)
+{
+	//~ Most steps only move a stockpile, and a step that moves nothing shouldn't wake the UI or dirty the property.
+	if (!(NewEconomy == Economy))
+	{
+		Economy = NewEconomy;
+		OnEconomyChanged.Broadcast(Economy);
+	}
+}
+
+void UStratEconomyComponent::OnRep_Economy()
+{
+	OnEconomyChanged.Broadcast(Economy);
+}
@@ -0,0 +1,44 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/PlayerStateComponent.h"
+#include "StratEconomyTypes.h"
+#include "StratEconomyComponent.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnStratEconomyChanged, const FStratFactionEconomy&, Economy);
+
+/**
+ * The owning player's faction economy, for the UI. UStratEconomySubsystem sets it each published step, and it replicates
+ * to that player only. Lives on AStratPlayerState.
+ */
+UCLASS(ClassGroup=(Strat), meta=(BlueprintSpawnableComponent, PrioritizeCategories="User"))
+class UE_RTS_API UStratEconomyComponent : public UPlayerStateComponent
+{
+	GENERATED_BODY()
+
+public:
+	UStratEconomyComponent(const FObjectInitializer& ObjectInitializer);
+
+	//~ Begin UActorComponent interface
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	//~ End UActorComponent interface
+
+	UFUNCTION(BlueprintPure, Category=StratEconomy)
+	const FStratFactionEconomy& GetEconomy() const { return Economy; }
+
+	/** Authority, or every peer in lockstep. */
+	void SetEconomy(const FStratFactionEconomy& NewEconomy);
+
+	/** Broadcast when a published step changed anything, on the server and the owning client alike. */
+	UPROPERTY(BlueprintAssignable, Category=StratEconomy)
+	FOnStratEconomyChanged OnEconomyChanged;
+
+protected:
+	UFUNCTION()
+	void OnRep_Economy();
+
+	UPROPERTY(VisibleInstanceOnly, ReplicatedUsing=OnRep_Economy, Category="User|Info")
+	FStratFactionEconomy Economy;
+};
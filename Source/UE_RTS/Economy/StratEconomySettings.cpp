@@ -0,0 +1,8 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratEconomySettings.h"
+
+UStratEconomySettings::UStratEconomySettings()
+{
+	CategoryName = TEXT("Game");
+}
@@ -0,0 +1,42 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "StratEconomyTypes.h"
+#include "StratEconomySettings.generated.h"
+
+/** Project settings for the economy. Found under Project Settings > Game > Strat Economy. */
+UCLASS(Config=Game, DefaultConfig, meta=(DisplayName="Strat Economy"))
+class UE_RTS_API UStratEconomySettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UStratEconomySettings();
+
+	/** Time between economy steps, rounded to whole sim steps. Nothing in the economy needs to be finer than this. */
+	UPROPERTY(Config, EditAnywhere, Category="Economy", meta=(ClampMin="0.05", UIMax="2.0", Units="s"))
+	float StepInterval{0.5f};
+
+	/** What every faction starts with. */
+	UPROPERTY(Config, EditAnywhere, Category="Economy")
+	FStratResourceAmounts StartingStockpile{FStratResourceAmounts::Make(500, 200, 200)};
+
+	/** Resources one gatherer takes from its node per minute, by resource. */
+	UPROPERTY(Config, EditAnywhere, Category="Gathering")
+	FStratResourceAmounts GatherRatePerMinute{FStratResourceAmounts::Make(60, 30, 30)};
+
+	/** Gatherers further than this from their node aren't working it. */
+	UPROPERTY(Config, EditAnywhere, Category="Gathering", meta=(ClampMin="0.0", Units="cm"))
+	float GatherRange{400.f};
+
+	/** Produced units appear this far in front of their producer, past its footprint. */
+	UPROPERTY(Config, EditAnywhere, Category="Production", meta=(ClampMin="0.0", Units="cm"))
+	float SpawnOffset{300.f};
+
+	/** Units a single producer can have queued. */
+	UPROPERTY(Config, EditAnywhere, Category="Production", meta=(ClampMin="1", ClampMax="64"))
+	int32 MaxQueuedPerProducer{10};
+};
@@ -0,0 +1,337 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratEconomySimulation.h"
+
+namespace
+{
+	int32 ToWhole(const int64 Milli)
+	{
+		return static_cast<int32>(FMath::Clamp<int64>(Milli / StratEconomy::MilliPerUnit, MIN_int32, MAX_int32));
+	}
+}
+
+void FStratEconomySimulation::Init(const FStratEconomyRates& InRates, TArray<FStratEconomyTypeInfo>&& InTypes)
+{
+	Rates = InRates;
+	Types = MoveTemp(InTypes);
+	Reset();
+}
+
+void FStratEconomySimulation::Reset()
+{
+	Nodes.Reset();
+	Producers.Reset();
+	StepCount = 0;
+
+	for (FFaction& Faction : Factions)
+	{
+		Faction = FFaction();
+		Faction.StockpileMilli = Rates.StartingMilli;
+	}
+}
+
+void FStratEconomySimulation::Step(const FStratEconomyInput& Input, FStratEconomySnapshot& Out)
+{
+	Out.Reset();
+
+	for (const FStratEconomyCommand& Command : Input.Commands)
+	{
+		ApplyCommand(Command);
+	}
+
+	for (FFaction& Faction : Factions)
+	{
+		for (int64& Gathered : Faction.GatheredMilli)
+		{
+			Gathered = 0;
+		}
+	}
+
+	//~ In input order, so when a node runs dry the same gatherers got the last of it on every peer.
+	for (const FStratEconomyInput::FGatherer& Gatherer : Input.Gatherers)
+	{
+		FNode& Node = Nodes[Gatherer.Node];
+		if (Node.RemainingMilli <= 0 || !StratFaction::IsValidId(Gatherer.Faction))
+		{
+			continue;
+		}
+
+		const int32 Resource = static_cast<int32>(Node.Resource);
+		const int64 Taken = FMath::Min(Rates.GatherMilliPerStep[Resource], Node.RemainingMilli);
+		Node.RemainingMilli -= Taken;
+		Factions[Gatherer.Faction].StockpileMilli[Resource] += Taken;
+		Factions[Gatherer.Faction].GatheredMilli[Resource] += Taken;
+
+		if (Node.RemainingMilli <= 0)
+		{
+			Out.DepletedNodes.Add(Gatherer.Node);
+		}
+	}
+
+	constexpr int32 Supply = static_cast<int32>(EStratResource::Supply);
+	for (int32 FactionId = 0; FactionId < StratFaction::MaxFactions; ++FactionId)
+	{
+		FFaction& Faction = Factions[FactionId];
+		Faction.StockpileMilli[Supply] -= Input.UpkeepMilli[FactionId];
+		Faction.bStarved = Faction.StockpileMilli[Supply] < 0;
+		Faction.StockpileMilli[Supply] = FMath::Max<int64>(Faction.StockpileMilli[Supply], 0);
+	}
+
+	for (int32 ProducerIndex = 0; ProducerIndex < Producers.Num(); ++ProducerIndex)
+	{
+		FProducer& Producer = Producers[ProducerIndex];
+		if (Producer.Queue.IsEmpty() || Factions[Producer.Faction].bStarved || --Producer.StepsLeft > 0)
+		{
+			continue;
+		}
+
+		Out.Produced.Add({ProducerIndex, Producer.Queue[0], Producer.Faction});
+		Producer.Queue.RemoveAt(0, EAllowShrinking::No);
+		--Factions[Producer.Faction].NumQueued;
+		if (!Producer.Queue.IsEmpty())
+		{
+			Producer.StepsLeft = Types[Producer.Queue[0]].BuildSteps;
+		}
+	}
+
+	Out.Step = ++StepCount;
+	for (int32 FactionId = 0; FactionId < StratFaction::MaxFactions; ++FactionId)
+	{
+		const FFaction& Faction = Factions[FactionId];
+		FStratFactionEconomy& Economy = Out.Factions[FactionId];
+		for (int32 Resource = 0; Resource < StratEconomy::NumResources; ++Resource)
+		{
+			Economy.Stockpile.Set(static_cast<EStratResource>(Resource), ToWhole(Faction.StockpileMilli[Resource]));
+			Economy.IncomePerMinute.Set(static_cast<EStratResource>(Resource), FMath::RoundToInt32(Faction.GatheredMilli[Resource] * Rates.StepsPerMinute / StratEconomy::MilliPerUnit));
+		}
+		Economy.UpkeepPerMinute = FMath::RoundToInt32(Input.UpkeepMilli[FactionId] * Rates.StepsPerMinute / StratEconomy::MilliPerUnit);
+		Economy.NumQueued = Faction.NumQueued;
+		Economy.bStarved = Faction.bStarved;
+	}
+}
+
+void FStratEconomySimulation::ApplyCommand(const FStratEconomyCommand& Command)
+{
+	switch (Command.Type)
+	{
+	case EStratEconomyCommandType::AddNode:
+		{
+			if (Nodes.Num() <= Command.Index)
+			{
+				Nodes.SetNum(Command.Index + 1);
+			}
+
+			FNode& Node = Nodes[Command.Index];
+			Node.RemainingMilli = Command.Amount * StratEconomy::MilliPerUnit;
+			Node.Resource = Command.Resource;
+		}
+		break;
+
+	case EStratEconomyCommandType::RemoveNode:
+		if (Nodes.IsValidIndex(Command.Index))
+		{
+			Nodes[Command.Index] = FNode();
+		}
+		break;
+
+	case EStratEconomyCommandType::QueueProduction:
+		{
+			if (!Types.IsValidIndex(Command.TypeId))
+			{
+				break;
+			}
+
+			if (Producers.Num() <= Command.Index)
+			{
+				Producers.SetNum(Command.Index + 1);
+			}
+
+			FProducer& Producer = Producers[Command.Index];
+			FFaction& Faction = Factions[Command.Faction];
+			const FStratEconomyTypeInfo& Type = Types[Command.TypeId];
+			if (Producer.Queue.Num() >= Rates.MaxQueuedPerProducer)
+			{
+				break;
+			}
+
+			bool bAffordable = true;
+			for (int32 Resource = 0; Resource < StratEconomy::NumResources; ++Resource)
+			{
+				bAffordable &= Faction.StockpileMilli[Resource] >= Type.CostMilli[Resource];
+			}
+			if (!bAffordable)
+			{
+				break;
+			}
+
+			for (int32 Resource = 0; Resource < StratEconomy::NumResources; ++Resource)
+			{
+				Faction.StockpileMilli[Resource] -= Type.CostMilli[Resource];
+			}
+
+			if (Producer.Queue.IsEmpty())
+			{
+				Producer.StepsLeft = Type.BuildSteps;
+			}
+			Producer.Queue.Add(Command.TypeId);
+			Producer.Faction = Command.Faction;
+			++Faction.NumQueued;
+		}
+		break;
+
+	case EStratEconomyCommandType::CancelProduction:
+		if (Producers.IsValidIndex(Command.Index) && !Producers[Command.Index].Queue.IsEmpty())
+		{
+			//~ From the back, so the unit in production keeps its progress unless it's the only one.
+			FProducer& Producer = Producers[Command.Index];
+			Refund(Producer.Faction, Producer.Queue.Pop(EAllowShrinking::No));
+		}
+		break;
+
+	case EStratEconomyCommandType::RemoveProducer:
+		if (Producers.IsValidIndex(Command.Index))
+		{
+			FProducer& Producer = Producers[Command.Index];
+			for (const uint16 TypeId : Producer.Queue)
+			{
+				Refund(Producer.Faction, TypeId);
+			}
+			Producer.Queue.Reset();
+			Producer.StepsLeft = 0;
+		}
+		break;
+
+	case EStratEconomyCommandType::AddResources:
+		{
+			int64& Stockpile = Factions[Command.Faction].StockpileMilli[static_cast<int32>(Command.Resource)];
+			Stockpile = FMath::Max<int64>(Stockpile + Command.Amount * StratEconomy::MilliPerUnit, 0);
+		}
+		break;
+	}
+}
+
+void FStratEconomySimulation::Refund(const uint8 Faction, const uint16 TypeId)
+{
+	FFaction& State = Factions[Faction];
+	for (int32 Resource = 0; Resource < StratEconomy::NumResources; ++Resource)
+	{
+		State.StockpileMilli[Resource] += Types[TypeId].CostMilli[Resource];
+	}
+	--State.NumQueued;
+}
+
+void FStratEconomySimulation::Serialize(FArchive& Ar)
+{
+	Ar << StepCount;
+
+	for (FFaction& Faction : Factions)
+	{
+		uint8 bStarved = Faction.bStarved;
+		for (int64& Stockpile : Faction.StockpileMilli)
+		{
+			Ar << Stockpile;
+		}
+		Ar << Faction.NumQueued << bStarved;
+		Faction.bStarved = bStarved != 0;
+	}
+
+	int32 NumNodes = Nodes.Num();
+	Ar << NumNodes;
+	if (Ar.IsLoading())
+	{
+		//~ Each node takes at least 9 bytes, which bounds what a damaged count can allocate.
+		if (NumNodes < 0 || NumNodes > (Ar.TotalSize() - Ar.Tell()) / 9)
+		{
+			Ar.SetError();
+			return;
+		}
+		Nodes.SetNum(NumNodes);
+	}
+	for (FNode& Node : Nodes)
+	{
+		uint8 Resource = static_cast<uint8>(Node.Resource);
+		Ar << Node.RemainingMilli << Resource;
+		if (Resource >= StratEconomy::NumResources)
+		{
+			Ar.SetError();
+			return;
+		}
+		Node.Resource = static_cast<EStratResource>(Resource);
+	}
+
+	int32 NumProducers = Producers.Num();
+	Ar << NumProducers;
+	if (Ar.IsLoading())
+	{
+		if (NumProducers < 0 || NumProducers > (Ar.TotalSize() - Ar.Tell()) / 9)
+		{
+			Ar.SetError();
+			return;
+		}
+		Producers.SetNum(NumProducers);
+	}
+	for (FProducer& Producer : Producers)
+	{
+		Ar << Producer.Queue << Producer.StepsLeft << Producer.Faction;
+		if (!StratFaction::IsValidId(Producer.Faction))
+		{
+			Ar.SetError();
+			return;
+		}
+	}
+}
+
+void FStratEconomySimulation::RemapTypeIds(const TConstArrayView<uint16> Remap)
+{
+	for (FProducer& Producer : Producers)
+	{
+		if (!Remap.IsEmpty())
+		{
+			for (uint16& TypeId : Producer.Queue)
+			{
+				TypeId = Remap.IsValidIndex(TypeId) ? Remap[TypeId] : MAX_uint16;
+			}
+		}
+
+		//~ Already paid for, but a type that's gone has no cost left to refund.
+		const int32 NumDropped = Producer.Queue.RemoveAll([this](const uint16 TypeId) { return !Types.IsValidIndex(TypeId); });
+		Factions[Producer.Faction].NumQueued -= NumDropped;
+	}
+}
+
+uint32 FStratEconomySimulation::ComputeStateHash(uint32 Hash) const
+{
+	Hash = FCrc::MemCrc32(&StepCount, sizeof(StepCount), Hash);
+	for (const FFaction& Faction : Factions)
+	{
+		const uint8 bStarved = Faction.bStarved;
+		Hash = FCrc::MemCrc32(Faction.StockpileMilli.GetData(), sizeof(int64) * StratEconomy::NumResources, Hash);
+		Hash = FCrc::MemCrc32(&Faction.NumQueued, sizeof(int32), Hash);
+		Hash = FCrc::MemCrc32(&bStarved, sizeof(uint8), Hash);
+	}
+
+	//~ Field by field, the structs have padding.
+	for (const FNode& Node : Nodes)
+	{
+		const uint8 Resource = static_cast<uint8>(Node.Resource);
+		Hash = FCrc::MemCrc32(&Node.RemainingMilli, sizeof(int64), Hash);
+		Hash = FCrc::MemCrc32(&Resource, sizeof(uint8), Hash);
+	}
+	for (const FProducer& Producer : Producers)
+	{
+		Hash = FCrc::MemCrc32(Producer.Queue.GetData(), Producer.Queue.Num() * sizeof(uint16), Hash);
+		Hash = FCrc::MemCrc32(&Producer.StepsLeft, sizeof(int32), Hash);
+		Hash = FCrc::MemCrc32(&Producer.Faction, sizeof(uint8), Hash);
+	}
+	return Hash;
+}
+
+SIZE_T FStratEconomySimulation::GetAllocatedSize() const
+{
+	SIZE_T Bytes = Types.GetAllocatedSize() + Nodes.GetAllocatedSize() + Producers.GetAllocatedSize();
+	for (const FProducer& Producer : Producers)
+	{
+		Bytes += Producer.Queue.GetAllocatedSize();
+	}
+	return Bytes;
+}
@@ -0,0 +1,198 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StratEconomyTypes.h"
+#include "Faction/StratFactionTypes.h"
+
+/** Per unit type numbers the economy needs, in the simulation's units. Flattened out of UStratUnitDefinition. */
+struct FStratEconomyTypeInfo
+{
+	TStaticArray<int64, StratEconomy::NumResources> CostMilli{InPlace, 0};
+	int32 BuildSteps{1};
+	int64 UpkeepMilliPerStep{0};
+};
+
+/** Rates of the whole economy, in the simulation's units. */
+struct FStratEconomyRates
+{
+	TStaticArray<int64, StratEconomy::NumResources> GatherMilliPerStep{InPlace, 0};
+	TStaticArray<int64, StratEconomy::NumResources> StartingMilli{InPlace, 0};
+	double StepsPerMinute{120.0};
+	int32 MaxQueuedPerProducer{10};
+};
+
+enum class EStratEconomyCommandType : uint8
+{
+	/** Sets node Index to Amount of Resource. Index is either the next new node or one freed by RemoveNode. */
+	AddNode,
+
+	/** Empties node Index and frees the slot. */
+	RemoveNode,
+
+	/** Faction pays for TypeId and producer Index queues it. Dropped if unaffordable or the queue is full. */
+	QueueProduction,
+
+	/** Refunds producer Index's last queued unit. */
+	CancelProduction,
+
+	/** Refunds producer Index's whole queue and frees the slot. */
+	RemoveProducer,
+
+	/** Adds Amount of Resource to Faction, or takes it when negative. Stockpiles never go below zero. */
+	AddResources,
+};
+
+/** A change from gameplay, applied at the start of the next economy step in the order it was made. */
+struct FStratEconomyCommand
+{
+	int32 Index{INDEX_NONE};
+	int32 Amount{0};
+	uint16 TypeId{0};
+	uint8 Faction{0};
+	EStratResource Resource{EStratResource::Supply};
+	EStratEconomyCommandType Type{EStratEconomyCommandType::AddResources};
+
+	/** Saves and replay keyframes. Loading sets an error on values no command can have. */
+	friend FArchive& operator<<(FArchive& Ar, FStratEconomyCommand& Command)
+	{
+		uint8 ResourceValue = static_cast<uint8>(Command.Resource);
+		uint8 TypeValue = static_cast<uint8>(Command.Type);
+		Ar << Command.Index << Command.Amount << Command.TypeId << Command.Faction << ResourceValue << TypeValue;
+		if (Ar.IsLoading())
+		{
+			if (ResourceValue >= StratEconomy::NumResources || TypeValue > static_cast<uint8>(EStratEconomyCommandType::AddResources)
+				|| !StratFaction::IsValidId(Command.Faction))
+			{
+				Ar.SetError();
+			}
+			Command.Resource = static_cast<EStratResource>(ResourceValue);
+			Command.Type = static_cast<EStratEconomyCommandType>(TypeValue);
+		}
+		return Ar;
+	}
+};
+
+/** Everything one step reads from the game thread, gathered before the task starts. */
+struct FStratEconomyInput
+{
+	struct FGatherer
+	{
+		int32 Node{INDEX_NONE};
+		uint8 Faction{0};
+	};
+
+	void Reset()
+	{
+		Commands.Reset();
+		Gatherers.Reset();
+		for (int64& Upkeep : UpkeepMilli)
+		{
+			Upkeep = 0;
+		}
+	}
+
+	TArray<FStratEconomyCommand> Commands;
+
+	/** Gatherers in range of their node this step. */
+	TArray<FGatherer> Gatherers;
+
+	/** Summed upkeep of each faction's living units. */
+	TStaticArray<int64, StratFaction::MaxFactions> UpkeepMilli{InPlace, 0};
+};
+
+/** What one step produced. Written by the worker, read by the game thread once published. */
+struct FStratEconomySnapshot
+{
+	struct FProduced
+	{
+		int32 Producer{INDEX_NONE};
+		uint16 TypeId{0};
+		uint8 Faction{0};
+	};
+
+	void Reset()
+	{
+		Produced.Reset();
+		DepletedNodes.Reset();
+	}
+
+	uint32 Step{0};
+	TStaticArray<FStratFactionEconomy, StratFaction::MaxFactions> Factions;
+
+	/** Units that finished production this step. The game thread spawns them. */
+	TArray<FProduced> Produced;
+
+	/** Nodes that ran out this step. */
+	TArray<int32> DepletedNodes;
+};
+
+/**
+ * The economy's own state and its fixed step. Plain data with no UObjects and no access to anything else, so a step can
+ * run on a worker while the game thread carries on. All math is in integers, thousandths of a resource, so lockstep peers
+ * running the same steps with the same inputs agree exactly.
+ */
+class UE_RTS_API FStratEconomySimulation
+{
+public:
+	void Init(const FStratEconomyRates& InRates, TArray<FStratEconomyTypeInfo>&& InTypes);
+
+	/** Back to the start of a match: starting stockpiles, no nodes and no producers. Keeps the rates and types. */
+	void Reset();
+
+	/** Runs one step: commands, gathering, upkeep, then production. Writes the results to Out. */
+	void Step(const FStratEconomyInput& Input, FStratEconomySnapshot& Out);
+
+	/**
+	 * Saves and replay keyframes. Everything but the rates and types, which come from Init. Loading sets an error on
+	 * anything this simulation's types can't hold, and leaves the simulation half read, so load into a copy.
+	 */
+	void Serialize(FArchive& Ar);
+
+	/**
+	 * After loading. Remap[saved type id] is this build's id, or MAX_uint16 for a type that's gone. Empty keeps the ids.
+	 * Either way, queued units of a type this build doesn't have are dropped.
+	 */
+	void RemapTypeIds(TConstArrayView<uint16> Remap);
+
+	uint32 ComputeStateHash(uint32 Hash) const;
+
+	int32 GetNumNodes() const { return Nodes.Num(); }
+	int32 GetNumProducers() const { return Producers.Num(); }
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	struct FFaction
+	{
+		TStaticArray<int64, StratEconomy::NumResources> StockpileMilli{InPlace, 0};
+		TStaticArray<int64, StratEconomy::NumResources> GatheredMilli{InPlace, 0};
+		int32 NumQueued{0};
+		bool bStarved{false};
+	};
+
+	struct FNode
+	{
+		int64 RemainingMilli{0};
+		EStratResource Resource{EStratResource::Supply};
+	};
+
+	struct FProducer
+	{
+		/** Type ids, front is in production. */
+		TArray<uint16> Queue;
+		int32 StepsLeft{0};
+		uint8 Faction{0};
+	};
+
+	void ApplyCommand(const FStratEconomyCommand& Command);
+	void Refund(uint8 Faction, uint16 TypeId);
+
+	FStratEconomyRates Rates;
+	TArray<FStratEconomyTypeInfo> Types;
+	TStaticArray<FFaction, StratFaction::MaxFactions> Factions;
+	TArray<FNode> Nodes;
+	TArray<FProducer> Producers;
+	uint32 StepCount{0};
+};
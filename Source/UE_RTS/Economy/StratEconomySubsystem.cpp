@@ -0,0 +1,668 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratEconomySubsystem.h"
+
+#include "StratEconomyComponent.h"
+#include "StratEconomySettings.h"
+#include "Algo/AllOf.h"
+#include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
+#include "Lockstep/StratLockstepSubsystem.h"
+#include "Memory/StratMemoryTags.h"
+#include "Player/StratPlayerState.h"
+#include "Units/StratUnitDefinition.h"
+#include "Units/StratUnitSettings.h"
+#include "Units/StratUnitSimSubsystem.h"
+
+DEFINE_LOG_CATEGORY(LogStratEconomy);
+
+DECLARE_CYCLE_STAT(TEXT("Economy Step (worker)"), STAT_StratEconomy_Step, STATGROUP_StratUnits);
+DECLARE_CYCLE_STAT(TEXT("Economy Gather Input"), STAT_StratEconomy_GatherInput, STATGROUP_StratUnits);
+DECLARE_CYCLE_STAT(TEXT("Economy Publish"), STAT_StratEconomy_Publish, STATGROUP_StratUnits);
+DECLARE_CYCLE_STAT(TEXT("Economy Wait"), STAT_StratEconomy_Wait, STATGROUP_StratUnits);
+
+namespace
+{
+	int64 ToMilliPerStep(const double PerMinute, const double StepsPerMinute)
+	{
+		return static_cast<int64>(FMath::RoundToDouble(PerMinute * StratEconomy::MilliPerUnit / StepsPerMinute));
+	}
+
+	void SerializeAmounts(FArchive& Ar, FStratResourceAmounts& Amounts)
+	{
+		Ar << Amounts.Supply << Amounts.Fuel << Amounts.Metal;
+	}
+
+	void SerializeSnapshot(FArchive& Ar, FStratEconomySnapshot& Snapshot)
+	{
+		Ar << Snapshot.Step;
+		for (FStratFactionEconomy& Economy : Snapshot.Factions)
+		{
+			uint8 bStarved = Economy.bStarved;
+			SerializeAmounts(Ar, Economy.Stockpile);
+			SerializeAmounts(Ar, Economy.IncomePerMinute);
+			Ar << Economy.UpkeepPerMinute << Economy.NumQueued << bStarved;
+			Economy.bStarved = bStarved != 0;
+		}
+
+		int32 NumProduced = Snapshot.Produced.Num();
+		Ar << NumProduced;
+		if (Ar.IsLoading())
+		{
+			//~ 7 bytes each, which bounds what a damaged count can allocate.
+			if (NumProduced < 0 || NumProduced > (Ar.TotalSize() - Ar.Tell()) / 7)
+			{
+				Ar.SetError();
+				return;
+			}
+			Snapshot.Produced.SetNum(NumProduced);
+		}
+		for (FStratEconomySnapshot::FProduced& Produced : Snapshot.Produced)
+		{
+			Ar << Produced.Producer << Produced.TypeId << Produced.Faction;
+		}
+		Ar << Snapshot.DepletedNodes;
+	}
+}
+
+void UStratEconomySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	LLM_SCOPE_BYTAG(StratUnits);
+
+	Super::Initialize(Collection);
+
+	UnitSim = Collection.InitializeDependency<UStratUnitSimSubsystem>();
+	if (!UnitSim)
+	{
+		return;
+	}
+	UnitSim->OnPostSimStep.AddUObject(this, &ThisClass::OnSimStepped);
+
+	//~ Whole sim steps, so every peer steps the economy on the same sim frames.
+	const UStratEconomySettings* Settings = GetDefault<UStratEconomySettings>();
+	const int32 SimTickRate = FMath::Max(GetDefault<UStratUnitSettings>()->SimTickRate, 1);
+	SimStepsPerEconomyStep = FMath::Max(1, FMath::RoundToInt32(Settings->StepInterval * SimTickRate));
+	const double StepSeconds = static_cast<double>(SimStepsPerEconomyStep) / SimTickRate;
+
+	FStratEconomyRates Rates;
+	Rates.StepsPerMinute = 60.0 / StepSeconds;
+	Rates.MaxQueuedPerProducer = Settings->MaxQueuedPerProducer;
+	for (int32 Resource = 0; Resource < StratEconomy::NumResources; ++Resource)
+	{
+		Rates.GatherMilliPerStep[Resource] = ToMilliPerStep(Settings->GatherRatePerMinute.Get(static_cast<EStratResource>(Resource)), Rates.StepsPerMinute);
+		Rates.StartingMilli[Resource] = Settings->StartingStockpile.Get(static_cast<EStratResource>(Resource)) * StratEconomy::MilliPerUnit;
+	}
+
+	TArray<FStratEconomyTypeInfo> Types;
+	for (int32 TypeId = 0; TypeId < UnitSim->GetTypeInfos().Num(); ++TypeId)
+	{
+		FStratEconomyTypeInfo& Type = Types.AddDefaulted_GetRef();
+		if (const UStratUnitDefinition* Definition = UnitSim->GetDefinition(static_cast<uint16>(TypeId)))
+		{
+			for (int32 Resource = 0; Resource < StratEconomy::NumResources; ++Resource)
+			{
+				Type.CostMilli[Resource] = Definition->Cost.Get(static_cast<EStratResource>(Resource)) * StratEconomy::MilliPerUnit;
+			}
+			Type.BuildSteps = FMath::Max(1, FMath::CeilToInt32(Definition->BuildTime / StepSeconds));
+			Type.UpkeepMilliPerStep = ToMilliPerStep(Definition->UpkeepPerMinute, Rates.StepsPerMinute);
+		}
+		TypeUpkeepMilli.Add(Type.UpkeepMilliPerStep);
+	}
+	Simulation.Init(Rates, MoveTemp(Types));
+}
+
+void UStratEconomySubsystem::Deinitialize()
+{
+	if (UnitSim)
+	{
+		UnitSim->OnPostSimStep.RemoveAll(this);
+	}
+
+	//~ The task writes into this object.
+	WaitForStep();
+
+	Super::Deinitialize();
+}
+
+bool UStratEconomySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+SIZE_T UStratEconomySubsystem::GetAllocatedSize() const
+{
+	SIZE_T Bytes = PendingCommands.GetAllocatedSize() + TaskInput.Commands.GetAllocatedSize() + TaskInput.Gatherers.GetAllocatedSize()
+		+ TypeUpkeepMilli.GetAllocatedSize() + NodeUnits.GetAllocatedSize() + NodeIndices.GetAllocatedSize() + FreeNodes.GetAllocatedSize()
+		+ Gatherers.GetAllocatedSize() + ProducerUnits.GetAllocatedSize() + ProducerIndices.GetAllocatedSize() + FreeProducers.GetAllocatedSize();
+	const FStratEconomySnapshot& Front = Snapshots[FrontIndex];
+	Bytes += Front.Produced.GetAllocatedSize() + Front.DepletedNodes.GetAllocatedSize();
+
+	//~ The simulation's arrays and the back snapshot belong to the task while it runs.
+	if (!StepTask.IsValid() || StepTask.IsCompleted())
+	{
+		const FStratEconomySnapshot& Back = Snapshots[FrontIndex ^ 1];
+		Bytes += Back.Produced.GetAllocatedSize() + Back.DepletedNodes.GetAllocatedSize() + Simulation.GetAllocatedSize();
+	}
+	return Bytes;
+}
+
+UStratLockstepSubsystem* UStratEconomySubsystem::GetLockstep() const
+{
+	return GetWorld()->GetSubsystem<UStratLockstepSubsystem>();
+}
+
+void UStratEconomySubsystem::AddResourceNode(const FStratUnitHandle Node, const EStratResource Resource, const int32 Amount)
+{
+	if (UStratLockstepSubsystem* Lockstep = GetLockstep())
+	{
+		FStratLockstepCommand Command;
+		Command.Type = EStratLockstepCommandType::AddResourceNode;
+		Command.TargetUnit = Node;
+		Command.Resource = Resource;
+		Command.Amount = Amount;
+		Lockstep->SubmitCommand(Command);
+		return;
+	}
+	ApplyResourceNode(Node, Resource, Amount);
+}
+
+void UStratEconomySubsystem::AssignGatherer(const FStratUnitHandle Worker, const FStratUnitHandle Node)
+{
+	if (UStratLockstepSubsystem* Lockstep = GetLockstep())
+	{
+		FStratLockstepCommand Command;
+		Command.Type = EStratLockstepCommandType::AssignGatherer;
+		Command.Units.Add(Worker);
+		Command.TargetUnit = Node;
+		Lockstep->SubmitCommand(Command);
+		return;
+	}
+	ApplyGatherer(Worker, Node);
+}
+
+void UStratEconomySubsystem::QueueProduction(const FStratUnitHandle& Producer, const uint16 TypeId)
+{
+	if (UStratLockstepSubsystem* Lockstep = GetLockstep())
+	{
+		FStratLockstepCommand Command;
+		Command.Type = EStratLockstepCommandType::QueueProduction;
+		Command.Units.Add(Producer);
+		Command.TypeId = TypeId;
+		Lockstep->SubmitCommand(Command);
+		return;
+	}
+	ApplyQueueProduction(Producer, TypeId);
+}
+
+void UStratEconomySubsystem::CancelProduction(const FStratUnitHandle Producer)
+{
+	if (UStratLockstepSubsystem* Lockstep = GetLockstep())
+	{
+		FStratLockstepCommand Command;
+		Command.Type = EStratLockstepCommandType::CancelProduction;
+		Command.Units.Add(Producer);
+		Lockstep->SubmitCommand(Command);
+		return;
+	}
+	ApplyCancelProduction(Producer);
+}
+
+void UStratEconomySubsystem::AddResources(const uint8 Faction, const EStratResource Resource, const int32 Amount)
+{
+	if (UStratLockstepSubsystem* Lockstep = GetLockstep())
+	{
+		FStratLockstepCommand Command;
+		Command.Type = EStratLockstepCommandType::AddResources;
+		Command.Faction = Faction;
+		Command.Resource = Resource;
+		Command.Amount = Amount;
+		Lockstep->SubmitCommand(Command);
+		return;
+	}
+	ApplyResources(Faction, Resource, Amount);
+}
+
+void UStratEconomySubsystem::ApplyResourceNode(const FStratUnitHandle& Node, const EStratResource Resource, const int32 Amount)
+{
+	if (!UnitSim->IsUnitValid(Node) || NodeIndices.Contains(Node) || Resource == EStratResource::MAX)
+	{
+		return;
+	}
+
+	//~ Like producers, a freed slot is only reused by a command queued after the RemoveNode that freed it.
+	FStratEconomyCommand& Command = PendingCommands.AddDefaulted_GetRef();
+	Command.Type = EStratEconomyCommandType::AddNode;
+	Command.Index = FreeNodes.IsEmpty() ? NodeUnits.Add(Node) : FreeNodes.Pop(EAllowShrinking::No);
+	Command.Resource = Resource;
+	Command.Amount = FMath::Max(Amount, 0);
+	NodeUnits[Command.Index] = Node;
+	NodeIndices.Add(Node, Command.Index);
+}
+
+void UStratEconomySubsystem::ApplyGatherer(const FStratUnitHandle& Worker, const FStratUnitHandle& Node)
+{
+	//~ By handle, so a worker whose node is gone doesn't gather from whatever reuses its slot.
+	if (NodeIndices.Contains(Node))
+	{
+		Gatherers.Add(Worker, Node);
+	}
+	else
+	{
+		Gatherers.Remove(Worker);
+	}
+}
+
+void UStratEconomySubsystem::ApplyQueueProduction(const FStratUnitHandle& Producer, const uint16 TypeId)
+{
+	int32 Row;
+	const FStratUnitChunk* Chunk = UnitSim->FindUnit(Producer, Row);
+	if (!Chunk || !UnitSim->GetTypeInfos().IsValidIndex(TypeId))
+	{
+		return;
+	}
+
+	FStratEconomyCommand& Command = PendingCommands.AddDefaulted_GetRef();
+	Command.Type = EStratEconomyCommandType::QueueProduction;
+	Command.Index = FindOrAddProducer(Producer);
+	Command.TypeId = TypeId;
+	Command.Faction = Chunk->Factions[Row];
+}
+
+void UStratEconomySubsystem::ApplyCancelProduction(const FStratUnitHandle& Producer)
+{
+	if (const int32* ProducerIndex = ProducerIndices.Find(Producer))
+	{
+		FStratEconomyCommand& Command = PendingCommands.AddDefaulted_GetRef();
+		Command.Type = EStratEconomyCommandType::CancelProduction;
+		Command.Index = *ProducerIndex;
+	}
+}
+
+void UStratEconomySubsystem::ApplyResources(const uint8 Faction, const EStratResource Resource, const int32 Amount)
+{
+	if (!StratFaction::IsValidId(Faction) || Resource == EStratResource::MAX)
+	{
+		return;
+	}
+
+	FStratEconomyCommand& Command = PendingCommands.AddDefaulted_GetRef();
+	Command.Type = EStratEconomyCommandType::AddResources;
+	Command.Faction = Faction;
+	Command.Resource = Resource;
+	Command.Amount = Amount;
+}
+
+FStratFactionEconomy UStratEconomySubsystem::GetFactionEconomy(const uint8 Faction) const
+{
+	return StratFaction::IsValidId(Faction) ? GetSnapshot().Factions[Faction] : FStratFactionEconomy();
+}
+
+int32 UStratEconomySubsystem::FindOrAddProducer(const FStratUnitHandle& Producer)
+{
+	if (const int32* ProducerIndex = ProducerIndices.Find(Producer))
+	{
+		return *ProducerIndex;
+	}
+
+	//~ The simulation frees a slot when it applies RemoveProducer, which is always before a later command reuses it.
+	const int32 ProducerIndex = FreeProducers.IsEmpty() ? ProducerUnits.Add(Producer) : FreeProducers.Pop(EAllowShrinking::No);
+	ProducerUnits[ProducerIndex] = Producer;
+	ProducerIndices.Add(Producer, ProducerIndex);
+	return ProducerIndex;
+}
+
+void UStratEconomySubsystem::RemoveProducer(const int32 ProducerIndex)
+{
+	FStratEconomyCommand& Command = PendingCommands.AddDefaulted_GetRef();
+	Command.Type = EStratEconomyCommandType::RemoveProducer;
+	Command.Index = ProducerIndex;
+
+	ProducerIndices.Remove(ProducerUnits[ProducerIndex]);
+	ProducerUnits[ProducerIndex] = FStratUnitHandle();
+	FreeProducers.Add(ProducerIndex);
+}
+
+void UStratEconomySubsystem::RemoveNode(const int32 NodeIndex)
+{
+	FStratEconomyCommand& Command = PendingCommands.AddDefaulted_GetRef();
+	Command.Type = EStratEconomyCommandType::RemoveNode;
+	Command.Index = NodeIndex;
+
+	NodeIndices.Remove(NodeUnits[NodeIndex]);
+	NodeUnits[NodeIndex] = FStratUnitHandle();
+	FreeNodes.Add(NodeIndex);
+}
+
+void UStratEconomySubsystem::WriteState(FArchive& Ar)
+{
+	WaitForStep();
+
+	uint8 bUnpublished = bStepUnpublished;
+	Ar << bUnpublished;
+	Simulation.Serialize(Ar);
+	SerializeSnapshot(Ar, Snapshots[FrontIndex]);
+	SerializeSnapshot(Ar, Snapshots[FrontIndex ^ 1]);
+	Ar << PendingCommands << NodeUnits << FreeNodes << Gatherers << ProducerUnits << FreeProducers;
+}
+
+bool UStratEconomySubsystem::ReadState(FArchive& Ar, const TConstArrayView<uint16> TypeIdRemap)
+{
+	WaitForStep();
+
+	uint8 bUnpublished = 0;
+	FStratEconomySimulation LoadedSimulation = Simulation;
+	TStaticArray<FStratEconomySnapshot, 2> LoadedSnapshots;
+	TArray<FStratEconomyCommand> LoadedCommands;
+	TArray<FStratUnitHandle> LoadedNodeUnits;
+	TArray<int32> LoadedFreeNodes;
+	TMap<FStratUnitHandle, FStratUnitHandle> LoadedGatherers;
+	TArray<FStratUnitHandle> LoadedProducerUnits;
+	TArray<int32> LoadedFreeProducers;
+
+	Ar << bUnpublished;
+	LoadedSimulation.Serialize(Ar);
+	SerializeSnapshot(Ar, LoadedSnapshots[0]);
+	SerializeSnapshot(Ar, LoadedSnapshots[1]);
+	Ar << LoadedCommands << LoadedNodeUnits << LoadedFreeNodes << LoadedGatherers << LoadedProducerUnits << LoadedFreeProducers;
+
+	//~ Every index the game thread or the simulation looks up without a check has to be in range.
+	const auto AllIn = [](const TArray<int32>& Indices, const int32 Num)
+	{
+		return Algo::AllOf(Indices, [Num](const int32 Index) { return Index >= 0 && Index < Num; });
+	};
+	bool bValid = !Ar.IsError() && LoadedSimulation.GetNumNodes() <= LoadedNodeUnits.Num() && LoadedSimulation.GetNumProducers() <= LoadedProducerUnits.Num()
+		&& AllIn(LoadedFreeNodes, LoadedNodeUnits.Num()) && AllIn(LoadedFreeProducers, LoadedProducerUnits.Num());
+	for (const FStratEconomySnapshot& Snapshot : LoadedSnapshots)
+	{
+		bValid &= AllIn(Snapshot.DepletedNodes, LoadedNodeUnits.Num());
+		bValid &= Algo::AllOf(Snapshot.Produced, [&LoadedProducerUnits](const FStratEconomySnapshot::FProduced& Produced)
+		{
+			return LoadedProducerUnits.IsValidIndex(Produced.Producer) && StratFaction::IsValidId(Produced.Faction);
+		});
+	}
+	for (const FStratEconomyCommand& Command : LoadedCommands)
+	{
+		switch (Command.Type)
+		{
+		case EStratEconomyCommandType::AddNode:
+		case EStratEconomyCommandType::RemoveNode:
+			bValid &= LoadedNodeUnits.IsValidIndex(Command.Index);
+			break;
+		case EStratEconomyCommandType::QueueProduction:
+		case EStratEconomyCommandType::CancelProduction:
+		case EStratEconomyCommandType::RemoveProducer:
+			bValid &= LoadedProducerUnits.IsValidIndex(Command.Index);
+			break;
+		default:
+			break;
+		}
+	}
+	if (!bValid)
+	{
+		UE_LOG(LogStratEconomy, Error, TEXT("Saved economy is damaged. Keeping the current one."));
+		return false;
+	}
+
+	//~ Types that are gone drop out of the queues. The simulation ignores queue orders for them, and nothing spawns them.
+	const auto Remap = [TypeIdRemap](const uint16 TypeId)
+	{
+		return TypeIdRemap.IsEmpty() ? TypeId : TypeIdRemap.IsValidIndex(TypeId) ? TypeIdRemap[TypeId] : MAX_uint16;
+	};
+	LoadedSimulation.RemapTypeIds(TypeIdRemap);
+	for (FStratEconomyCommand& Command : LoadedCommands)
+	{
+		if (Command.Type == EStratEconomyCommandType::QueueProduction)
+		{
+			Command.TypeId = Remap(Command.TypeId);
+		}
+	}
+	for (FStratEconomySnapshot& Snapshot : LoadedSnapshots)
+	{
+		for (FStratEconomySnapshot::FProduced& Produced : Snapshot.Produced)
+		{
+			Produced.TypeId = Remap(Produced.TypeId);
+		}
+		Snapshot.Produced.RemoveAll([this](const FStratEconomySnapshot::FProduced& Produced) { return !UnitSim->GetTypeInfos().IsValidIndex(Produced.TypeId); });
+	}
+
+	Simulation = MoveTemp(LoadedSimulation);
+	Snapshots = MoveTemp(LoadedSnapshots);
+	FrontIndex = 0;
+	bStepUnpublished = bUnpublished != 0;
+	PendingCommands = MoveTemp(LoadedCommands);
+	NodeUnits = MoveTemp(LoadedNodeUnits);
+	FreeNodes = MoveTemp(LoadedFreeNodes);
+	Gatherers = MoveTemp(LoadedGatherers);
+	ProducerUnits = MoveTemp(LoadedProducerUnits);
+	FreeProducers = MoveTemp(LoadedFreeProducers);
+
+	NodeIndices.Reset();
+	for (int32 NodeIndex = 0; NodeIndex < NodeUnits.Num(); ++NodeIndex)
+	{
+		if (NodeUnits[NodeIndex].IsValid())
+		{
+			NodeIndices.Add(NodeUnits[NodeIndex], NodeIndex);
+		}
+	}
+	ProducerIndices.Reset();
+	for (int32 ProducerIndex = 0; ProducerIndex < ProducerUnits.Num(); ++ProducerIndex)
+	{
+		if (ProducerUnits[ProducerIndex].IsValid())
+		{
+			ProducerIndices.Add(ProducerUnits[ProducerIndex], ProducerIndex);
+		}
+	}
+
+	PushToPlayers(GetSnapshot());
+	return true;
+}
+
+void UStratEconomySubsystem::ResetState()
+{
+	WaitForStep();
+
+	Simulation.Reset();
+	Snapshots = TStaticArray<FStratEconomySnapshot, 2>();
+	FrontIndex = 0;
+	bStepUnpublished = false;
+	PendingCommands.Reset();
+	NodeUnits.Reset();
+	NodeIndices.Reset();
+	FreeNodes.Reset();
+	Gatherers.Reset();
+	ProducerUnits.Reset();
+	ProducerIndices.Reset();
+	FreeProducers.Reset();
+
+	PushToPlayers(GetSnapshot());
+}
+
+uint32 UStratEconomySubsystem::ComputeStateHash(uint32 Hash)
+{
+	//~ Lockstep hashes right after the sim step that may have launched this, so this is the one wait that can cost a little.
+	WaitForStep();
+
+	Hash = Simulation.ComputeStateHash(Hash);
+
+	//~ What the step in flight made that isn't spawned yet, and which slots the next nodes and producers get.
+	if (bStepUnpublished)
+	{
+		const FStratEconomySnapshot& Back = Snapshots[FrontIndex ^ 1];
+		for (const FStratEconomySnapshot::FProduced& Produced : Back.Produced)
+		{
+			Hash = FCrc::MemCrc32(&Produced.Producer, sizeof(int32), Hash);
+			Hash = FCrc::MemCrc32(&Produced.TypeId, sizeof(uint16), Hash);
+			Hash = FCrc::MemCrc32(&Produced.Faction, sizeof(uint8), Hash);
+		}
+		Hash = FCrc::MemCrc32(Back.DepletedNodes.GetData(), Back.DepletedNodes.Num() * sizeof(int32), Hash);
+	}
+	Hash = FCrc::MemCrc32(NodeUnits.GetData(), NodeUnits.Num() * sizeof(FStratUnitHandle), Hash);
+	Hash = FCrc::MemCrc32(FreeNodes.GetData(), FreeNodes.Num() * sizeof(int32), Hash);
+	Hash = FCrc::MemCrc32(ProducerUnits.GetData(), ProducerUnits.Num() * sizeof(FStratUnitHandle), Hash);
+	Hash = FCrc::MemCrc32(FreeProducers.GetData(), FreeProducers.Num() * sizeof(int32), Hash);
+	return Hash;
+}
+
+void UStratEconomySubsystem::OnSimStepped(const float FixedDeltaTime)
+{
+	if (UnitSim->GetSimFrame() % SimStepsPerEconomyStep != 0 || (GetWorld()->GetNetMode() == NM_Client && !UnitSim->IsLockstep()))
+	{
+		return;
+	}
+
+	LLM_SCOPE_BYTAG(StratUnits);
+
+	PublishStep();
+	LaunchStep();
+}
+
+void UStratEconomySubsystem::WaitForStep()
+{
+	if (StepTask.IsValid())
+	{
+		//~ Steps take microseconds and had a whole economy step to finish. Waiting here only shows up under a debugger.
+		SCOPE_CYCLE_COUNTER(STAT_StratEconomy_Wait);
+		StepTask.Wait();
+		StepTask = UE::Tasks::FTask();
+	}
+}
+
+void UStratEconomySubsystem::PublishStep()
+{
+	if (!bStepUnpublished)
+	{
+		return;
+	}
+
+	WaitForStep();
+	bStepUnpublished = false;
+
+	SCOPE_CYCLE_COUNTER(STAT_StratEconomy_Publish);
+
+	FrontIndex ^= 1;
+	const FStratEconomySnapshot& Snapshot = Snapshots[FrontIndex];
+
+	//~ Depleted nodes free their slots like dead ones. Whatever still stands there is just a unit now.
+	for (const int32 NodeIndex : Snapshot.DepletedNodes)
+	{
+		if (NodeUnits[NodeIndex].IsValid())
+		{
+			UE_LOG(LogStratEconomy, Verbose, TEXT("Resource node %s ran out."), *NodeUnits[NodeIndex].ToString());
+			RemoveNode(NodeIndex);
+		}
+	}
+
+	SpawnProduced(Snapshot);
+	PushToPlayers(Snapshot);
+	OnEconomyPublished.Broadcast(Snapshot);
+}
+
+void UStratEconomySubsystem::SpawnProduced(const FStratEconomySnapshot& Snapshot)
+{
+	const float SpawnOffset = GetDefault<UStratEconomySettings>()->SpawnOffset;
+	for (const FStratEconomySnapshot::FProduced& Produced : Snapshot.Produced)
+	{
+		//~ The producer died after the step was launched. Its queue was refunded, the finished unit is lost with it.
+		int32 Row;
+		const FStratUnitChunk* Chunk = UnitSim->FindUnit(ProducerUnits[Produced.Producer], Row);
+		if (!Chunk)
+		{
+			continue;
+		}
+
+		const FVector Forward = FRotator(0.f, Chunk->Yaws[Row], 0.f).Vector();
+		const FVector Location = FVector(Chunk->Positions[Row]) + Forward * (UnitSim->GetTypeInfo(Chunk->TypeIds[Row]).Radius + SpawnOffset);
+		UnitSim->SpawnUnitOfType(Produced.TypeId, Location, Produced.Faction);
+	}
+}
+
+void UStratEconomySubsystem::PushToPlayers(const FStratEconomySnapshot& Snapshot)
+{
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	if (!GameState)
+	{
+		return;
+	}
+
+	for (APlayerState* Player : GameState->PlayerArray)
+	{
+		const AStratPlayerState* StratPlayer = Cast<AStratPlayerState>(Player);
+		if (UStratEconomyComponent* Economy = StratPlayer ? StratPlayer->FindComponentByClass<UStratEconomyComponent>() : nullptr)
+		{
+			Economy->SetEconomy(Snapshot.Factions[StratPlayer->GetFactionId()]);
+		}
+	}
+}
+
+void UStratEconomySubsystem::LaunchStep()
+{
+	{
+		SCOPE_CYCLE_COUNTER(STAT_StratEconomy_GatherInput);
+
+		TaskInput.Reset();
+
+		//~ Dead producers refund their queues. Queued behind this step's orders, which were made while they still stood.
+		for (int32 ProducerIndex = 0; ProducerIndex < ProducerUnits.Num(); ++ProducerIndex)
+		{
+			if (ProducerUnits[ProducerIndex].IsValid() && !UnitSim->IsUnitValid(ProducerUnits[ProducerIndex]))
+			{
+				RemoveProducer(ProducerIndex);
+			}
+		}
+		for (int32 NodeIndex = 0; NodeIndex < NodeUnits.Num(); ++NodeIndex)
+		{
+			if (NodeUnits[NodeIndex].IsValid() && !UnitSim->IsUnitValid(NodeUnits[NodeIndex]))
+			{
+				RemoveNode(NodeIndex);
+			}
+		}
+		Swap(TaskInput.Commands, PendingCommands);
+
+		const float GatherRangeSq = FMath::Square(GetDefault<UStratEconomySettings>()->GatherRange);
+		for (auto It = Gatherers.CreateIterator(); It; ++It)
+		{
+			int32 Row;
+			int32 NodeRow;
+			const int32* NodeIndex = NodeIndices.Find(It.Value());
+			const FStratUnitChunk* Chunk = UnitSim->FindUnit(It.Key(), Row);
+			const FStratUnitChunk* NodeChunk = NodeIndex ? UnitSim->FindUnit(It.Value(), NodeRow) : nullptr;
+			if (!Chunk || !NodeChunk)
+			{
+				It.RemoveCurrent();
+				continue;
+			}
+
+			const FVector3f Offset = Chunk->Positions[Row] - NodeChunk->Positions[NodeRow];
+			if (FVector2f(Offset.X, Offset.Y).SizeSquared() <= GatherRangeSq)
+			{
+				TaskInput.Gatherers.Add({*NodeIndex, Chunk->Factions[Row]});
+			}
+		}
+
+		//~ The map's order depends on its whole history, which a load doesn't bring back. This order only on what's gathering.
+		TaskInput.Gatherers.Sort([](const FStratEconomyInput::FGatherer& A, const FStratEconomyInput::FGatherer& B)
+		{
+			return A.Node != B.Node ? A.Node < B.Node : A.Faction < B.Faction;
+		});
+
+		UnitSim->ForEachChunk([this](const FStratUnitChunk& Chunk)
+		{
+			for (int32 Row = 0; Row < Chunk.Num; ++Row)
+			{
+				//~ Loads and replication don't go through the spawn checks, so a bad id can still turn up here.
+				if (StratFaction::IsValidId(Chunk.Factions[Row]))
+				{
+					TaskInput.UpkeepMilli[Chunk.Factions[Row]] += TypeUpkeepMilli[Chunk.TypeIds[Row]];
+				}
+			}
+		});
+	}
+
+	bStepUnpublished = true;
+	FStratEconomySnapshot& Back = Snapshots[FrontIndex ^ 1];
+	StepTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [this, &Back]
+	{
+		SCOPE_CYCLE_COUNTER(STAT_StratEconomy_Step);
+		Simulation.Step(TaskInput, Back);
+	});
+}
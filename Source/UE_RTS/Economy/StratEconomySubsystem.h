@@ -0,0 +1,154 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StratEconomySimulation.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tasks/Task.h"
+#include "Units/StratUnitTypes.h"
+#include "StratEconomySubsystem.generated.h"
+
+class UStratLockstepSubsystem;
+class UStratUnitSimSubsystem;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogStratEconomy, Log, All);
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnStratEconomyPublished, const FStratEconomySnapshot& /*Snapshot*/);
+
+/**
+ * Resource nodes, gathering, upkeep and production queues for every faction, stepped as one FStratEconomySimulation on a
+ * worker task instead of as timers and ticks on the game thread.
+ *
+ * Every UStratEconomySettings::StepInterval worth of sim steps, the game thread waits for the previous step's task, which has
+ * long finished, publishes its snapshot, spawns what it produced, then gathers the next input and launches the next step.
+ * The worker writes the back snapshot while the game thread reads the front one, so results trail the simulation by one
+ * economy step and neither side ever locks.
+ *
+ * Published economies are pushed into each player's UStratEconomyComponent on AStratPlayerState, which replicates them to
+ * that player for the UI. The economy runs on the authority, or on every peer in lockstep, where the integer math and the
+ * step being tied to sim frames keep peers in agreement.
+ *
+ * Saves and replay keyframes carry the whole economy through WriteState, and lockstep folds it into its state hash.
+ * In lockstep every input below goes out as a UStratLockstepSubsystem command and is applied on its tick on every peer.
+ */
+UCLASS()
+class UE_RTS_API UStratEconomySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	/** Authority. Makes a unit a resource node holding Amount. Usually a structure. */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category=StratEconomy)
+	void AddResourceNode(FStratUnitHandle Node, EStratResource Resource, int32 Amount);
+
+	/** Sends a worker to gather from a node. It counts while within GatherRange of it. An invalid node unassigns the worker. */
+	UFUNCTION(BlueprintCallable, Category=StratEconomy)
+	void AssignGatherer(FStratUnitHandle Worker, FStratUnitHandle Node);
+
+	/** Queues a unit of TypeId at a producer, paid from the producer's faction. Dropped if unaffordable or the queue is full. */
+	void QueueProduction(const FStratUnitHandle& Producer, uint16 TypeId);
+
+	/** Cancels the producer's last queued unit and refunds it. */
+	UFUNCTION(BlueprintCallable, Category=StratEconomy)
+	void CancelProduction(FStratUnitHandle Producer);
+
+	/** Authority. Adds resources to a faction, or takes them when negative. */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category=StratEconomy)
+	void AddResources(uint8 Faction, EStratResource Resource, int32 Amount);
+
+	//~ The inputs above, applied on this machine right away. For UStratLockstepSubsystem applying a command on its tick.
+	void ApplyResourceNode(const FStratUnitHandle& Node, EStratResource Resource, int32 Amount);
+	void ApplyGatherer(const FStratUnitHandle& Worker, const FStratUnitHandle& Node);
+	void ApplyQueueProduction(const FStratUnitHandle& Producer, uint16 TypeId);
+	void ApplyCancelProduction(const FStratUnitHandle& Producer);
+	void ApplyResources(uint8 Faction, EStratResource Resource, int32 Amount);
+
+	/** The faction's economy as of the last published step. */
+	UFUNCTION(BlueprintPure, Category=StratEconomy)
+	FStratFactionEconomy GetFactionEconomy(uint8 Faction) const;
+
+	/** The last published step. Valid until the next one is published. */
+	const FStratEconomySnapshot& GetSnapshot() const { return Snapshots[FrontIndex]; }
+
+	/** Broadcast on the game thread after each step is published and its units spawned. */
+	FOnStratEconomyPublished OnEconomyPublished;
+
+	/**
+	 * Saves and replay keyframes. Waits for the step in flight, which has already changed the simulation, and writes what
+	 * it hasn't published yet along with everything else.
+	 */
+	void WriteState(FArchive& Ar);
+
+	/**
+	 * Replaces the economy with one WriteState wrote. TypeIdRemap maps saved type ids to this build's, empty keeps them.
+	 * False if Ar is damaged, which leaves the economy as it was.
+	 */
+	bool ReadState(FArchive& Ar, TConstArrayView<uint16> TypeIdRemap = {});
+
+	/** Back to the start of a match, for loads that carry no economy. */
+	void ResetState();
+
+	/** Folds the economy into a lockstep state hash. Waits for the step in flight. */
+	uint32 ComputeStateHash(uint32 Hash);
+
+	SIZE_T GetAllocatedSize() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void OnSimStepped(float FixedDeltaTime);
+
+	/** Set when inputs go through lockstep commands instead of applying here. */
+	UStratLockstepSubsystem* GetLockstep() const;
+
+	/** After this the game thread owns the simulation and both snapshots until the next launch. */
+	void WaitForStep();
+
+	/** Waits for the step in flight and swaps its snapshot to the front. */
+	void PublishStep();
+	void SpawnProduced(const FStratEconomySnapshot& Snapshot);
+	void PushToPlayers(const FStratEconomySnapshot& Snapshot);
+
+	/** Fills TaskInput from the units and the commands made since the last step, then launches the step. */
+	void LaunchStep();
+
+	int32 FindOrAddProducer(const FStratUnitHandle& Producer);
+	void RemoveProducer(int32 ProducerIndex);
+	void RemoveNode(int32 NodeIndex);
+
+	/** Owned by the task while it runs. The game thread only touches it after waiting. */
+	FStratEconomySimulation Simulation;
+	FStratEconomyInput TaskInput;
+	TStaticArray<FStratEconomySnapshot, 2> Snapshots;
+	int32 FrontIndex{0};
+	UE::Tasks::FTask StepTask;
+
+	/** A step was launched and the back snapshot holds its results. Survives WaitForStep, cleared by publishing them. */
+	bool bStepUnpublished{false};
+
+	/** Commands made since the last launch. Moved into TaskInput at the next one. */
+	TArray<FStratEconomyCommand> PendingCommands;
+
+	/** Per unit type, in milli per economy step. */
+	TArray<int64> TypeUpkeepMilli;
+
+	/** Game thread bookkeeping. Node and producer indices are the simulation's. Gatherers map each worker to its node. */
+	TArray<FStratUnitHandle> NodeUnits;
+	TMap<FStratUnitHandle, int32> NodeIndices;
+	TArray<int32> FreeNodes;
+	TMap<FStratUnitHandle, FStratUnitHandle> Gatherers;
+	TArray<FStratUnitHandle> ProducerUnits;
+	TMap<FStratUnitHandle, int32> ProducerIndices;
+	TArray<int32> FreeProducers;
+
+	int32 SimStepsPerEconomyStep{1};
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratUnitSimSubsystem> UnitSim;
+};
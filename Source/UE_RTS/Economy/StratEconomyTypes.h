@@ -0,0 +1,109 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StratEconomyTypes.generated.h"
+
+UENUM(BlueprintType)
+enum class EStratResource : uint8
+{
+	/** Pays upkeep. Armies starve without it. */
+	Supply,
+	Fuel,
+	Metal,
+
+	MAX UMETA(Hidden)
+};
+
+namespace StratEconomy
+{
+	constexpr int32 NumResources = static_cast<int32>(EStratResource::MAX);
+
+	/** The simulation counts thousandths of a resource, so slow rates still add up exactly in integers. */
+	constexpr int64 MilliPerUnit = 1000;
+}
+
+/** One amount per resource, in whole units. Costs, stockpiles and rates. */
+USTRUCT(BlueprintType)
+struct FStratResourceAmounts
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=StratEconomy, meta=(ClampMin="0"))
+	int32 Supply{0};
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=StratEconomy, meta=(ClampMin="0"))
+	int32 Fuel{0};
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=StratEconomy, meta=(ClampMin="0"))
+	int32 Metal{0};
+
+	static FStratResourceAmounts Make(const int32 InSupply, const int32 InFuel, const int32 InMetal)
+	{
+		FStratResourceAmounts Result;
+		Result.Supply = InSupply;
+		Result.Fuel = InFuel;
+		Result.Metal = InMetal;
+		return Result;
+	}
+
+	int32 Get(const EStratResource Resource) const
+	{
+		switch (Resource)
+		{
+		case EStratResource::Supply: return Supply;
+		case EStratResource::Fuel: return Fuel;
+		case EStratResource::Metal: return Metal;
+		default: return 0;
+		}
+	}
+
+	void Set(const EStratResource Resource, const int32 Amount)
+	{
+		switch (Resource)
+		{
+		case EStratResource::Supply: Supply = Amount;
+			break;
+		case EStratResource::Fuel: Fuel = Amount;
+			break;
+		case EStratResource::Metal: Metal = Amount;
+			break;
+		default: break;
+		}
+	}
+
+	bool operator==(const FStratResourceAmounts& Other) const { return Supply == Other.Supply && Fuel == Other.Fuel && Metal == Other.Metal; }
+};
+
+/** What a faction's players see of its economy. Published by UStratEconomySubsystem and replicated to the owning player. */
+USTRUCT(BlueprintType)
+struct FStratFactionEconomy
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category=StratEconomy)
+	FStratResourceAmounts Stockpile;
+
+	/** Gathered over the last economy step, scaled to a minute. Before upkeep. */
+	UPROPERTY(BlueprintReadOnly, Category=StratEconomy)
+	FStratResourceAmounts IncomePerMinute;
+
+	/** Supply the faction's units cost per minute. */
+	UPROPERTY(BlueprintReadOnly, Category=StratEconomy)
+	int32 UpkeepPerMinute{0};
+
+	/** Units waiting in every production queue of the faction. */
+	UPROPERTY(BlueprintReadOnly, Category=StratEconomy)
+	int32 NumQueued{0};
+
+	/** Supply ran out. Production is stalled until it's back. */
+	UPROPERTY(BlueprintReadOnly, Category=StratEconomy)
+	bool bStarved{false};
+
+	bool operator==(const FStratFactionEconomy& Other) const
+	{
+		return Stockpile == Other.Stockpile && IncomePerMinute == Other.IncomePerMinute && UpkeepPerMinute == Other.UpkeepPerMinute
+			&& NumQueued == Other.NumQueued && bStarved == Other.bStarved;
+	}
+};
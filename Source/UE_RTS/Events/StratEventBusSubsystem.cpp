@@ -0,0 +1,90 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratEventBusSubsystem.h"
+
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("Event Dispatch"), STAT_StratEvents_Dispatch, STATGROUP_StratUnits);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Events Dispatched"), STAT_StratEvents_NumDispatched, STATGROUP_StratUnits);
+DECLARE_MEMORY_STAT(TEXT("Event Queues"), STAT_StratEvents_Memory, STATGROUP_StratUnits);
+
+template <typename EventType>
+void UStratEventBusSubsystem::AddChannel(const int32 InitialCapacity)
+{
+	Queues[static_cast<int32>(EventType::Channel)] = MakeUnique<TStratEventQueue<EventType>>(InitialCapacity);
+}
+
+void UStratEventBusSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	//~ Sized for a large fight so steady play never grows them.
+	AddChannel<FStratUnitDiedEvent>(256);
+	AddChannel<FStratSelectionChangedEvent>(4);
+	AddChannel<FStratOrderIssuedEvent>(512);
+	AddChannel<FStratProjectileImpactEvent>(512);
+
+	for (int32 Channel = 0; Channel < Queues.Num(); ++Channel)
+	{
+		checkf(Queues[Channel].IsValid(), TEXT("Event channel %d has no queue. Add it in UStratEventBusSubsystem::Initialize."), Channel);
+	}
+}
+
+void UStratEventBusSubsystem::Deinitialize()
+{
+	for (TUniquePtr<FStratEventQueueBase>& Queue : Queues)
+	{
+		Queue.Reset();
+	}
+
+	Super::Deinitialize();
+}
+
+void UStratEventBusSubsystem::Tick(const float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_StratEvents_Dispatch);
+	STRAT_SCOPED_SYSTEM_TIMING(EventDispatch);
+
+	int32 NumDispatched = 0;
+	for (const TUniquePtr<FStratEventQueueBase>& Queue : Queues)
+	{
+		NumDispatched += Queue->NumQueued();
+		Queue->Dispatch();
+	}
+
+	SET_DWORD_STAT(STAT_StratEvents_NumDispatched, NumDispatched);
+	SET_MEMORY_STAT(STAT_StratEvents_Memory, GetAllocatedSize());
+}
+
+TStatId UStratEventBusSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UStratEventBusSubsystem, STATGROUP_StratUnits);
+}
+
+bool UStratEventBusSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UStratEventBusSubsystem::StopListeningAll(const UObject* UserObject)
+{
+	for (const TUniquePtr<FStratEventQueueBase>& Queue : Queues)
+	{
+		if (Queue)
+		{
+			Queue->RemoveListeners(UserObject);
+		}
+	}
+}
+
+SIZE_T UStratEventBusSubsystem::GetAllocatedSize() const
+{
+	SIZE_T Size = 0;
+	for (const TUniquePtr<FStratEventQueueBase>& Queue : Queues)
+	{
+		Size += Queue ? Queue->GetAllocatedSize() : 0;
+	}
+	return Size;
+}
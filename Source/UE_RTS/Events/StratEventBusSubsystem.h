@@ -0,0 +1,131 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StratEventTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include <type_traits>
+#include "StratEventBusSubsystem.generated.h"
+
+/** Queue of one channel. The bus only sees this base, so it can dispatch every channel in one loop. */
+class FStratEventQueueBase
+{
+public:
+	virtual ~FStratEventQueueBase() = default;
+
+	/** Hands everything queued so far to the listeners, then empties the queue. */
+	virtual void Dispatch() = 0;
+	virtual void RemoveListeners(FDelegateUserObjectConst UserObject) = 0;
+	virtual int32 NumQueued() const = 0;
+	virtual SIZE_T GetAllocatedSize() const = 0;
+};
+
+template <typename EventType>
+class TStratEventQueue final : public FStratEventQueueBase
+{
+	static_assert(std::is_trivially_copyable_v<EventType> && std::is_trivially_destructible_v<EventType>, "Events must be plain data.");
+
+public:
+	using FListener = TMulticastDelegate<void(TConstArrayView<EventType>)>;
+
+	explicit TStratEventQueue(const int32 InitialCapacity)
+	{
+		Queued.Reserve(InitialCapacity);
+		Dispatching.Reserve(InitialCapacity);
+	}
+
+	void Add(const EventType& Event) { Queued.Add(Event); }
+
+	virtual void Dispatch() override
+	{
+		if (Queued.IsEmpty())
+		{
+			return;
+		}
+
+		//~ Swap so listeners can raise more events of this channel. Those wait for the next frame. Both arrays keep their capacity.
+		Swap(Queued, Dispatching);
+		Listeners.Broadcast(Dispatching);
+		Dispatching.Reset();
+	}
+
+	virtual void RemoveListeners(const FDelegateUserObjectConst UserObject) override { Listeners.RemoveAll(UserObject); }
+	virtual int32 NumQueued() const override { return Queued.Num(); }
+	virtual SIZE_T GetAllocatedSize() const override { return Queued.GetAllocatedSize() + Dispatching.GetAllocatedSize(); }
+
+	FListener Listeners;
+
+private:
+	TArray<EventType> Queued;
+	TArray<EventType> Dispatching;
+};
+
+/**
+ * Gameplay events for native systems. Raising an event copies it into its channel's queue, and once per frame every channel
+ * hands its whole queue to each listener as one array. Queues keep their memory, so raising doesn't allocate once warm.
+ *
+ * Game thread only. For Blueprint facing notifications keep using the owning system's delegates.
+ */
+UCLASS()
+class UE_RTS_API UStratEventBusSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	//~ Begin UTickableWorldSubsystem interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~ End UTickableWorldSubsystem interface
+
+	/** Queues an event for this frame's dispatch. */
+	template <typename EventType>
+	void Raise(const EventType& Event)
+	{
+		checkSlow(IsInGameThread());
+		GetQueue<EventType>().Add(Event);
+	}
+
+	/** Func gets every event of the channel raised since the last dispatch, once per frame. Not called for empty frames. */
+	template <typename EventType, typename UserClass, typename FuncType>
+	FDelegateHandle Listen(UserClass* UserObject, FuncType Func)
+	{
+		return GetQueue<EventType>().Listeners.AddUObject(UserObject, Func);
+	}
+
+	template <typename EventType>
+	FDelegateHandle Listen(TFunction<void(TConstArrayView<EventType>)>&& Func)
+	{
+		return GetQueue<EventType>().Listeners.AddLambda(MoveTemp(Func));
+	}
+
+	template <typename EventType>
+	void StopListening(const FDelegateHandle Handle)
+	{
+		GetQueue<EventType>().Listeners.Remove(Handle);
+	}
+
+	/** Removes UserObject from every channel. */
+	void StopListeningAll(const UObject* UserObject);
+
+	SIZE_T GetAllocatedSize() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	template <typename EventType>
+	TStratEventQueue<EventType>& GetQueue()
+	{
+		return static_cast<TStratEventQueue<EventType>&>(*Queues[static_cast<int32>(EventType::Channel)]);
+	}
+
+	template <typename EventType>
+	void AddChannel(int32 InitialCapacity);
+
+	TStaticArray<TUniquePtr<FStratEventQueueBase>, static_cast<int32>(EStratEventChannel::MAX)> Queues;
+};
@@ -0,0 +1,64 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Units/StratUnitTypes.h"
+
+/** One queue and one listener list per channel. Add a channel here for every new event type. */
+enum class EStratEventChannel : uint8
+{
+	UnitDied,
+	SelectionChanged,
+	OrderIssued,
+	ProjectileImpact,
+
+	MAX
+};
+
+/**
+ * Events are plain data, copied into a contiguous queue per channel and handed to listeners as one array per frame.
+ * Every event type needs a static Channel. Keep them small, thousands can fire per second in a large fight.
+ */
+
+/** Authority, or every peer in lockstep. The unit is already gone from the simulation when listeners run. */
+struct FStratUnitDiedEvent
+{
+	static constexpr EStratEventChannel Channel = EStratEventChannel::UnitDied;
+
+	FStratUnitHandle Unit;
+	FVector3f Location{FVector3f::ZeroVector};
+	uint16 TypeId{0};
+	uint8 Faction{0};
+};
+
+/** The local player's selection changed. */
+struct FStratSelectionChangedEvent
+{
+	static constexpr EStratEventChannel Channel = EStratEventChannel::SelectionChanged;
+
+	int32 NumSelected{0};
+};
+
+/** Authority, or every peer in lockstep. A unit's order was replaced. */
+struct FStratOrderIssuedEvent
+{
+	static constexpr EStratEventChannel Channel = EStratEventChannel::OrderIssued;
+
+	FStratUnitHandle Unit;
+	FStratUnitHandle TargetUnit;
+	FVector3f TargetLocation{FVector3f::ZeroVector};
+	EStratUnitOrderType Type{EStratUnitOrderType::None};
+};
+
+/** A projectile hit a unit or the ground. Raised on every machine that flies it, so clients can play impacts too. */
+struct FStratProjectileImpactEvent
+{
+	static constexpr EStratEventChannel Channel = EStratEventChannel::ProjectileImpact;
+
+	FVector3f Location{FVector3f::ZeroVector};
+
+	/** Invalid for ground hits. */
+	FStratUnitHandle HitUnit;
+	uint16 ProjectileType{0};
+};
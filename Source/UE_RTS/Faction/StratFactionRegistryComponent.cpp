@@ -0,0 +1,61 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratFactionRegistryComponent.h"
+
+#include "StratFactionSubsystem.h"
+#include "Engine/World.h"
+#include "Net/UnrealNetwork.h"
+
+UStratFactionRegistryComponent::UStratFactionRegistryComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	SetIsReplicatedByDefault(true);
+
+	//~ Defaults on both ends, so only rows the server changed go over the wire.
+	Relations.Reserve(StratFaction::MaxFactions);
+	for (int32 Faction = 0; Faction < StratFaction::MaxFactions; ++Faction)
+	{
+		Relations.Add(FStratFactionRelations::MakeDefault(static_cast<uint8>(Faction)));
+	}
+}
+
+void UStratFactionRegistryComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(UStratFactionRegistryComponent, Relations);
+}
+
+void UStratFactionRegistryComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	UStratFactionSubsystem* Factions = GetWorld()->GetSubsystem<UStratFactionSubsystem>();
+	if (!Factions)
+	{
+		return;
+	}
+
+	//~ The server may have set relations before the game state existed.
+	if (GetOwner()->HasAuthority())
+	{
+		SetRelations(Factions->GetAllRelations());
+	}
+	else
+	{
+		Factions->ApplyReplicatedRelations(Relations);
+	}
+}
+
+void UStratFactionRegistryComponent::SetRelations(const TConstArrayView<FStratFactionRelations> InRelations)
+{
+	Relations = TArray<FStratFactionRelations>(InRelations);
+}
+
+void UStratFactionRegistryComponent::OnRep_Relations()
+{
+	if (UStratFactionSubsystem* Factions = GetWorld()->GetSubsystem<UStratFactionSubsystem>())
+	{
+		Factions->ApplyReplicatedRelations(Relations);
+	}
+}
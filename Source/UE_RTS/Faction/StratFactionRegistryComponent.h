@@ -0,0 +1,36 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/GameStateComponent.h"
+#include "StratFactionTypes.h"
+#include "StratFactionRegistryComponent.generated.h"
+
+/**
+ * Replicates the faction relation table of UStratFactionSubsystem. Lives on AStratGameState.
+ * The table is a fixed array of every faction, so a change only sends the rows that differ.
+ */
+UCLASS(ClassGroup=(Strat), meta=(BlueprintSpawnableComponent))
+class UE_RTS_API UStratFactionRegistryComponent : public UGameStateComponent
+{
+	GENERATED_BODY()
+
+public:
+	UStratFactionRegistryComponent(const FObjectInitializer& ObjectInitializer);
+
+	//~ Begin UActorComponent interface
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void BeginPlay() override;
+	//~ End UActorComponent interface
+
+	/** Server. */
+	void SetRelations(TConstArrayView<FStratFactionRelations> InRelations);
+
+protected:
+	UFUNCTION()
+	void OnRep_Relations();
+
+	UPROPERTY(ReplicatedUsing=OnRep_Relations)
+	TArray<FStratFactionRelations> Relations;
+};
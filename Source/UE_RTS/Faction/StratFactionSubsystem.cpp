@@ -0,0 +1,161 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratFactionSubsystem.h"
+
+#include "StratFactionRegistryComponent.h"
+#include "Engine/World.h"
+#include "Lockstep/StratLockstepSubsystem.h"
+#include "Player/StratGameState.h"
+
+DEFINE_LOG_CATEGORY(LogStratFaction);
+
+void UStratFactionSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	for (int32 Faction = 0; Faction < StratFaction::MaxFactions; ++Faction)
+	{
+		Relations[Faction] = FStratFactionRelations::MakeDefault(static_cast<uint8>(Faction));
+	}
+}
+
+bool UStratFactionSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+EStratFactionRelation UStratFactionSubsystem::GetRelation(const uint8 Faction, const uint8 Other) const
+{
+	if (!StratFaction::IsValidId(Faction) || !StratFaction::IsValidId(Other))
+	{
+		return EStratFactionRelation::Neutral;
+	}
+
+	if (IsAllied(Faction, Other))
+	{
+		return EStratFactionRelation::Ally;
+	}
+	return IsHostile(Faction, Other) ? EStratFactionRelation::Enemy : EStratFactionRelation::Neutral;
+}
+
+bool UStratFactionSubsystem::CanChange(const uint8 Faction, const uint8 Other) const
+{
+	if (GetWorld()->GetNetMode() == NM_Client)
+	{
+		UE_LOG(LogStratFaction, Warning, TEXT("Faction relations are authority only."));
+		return false;
+	}
+
+	if (!StratFaction::IsValidId(Faction) || !StratFaction::IsValidId(Other))
+	{
+		UE_LOG(LogStratFaction, Warning, TEXT("Faction ids go up to %d. Got %d and %d."), StratFaction::MaxFactions - 1, Faction, Other);
+		return false;
+	}
+	return true;
+}
+
+void UStratFactionSubsystem::SetRelation(const uint8 Faction, const uint8 Other, const EStratFactionRelation Relation)
+{
+	if (!CanChange(Faction, Other) || Faction == Other)
+	{
+		return;
+	}
+
+	if (UStratLockstepSubsystem* Lockstep = GetWorld()->GetSubsystem<UStratLockstepSubsystem>())
+	{
+		Lockstep->SubmitRelation(Faction, Other, Relation);
+		return;
+	}
+	ApplyRelation(Faction, Other, Relation);
+}
+
+void UStratFactionSubsystem::ApplyRelation(const uint8 Faction, const uint8 Other, const EStratFactionRelation Relation)
+{
+	if (!StratFaction::IsValidId(Faction) || !StratFaction::IsValidId(Other) || Faction == Other)
+	{
+		return;
+	}
+
+	const auto SetOneWay = [this, Relation](const uint8 From, const uint8 To)
+	{
+		FStratFactionRelations& Row = Relations[From];
+		const uint64 ToBit = StratFaction::Bit(To);
+		Row.Allies = Relation == EStratFactionRelation::Ally ? Row.Allies | ToBit : Row.Allies & ~ToBit;
+		Row.Enemies = Relation == EStratFactionRelation::Enemy ? Row.Enemies | ToBit : Row.Enemies & ~ToBit;
+	};
+	SetOneWay(Faction, Other);
+	SetOneWay(Other, Faction);
+
+	PushToRegistry();
+	OnRelationsChanged.Broadcast();
+}
+
+void UStratFactionSubsystem::SetSharedControl(const uint8 Faction, const uint8 Other, const bool bShared)
+{
+	if (!CanChange(Faction, Other) || Faction == Other)
+	{
+		return;
+	}
+
+	if (UStratLockstepSubsystem* Lockstep = GetWorld()->GetSubsystem<UStratLockstepSubsystem>())
+	{
+		Lockstep->SubmitSharedControl(Faction, Other, bShared);
+		return;
+	}
+	ApplySharedControl(Faction, Other, bShared);
+}
+
+void UStratFactionSubsystem::ApplySharedControl(const uint8 Faction, const uint8 Other, const bool bShared)
+{
+	if (!StratFaction::IsValidId(Faction) || !StratFaction::IsValidId(Other) || Faction == Other)
+	{
+		return;
+	}
+
+	FStratFactionRelations& Row = Relations[Faction];
+	const uint64 OtherBit = StratFaction::Bit(Other);
+	Row.Control = bShared ? Row.Control | OtherBit : Row.Control & ~OtherBit;
+
+	PushToRegistry();
+	OnRelationsChanged.Broadcast();
+}
+
+void UStratFactionSubsystem::ApplyReplicatedRelations(const TConstArrayView<FStratFactionRelations> InRelations)
+{
+	//~ Lockstep peers apply changes from the command stream on their tick. The replicated table lands whenever it lands.
+	if (GetWorld()->GetSubsystem<UStratLockstepSubsystem>())
+	{
+		return;
+	}
+	RestoreRelations(InRelations);
+}
+
+void UStratFactionSubsystem::RestoreRelations(const TConstArrayView<FStratFactionRelations> InRelations)
+{
+	if (InRelations.Num() != StratFaction::MaxFactions)
+	{
+		return;
+	}
+
+	for (int32 Faction = 0; Faction < StratFaction::MaxFactions; ++Faction)
+	{
+		Relations[Faction] = InRelations[Faction];
+	}
+	PushToRegistry();
+	OnRelationsChanged.Broadcast();
+}
+
+void UStratFactionSubsystem::PushToRegistry() const
+{
+	if (GetWorld()->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	//~ No game state yet is fine. The registry pulls the whole table when it begins play.
+	const AStratGameState* GameState = GetWorld()->GetGameState<AStratGameState>();
+	if (UStratFactionRegistryComponent* Registry = GameState ? GameState->GetFactionRegistry() : nullptr)
+	{
+		Registry->SetRelations(Relations);
+	}
+}
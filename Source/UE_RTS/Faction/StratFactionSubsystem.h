@@ -0,0 +1,85 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StratFactionTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "StratFactionSubsystem.generated.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogStratFaction, Log, All);
+
+DECLARE_MULTICAST_DELEGATE(FOnStratFactionRelationsChanged);
+
+/**
+ * Who is at war with whom, and who commands whose units. Every check is one AND against a 64 bit mask, so targeting, fog and
+ * selection can ask per unit. In a loop over many units, fetch the mask once with GetEnemyMask and test Bit(Faction) per unit.
+ *
+ * The server changes relations here. UStratFactionRegistryComponent on AStratGameState replicates them, and on clients
+ * writes them back here. In lockstep the simulation reads relations, so changes instead go through the command stream
+ * and every peer applies them on the same tick.
+ */
+UCLASS()
+class UE_RTS_API UStratFactionSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	//~ End USubsystem interface
+
+	bool IsHostile(const uint8 Faction, const uint8 Other) const { return (GetRelations(Faction).Enemies & StratFaction::Bit(Other)) != 0; }
+	bool IsAllied(const uint8 Faction, const uint8 Other) const { return (GetRelations(Faction).Allies & StratFaction::Bit(Other)) != 0; }
+
+	/** True if players of Commander can select and order units of UnitFaction. */
+	bool CanCommand(const uint8 Commander, const uint8 UnitFaction) const { return (GetRelations(Commander).Control & StratFaction::Bit(UnitFaction)) != 0; }
+
+	uint64 GetEnemyMask(const uint8 Faction) const { return GetRelations(Faction).Enemies; }
+	uint64 GetAllyMask(const uint8 Faction) const { return GetRelations(Faction).Allies; }
+	uint64 GetControlMask(const uint8 Faction) const { return GetRelations(Faction).Control; }
+
+	const FStratFactionRelations& GetRelations(const uint8 Faction) const
+	{
+		checkSlow(StratFaction::IsValidId(Faction));
+		return Relations[Faction];
+	}
+
+	TConstArrayView<FStratFactionRelations> GetAllRelations() const { return Relations; }
+
+	UFUNCTION(BlueprintPure, Category=StratFaction)
+	EStratFactionRelation GetRelation(uint8 Faction, uint8 Other) const;
+
+	/** Authority. Sets how both factions see each other. A faction is always its own ally. */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category=StratFaction)
+	void SetRelation(uint8 Faction, uint8 Other, EStratFactionRelation Relation);
+
+	/** Authority. Lets players of Faction select and order Other's units, like co-op players sharing an army. One way. */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category=StratFaction)
+	void SetSharedControl(uint8 Faction, uint8 Other, bool bShared);
+
+	/** Sets the relation on this machine right away. For UStratLockstepSubsystem applying a scheduled change, use SetRelation. */
+	void ApplyRelation(uint8 Faction, uint8 Other, EStratFactionRelation Relation);
+
+	/** Sets shared control on this machine right away. For UStratLockstepSubsystem applying a scheduled change, use SetSharedControl. */
+	void ApplySharedControl(uint8 Faction, uint8 Other, bool bShared);
+
+	/** Client. Called by UStratFactionRegistryComponent with the replicated table. Ignored in lockstep. */
+	void ApplyReplicatedRelations(TConstArrayView<FStratFactionRelations> InRelations);
+
+	/** Replaces the whole table on this machine, e.g. from a replay keyframe. */
+	void RestoreRelations(TConstArrayView<FStratFactionRelations> InRelations);
+
+	FOnStratFactionRelationsChanged OnRelationsChanged;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Logs and returns false for clients and ids out of range. */
+	bool CanChange(uint8 Faction, uint8 Other) const;
+
+	/** Server. Copies the table to the game state's registry for replication. */
+	void PushToRegistry() const;
+
+	TStaticArray<FStratFactionRelations, StratFaction::MaxFactions> Relations;
+};
@@ -0,0 +1,62 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StratFactionTypes.generated.h"
+
+namespace StratFaction
+{
+	/** Faction ids are 0 to MaxFactions - 1, one bit each in a relation mask. */
+	constexpr int32 MaxFactions = 64;
+
+	FORCEINLINE bool IsValidId(const int32 Faction) { return Faction >= 0 && Faction < MaxFactions; }
+
+	/** Ids out of range have no bit, so they match nothing instead of wrapping onto another faction. */
+	FORCEINLINE uint64 Bit(const uint8 Faction)
+	{
+		checkSlow(IsValidId(Faction));
+		return Faction < MaxFactions ? static_cast<uint64>(1) << Faction : 0;
+	}
+}
+
+UENUM(BlueprintType)
+enum class EStratFactionRelation : uint8
+{
+	/** Not attacked automatically and not commanded. */
+	Neutral,
+	Ally,
+	Enemy,
+};
+
+/**
+ * How one faction sees every other, as one bit per faction. A faction is always its own ally and controls its own units.
+ * Relations are kept symmetric by UStratFactionSubsystem. Control isn't, sharing an army both ways is two grants.
+ */
+USTRUCT()
+struct FStratFactionRelations
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	uint64 Allies{0};
+
+	UPROPERTY()
+	uint64 Enemies{0};
+
+	/** Factions whose units players of this faction can select and order. */
+	UPROPERTY()
+	uint64 Control{0};
+
+	/** Own faction only, at war with everyone else. Same as before factions had relations. */
+	static FStratFactionRelations MakeDefault(const uint8 Faction)
+	{
+		FStratFactionRelations Relations;
+		Relations.Allies = StratFaction::Bit(Faction);
+		Relations.Enemies = ~StratFaction::Bit(Faction);
+		Relations.Control = StratFaction::Bit(Faction);
+		return Relations;
+	}
+
+	bool operator==(const FStratFactionRelations& Other) const { return Allies == Other.Allies && Enemies == Other.Enemies && Control == Other.Control; }
+};
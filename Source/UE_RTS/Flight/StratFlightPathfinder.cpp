@@ -0,0 +1,191 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratFlightPathfinder.h"
+
+#include "Algo/Reverse.h"
+#include "World/StratHeightGrid.h"
+
+namespace
+{
+	constexpr int32 NeighborX[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+	constexpr int32 NeighborY[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+
+	FIntPoint ClampToGrid(const FStratHeightGrid& Grid, const FIntPoint& Cell)
+	{
+		return FIntPoint(FMath::Clamp(Cell.X, 0, Grid.SizeX - 1), FMath::Clamp(Cell.Y, 0, Grid.SizeY - 1));
+	}
+}
+
+bool FStratFlightPathfinder::FindPath(const FStratHeightGrid& Clearance, const FParams& Params, const FVector2D& Start, const FVector2D& Goal, TArray<FVector2D>& OutWaypoints)
+{
+	OutWaypoints.Reset();
+	if (!Clearance.IsValid())
+	{
+		return false;
+	}
+
+	const auto IsBlocked = [&Clearance, Ceiling = Params.Ceiling](const int32 X, const int32 Y)
+	{
+		return Clearance.Heights[Clearance.ToIndex(X, Y)] > Ceiling;
+	};
+
+	const FIntPoint StartCell = ClampToGrid(Clearance, Clearance.WorldToCell(Start));
+	const FIntPoint GoalCell = ClampToGrid(Clearance, Clearance.WorldToCell(Goal));
+	if (IsBlocked(GoalCell.X, GoalCell.Y))
+	{
+		return false;
+	}
+
+	//~ Most flights are over open ground. Skip the search when nothing is in the way.
+	if (StartCell == GoalCell || IsLineClear(Clearance, Params.Ceiling, Start, Goal))
+	{
+		OutWaypoints.Add(Goal);
+		return true;
+	}
+
+	ResetFor(Clearance.Heights.Num());
+
+	const float CellSize = Clearance.CellSize;
+	const auto EstimateCost = [&GoalCell, CellSize](const int32 X, const int32 Y)
+	{
+		//~ Octile distance. Never more than the real cost, which is at least the distance flown.
+		const int32 DX = FMath::Abs(X - GoalCell.X);
+		const int32 DY = FMath::Abs(Y - GoalCell.Y);
+		return (FMath::Max(DX, DY) + (UE_SQRT_2 - 1.f) * FMath::Min(DX, DY)) * CellSize;
+	};
+	const auto CheaperFirst = [](const FOpenCell& A, const FOpenCell& B) { return A.EstimatedCost < B.EstimatedCost; };
+
+	const int32 StartIndex = Clearance.ToIndex(StartCell.X, StartCell.Y);
+	const int32 GoalIndex = Clearance.ToIndex(GoalCell.X, GoalCell.Y);
+	CostSoFar[StartIndex] = 0.f;
+	CameFrom[StartIndex] = INDEX_NONE;
+	OpenedStamps[StartIndex] = SearchStamp;
+	OpenHeap.HeapPush({StartIndex, EstimateCost(StartCell.X, StartCell.Y)}, CheaperFirst);
+
+	bool bFound = false;
+	int32 NumExpanded = 0;
+	while (!OpenHeap.IsEmpty())
+	{
+		FOpenCell Current;
+		OpenHeap.HeapPop(Current, CheaperFirst, EAllowShrinking::No);
+
+		//~ A cell can be in the heap more than once when a cheaper way to it turned up. Only the first pop counts.
+		if (ClosedStamps[Current.Index] == SearchStamp)
+		{
+			continue;
+		}
+		ClosedStamps[Current.Index] = SearchStamp;
+
+		if (Current.Index == GoalIndex)
+		{
+			bFound = true;
+			break;
+		}
+
+		if (++NumExpanded > Params.MaxSearchCells)
+		{
+			break;
+		}
+
+		const int32 X = Current.Index % Clearance.SizeX;
+		const int32 Y = Current.Index / Clearance.SizeX;
+		const float Height = Clearance.Heights[Current.Index];
+
+		for (int32 Dir = 0; Dir < 8; ++Dir)
+		{
+			const int32 NX = X + NeighborX[Dir];
+			const int32 NY = Y + NeighborY[Dir];
+			if (!Clearance.IsValidCell(NX, NY) || IsBlocked(NX, NY))
+			{
+				continue;
+			}
+
+			const bool bDiagonal = Dir >= 4;
+			if (bDiagonal && (IsBlocked(NX, Y) || IsBlocked(X, NY)))
+			{
+				continue;
+			}
+
+			const int32 NeighborIndex = Clearance.ToIndex(NX, NY);
+			if (ClosedStamps[NeighborIndex] == SearchStamp)
+			{
+				continue;
+			}
+
+			const float Climb = FMath::Max(0.f, Clearance.Heights[NeighborIndex] - Height);
+			const float NewCost = CostSoFar[Current.Index] + (bDiagonal ? UE_SQRT_2 : 1.f) * CellSize + Climb * Params.ClimbCost;
+			if (OpenedStamps[NeighborIndex] == SearchStamp && NewCost >= CostSoFar[NeighborIndex])
+			{
+				continue;
+			}
+
+			OpenedStamps[NeighborIndex] = SearchStamp;
+			CostSoFar[NeighborIndex] = NewCost;
+			CameFrom[NeighborIndex] = Current.Index;
+			OpenHeap.HeapPush({NeighborIndex, NewCost + EstimateCost(NX, NY)}, CheaperFirst);
+		}
+	}
+
+	if (!bFound)
+	{
+		return false;
+	}
+
+	CellPath.Reset();
+	for (int32 Index = GoalIndex; Index != INDEX_NONE; Index = CameFrom[Index])
+	{
+		CellPath.Add(FIntPoint(Index % Clearance.SizeX, Index / Clearance.SizeX));
+	}
+	Algo::Reverse(CellPath);
+
+	//~ Pull the cell path tight. Each leg runs as far as a straight line stays clear, then turns at the last cell it reached.
+	FVector2D Anchor = Start;
+	for (int32 PathIndex = 1; PathIndex < CellPath.Num(); ++PathIndex)
+	{
+		if (!IsLineClear(Clearance, Params.Ceiling, Anchor, Clearance.CellToWorld(CellPath[PathIndex])))
+		{
+			Anchor = Clearance.CellToWorld(CellPath[PathIndex - 1]);
+			OutWaypoints.Add(Anchor);
+		}
+	}
+	OutWaypoints.Add(Goal);
+	return true;
+}
+
+bool FStratFlightPathfinder::IsLineClear(const FStratHeightGrid& Clearance, const float Ceiling, const FVector2D& A, const FVector2D& B)
+{
+	//~ Half cell steps. Clearance is already widened by ClearanceRadius, which covers corners the samples skip.
+	const FVector2D Delta = B - A;
+	const int32 NumSamples = FMath::Max(1, FMath::CeilToInt32(Delta.Size() / (Clearance.CellSize * 0.5f)));
+	for (int32 Sample = 0; Sample <= NumSamples; ++Sample)
+	{
+		const FIntPoint Cell = Clearance.WorldToCell(A + Delta * (static_cast<double>(Sample) / NumSamples));
+		if (!Clearance.IsValidCell(Cell.X, Cell.Y) || Clearance.Heights[Clearance.ToIndex(Cell.X, Cell.Y)] > Ceiling)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void FStratFlightPathfinder::ResetFor(const int32 NumCells)
+{
+	if (OpenedStamps.Num() != NumCells)
+	{
+		CostSoFar.SetNumUninitialized(NumCells);
+		CameFrom.SetNumUninitialized(NumCells);
+		OpenedStamps.Init(0, NumCells);
+		ClosedStamps.Init(0, NumCells);
+		SearchStamp = 0;
+	}
+
+	//~ Stamps wrapped. Clear them so old marks can't match the new stamp.
+	if (++SearchStamp == 0)
+	{
+		FMemory::Memzero(OpenedStamps.GetData(), OpenedStamps.Num() * sizeof(uint32));
+		FMemory::Memzero(ClosedStamps.GetData(), ClosedStamps.Num() * sizeof(uint32));
+		SearchStamp = 1;
+	}
+
+	OpenHeap.Reset();
+}
@@ -0,0 +1,47 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FStratHeightGrid;
+
+/**
+ * A* over a 2.5D clearance grid, where each cell's height is the lowest safe altitude to fly over it.
+ * Cells that need more than the ceiling are walls. The cell path is then pulled tight into as few straight legs as possible.
+ *
+ * Keeps its node arrays between searches and tells them apart by a search stamp, so searching doesn't allocate once warm.
+ */
+class UE_RTS_API FStratFlightPathfinder
+{
+public:
+	struct FParams
+	{
+		float Ceiling{0.f};
+		float ClimbCost{0.f};
+		int32 MaxSearchCells{0};
+	};
+
+	/** Waypoints from Start, excluding it, to Goal. False if Goal is unreachable or the search ran out of cells. */
+	bool FindPath(const FStratHeightGrid& Clearance, const FParams& Params, const FVector2D& Start, const FVector2D& Goal, TArray<FVector2D>& OutWaypoints);
+
+	/** True if a straight flight from A to B stays under Ceiling. */
+	static bool IsLineClear(const FStratHeightGrid& Clearance, float Ceiling, const FVector2D& A, const FVector2D& B);
+
+private:
+	struct FOpenCell
+	{
+		int32 Index;
+		float EstimatedCost;
+	};
+
+	void ResetFor(int32 NumCells);
+
+	TArray<float> CostSoFar;
+	TArray<int32> CameFrom;
+	TArray<uint32> OpenedStamps;
+	TArray<uint32> ClosedStamps;
+	TArray<FOpenCell> OpenHeap;
+	TArray<FIntPoint> CellPath;
+	uint32 SearchStamp{0};
+};
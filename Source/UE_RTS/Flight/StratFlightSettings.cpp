@@ -0,0 +1,8 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratFlightSettings.h"
+
+UStratFlightSettings::UStratFlightSettings()
+{
+	CategoryName = TEXT("Game");
+}
@@ -0,0 +1,48 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "StratFlightSettings.generated.h"
+
+/** Project settings for flying units. Found under Project Settings > Game > Strat Flight. */
+UCLASS(Config=Game, DefaultConfig, meta=(DisplayName="Strat Flight"))
+class UE_RTS_API UStratFlightSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UStratFlightSettings();
+
+	/** Size of a clearance cell. Paths are searched cell by cell, so bigger cells search faster but route coarser. */
+	UPROPERTY(Config, EditAnywhere, Category="Flight", meta=(ClampMin="100.0", UIMin="400.0", UIMax="2000.0", Units="cm"))
+	float FlightCellSize{800.f};
+
+	/** Flying units stay at least this high above the highest terrain or roof near them. */
+	UPROPERTY(Config, EditAnywhere, Category="Flight", meta=(ClampMin="0.0", Units="cm"))
+	float ClearanceMargin{400.f};
+
+	/** Ground this far outside a cell still counts toward its clearance, so a unit's body doesn't clip a peak beside its path. */
+	UPROPERTY(Config, EditAnywhere, Category="Flight", meta=(ClampMin="0.0", Units="cm"))
+	float ClearanceRadius{400.f};
+
+	/** Highest altitude flying units may reach. Cells that need more are impassable, so tall mountains are flown around. */
+	UPROPERTY(Config, EditAnywhere, Category="Flight", meta=(Units="cm"))
+	float FlightCeiling{12000.f};
+
+	/** Path cost of every cm climbed, on top of distance. Higher prefers flying around hills over flying across them. */
+	UPROPERTY(Config, EditAnywhere, Category="Flight", meta=(ClampMin="0.0"))
+	float ClimbCost{0.5f};
+
+	/** Searches give up after this many cells and the unit flies straight. */
+	UPROPERTY(Config, EditAnywhere, Category="Flight", meta=(ClampMin="100"))
+	int32 MaxSearchCells{40000};
+
+	UPROPERTY(Config, EditAnywhere, Category="Flight", meta=(ClampMin="1.0", Units="cm/s"))
+	float ClimbRate{800.f};
+
+	/** Flying units climb for what's this far ahead of them, so they clear a ridge instead of reaching it low. */
+	UPROPERTY(Config, EditAnywhere, Category="Flight", meta=(ClampMin="0.0", Units="s"))
+	float LookAheadTime{1.5f};
+};
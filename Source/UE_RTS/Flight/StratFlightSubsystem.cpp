@@ -0,0 +1,267 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratFlightSubsystem.h"
+
+#include "StratFlightSettings.h"
+#include "Engine/World.h"
+#include "Units/StratUnitSimSubsystem.h"
+#include "World/StratTerrainSubsystem.h"
+
+DEFINE_LOG_CATEGORY(LogStratFlight);
+
+DECLARE_CYCLE_STAT(TEXT("Flight Path Search"), STAT_StratFlight_PathSearch, STATGROUP_StratUnits);
+DECLARE_CYCLE_STAT(TEXT("Flight Clearance Rebuild"), STAT_StratFlight_ClearanceRebuild, STATGROUP_StratUnits);
+DECLARE_CYCLE_STAT(TEXT("Flight Altitude"), STAT_StratFlight_Altitude, STATGROUP_StratUnits);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Flight Routes"), STAT_StratFlight_Routes, STATGROUP_StratUnits);
+
+void UStratFlightSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UnitSim = Collection.InitializeDependency<UStratUnitSimSubsystem>();
+	Terrain = Collection.InitializeDependency<UStratTerrainSubsystem>();
+
+	if (UnitSim)
+	{
+		UnitSim->OnPostSimStep.AddUObject(this, &ThisClass::OnSimStepped);
+	}
+
+	if (Terrain)
+	{
+		Terrain->OnHeightsChanged.AddUObject(this, &ThisClass::OnTerrainHeightsChanged);
+	}
+}
+
+void UStratFlightSubsystem::Deinitialize()
+{
+	if (UnitSim)
+	{
+		UnitSim->OnPostSimStep.RemoveAll(this);
+	}
+
+	if (Terrain)
+	{
+		Terrain->OnHeightsChanged.RemoveAll(this);
+	}
+
+	Routes.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UStratFlightSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UStratFlightSubsystem::IssueFlightMove(const FStratUnitHandle Unit, const FVector& Location)
+{
+	if (GetWorld()->GetNetMode() == NM_Client || UnitSim->IsLockstep())
+	{
+		UE_LOG(LogStratFlight, Warning, TEXT("IssueFlightMove is authority only and not for lockstep. %s wasn't ordered."), *Unit.ToString());
+		return;
+	}
+
+	int32 Row;
+	const FStratUnitChunk* Chunk = UnitSim->FindUnit(Unit, Row);
+	if (!Chunk)
+	{
+		return;
+	}
+
+	if (Chunk->Archetype != EStratUnitArchetype::Flying)
+	{
+		UnitSim->IssueMoveOrder(Unit, Location);
+		return;
+	}
+
+	//~ A new flight move replaces whatever was queued. The legs themselves keep the queue for after the flight.
+	UnitSim->ClearQueuedOrders(Unit);
+
+	FFlightRoute Route;
+	if (PlanRoute(Unit, FVector2D(Chunk->Positions[Row].X, Chunk->Positions[Row].Y), FVector2D(Location), Route))
+	{
+		Routes.Add(Unit, MoveTemp(Route));
+	}
+	else
+	{
+		Routes.Remove(Unit);
+		UnitSim->IssueMoveOrder(Unit, Location);
+	}
+}
+
+float UStratFlightSubsystem::GetSafeAltitude(const FVector& Location) const
+{
+	return GetCellClearance(FVector2D(Location));
+}
+
+float UStratFlightSubsystem::GetCellClearance(const FVector2D& WorldXY) const
+{
+	if (!Clearance.IsValid())
+	{
+		return 0.f;
+	}
+
+	//~ The cell's own value, not a blend. Blending would dip below a peak that only one neighbor covers.
+	const FIntPoint Cell = Clearance.WorldToCell(WorldXY);
+	return Clearance.GetCellHeight(Cell.X, Cell.Y);
+}
+
+void UStratFlightSubsystem::OnTerrainHeightsChanged(const FBox2D& ChangedArea)
+{
+	SCOPE_CYCLE_COUNTER(STAT_StratFlight_ClearanceRebuild);
+
+	const FStratHeightGrid& TerrainGrid = Terrain->GetHeightGrid();
+	const UStratFlightSettings* Settings = GetDefault<UStratFlightSettings>();
+
+	//~ First build. Everything after that only rebuilds cells the change can reach.
+	if (!Clearance.IsValid())
+	{
+		Clearance.Init(TerrainGrid.GetBounds(), Settings->FlightCellSize);
+	}
+
+	const FIntRect CellRect = Clearance.GetCellRect(ChangedArea.ExpandBy(Settings->ClearanceRadius));
+	const double HalfExtent = Clearance.CellSize * 0.5 + Settings->ClearanceRadius;
+	for (int32 Y = CellRect.Min.Y; Y < CellRect.Max.Y; ++Y)
+	{
+		for (int32 X = CellRect.Min.X; X < CellRect.Max.X; ++X)
+		{
+			const FVector2D Center = Clearance.CellToWorld(FIntPoint(X, Y));
+			const FIntRect HeightRect = TerrainGrid.GetCellRect(FBox2D(Center - FVector2D(HalfExtent), Center + FVector2D(HalfExtent)));
+
+			float Highest = TerrainGrid.SampleHeight(Center);
+			for (int32 HY = HeightRect.Min.Y; HY < HeightRect.Max.Y; ++HY)
+			{
+				for (int32 HX = HeightRect.Min.X; HX < HeightRect.Max.X; ++HX)
+				{
+					Highest = FMath::Max(Highest, TerrainGrid.Heights[TerrainGrid.ToIndex(HX, HY)]);
+				}
+			}
+
+			Clearance.Heights[Clearance.ToIndex(X, Y)] = Highest + Settings->ClearanceMargin;
+		}
+	}
+
+	bRoutesDirty = !Routes.IsEmpty();
+}
+
+void UStratFlightSubsystem::OnSimStepped(const float FixedDeltaTime)
+{
+	if (GetWorld()->GetNetMode() != NM_Client && !UnitSim->IsLockstep())
+	{
+		AdvanceRoutes();
+	}
+
+	UpdateAltitudes(FixedDeltaTime);
+
+	SET_DWORD_STAT(STAT_StratFlight_Routes, Routes.Num());
+}
+
+void UStratFlightSubsystem::AdvanceRoutes()
+{
+	const float Ceiling = GetDefault<UStratFlightSettings>()->FlightCeiling;
+
+	for (auto It = Routes.CreateIterator(); It; ++It)
+	{
+		const FStratUnitHandle Unit = It.Key();
+		FFlightRoute& Route = It.Value();
+
+		int32 Row;
+		const FStratUnitChunk* Chunk = UnitSim->FindUnit(Unit, Row);
+		if (!Chunk)
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		if (EnumHasAnyFlags(Chunk->Flags[Row], EStratUnitFlags::OrderCompleted))
+		{
+			if (++Route.NextWaypoint >= Route.Waypoints.Num())
+			{
+				It.RemoveCurrent();
+				continue;
+			}
+
+			UnitSim->SetCurrentOrder(Unit, FStratUnitOrder::MakeMove(FVector(Route.Waypoints[Route.NextWaypoint], 0.0)));
+			continue;
+		}
+
+		//~ Something else gave the unit a new order. The route is no longer the plan.
+		const FStratUnitOrder& Order = Chunk->Orders[Row];
+		const FVector2D Waypoint = Route.Waypoints[Route.NextWaypoint];
+		if (Order.Type != EStratUnitOrderType::Move || !FVector2D(Order.TargetLocation.X, Order.TargetLocation.Y).Equals(Waypoint, 1.0))
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		//~ The terrain changed. Search again if the current leg is now blocked.
+		const FVector2D UnitXY(Chunk->Positions[Row].X, Chunk->Positions[Row].Y);
+		if (bRoutesDirty && !FStratFlightPathfinder::IsLineClear(Clearance, Ceiling, UnitXY, Waypoint))
+		{
+			const FVector2D Destination = Route.Waypoints.Last();
+			if (!PlanRoute(Unit, UnitXY, Destination, Route))
+			{
+				UnitSim->SetCurrentOrder(Unit, FStratUnitOrder::MakeMove(FVector(Destination, 0.0)));
+				It.RemoveCurrent();
+			}
+		}
+	}
+
+	bRoutesDirty = false;
+}
+
+bool UStratFlightSubsystem::PlanRoute(const FStratUnitHandle& Unit, const FVector2D& From, const FVector2D& To, FFlightRoute& OutRoute)
+{
+	SCOPE_CYCLE_COUNTER(STAT_StratFlight_PathSearch);
+
+	const UStratFlightSettings* Settings = GetDefault<UStratFlightSettings>();
+	FStratFlightPathfinder::FParams Params;
+	Params.Ceiling = Settings->FlightCeiling;
+	Params.ClimbCost = Settings->ClimbCost;
+	Params.MaxSearchCells = Settings->MaxSearchCells;
+
+	OutRoute.NextWaypoint = 0;
+	if (!Pathfinder.FindPath(Clearance, Params, From, To, OutRoute.Waypoints))
+	{
+		return false;
+	}
+
+	//~ Flying moves ignore the order's Z. Altitude is UpdateAltitudes' job.
+	UnitSim->SetCurrentOrder(Unit, FStratUnitOrder::MakeMove(FVector(OutRoute.Waypoints[0], 0.0)));
+	return true;
+}
+
+void UStratFlightSubsystem::UpdateAltitudes(const float FixedDeltaTime)
+{
+	if (!Clearance.IsValid())
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_StratFlight_Altitude);
+
+	const UStratFlightSettings* Settings = GetDefault<UStratFlightSettings>();
+	const bool bLockstep = UnitSim->IsLockstep();
+
+	UnitSim->ForEachChunk([this, Settings, bLockstep, FixedDeltaTime](FStratUnitChunk& Chunk)
+	{
+		if (Chunk.Archetype != EStratUnitArchetype::Flying)
+		{
+			return;
+		}
+
+		for (int32 Row = 0; Row < Chunk.Num; ++Row)
+		{
+			FVector3f& Position = Chunk.Positions[Row];
+			const FVector2D Here(Position.X, Position.Y);
+			const FVector2D Ahead = Here + FVector2D(Chunk.Velocities[Row].X, Chunk.Velocities[Row].Y) * Settings->LookAheadTime;
+
+			const float Floor = GetCellClearance(Here);
+			const float Target = FMath::Max(Floor, FMath::Min(GetCellClearance(Ahead), Settings->FlightCeiling));
+
+			//~ In lockstep the position was just rewritten from fixed point, so there's no altitude to carry over.
+			Position.Z = bLockstep ? Target : FMath::Max(FMath::FInterpConstantTo(Position.Z, Target, FixedDeltaTime, Settings->ClimbRate), Floor);
+		}
+	});
+}
@@ -0,0 +1,84 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StratFlightPathfinder.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Units/StratUnitTypes.h"
+#include "World/StratHeightGrid.h"
+#include "StratFlightSubsystem.generated.h"
+
+class UStratTerrainSubsystem;
+class UStratUnitSimSubsystem;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogStratFlight, Log, All);
+
+/**
+ * Routing for flying units. Keeps a 2.5D clearance grid, the lowest safe altitude over each cell, built from the terrain
+ * height grid, which already includes building roofs. Only cells under a terrain change are rebuilt.
+ *
+ * Flight moves are searched on that grid and flown as straight legs, one move order each. Every sim step, flying units
+ * climb or sink toward the clearance under and just ahead of them. Cells above UStratFlightSettings::FlightCeiling are
+ * flown around.
+ *
+ * Routes are authority only and not for lockstep, where flight moves go through UStratLockstepSubsystem as straight moves.
+ * Altitude runs on every machine. In lockstep it only lifts the presented position, which the simulation never reads back.
+ */
+UCLASS()
+class UE_RTS_API UStratFlightSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	/** Routes a flying unit around anything above the ceiling. Falls back to a straight move when there's no route. */
+	UFUNCTION(BlueprintCallable, Category=StratFlight)
+	void IssueFlightMove(FStratUnitHandle Unit, const FVector& Location);
+
+	/** Lowest safe altitude over a location. */
+	UFUNCTION(BlueprintPure, Category=StratFlight)
+	float GetSafeAltitude(const FVector& Location) const;
+
+	const FStratHeightGrid& GetClearance() const { return Clearance; }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void OnTerrainHeightsChanged(const FBox2D& ChangedArea);
+	void OnSimStepped(float FixedDeltaTime);
+	void AdvanceRoutes();
+	void UpdateAltitudes(float FixedDeltaTime);
+
+	float GetCellClearance(const FVector2D& WorldXY) const;
+
+	/** Remaining legs of a flight. The unit's current move order is to Waypoints[NextWaypoint]. */
+	struct FFlightRoute
+	{
+		TArray<FVector2D> Waypoints;
+		int32 NextWaypoint{0};
+	};
+
+	/** Searches a route and orders the unit along its first leg. False if there's no route. */
+	bool PlanRoute(const FStratUnitHandle& Unit, const FVector2D& From, const FVector2D& To, FFlightRoute& OutRoute);
+
+	TMap<FStratUnitHandle, FFlightRoute> Routes;
+
+	/** Heights are the lowest safe altitude per cell. */
+	FStratHeightGrid Clearance;
+
+	FStratFlightPathfinder Pathfinder;
+
+	/** Routes might cross changed cells. Checked on the next step. */
+	bool bRoutesDirty{false};
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratUnitSimSubsystem> UnitSim;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratTerrainSubsystem> Terrain;
+};
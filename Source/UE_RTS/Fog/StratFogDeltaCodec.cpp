@@ -0,0 +1,147 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratFogDeltaCodec.h"
+
+namespace
+{
+	void WriteVarInt(TArray<uint8>& Out, uint32 Value)
+	{
+		while (Value >= 0x80)
+		{
+			Out.Add(static_cast<uint8>(Value | 0x80));
+			Value >>= 7;
+		}
+		Out.Add(static_cast<uint8>(Value));
+	}
+
+	bool ReadVarInt(const TConstArrayView<uint8> In, int32& InOutOffset, uint32& OutValue)
+	{
+		OutValue = 0;
+		for (int32 Shift = 0; Shift < 32; Shift += 7)
+		{
+			if (!In.IsValidIndex(InOutOffset))
+			{
+				return false;
+			}
+
+			const uint8 Byte = In[InOutOffset++];
+			OutValue |= static_cast<uint32>(Byte & 0x7F) << Shift;
+			if ((Byte & 0x80) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	uint32 GetDiffWord(const TArray<uint32>* BaseWords, const TArray<uint32>& CurrentWords, const int32 WordIndex)
+	{
+		return BaseWords ? (*BaseWords)[WordIndex] ^ CurrentWords[WordIndex] : CurrentWords[WordIndex];
+	}
+
+	/** Flips bits [Start, Start + Count) of Words. */
+	void FlipRange(TArray<uint32>& Words, int32 Start, int32 Count)
+	{
+		while (Count > 0)
+		{
+			const int32 WordIndex = Start >> 5;
+			const int32 BitInWord = Start & 31;
+			const int32 BitsThisWord = FMath::Min(Count, 32 - BitInWord);
+			const uint32 Mask = BitsThisWord == 32 ? ~0u : ((1u << BitsThisWord) - 1) << BitInWord;
+			Words[WordIndex] ^= Mask;
+			Start += BitsThisWord;
+			Count -= BitsThisWord;
+		}
+	}
+}
+
+void StratFogDelta::Encode(const TArray<uint32>* BaseWords, const TArray<uint32>& CurrentWords, const int32 NumBits, TArray<uint8>& OutPayload)
+{
+	const int32 NumWords = FMath::DivideAndRoundUp(NumBits, 32);
+	check(CurrentWords.Num() >= NumWords && (!BaseWords || BaseWords->Num() >= NumWords));
+
+	OutPayload.Reset();
+	WriteVarInt(OutPayload, static_cast<uint32>(NumBits));
+
+	//~ Runs alternate, starting with unchanged bits. A zero length first run is allowed.
+	bool bRunIsFlipped = false;
+	uint32 RunLength = 0;
+	int32 Bit = 0;
+	while (Bit < NumBits)
+	{
+		const int32 WordIndex = Bit >> 5;
+		const uint32 Diff = GetDiffWord(BaseWords, CurrentWords, WordIndex);
+		const bool bWholeWord = (Bit & 31) == 0 && Bit + 32 <= NumBits;
+
+		//~ Most words are all unchanged (or, for a full resend of explored areas, all set). Skip them 32 bits at a time.
+		if (bWholeWord && Diff == (bRunIsFlipped ? ~0u : 0u))
+		{
+			RunLength += 32;
+			Bit += 32;
+			continue;
+		}
+
+		const bool bFlipped = (Diff >> (Bit & 31)) & 1u;
+		if (bFlipped != bRunIsFlipped)
+		{
+			WriteVarInt(OutPayload, RunLength);
+			bRunIsFlipped = bFlipped;
+			RunLength = 0;
+		}
+		++RunLength;
+		++Bit;
+	}
+
+	//~ A trailing unchanged run is implied.
+	if (bRunIsFlipped)
+	{
+		WriteVarInt(OutPayload, RunLength);
+	}
+}
+
+bool StratFogDelta::Decode(const TArray<uint32>* BaseWords, const TConstArrayView<uint8> Payload, const int32 NumBits, TArray<uint32>& OutWords)
+{
+	const int32 NumWords = FMath::DivideAndRoundUp(NumBits, 32);
+	if (BaseWords && BaseWords->Num() < NumWords)
+	{
+		return false;
+	}
+
+	int32 Offset = 0;
+	uint32 EncodedNumBits;
+	if (!ReadVarInt(Payload, Offset, EncodedNumBits) || EncodedNumBits != static_cast<uint32>(NumBits))
+	{
+		return false;
+	}
+
+	if (BaseWords)
+	{
+		OutWords = *BaseWords;
+	}
+	else
+	{
+		OutWords.Reset();
+		OutWords.SetNumZeroed(NumWords);
+	}
+
+	bool bRunIsFlipped = false;
+	int64 Bit = 0;
+	while (Offset < Payload.Num())
+	{
+		uint32 RunLength;
+		if (!ReadVarInt(Payload, Offset, RunLength) || Bit + RunLength > NumBits)
+		{
+			return false;
+		}
+
+		if (bRunIsFlipped)
+		{
+			FlipRange(OutWords, static_cast<int32>(Bit), static_cast<int32>(RunLength));
+		}
+
+		Bit += RunLength;
+		bRunIsFlipped = !bRunIsFlipped;
+	}
+
+	return true;
+}
@@ -0,0 +1,18 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Run-length codec for fog bitsets. Encodes the XOR of a base and a current bitset as alternating runs of unchanged and
+ * flipped bits, each run a varint. Fog changes are spatially coherent, so a moving army costs a handful of bytes.
+ * A null base means all zeros, which makes the same path double as the full resend.
+ */
+namespace StratFogDelta
+{
+	UE_RTS_API void Encode(const TArray<uint32>* BaseWords, const TArray<uint32>& CurrentWords, int32 NumBits, TArray<uint8>& OutPayload);
+
+	/** Returns false if the payload is malformed or was encoded for a different number of bits. OutWords is only valid on success. */
+	UE_RTS_API bool Decode(const TArray<uint32>* BaseWords, TConstArrayView<uint8> Payload, int32 NumBits, TArray<uint32>& OutWords);
+}
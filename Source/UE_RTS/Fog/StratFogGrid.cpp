@@ -0,0 +1,210 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratFogGrid.h"
+
+#include "Math/VectorRegister.h"
+
+void FStratTeamVisibility::Init(const int32 NumCells)
+{
+	RefCounts.Reset();
+	RefCounts.SetNumZeroed(NumCells);
+	Explored.Init(false, NumCells);
+	++Version;
+}
+
+void FStratTeamVisibility::ApplyStamp(const FStratHeightGrid& Layout, const FIntPoint& Center, const int32 RadiusCells, const TConstArrayView<uint64> Mask, const int32 Delta)
+{
+	const int32 Diameter = RadiusCells * 2 + 1;
+	bool bChanged = false;
+
+	for (int32 WordIndex = 0; WordIndex < Mask.Num(); ++WordIndex)
+	{
+		uint64 Word = Mask[WordIndex];
+		while (Word)
+		{
+			const int32 Bit = static_cast<int32>(FMath::CountTrailingZeros64(Word));
+			Word &= Word - 1;
+
+			const int32 LocalIndex = WordIndex * 64 + Bit;
+			const int32 CellX = Center.X + LocalIndex % Diameter - RadiusCells;
+			const int32 CellY = Center.Y + LocalIndex / Diameter - RadiusCells;
+			if (!Layout.IsValidCell(CellX, CellY))
+			{
+				continue;
+			}
+
+			const int32 CellIndex = Layout.ToIndex(CellX, CellY);
+			uint16& RefCount = RefCounts[CellIndex];
+			if (Delta > 0)
+			{
+				bChanged |= RefCount == 0;
+				RefCount = static_cast<uint16>(FMath::Min<int32>(RefCount + 1, MAX_uint16));
+				if (!Explored[CellIndex])
+				{
+					Explored[CellIndex] = true;
+					bChanged = true;
+				}
+			}
+			else if (ensure(RefCount > 0))
+			{
+				--RefCount;
+				bChanged |= RefCount == 0;
+			}
+		}
+	}
+
+	if (bChanged)
+	{
+		++Version;
+	}
+}
+
+void FStratFogSnapshot::Build(const FStratTeamVisibility& Visibility)
+{
+	const int32 NumCells = Visibility.RefCounts.Num();
+	const int32 WordsPerLayer = GetNumWordsPerLayer(NumCells);
+	Version = Visibility.Version;
+	Words.Reset();
+	Words.SetNumZeroed(WordsPerLayer * 2);
+
+	for (int32 CellIndex = 0; CellIndex < NumCells; ++CellIndex)
+	{
+		if (Visibility.RefCounts[CellIndex] > 0)
+		{
+			Words[CellIndex >> 5] |= 1u << (CellIndex & 31);
+		}
+	}
+
+	FMemory::Memcpy(&Words[WordsPerLayer], Visibility.Explored.GetData(), WordsPerLayer * sizeof(uint32));
+}
+
+void FStratFogSnapshot::ApplyWords(const TArray<uint32>& InWords, FStratTeamVisibility& Visibility)
+{
+	const int32 NumCells = Visibility.RefCounts.Num();
+	const int32 WordsPerLayer = GetNumWordsPerLayer(NumCells);
+	if (!ensure(InWords.Num() == WordsPerLayer * 2))
+	{
+		return;
+	}
+
+	for (int32 CellIndex = 0; CellIndex < NumCells; ++CellIndex)
+	{
+		Visibility.RefCounts[CellIndex] = (InWords[CellIndex >> 5] >> (CellIndex & 31)) & 1u;
+	}
+
+	FMemory::Memcpy(Visibility.Explored.GetData(), &InWords[WordsPerLayer], WordsPerLayer * sizeof(uint32));
+	++Visibility.Version;
+}
+
+void FStratFogRaySet::Build(const int32 InRadiusCells, const float CellSize)
+{
+	RadiusCells = InRadiusCells;
+	StepX.Reset();
+	StepY.Reset();
+	StepDistance.Reset();
+
+	//~ One ray per border cell. Stepping by 1/R of the ray moves exactly one cell along the major axis each step.
+	auto AddRay = [this, CellSize](const int32 EndX, const int32 EndY)
+	{
+		const float InvRadius = 1.f / RadiusCells;
+		const float DirX = EndX * InvRadius;
+		const float DirY = EndY * InvRadius;
+		StepX.Add(DirX);
+		StepY.Add(DirY);
+		StepDistance.Add(FMath::Sqrt(DirX * DirX + DirY * DirY) * CellSize);
+	};
+
+	for (int32 Offset = -RadiusCells; Offset < RadiusCells; ++Offset)
+	{
+		AddRay(Offset, -RadiusCells);
+		AddRay(RadiusCells, Offset);
+		AddRay(-Offset, RadiusCells);
+		AddRay(-RadiusCells, -Offset);
+	}
+
+	//~ 8R rays is always a multiple of four, but keep the kernel safe if that ever changes.
+	while (StepX.Num() % 4 != 0)
+	{
+		StepX.Add(StepX.Last());
+		StepY.Add(StepY.Last());
+		StepDistance.Add(StepDistance.Last());
+	}
+}
+
+void StratFog::ComputeVisibleMask(const FStratHeightGrid& Heights, const FStratFogRaySet& Rays, const FIntPoint& Center, const float EyeHeight, TArray<uint64>& OutMask)
+{
+	const int32 Radius = Rays.RadiusCells;
+	const int32 Diameter = Radius * 2 + 1;
+	OutMask.Reset();
+	OutMask.SetNumZeroed(GetMaskNumWords(Radius));
+
+	auto MarkVisible = [&OutMask, Diameter, Radius](const int32 LocalX, const int32 LocalY)
+	{
+		const int32 LocalIndex = (LocalY + Radius) * Diameter + LocalX + Radius;
+		OutMask[LocalIndex >> 6] |= 1ull << (LocalIndex & 63);
+	};
+
+	if (!Heights.IsValidCell(Center.X, Center.Y))
+	{
+		return;
+	}
+
+	MarkVisible(0, 0);
+
+	const float EyeZ = Heights.Heights[Heights.ToIndex(Center.X, Center.Y)] + EyeHeight;
+	const float MaxDistance = Radius * Heights.CellSize;
+	const VectorRegister4Float EyeZV = VectorSetFloat1(EyeZ);
+	const VectorRegister4Float MaxDistanceV = VectorSetFloat1(MaxDistance);
+	const VectorRegister4Float CenterXV = VectorSetFloat1(Center.X + 0.5f);
+	const VectorRegister4Float CenterYV = VectorSetFloat1(Center.Y + 0.5f);
+
+	for (int32 RayBase = 0; RayBase < Rays.StepX.Num(); RayBase += 4)
+	{
+		const VectorRegister4Float StepXV = VectorLoadAligned(&Rays.StepX[RayBase]);
+		const VectorRegister4Float StepYV = VectorLoadAligned(&Rays.StepY[RayBase]);
+		const VectorRegister4Float StepDistanceV = VectorLoadAligned(&Rays.StepDistance[RayBase]);
+
+		VectorRegister4Float PosX = CenterXV;
+		VectorRegister4Float PosY = CenterYV;
+		VectorRegister4Float Distance = VectorZeroFloat();
+		VectorRegister4Float MaxSlope = VectorSetFloat1(-UE_BIG_NUMBER);
+
+		for (int32 Step = 1; Step <= Radius; ++Step)
+		{
+			PosX = VectorAdd(PosX, StepXV);
+			PosY = VectorAdd(PosY, StepYV);
+			Distance = VectorAdd(Distance, StepDistanceV);
+
+			alignas(16) float SampleX[4];
+			alignas(16) float SampleY[4];
+			alignas(16) float SampleZ[4];
+			VectorStoreAligned(PosX, SampleX);
+			VectorStoreAligned(PosY, SampleY);
+
+			//~ The only scalar part, there is no portable gather. Cells off the grid never block and are never marked.
+			int32 CellX[4];
+			int32 CellY[4];
+			for (int32 Lane = 0; Lane < 4; ++Lane)
+			{
+				CellX[Lane] = FMath::FloorToInt32(SampleX[Lane]);
+				CellY[Lane] = FMath::FloorToInt32(SampleY[Lane]);
+				SampleZ[Lane] = Heights.IsValidCell(CellX[Lane], CellY[Lane]) ? Heights.Heights[Heights.ToIndex(CellX[Lane], CellY[Lane])] : -UE_BIG_NUMBER;
+			}
+
+			const VectorRegister4Float Slope = VectorDivide(VectorSubtract(VectorLoadAligned(SampleZ), EyeZV), Distance);
+			const VectorRegister4Float VisibleMask = VectorBitwiseAnd(VectorCompareGE(Slope, MaxSlope), VectorCompareLE(Distance, MaxDistanceV));
+			MaxSlope = VectorMax(MaxSlope, Slope);
+
+			int32 VisibleLanes = VectorMaskBits(VisibleMask);
+			while (VisibleLanes)
+			{
+				const int32 Lane = FMath::CountTrailingZeros(static_cast<uint32>(VisibleLanes));
+				VisibleLanes &= VisibleLanes - 1;
+				if (SampleZ[Lane] > -UE_BIG_NUMBER)
+				{
+					MarkVisible(CellX[Lane] - Center.X, CellY[Lane] - Center.Y);
+				}
+			}
+		}
+	}
+}
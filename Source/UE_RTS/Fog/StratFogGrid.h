@@ -0,0 +1,73 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "World/StratHeightGrid.h"
+
+/**
+ * Visibility of one team over the fog grid.
+ * Every vision stamp adds one to the cells it sees, so revealing and hiding is a counter change instead of a recompute.
+ */
+struct UE_RTS_API FStratTeamVisibility
+{
+	void Init(int32 NumCells);
+
+	bool IsVisible(const int32 CellIndex) const { return RefCounts[CellIndex] > 0; }
+	bool IsExplored(const int32 CellIndex) const { return Explored[CellIndex]; }
+
+	/** Adds Delta (+1 or -1) to every cell set in a stamp mask. See FStratFogGrid::ComputeVisibleMask for the mask layout. */
+	void ApplyStamp(const FStratHeightGrid& Layout, const FIntPoint& Center, int32 RadiusCells, TConstArrayView<uint64> Mask, int32 Delta);
+
+	SIZE_T GetAllocatedSize() const { return RefCounts.GetAllocatedSize() + Explored.GetAllocatedSize(); }
+
+	TArray<uint16> RefCounts;
+	TBitArray<> Explored;
+
+	/** Bumped whenever any cell flips between visible and hidden, or becomes explored. */
+	uint32 Version{0};
+};
+
+/** Packed copy of a team's visibility for replication. Visible bits, then explored bits, each padded to whole words. */
+struct FStratFogSnapshot
+{
+	static int32 GetNumWordsPerLayer(const int32 NumCells) { return FMath::DivideAndRoundUp(NumCells, 32); }
+
+	void Build(const FStratTeamVisibility& Visibility);
+
+	/** Writes snapshot words back into a visibility, with a reference count of one for every visible cell. */
+	static void ApplyWords(const TArray<uint32>& InWords, FStratTeamVisibility& Visibility);
+
+	int32 GetNumBits() const { return Words.Num() * 32; }
+
+	uint32 Version{0};
+	TArray<uint32> Words;
+};
+
+/** Rays from a cell center to every cell on the border of a square of a given radius, padded to a multiple of four. */
+struct FStratFogRaySet
+{
+	void Build(int32 RadiusCells, float CellSize);
+
+	int32 RadiusCells{0};
+	TArray<float, TAlignedHeapAllocator<16>> StepX;
+	TArray<float, TAlignedHeapAllocator<16>> StepY;
+	TArray<float, TAlignedHeapAllocator<16>> StepDistance;
+};
+
+namespace StratFog
+{
+	/** Number of uint64 words in a stamp mask of this radius. */
+	inline int32 GetMaskNumWords(const int32 RadiusCells)
+	{
+		const int32 Diameter = RadiusCells * 2 + 1;
+		return FMath::DivideAndRoundUp(Diameter * Diameter, 64);
+	}
+
+	/**
+	 * Heightfield line of sight. Marches every ray of the ray set outward from Center, four rays per SIMD register,
+	 * and marks cells whose slope from the eye is at least the steepest slope seen so far on that ray.
+	 * OutMask is a (2R+1)^2 bit mask, row-major, with the center at (R, R).
+	 */
+	UE_RTS_API void ComputeVisibleMask(const FStratHeightGrid& Heights, const FStratFogRaySet& Rays, const FIntPoint& Center, float EyeHeight, TArray<uint64>& OutMask);
+}
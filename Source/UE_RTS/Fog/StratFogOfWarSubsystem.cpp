@@ -0,0 +1,337 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratFogOfWarSubsystem.h"
+
+#include "StratFogSettings.h"
+#include "Async/ParallelFor.h"
+#include "Memory/StratMemoryTags.h"
+#include "Units/StratUnitSimSubsystem.h"
+#include "World/StratTerrainSubsystem.h"
+
+DEFINE_LOG_CATEGORY(LogStratFog);
+
+DECLARE_CYCLE_STAT(TEXT("Fog Update"), STAT_StratFog_Update, STATGROUP_StratFog);
+DECLARE_CYCLE_STAT(TEXT("Line Of Sight"), STAT_StratFog_LineOfSight, STATGROUP_StratFog);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Restamped Units"), STAT_StratFog_Restamped, STATGROUP_StratFog);
+
+namespace
+{
+	/** Vision without line of sight. Same mask layout as StratFog::ComputeVisibleMask. */
+	void ComputeCircleMask(const int32 RadiusCells, TArray<uint64>& OutMask)
+	{
+		const int32 Diameter = RadiusCells * 2 + 1;
+		OutMask.Reset();
+		OutMask.SetNumZeroed(StratFog::GetMaskNumWords(RadiusCells));
+
+		const int32 RadiusSq = RadiusCells * RadiusCells;
+		for (int32 Y = -RadiusCells; Y <= RadiusCells; ++Y)
+		{
+			for (int32 X = -RadiusCells; X <= RadiusCells; ++X)
+			{
+				if (X * X + Y * Y <= RadiusSq)
+				{
+					const int32 LocalIndex = (Y + RadiusCells) * Diameter + X + RadiusCells;
+					OutMask[LocalIndex >> 6] |= 1ull << (LocalIndex & 63);
+				}
+			}
+		}
+	}
+}
+
+void UStratFogOfWarSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	LLM_SCOPE_BYTAG(StratFog);
+
+	Super::Initialize(Collection);
+
+	UnitSim = Collection.InitializeDependency<UStratUnitSimSubsystem>();
+	Terrain = Collection.InitializeDependency<UStratTerrainSubsystem>();
+
+	if (UnitSim)
+	{
+		UnitSim->OnPostSimStep.AddUObject(this, &ThisClass::OnSimStepped);
+	}
+
+	if (Terrain)
+	{
+		Terrain->OnHeightsChanged.AddUObject(this, &ThisClass::OnTerrainHeightsChanged);
+	}
+}
+
+void UStratFogOfWarSubsystem::Deinitialize()
+{
+	if (UnitSim)
+	{
+		UnitSim->OnPostSimStep.RemoveAll(this);
+	}
+
+	if (Terrain)
+	{
+		Terrain->OnHeightsChanged.RemoveAll(this);
+	}
+
+	Super::Deinitialize();
+}
+
+bool UStratFogOfWarSubsystem::IsLocationVisible(const uint8 Team, const FVector& Location) const
+{
+	const FStratTeamVisibility* Visibility = GetTeamVisibility(Team);
+	const FIntPoint Cell = Layout.WorldToCell(FVector2D(Location));
+	return Visibility && Layout.IsValidCell(Cell.X, Cell.Y) && Visibility->IsVisible(Layout.ToIndex(Cell.X, Cell.Y));
+}
+
+bool UStratFogOfWarSubsystem::IsLocationExplored(const uint8 Team, const FVector& Location) const
+{
+	const FStratTeamVisibility* Visibility = GetTeamVisibility(Team);
+	const FIntPoint Cell = Layout.WorldToCell(FVector2D(Location));
+	return Visibility && Layout.IsValidCell(Cell.X, Cell.Y) && Visibility->IsExplored(Layout.ToIndex(Cell.X, Cell.Y));
+}
+
+void UStratFogOfWarSubsystem::InvalidateArea(const FBox2D& WorldArea)
+{
+	const FIntRect CellRect = Layout.GetCellRect(WorldArea);
+	for (FVisionStamp& Stamp : Stamps)
+	{
+		if (Stamp.Unit.IsValid())
+		{
+			const FIntPoint Extent(Stamp.RadiusCells, Stamp.RadiusCells);
+			const FIntRect StampRect(Stamp.Cell - Extent, Stamp.Cell + Extent + FIntPoint(1, 1));
+			Stamp.bDirty |= StampRect.Intersect(CellRect);
+		}
+	}
+}
+
+const FStratFogSnapshot* UStratFogOfWarSubsystem::GetTeamSnapshot(const uint8 Team)
+{
+	const FStratTeamVisibility* Visibility = GetTeamVisibility(Team);
+	if (!Visibility)
+	{
+		return nullptr;
+	}
+
+	if (TeamSnapshots.Num() <= Team)
+	{
+		TeamSnapshots.SetNum(Team + 1);
+	}
+
+	FStratFogSnapshot& Snapshot = TeamSnapshots[Team];
+	if (Snapshot.Words.IsEmpty() || Snapshot.Version != Visibility->Version)
+	{
+		Snapshot.Build(*Visibility);
+	}
+	return &Snapshot;
+}
+
+void UStratFogOfWarSubsystem::ApplyReplicatedTeamState(const uint8 Team, const TArray<uint32>& SnapshotWords)
+{
+	if (Layout.IsValid())
+	{
+		FStratFogSnapshot::ApplyWords(SnapshotWords, GetOrAddTeam(Team));
+	}
+}
+
+SIZE_T UStratFogOfWarSubsystem::GetAllocatedSize() const
+{
+	SIZE_T Result = Layout.GetAllocatedSize() + Teams.GetAllocatedSize() + Stamps.GetAllocatedSize() + TeamSnapshots.GetAllocatedSize();
+	for (const FStratTeamVisibility& Team : Teams)
+	{
+		Result += Team.GetAllocatedSize();
+	}
+	for (const FStratFogSnapshot& Snapshot : TeamSnapshots)
+	{
+		Result += Snapshot.Words.GetAllocatedSize();
+	}
+	for (const FVisionStamp& Stamp : Stamps)
+	{
+		Result += Stamp.Mask.GetAllocatedSize();
+	}
+	return Result;
+}
+
+bool UStratFogOfWarSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UStratFogOfWarSubsystem::OnSimStepped(float FixedDeltaTime)
+{
+	LLM_SCOPE_BYTAG(StratFog);
+
+	//~ Clients get their team's fog from UStratFogReplicationComponent.
+	if (GetWorld()->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	if (++StepsSinceUpdate >= GetDefault<UStratFogSettings>()->UpdateEveryNSteps)
+	{
+		StepsSinceUpdate = 0;
+		UpdateVisibility();
+	}
+}
+
+void UStratFogOfWarSubsystem::OnTerrainHeightsChanged(const FBox2D& ChangedArea)
+{
+	const FStratHeightGrid& TerrainGrid = Terrain->GetHeightGrid();
+
+	//~ First build. Everything after that only resamples the changed area.
+	if (!Layout.IsValid())
+	{
+		Layout.Init(TerrainGrid.GetBounds(), GetDefault<UStratFogSettings>()->FogCellSize);
+		for (FStratTeamVisibility& Team : Teams)
+		{
+			Team.Init(Layout.Heights.Num());
+		}
+	}
+
+	const FIntRect CellRect = Layout.GetCellRect(ChangedArea);
+	for (int32 Y = CellRect.Min.Y; Y < CellRect.Max.Y; ++Y)
+	{
+		for (int32 X = CellRect.Min.X; X < CellRect.Max.X; ++X)
+		{
+			Layout.Heights[Layout.ToIndex(X, Y)] = TerrainGrid.SampleHeight(Layout.CellToWorld(FIntPoint(X, Y)));
+		}
+	}
+
+	InvalidateArea(ChangedArea);
+}
+
+void UStratFogOfWarSubsystem::UpdateVisibility()
+{
+	if (!UnitSim || !Layout.IsValid())
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_StratFog_Update);
+	STRAT_SCOPED_SYSTEM_TIMING(FogOfWar);
+
+	const UStratFogSettings* Settings = GetDefault<UStratFogSettings>();
+	const TConstArrayView<FStratUnitTypeInfo> Types = UnitSim->GetTypeInfos();
+	++UpdateCounter;
+
+	//~ Pass 1: find units whose stamp is out of date and take their old stamp off the grid.
+	TArray<int32> Restamp;
+	UnitSim->ForEachChunk([&](const FStratUnitChunk& Chunk)
+	{
+		for (int32 Row = 0; Row < Chunk.Num; ++Row)
+		{
+			const FStratUnitTypeInfo& Type = Types[Chunk.TypeIds[Row]];
+			if (Type.VisionRadius <= 0.f)
+			{
+				continue;
+			}
+
+			const FStratUnitHandle Unit = Chunk.Handles[Row];
+			const FVector3f& Position = Chunk.Positions[Row];
+			const FIntPoint Cell = Layout.WorldToCell(FVector2D(Position.X, Position.Y));
+			const int32 RadiusCells = FMath::Clamp(FMath::CeilToInt32(Type.VisionRadius / Layout.CellSize), 1, Settings->MaxVisionRadiusCells);
+
+			if (Stamps.Num() <= Unit.GetIndex())
+			{
+				Stamps.SetNum(Unit.GetIndex() + 1);
+			}
+
+			FVisionStamp& Stamp = Stamps[Unit.GetIndex()];
+			Stamp.LastSeenUpdate = UpdateCounter;
+
+			const bool bUpToDate = Stamp.Unit == Unit && !Stamp.bDirty && Stamp.Cell == Cell && Stamp.RadiusCells == RadiusCells && Stamp.Team == Chunk.Factions[Row];
+			if (bUpToDate)
+			{
+				continue;
+			}
+
+			RemoveStamp(Stamp);
+			Stamp.Unit = Unit;
+			Stamp.Cell = Cell;
+			Stamp.RadiusCells = RadiusCells;
+			Stamp.EyeHeight = Type.EyeHeight;
+			Stamp.Team = Chunk.Factions[Row];
+			Restamp.Add(Unit.GetIndex());
+
+			//~ Ray sets are shared and read from workers below, so make sure they exist now.
+			GetRaySet(RadiusCells);
+		}
+	});
+
+	//~ Units that no longer exist (or lost their vision) didn't show up above.
+	for (FVisionStamp& Stamp : Stamps)
+	{
+		if (Stamp.Unit.IsValid() && Stamp.LastSeenUpdate != UpdateCounter)
+		{
+			RemoveStamp(Stamp);
+		}
+	}
+
+	//~ Pass 2: line of sight is the expensive part and only reads shared data, so it runs wide.
+	{
+		SCOPE_CYCLE_COUNTER(STAT_StratFog_LineOfSight);
+		const bool bUseLineOfSight = Settings->bUseLineOfSight;
+		ParallelFor(Restamp.Num(), [this, &Restamp, bUseLineOfSight](const int32 Index)
+		{
+			FVisionStamp& Stamp = Stamps[Restamp[Index]];
+			if (bUseLineOfSight)
+			{
+				ComputeStampMask(Stamp);
+			}
+			else
+			{
+				ComputeCircleMask(Stamp.RadiusCells, Stamp.Mask);
+			}
+		});
+	}
+
+	//~ Pass 3: apply. Reference counts are shared between units of a team, so this stays serial.
+	for (const int32 StampIndex : Restamp)
+	{
+		const FVisionStamp& Stamp = Stamps[StampIndex];
+		GetOrAddTeam(Stamp.Team).ApplyStamp(Layout, Stamp.Cell, Stamp.RadiusCells, Stamp.Mask, +1);
+	}
+
+	SET_DWORD_STAT(STAT_StratFog_Restamped, Restamp.Num());
+}
+
+FStratTeamVisibility& UStratFogOfWarSubsystem::GetOrAddTeam(const uint8 Team)
+{
+	if (Teams.Num() <= Team)
+	{
+		Teams.SetNum(Team + 1);
+	}
+
+	FStratTeamVisibility& Visibility = Teams[Team];
+	if (Visibility.RefCounts.Num() != Layout.Heights.Num())
+	{
+		Visibility.Init(Layout.Heights.Num());
+	}
+	return Visibility;
+}
+
+const FStratFogRaySet& UStratFogOfWarSubsystem::GetRaySet(const int32 RadiusCells)
+{
+	FStratFogRaySet* RaySet = RaySets.Find(RadiusCells);
+	if (!RaySet)
+	{
+		RaySet = &RaySets.Add(RadiusCells);
+		RaySet->Build(RadiusCells, Layout.CellSize);
+	}
+	return *RaySet;
+}
+
+void UStratFogOfWarSubsystem::RemoveStamp(FVisionStamp& Stamp)
+{
+	if (Stamp.Unit.IsValid() && !Stamp.Mask.IsEmpty())
+	{
+		GetOrAddTeam(Stamp.Team).ApplyStamp(Layout, Stamp.Cell, Stamp.RadiusCells, Stamp.Mask, -1);
+	}
+
+	//~ Keep the mask allocation, the next stamp in this slot most likely has the same radius.
+	Stamp.Unit = FStratUnitHandle();
+	Stamp.Mask.Reset();
+	Stamp.bDirty = false;
+}
+
+void UStratFogOfWarSubsystem::ComputeStampMask(FVisionStamp& Stamp) const
+{
+	const FStratFogRaySet& RaySet = RaySets.FindChecked(Stamp.RadiusCells);
+	StratFog::ComputeVisibleMask(Layout, RaySet, Stamp.Cell, Stamp.EyeHeight, Stamp.Mask);
+}
@@ -0,0 +1,99 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StratFogGrid.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Units/StratUnitTypes.h"
+#include "StratFogOfWarSubsystem.generated.h"
+
+class UStratTerrainSubsystem;
+class UStratUnitSimSubsystem;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogStratFog, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("StratFog"), STATGROUP_StratFog, STATCAT_Advanced);
+
+/**
+ * Per team visibility grid, updated incrementally from the unit simulation.
+ * A unit's vision is a stamp. Only units that changed cell, team or vision radius remove their old stamp and add a new one,
+ * so a still army costs nothing. Teams are unit factions.
+ */
+UCLASS()
+class UE_RTS_API UStratFogOfWarSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	UFUNCTION(BlueprintPure, Category=StratFog)
+	bool IsLocationVisible(uint8 Team, const FVector& Location) const;
+
+	UFUNCTION(BlueprintPure, Category=StratFog)
+	bool IsLocationExplored(uint8 Team, const FVector& Location) const;
+
+	/** Forces every stamp touching the area to re-stamp on the next update. E.g. a building opened or closed a view. */
+	void InvalidateArea(const FBox2D& WorldArea);
+
+	/** Fog cell layout. Heights are the terrain resampled to fog cells. */
+	const FStratHeightGrid& GetLayout() const { return Layout; }
+
+	/** Null if no unit of that team has ever had vision. */
+	const FStratTeamVisibility* GetTeamVisibility(const uint8 Team) const { return Teams.IsValidIndex(Team) && Teams[Team].RefCounts.Num() > 0 ? &Teams[Team] : nullptr; }
+
+	/** Packed visibility of a team for replication. Rebuilt only when the team's version changed since the last call. */
+	const FStratFogSnapshot* GetTeamSnapshot(uint8 Team);
+
+	/** Number of bits in every team snapshot. Zero until the layout exists. */
+	int32 GetSnapshotNumBits() const { return FStratFogSnapshot::GetNumWordsPerLayer(Layout.Heights.Num()) * 2 * 32; }
+
+	/** Clients don't compute fog. They overwrite their team's grid with what the server replicated. */
+	void ApplyReplicatedTeamState(uint8 Team, const TArray<uint32>& SnapshotWords);
+
+	SIZE_T GetAllocatedSize() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	struct FVisionStamp
+	{
+		FStratUnitHandle Unit;
+		FIntPoint Cell{FIntPoint::ZeroValue};
+		int32 RadiusCells{0};
+		float EyeHeight{0.f};
+		uint8 Team{0};
+		bool bDirty{false};
+		uint32 LastSeenUpdate{0};
+		TArray<uint64> Mask;
+	};
+
+	void OnSimStepped(float FixedDeltaTime);
+	void OnTerrainHeightsChanged(const FBox2D& ChangedArea);
+	void UpdateVisibility();
+	FStratTeamVisibility& GetOrAddTeam(uint8 Team);
+	const FStratFogRaySet& GetRaySet(int32 RadiusCells);
+	void RemoveStamp(FVisionStamp& Stamp);
+	void ComputeStampMask(FVisionStamp& Stamp) const;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratUnitSimSubsystem> UnitSim;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratTerrainSubsystem> Terrain;
+
+	FStratHeightGrid Layout;
+	TArray<FStratTeamVisibility> Teams;
+
+	/** Indexed by FStratUnitHandle::GetIndex(). */
+	TArray<FVisionStamp> Stamps;
+
+	TArray<FStratFogSnapshot> TeamSnapshots;
+	TMap<int32, FStratFogRaySet> RaySets;
+	uint32 UpdateCounter{0};
+	int32 StepsSinceUpdate{0};
+};
@@ -0,0 +1,225 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratFogReplicationComponent.h"
+
+#include "StratFogDeltaCodec.h"
+#include "StratFogOfWarSubsystem.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Player/StratPlayerState.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Fog Bytes Sent"), STAT_StratFog_BytesSent, STATGROUP_StratFog);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Fog Full Resends"), STAT_StratFog_FullResends, STATGROUP_StratFog);
+
+namespace
+{
+	/** With nothing new to say, the last delta is only re-sent every few intervals until it's acknowledged. */
+	constexpr int32 ResendEveryNIntervals = 3;
+}
+
+UStratFogReplicationComponent::UStratFogReplicationComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	SetIsReplicatedByDefault(true);
+}
+
+void UStratFogReplicationComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	//~ Only the server sends. Clients just answer RPCs.
+	SetComponentTickEnabled(GetOwner()->HasAuthority());
+}
+
+void UStratFogReplicationComponent::TickComponent(const float DeltaTime, const ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	SendTimer -= DeltaTime;
+	if (SendTimer > 0.f)
+	{
+		return;
+	}
+	SendTimer = SendInterval;
+
+	//~ A listen server's own player already reads the authoritative grid.
+	const AStratPlayerState* PS = GetPlayerState<AStratPlayerState>();
+	const APlayerController* PC = PS ? PS->GetPlayerController() : nullptr;
+	if (!PC || PC->IsLocalController())
+	{
+		return;
+	}
+
+	if (UStratFogOfWarSubsystem* Fog = GetWorld()->GetSubsystem<UStratFogOfWarSubsystem>())
+	{
+		SendUpdate(*Fog);
+	}
+}
+
+void UStratFogReplicationComponent::SendUpdate(UStratFogOfWarSubsystem& Fog)
+{
+	const uint8 Team = GetPlayerStateChecked<AStratPlayerState>()->GetFactionId();
+	if (Team != HistoryTeam)
+	{
+		ResetHistory();
+		HistoryTeam = Team;
+	}
+
+	const FStratFogSnapshot* Snapshot = Fog.GetTeamSnapshot(Team);
+	if (!Snapshot)
+	{
+		return;
+	}
+
+	const FSentSnapshot* Base = AckedSeq != 0 ? History.FindByPredicate([this](const FSentSnapshot& Sent) { return Sent.Seq == AckedSeq; }) : nullptr;
+	if (Base && Base->Version == Snapshot->Version)
+	{
+		return;
+	}
+
+	const bool bNothingNewSinceLastSend = !History.IsEmpty() && History.Last().Version == Snapshot->Version;
+	if (bNothingNewSinceLastSend && ++IntervalsSinceSend < ResendEveryNIntervals)
+	{
+		return;
+	}
+	IntervalsSinceSend = 0;
+
+	TArray<uint8> Payload;
+	StratFogDelta::Encode(Base ? &Base->Words : nullptr, Snapshot->Words, Snapshot->GetNumBits(), Payload);
+	const uint32 BaseSeq = Base ? Base->Seq : 0;
+
+	//~ A big delta every interval would pile up behind the last on a slow link. Wait for it, then send what's current.
+	const bool bReliable = Payload.Num() > MaxUnreliablePayloadBytes;
+	if (bReliable && ReliableInFlightSeq != 0)
+	{
+		return;
+	}
+
+	FSentSnapshot& Sent = History.AddDefaulted_GetRef();
+	Sent.Seq = NextSeq++;
+	Sent.Version = Snapshot->Version;
+	Sent.Words = Snapshot->Words;
+	const uint32 Seq = Sent.Seq;
+
+	//~ Never drop the acknowledged snapshot, it's the only one we know the client has.
+	for (int32 Index = 0; History.Num() > HistorySize && Index < History.Num();)
+	{
+		if (History[Index].Seq != AckedSeq)
+		{
+			History.RemoveAt(Index);
+		}
+		else
+		{
+			++Index;
+		}
+	}
+
+	if (bReliable)
+	{
+		ReliableInFlightSeq = Seq;
+		Client_ReceiveFogDeltaReliable(Seq, BaseSeq, Team, Payload);
+	}
+	else
+	{
+		Client_ReceiveFogDelta(Seq, BaseSeq, Team, Payload);
+	}
+
+	INC_DWORD_STAT_BY(STAT_StratFog_BytesSent, Payload.Num());
+	if (BaseSeq == 0)
+	{
+		INC_DWORD_STAT(STAT_StratFog_FullResends);
+	}
+}
+
+void UStratFogReplicationComponent::ResetHistory()
+{
+	History.Reset();
+	AckedSeq = 0;
+	IntervalsSinceSend = 0;
+}
+
+void UStratFogReplicationComponent::Client_ReceiveFogDelta_Implementation(const uint32 Seq, const uint32 BaseSeq, const uint8 Team, const TArray<uint8>& Payload)
+{
+	ReceiveFogDelta(Seq, BaseSeq, Team, Payload);
+}
+
+void UStratFogReplicationComponent::Client_ReceiveFogDeltaReliable_Implementation(const uint32 Seq, const uint32 BaseSeq, const uint8 Team, const TArray<uint8>& Payload)
+{
+	ReceiveFogDelta(Seq, BaseSeq, Team, Payload);
+	Server_ReleaseReliableFog(Seq);
+}
+
+void UStratFogReplicationComponent::Server_ReleaseReliableFog_Implementation(const uint32 Seq)
+{
+	if (Seq == ReliableInFlightSeq)
+	{
+		ReliableInFlightSeq = 0;
+	}
+}
+
+void UStratFogReplicationComponent::ReceiveFogDelta(const uint32 Seq, const uint32 BaseSeq, const uint8 Team, const TArray<uint8>& Payload)
+{
+	//~ Unreliable packets arrive out of order. Older snapshots than the one applied are useless.
+	if (Seq <= AckedSeq)
+	{
+		return;
+	}
+
+	UStratFogOfWarSubsystem* Fog = GetWorld()->GetSubsystem<UStratFogOfWarSubsystem>();
+	const int32 NumBits = Fog ? Fog->GetSnapshotNumBits() : 0;
+	if (NumBits == 0)
+	{
+		return;
+	}
+
+	if (Team != HistoryTeam)
+	{
+		ResetHistory();
+		HistoryTeam = Team;
+	}
+
+	const FSentSnapshot* Base = nullptr;
+	if (BaseSeq != 0)
+	{
+		Base = History.FindByPredicate([BaseSeq](const FSentSnapshot& Received) { return Received.Seq == BaseSeq; });
+	}
+
+	TArray<uint32> Words;
+	const bool bDecoded = (BaseSeq == 0 || Base) && StratFogDelta::Decode(Base ? &Base->Words : nullptr, Payload, NumBits, Words);
+	if (!bDecoded)
+	{
+		//~ Out of sync. Acknowledging zero asks the server for a full resend.
+		Server_AckFog(0);
+		return;
+	}
+
+	FSentSnapshot& Received = History.AddDefaulted_GetRef();
+	Received.Seq = Seq;
+	Received.Words = MoveTemp(Words);
+	Fog->ApplyReplicatedTeamState(Team, Received.Words);
+
+	while (History.Num() > HistorySize)
+	{
+		History.RemoveAt(0);
+	}
+
+	AckedSeq = Seq;
+	Server_AckFog(Seq);
+}
+
+void UStratFogReplicationComponent::Server_AckFog_Implementation(const uint32 Seq)
+{
+	if (Seq == 0)
+	{
+		ResetHistory();
+		return;
+	}
+
+	if (Seq > AckedSeq && History.ContainsByPredicate([Seq](const FSentSnapshot& Sent) { return Sent.Seq == Seq; }))
+	{
+		AckedSeq = Seq;
+		History.RemoveAll([Seq](const FSentSnapshot& Sent) { return Sent.Seq < Seq; });
+	}
+}
@@ -0,0 +1,82 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/PlayerStateComponent.h"
+#include "StratFogGrid.h"
+#include "StratFogReplicationComponent.generated.h"
+
+class UStratFogOfWarSubsystem;
+
+/**
+ * Streams the owning player's team fog of war to that player only.
+ * The server sends run-length deltas against the last snapshot the client acknowledged. If the client never acknowledged one,
+ * or it fell out of history, the delta is against nothing, which is the full resend. Deltas too big to send unreliably go
+ * reliable, one at a time: the next waits until the client has answered the last, so a slow link never queues them up.
+ * Lives on AStratPlayerState, so client RPCs reach exactly the one player on that team.
+ */
+UCLASS(ClassGroup=(Strat), meta=(BlueprintSpawnableComponent, PrioritizeCategories="User"))
+class UE_RTS_API UStratFogReplicationComponent : public UPlayerStateComponent
+{
+	GENERATED_BODY()
+
+public:
+	UStratFogReplicationComponent(const FObjectInitializer& ObjectInitializer);
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+protected:
+	virtual void BeginPlay() override;
+
+	void SendUpdate(UStratFogOfWarSubsystem& Fog);
+	void ResetHistory();
+
+	/** Payload is a StratFogDelta stream. BaseSeq zero means it encodes against an empty grid. */
+	UFUNCTION(Client, Unreliable)
+	void Client_ReceiveFogDelta(uint32 Seq, uint32 BaseSeq, uint8 Team, const TArray<uint8>& Payload);
+
+	/** Same as Client_ReceiveFogDelta. Used when the payload is too big to risk losing one fragment of it. */
+	UFUNCTION(Client, Reliable)
+	void Client_ReceiveFogDeltaReliable(uint32 Seq, uint32 BaseSeq, uint8 Team, const TArray<uint8>& Payload);
+
+	/** Answers every reliable delta, applied or not, so the server can send the next one. Reliable so it can't be lost. */
+	UFUNCTION(Server, Reliable)
+	void Server_ReleaseReliableFog(uint32 Seq);
+
+	void ReceiveFogDelta(uint32 Seq, uint32 BaseSeq, uint8 Team, const TArray<uint8>& Payload);
+
+	UFUNCTION(Server, Unreliable)
+	void Server_AckFog(uint32 Seq);
+
+	struct FSentSnapshot
+	{
+		uint32 Seq{0};
+		uint32 Version{0};
+		TArray<uint32> Words;
+	};
+
+	/** Server: snapshots sent but maybe not acknowledged yet, oldest first. Client: snapshots received, oldest first. */
+	TArray<FSentSnapshot> History;
+
+	/** Server: newest snapshot the client confirmed. Client: newest snapshot applied. */
+	uint32 AckedSeq{0};
+	uint32 NextSeq{1};
+	int32 HistoryTeam{INDEX_NONE};
+	int32 IntervalsSinceSend{0};
+	float SendTimer{0.f};
+
+	/** Server: the reliable delta the client hasn't answered yet, zero if none. */
+	uint32 ReliableInFlightSeq{0};
+
+	/** How often the server checks for fog changes to send, in seconds. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Options", meta=(ClampMin="0.02", UIMin="0.05", UIMax="1.0", Units="s"))
+	float SendInterval{0.2f};
+
+	/** Snapshots kept on both ends to delta against. Bounds memory to HistorySize grids per connection. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Options", meta=(ClampMin="2", ClampMax="32"))
+	int32 HistorySize{8};
+
+	/** Payloads bigger than this go reliable. Unreliable RPCs this size would be split, and losing any part loses all of it. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User", AdvancedDisplay, meta=(ClampMin="64", Units="Bytes"))
+	int32 MaxUnreliablePayloadBytes{1000};
+};
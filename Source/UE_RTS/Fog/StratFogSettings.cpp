@@ -0,0 +1,8 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratFogSettings.h"
+
+UStratFogSettings::UStratFogSettings()
+{
+	CategoryName = TEXT("Game");
+}
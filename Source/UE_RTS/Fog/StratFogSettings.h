@@ -0,0 +1,33 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "StratFogSettings.generated.h"
+
+/** Project settings for fog of war. Found under Project Settings > Game > Strat Fog Of War. */
+UCLASS(Config=Game, DefaultConfig, meta=(DisplayName="Strat Fog Of War"))
+class UE_RTS_API UStratFogSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UStratFogSettings();
+
+	/** Size of a visibility cell. Vision radius in cells is VisionRadius / FogCellSize, which drives the line of sight cost. */
+	UPROPERTY(Config, EditAnywhere, Category="Fog", meta=(ClampMin="50.0", UIMin="100.0", UIMax="800.0", Units="cm"))
+	float FogCellSize{200.f};
+
+	/** Fog updates every N simulation steps. Units only re-stamp if they changed cell, so this mostly bounds latency. */
+	UPROPERTY(Config, EditAnywhere, Category="Fog", meta=(ClampMin="1", ClampMax="20"))
+	int32 UpdateEveryNSteps{2};
+
+	/** Hard cap on vision radius in cells. Keeps one huge radius from blowing the frame. */
+	UPROPERTY(Config, EditAnywhere, Category="Fog", meta=(ClampMin="1", ClampMax="128"))
+	int32 MaxVisionRadiusCells{48};
+
+	/** When false, vision is a plain circle. Useful for flat test maps and to measure line of sight cost. */
+	UPROPERTY(Config, EditAnywhere, Category="Fog")
+	bool bUseLineOfSight{true};
+};
@@ -0,0 +1,56 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratLockstepComponent.h"
+
+#include "StratLockstepSubsystem.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerState.h"
+
+UStratLockstepComponent::UStratLockstepComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	SetIsReplicatedByDefault(true);
+}
+
+void UStratLockstepComponent::Server_SubmitCommands_Implementation(const uint32 ClientTick, const TArray<FStratLockstepCommand>& Commands)
+{
+	UStratLockstepSubsystem* Lockstep = GetWorld()->GetSubsystem<UStratLockstepSubsystem>();
+	if (!Lockstep)
+	{
+		return;
+	}
+
+	InputLatencyTicks = static_cast<int32>(Lockstep->GetCurrentTick() - FMath::Min(ClientTick, Lockstep->GetCurrentTick()));
+	Lockstep->EnqueueClientCommands(*GetPlayerStateChecked<APlayerState>(), Commands);
+}
+
+void UStratLockstepComponent::Client_ReceiveTicks_Implementation(const uint32 FirstTick, const uint32 EndTick, const TArray<FStratLockstepCommand>& Commands)
+{
+	if (UStratLockstepSubsystem* Lockstep = GetWorld()->GetSubsystem<UStratLockstepSubsystem>())
+	{
+		Lockstep->ReceiveTicks(FirstTick, EndTick, Commands);
+	}
+}
+
+void UStratLockstepComponent::Client_ReceiveKeyframePart_Implementation(const uint32 Tick, const int32 TotalSize, const int32 Offset, const TArray<uint8>& Bytes)
+{
+	if (UStratLockstepSubsystem* Lockstep = GetWorld()->GetSubsystem<UStratLockstepSubsystem>())
+	{
+		Lockstep->ReceiveKeyframePart(Tick, TotalSize, Offset, Bytes);
+	}
+}
+
+void UStratLockstepComponent::Server_RequestTicks_Implementation(const uint32 FromTick)
+{
+	//~ Never forward, so a client can't skip ticks it hasn't run. A keyframe already sent goes again in full.
+	SentEndTick = FMath::Min(SentEndTick, FromTick);
+	SentKeyframeTick = MAX_uint32;
+}
+
+void UStratLockstepComponent::Server_ReportStateHash_Implementation(const uint32 Tick, const uint32 Hash)
+{
+	if (UStratLockstepSubsystem* Lockstep = GetWorld()->GetSubsystem<UStratLockstepSubsystem>())
+	{
+		Lockstep->CheckClientHash(*GetPlayerStateChecked<APlayerState>(), Tick, Hash);
+	}
+}
@@ -0,0 +1,52 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/PlayerStateComponent.h"
+#include "StratLockstepTypes.h"
+#include "StratLockstepComponent.generated.h"
+
+/**
+ * One player's lockstep connection. Carries commands up, the server's tick stream down, and state hashes back up.
+ * Lives on AStratPlayerState so each client only receives its own copy of the stream. Idle unless lockstep is enabled.
+ */
+UCLASS(ClassGroup=(Strat), meta=(BlueprintSpawnableComponent, PrioritizeCategories="User"))
+class UE_RTS_API UStratLockstepComponent : public UPlayerStateComponent
+{
+	GENERATED_BODY()
+
+public:
+	UStratLockstepComponent(const FObjectInitializer& ObjectInitializer);
+
+	/** Client. ClientTick is the client's simulation frame when the batch was made, so the server can measure input latency. */
+	UFUNCTION(Server, Reliable)
+	void Server_SubmitCommands(uint32 ClientTick, const TArray<FStratLockstepCommand>& Commands);
+
+	/** Server. Every tick in [FirstTick, EndTick) is final, and Commands holds all of their commands in execution order. */
+	UFUNCTION(Client, Reliable)
+	void Client_ReceiveTicks(uint32 FirstTick, uint32 EndTick, const TArray<FStratLockstepCommand>& Commands);
+
+	/** Server. Part of the join keyframe, for a client behind the command history the server still keeps. */
+	UFUNCTION(Client, Reliable)
+	void Client_ReceiveKeyframePart(uint32 Tick, int32 TotalSize, int32 Offset, const TArray<uint8>& Bytes);
+
+	UFUNCTION(Server, Unreliable)
+	void Server_ReportStateHash(uint32 Tick, uint32 Hash);
+
+	/** Client. The stream had a gap. Sends everything again from FromTick, or the join keyframe if that's older. */
+	UFUNCTION(Server, Reliable)
+	void Server_RequestTicks(uint32 FromTick);
+
+	/** Server. Ticks before this were already sent to this client. */
+	uint32 SentEndTick{0};
+
+	/** Server. The join keyframe being sent to this client, and how far. */
+	uint32 SentKeyframeTick{MAX_uint32};
+	int32 SentKeyframeBytes{0};
+
+protected:
+	/** Server. How many ticks old the last command batch from this client was on arrival. */
+	UPROPERTY(VisibleInstanceOnly, Category="User|Info")
+	int32 InputLatencyTicks{0};
+};
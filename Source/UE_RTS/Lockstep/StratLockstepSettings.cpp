@@ -0,0 +1,8 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratLockstepSettings.h"
+
+UStratLockstepSettings::UStratLockstepSettings()
+{
+	CategoryName = TEXT("Game");
+}
@@ -0,0 +1,61 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "StratLockstepSettings.generated.h"
+
+/** Project settings for lockstep networking. Found under Project Settings > Game > Strat Lockstep. */
+UCLASS(Config=Game, DefaultConfig, meta=(DisplayName="Strat Lockstep"))
+class UE_RTS_API UStratLockstepSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UStratLockstepSettings();
+
+	/**
+	 * Replaces unit replication with lockstep. Only commands travel over the network and every peer runs the simulation,
+	 * so bandwidth no longer grows with unit count. Units must then only be spawned and ordered through UStratLockstepSubsystem.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category="Lockstep")
+	bool bEnabled{false};
+
+	/** Clients hash their simulation every this many ticks and the server compares it with its own. */
+	UPROPERTY(Config, EditAnywhere, Category="Lockstep", meta=(ClampMin="1", ClampMax="600"))
+	int32 HashEveryNTicks{10};
+
+	/** Server hashes kept for comparison. Client reports older than this many hashes can't be checked. */
+	UPROPERTY(Config, EditAnywhere, Category="Lockstep", meta=(ClampMin="8", ClampMax="1024"))
+	int32 HashHistorySize{64};
+
+	/** Clients try to keep this many received ticks unplayed, to ride out jitter. More buffered than this and they speed up. */
+	UPROPERTY(Config, EditAnywhere, Category="Lockstep", meta=(ClampMin="0", ClampMax="20"))
+	int32 TargetBufferTicks{2};
+
+	/** Cap on ticks a client runs in one frame while catching up, e.g. right after joining. */
+	UPROPERTY(Config, EditAnywhere, Category="Lockstep", meta=(ClampMin="1", ClampMax="200"))
+	int32 MaxCatchUpStepsPerFrame{20};
+
+	/**
+	 * The server snapshots the match every this many ticks and drops older commands. Late joiners, and clients that fell
+	 * behind what's kept, load the snapshot and play on from there. Lower keeps less history, higher takes fewer snapshots.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category="Lockstep", AdvancedDisplay, meta=(ClampMin="30", ClampMax="36000"))
+	int32 JoinKeyframeEveryNTicks{900};
+
+	/**
+	 * Serialized command bytes per RPC when the server sends ticks, so history and big orders stay under the reliable bunch
+	 * limits. One tick's commands always go in one RPC, so a tick bigger than this is sent whole.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category="Lockstep", AdvancedDisplay, meta=(ClampMin="1024", ClampMax="60000", Units="Bytes"))
+	int32 MaxBytesPerRpc{16 * 1024};
+
+	/**
+	 * Units per command. Bigger orders are split into several commands on the tick they're given, and the server drops
+	 * bigger commands from clients. Can't go above StratLockstep::MaxUnitsPerCommand, the wire format's own cap.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category="Lockstep", AdvancedDisplay, meta=(ClampMin="1", ClampMax="1024"))
+	int32 MaxUnitsPerCommand{200};
+};
@@ -0,0 +1,765 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratLockstepSubsystem.h"
+
+#include "StratLockstepComponent.h"
+#include "StratLockstepSettings.h"
+#include "Algo/BinarySearch.h"
+#include "Economy/StratEconomySubsystem.h"
+#include "Engine/World.h"
+#include "Faction/StratFactionSubsystem.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerController.h"
+#include "Player/StratPlayerState.h"
+#include "Save/StratSaveFile.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Units/StratUnitSettings.h"
+#include "Units/StratUnitSimSubsystem.h"
+#include "Units/StratUnitSnapshot.h"
+
+DEFINE_LOG_CATEGORY(LogStratLockstep);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Lockstep Buffered Ticks"), STAT_StratLockstep_BufferedTicks, STATGROUP_StratUnits);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Lockstep Command History"), STAT_StratLockstep_CommandHistory, STATGROUP_StratUnits);
+
+namespace
+{
+	/** Caps reliable RPCs per client per frame, so a late joiner's history can't overflow the reliable buffer. */
+	constexpr int32 MaxRpcsPerClientPerFrame = 8;
+
+	/** Join keyframes go down in parts this big, well under the partial bunch limit. */
+	constexpr int32 KeyframePartBytes = 32 * 1024;
+
+	FIntVector ToWholeCm(const FVector& Location)
+	{
+		return FIntVector(FMath::RoundToInt32(Location.X), FMath::RoundToInt32(Location.Y), FMath::RoundToInt32(Location.Z));
+	}
+}
+
+bool UStratLockstepSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return Super::ShouldCreateSubsystem(Outer) && GetDefault<UStratLockstepSettings>()->bEnabled;
+}
+
+void UStratLockstepSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UnitSim = Collection.InitializeDependency<UStratUnitSimSubsystem>();
+	Factions = Collection.InitializeDependency<UStratFactionSubsystem>();
+	Economy = Collection.InitializeDependency<UStratEconomySubsystem>();
+	if (UnitSim)
+	{
+		UnitSim->EnableLockstep();
+	}
+
+	HashHistory.SetNum(GetDefault<UStratLockstepSettings>()->HashHistorySize);
+}
+
+void UStratLockstepSubsystem::Deinitialize()
+{
+	CommandHistory.Empty();
+	CommandHistoryBytes.Empty();
+	JoinKeyframe.Empty();
+	ReceivedCommands.Empty();
+	ReceivingKeyframe.Empty();
+
+	Super::Deinitialize();
+}
+
+void UStratLockstepSubsystem::Tick(const float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!UnitSim || bReplayDriven)
+	{
+		return;
+	}
+
+	if (IsServer())
+	{
+		TickServer(DeltaTime);
+	}
+	else
+	{
+		TickClient(DeltaTime);
+	}
+
+	SET_DWORD_STAT(STAT_StratLockstep_BufferedTicks, ClosedEndTick > GetCurrentTick() ? ClosedEndTick - GetCurrentTick() : 0);
+	SET_DWORD_STAT(STAT_StratLockstep_CommandHistory, CommandHistory.Num());
+}
+
+TStatId UStratLockstepSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UStratLockstepSubsystem, STATGROUP_StratUnits);
+}
+
+bool UStratLockstepSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UStratLockstepSubsystem::IssueMove(const TArray<FStratUnitHandle>& Units, const FVector& Location, const bool bQueued)
+{
+	FStratLockstepCommand Command;
+	Command.Type = EStratLockstepCommandType::Move;
+	Command.Units = Units;
+	Command.TargetLocation = ToWholeCm(Location);
+	Command.bQueued = bQueued;
+	SubmitCommand(Command);
+}
+
+void UStratLockstepSubsystem::IssueAttack(const TArray<FStratUnitHandle>& Units, const FStratUnitHandle Target, const bool bQueued)
+{
+	FStratLockstepCommand Command;
+	Command.Type = EStratLockstepCommandType::Attack;
+	Command.Units = Units;
+	Command.TargetUnit = Target;
+	Command.bQueued = bQueued;
+	SubmitCommand(Command);
+}
+
+void UStratLockstepSubsystem::IssueFormationMove(const TArray<FStratUnitHandle>& Units, const FVector& Location, const float Spacing, const bool bQueued)
+{
+	FStratLockstepCommand Command;
+	Command.Type = EStratLockstepCommandType::Formation;
+	Command.Units = Units;
+	Command.TargetLocation = ToWholeCm(Location);
+	Command.FormationSpacing = FMath::Max(FMath::RoundToInt32(Spacing), 1);
+	Command.bQueued = bQueued;
+	SubmitCommand(Command);
+}
+
+void UStratLockstepSubsystem::SpawnUnit(const UStratUnitDefinition* Definition, const FVector& Location, const uint8 Faction)
+{
+	const int32 TypeId = UnitSim ? UnitSim->FindTypeId(Definition) : INDEX_NONE;
+	if (!ensure(IsServer()) || !ensureMsgf(TypeId != INDEX_NONE, TEXT("%s isn't listed in UStratUnitSettings::UnitDefinitions."), *GetNameSafe(Definition)))
+	{
+		return;
+	}
+
+	FStratLockstepCommand Command;
+	Command.Type = EStratLockstepCommandType::Spawn;
+	Command.TargetLocation = ToWholeCm(Location);
+	Command.TypeId = static_cast<uint16>(TypeId);
+	Command.Faction = Faction;
+	SubmitCommand(Command);
+}
+
+void UStratLockstepSubsystem::SubmitRelation(const uint8 Faction, const uint8 Other, const EStratFactionRelation Relation)
+{
+	if (!ensure(IsServer()))
+	{
+		return;
+	}
+
+	FStratLockstepCommand Command;
+	Command.Type = EStratLockstepCommandType::SetRelation;
+	Command.Faction = Faction;
+	Command.OtherFaction = Other;
+	Command.Relation = Relation;
+	SubmitCommand(Command);
+}
+
+void UStratLockstepSubsystem::SubmitSharedControl(const uint8 Faction, const uint8 Other, const bool bShared)
+{
+	if (!ensure(IsServer()))
+	{
+		return;
+	}
+
+	FStratLockstepCommand Command;
+	Command.Type = EStratLockstepCommandType::SetSharedControl;
+	Command.Faction = Faction;
+	Command.OtherFaction = Other;
+	Command.bSharedControl = bShared;
+	SubmitCommand(Command);
+}
+
+void UStratLockstepSubsystem::SubmitCommand(const FStratLockstepCommand& Command)
+{
+	TArray<FStratLockstepCommand>& Queue = IsServer() ? PendingCommands : OutgoingCommands;
+
+	//~ Split big orders on every peer, so no command goes over the wire format's cap or the server's config.
+	const int32 MaxUnitsPerCommand = GetMaxUnitsPerCommand();
+	if (Command.Units.Num() <= MaxUnitsPerCommand)
+	{
+		Queue.Add(Command);
+		return;
+	}
+
+	const bool bFormation = Command.Type == EStratLockstepCommandType::Formation;
+	const int32 FormationSlots = Command.FormationSlots > 0 ? Command.FormationSlots : Command.Units.Num();
+	if (bFormation && FormationSlots > StratLockstep::MaxFormationSlots)
+	{
+		UE_LOG(LogStratLockstep, Warning, TEXT("Dropped a formation of %d units. Formations hold up to %d."), FormationSlots, StratLockstep::MaxFormationSlots);
+		return;
+	}
+
+	for (int32 FirstUnit = 0; FirstUnit < Command.Units.Num(); FirstUnit += MaxUnitsPerCommand)
+	{
+		FStratLockstepCommand& Part = Queue.Add_GetRef(Command);
+		Part.Units = TArray<FStratUnitHandle>(TConstArrayView<FStratUnitHandle>(Command.Units).Mid(FirstUnit, MaxUnitsPerCommand));
+		if (bFormation)
+		{
+			Part.FormationFirstSlot = Command.FormationFirstSlot + FirstUnit;
+			Part.FormationSlots = FormationSlots;
+		}
+	}
+}
+
+int32 UStratLockstepSubsystem::GetMaxUnitsPerCommand()
+{
+	return FMath::Clamp(GetDefault<UStratLockstepSettings>()->MaxUnitsPerCommand, 1, StratLockstep::MaxUnitsPerCommand);
+}
+
+uint32 UStratLockstepSubsystem::GetCurrentTick() const
+{
+	return UnitSim ? UnitSim->GetSimFrame() : 0;
+}
+
+void UStratLockstepSubsystem::EnqueueClientCommands(const APlayerState& Player, const TConstArrayView<FStratLockstepCommand> Commands)
+{
+	const AStratPlayerState* StratPlayer = Cast<AStratPlayerState>(&Player);
+	const uint8 Faction = StratPlayer ? StratPlayer->GetFactionId() : 0;
+	const int32 MaxUnitsPerCommand = GetMaxUnitsPerCommand();
+
+	for (const FStratLockstepCommand& Command : Commands)
+	{
+		if (Command.IsServerOnly() || Command.Units.Num() > MaxUnitsPerCommand)
+		{
+			UE_LOG(LogStratLockstep, Warning, TEXT("Dropped a command from %s. Clients can't spawn, change relations, add resources or order more than %d units."), *Player.GetPlayerName(), MaxUnitsPerCommand);
+			continue;
+		}
+
+		if (Command.Type == EStratLockstepCommandType::Formation && (Command.FormationFirstSlot < 0 || Command.FormationSlots < 0
+			|| Command.FormationSlots > StratLockstep::MaxFormationSlots || (Command.FormationSlots > 0 && Command.FormationFirstSlot + Command.Units.Num() > Command.FormationSlots)))
+		{
+			UE_LOG(LogStratLockstep, Warning, TEXT("Dropped a formation from %s with slots out of range."), *Player.GetPlayerName());
+			continue;
+		}
+
+		//~ Players only order factions they command. Checked here, once, so clients never need to.
+		const uint64 ControlMask = Factions ? Factions->GetControlMask(Faction) : StratFaction::Bit(Faction);
+		FStratLockstepCommand& Accepted = PendingCommands.Add_GetRef(Command);
+		Accepted.Units.RemoveAll([this, ControlMask](const FStratUnitHandle& Unit)
+		{
+			int32 Row;
+			const FStratUnitChunk* Chunk = UnitSim->FindUnit(Unit, Row);
+			return !Chunk || (ControlMask & StratFaction::Bit(Chunk->Factions[Row])) == 0;
+		});
+
+		if (Accepted.Units.IsEmpty())
+		{
+			PendingCommands.Pop(EAllowShrinking::No);
+		}
+	}
+}
+
+void UStratLockstepSubsystem::ReceiveTicks(const uint32 FirstTick, const uint32 EndTick, const TConstArrayView<FStratLockstepCommand> Commands)
+{
+	//~ Running on past missing ticks would desync for good. Ask again from the first one, once, and drop batches until then.
+	if (FirstTick > ClosedEndTick)
+	{
+		UStratLockstepComponent* Component = GetLocalComponent();
+		if (Component && ResendRequestedTick != ClosedEndTick)
+		{
+			UE_LOG(LogStratLockstep, Warning, TEXT("Tick stream has a gap. Expected %u, got %u. Asking the server to send again."), ClosedEndTick, FirstTick);
+			Component->Server_RequestTicks(ClosedEndTick);
+			ResendRequestedTick = ClosedEndTick;
+		}
+		return;
+	}
+
+	if (EndTick <= ClosedEndTick)
+	{
+		return;
+	}
+
+	for (const FStratLockstepCommand& Command : Commands)
+	{
+		if (Command.Tick >= ClosedEndTick && Command.Tick < EndTick)
+		{
+			ReceivedCommands.Add(Command);
+		}
+	}
+	ClosedEndTick = EndTick;
+}
+
+void UStratLockstepSubsystem::ReceiveKeyframePart(const uint32 Tick, const int32 TotalSize, const int32 Offset, const TConstArrayView<uint8> Bytes)
+{
+	//~ Every keyframe starts at offset zero. A newer one restarts the transfer, so parts of any other are stale.
+	if (Offset == 0)
+	{
+		ReceivingKeyframeTick = Tick;
+		ReceivingKeyframe.Reset();
+	}
+	if (Tick != ReceivingKeyframeTick || Offset != ReceivingKeyframe.Num() || Bytes.Num() > TotalSize - Offset)
+	{
+		return;
+	}
+
+	ReceivingKeyframe.Append(Bytes);
+	if (ReceivingKeyframe.Num() < TotalSize)
+	{
+		return;
+	}
+
+	ReceivingKeyframeTick = MAX_uint32;
+	if (!ReadKeyframe(MoveTemp(ReceivingKeyframe)) || GetCurrentTick() != Tick)
+	{
+		UE_LOG(LogStratLockstep, Error, TEXT("The server's keyframe at tick %u didn't load. This client can't follow the match."), Tick);
+		return;
+	}
+
+	//~ Ticks from the keyframe on come next, in full.
+	ReceivedCommands.Reset();
+	NextCommandIndex = 0;
+	ClosedEndTick = Tick;
+	ResendRequestedTick = MAX_uint32;
+	StepAccumulator = 0.f;
+	UE_LOG(LogStratLockstep, Log, TEXT("Loaded the server's keyframe at tick %u."), Tick);
+}
+
+void UStratLockstepSubsystem::WriteKeyframe(TArray<uint8>& OutBytes)
+{
+	FStratUnitSnapshot Snapshot;
+	UnitSim->WriteSnapshot(Snapshot);
+
+	FStratSaveWriter Writer;
+	StratSave::AddUnitColumns(Writer, Snapshot);
+	if (Factions)
+	{
+		Writer.AddColumn(StratSave::EChunk::FactionRelations, TArray<FStratFactionRelations>(Factions->GetAllRelations()));
+	}
+	if (Economy)
+	{
+		TArray<uint8> EconomyBytes;
+		FMemoryWriter Ar(EconomyBytes);
+		Economy->WriteState(Ar);
+		Writer.AddChunk(StratSave::EChunk::Economy, MoveTemp(EconomyBytes));
+	}
+	Writer.Finish(OutBytes);
+}
+
+bool UStratLockstepSubsystem::ReadKeyframe(TArray<uint8>&& Bytes)
+{
+	FStratSaveReader Reader;
+	FStratUnitSnapshot Snapshot;
+	TArray<FStratFactionRelations> Relations;
+	if (!Reader.OpenBytes(MoveTemp(Bytes)) || !StratSave::BindUnitColumns(Reader, Snapshot)
+		|| (Reader.HasChunk(StratSave::EChunk::FactionRelations) && !Reader.BindColumn(StratSave::EChunk::FactionRelations, Relations))
+		|| !Reader.Decompress() || !UnitSim->ReadSnapshot(Snapshot))
+	{
+		return false;
+	}
+
+	//~ Relations change through commands, so a replay seek back has to undo the ones after the keyframe.
+	if (Factions)
+	{
+		Factions->RestoreRelations(Relations);
+	}
+
+	//~ Keyframes from before the economy was in them start it over, which is only right for a replay's first one.
+	if (Economy)
+	{
+		if (!Reader.HasChunk(StratSave::EChunk::Economy))
+		{
+			Economy->ResetState();
+			return true;
+		}
+
+		TArray<uint8> EconomyBytes;
+		const bool bRead = Reader.ReadChunk(StratSave::EChunk::Economy, EconomyBytes);
+		FMemoryReader Ar(EconomyBytes);
+		return bRead && Economy->ReadState(Ar);
+	}
+	return true;
+}
+
+void UStratLockstepSubsystem::CheckClientHash(APlayerState& Player, const uint32 Tick, const uint32 Hash)
+{
+	const int32 HashEveryNTicks = FMath::Max(GetDefault<UStratLockstepSettings>()->HashEveryNTicks, 1);
+	const FTickHash& Own = HashHistory[(Tick / HashEveryNTicks) % HashHistory.Num()];
+	if (Own.Tick != Tick)
+	{
+		//~ Too old, already overwritten.
+		return;
+	}
+
+	if (Own.Hash != Hash)
+	{
+		UE_LOG(LogStratLockstep, Error, TEXT("Desync with %s at tick %u. Server hash %08x, client hash %08x."), *Player.GetPlayerName(), Tick, Own.Hash, Hash);
+		OnDesyncDetected.Broadcast(&Player, Tick);
+	}
+}
+
+bool UStratLockstepSubsystem::IsServer() const
+{
+	return GetWorld()->GetNetMode() != NM_Client;
+}
+
+void UStratLockstepSubsystem::TickServer(const float DeltaTime)
+{
+	const float FixedDeltaTime = UnitSim->GetFixedDeltaTime();
+	const int32 MaxStepsPerFrame = GetDefault<UStratUnitSettings>()->MaxStepsPerFrame;
+	const uint32 JoinKeyframeEveryNTicks = static_cast<uint32>(FMath::Max(GetDefault<UStratLockstepSettings>()->JoinKeyframeEveryNTicks, 1));
+
+	StepAccumulator += DeltaTime;
+	int32 NumSteps = 0;
+	while (StepAccumulator >= FixedDeltaTime && NumSteps < MaxStepsPerFrame)
+	{
+		//~ Closing the tick. From here its commands are history and can't change.
+		const uint32 Tick = GetCurrentTick();
+		const int32 FirstCommand = CommandHistory.Num();
+		for (FStratLockstepCommand& Command : PendingCommands)
+		{
+			Command.Tick = Tick;
+			CommandHistoryBytes.Add(Command.GetNetBytes());
+			CommandHistory.Add(MoveTemp(Command));
+		}
+		PendingCommands.Reset();
+
+		RunTick(TConstArrayView<FStratLockstepCommand>(CommandHistory).RightChop(FirstCommand));
+		StepAccumulator -= FixedDeltaTime;
+		++NumSteps;
+
+		if (GetCurrentTick() % JoinKeyframeEveryNTicks == 0)
+		{
+			TakeJoinKeyframe();
+		}
+	}
+
+	StepAccumulator = FMath::Min(StepAccumulator, FixedDeltaTime);
+	SendClosedTicks();
+}
+
+void UStratLockstepSubsystem::TickClient(const float DeltaTime)
+{
+	const UStratLockstepSettings* Settings = GetDefault<UStratLockstepSettings>();
+	const float FixedDeltaTime = UnitSim->GetFixedDeltaTime();
+
+	//~ Commands go up once per tick of wall time, not per frame.
+	FlushTimer += DeltaTime;
+	if (FlushTimer >= FixedDeltaTime)
+	{
+		FlushTimer = 0.f;
+		FlushLocalCommands();
+	}
+
+	//~ Run at the fixed rate, faster when too far behind the server, and never past what the server closed.
+	StepAccumulator += DeltaTime;
+	const int32 Buffered = static_cast<int32>(ClosedEndTick - FMath::Min(ClosedEndTick, GetCurrentTick()));
+	int32 NumSteps = FMath::FloorToInt32(StepAccumulator / FixedDeltaTime);
+	if (Buffered > Settings->TargetBufferTicks)
+	{
+		NumSteps = FMath::Max(NumSteps, Buffered - Settings->TargetBufferTicks);
+	}
+	NumSteps = FMath::Min3(NumSteps, Buffered, Settings->MaxCatchUpStepsPerFrame);
+
+	for (int32 Step = 0; Step < NumSteps; ++Step)
+	{
+		const uint32 Tick = GetCurrentTick();
+		const int32 FirstCommand = NextCommandIndex;
+		while (ReceivedCommands.IsValidIndex(NextCommandIndex) && ReceivedCommands[NextCommandIndex].Tick == Tick)
+		{
+			++NextCommandIndex;
+		}
+
+		RunTick(TConstArrayView<FStratLockstepCommand>(ReceivedCommands).Slice(FirstCommand, NextCommandIndex - FirstCommand));
+	}
+
+	StepAccumulator = FMath::Clamp(StepAccumulator - NumSteps * FixedDeltaTime, 0.f, FixedDeltaTime);
+
+	if (NextCommandIndex > 1024 && NextCommandIndex * 2 > ReceivedCommands.Num())
+	{
+		ReceivedCommands.RemoveAt(0, NextCommandIndex, EAllowShrinking::No);
+		NextCommandIndex = 0;
+	}
+}
+
+void UStratLockstepSubsystem::RunTick(const TConstArrayView<FStratLockstepCommand> Commands)
+{
+	OnTickStarting.Broadcast(GetCurrentTick(), Commands);
+
+	for (const FStratLockstepCommand& Command : Commands)
+	{
+		ApplyCommand(Command);
+	}
+
+	const uint32 Tick = GetCurrentTick();
+	UnitSim->StepOnce();
+
+	const int32 HashEveryNTicks = FMath::Max(GetDefault<UStratLockstepSettings>()->HashEveryNTicks, 1);
+	if (Tick % HashEveryNTicks != 0)
+	{
+		return;
+	}
+
+	const uint32 Hash = ComputeStateHash();
+	if (IsServer())
+	{
+		HashHistory[(Tick / HashEveryNTicks) % HashHistory.Num()] = {Tick, Hash};
+	}
+	else if (UStratLockstepComponent* Component = GetLocalComponent())
+	{
+		Component->Server_ReportStateHash(Tick, Hash);
+	}
+}
+
+uint32 UStratLockstepSubsystem::ComputeStateHash()
+{
+	const uint32 Hash = UnitSim->ComputeStateHash();
+	return Economy ? Economy->ComputeStateHash(Hash) : Hash;
+}
+
+void UStratLockstepSubsystem::ApplyCommand(const FStratLockstepCommand& Command)
+{
+	switch (Command.Type)
+	{
+	case EStratLockstepCommandType::Spawn:
+		UnitSim->SpawnUnitOfType(Command.TypeId, FVector(Command.TargetLocation), Command.Faction);
+		break;
+
+	case EStratLockstepCommandType::Move:
+		{
+			FStratUnitOrder Order;
+			Order.Type = EStratUnitOrderType::Move;
+			Order.TargetLocation = FVector3f(FVector(Command.TargetLocation));
+			Order.FixedTargetLocation = FStratFixedVector::FromIntCm(Command.TargetLocation);
+			IssueToUnits(Command, Order);
+		}
+		break;
+
+	case EStratLockstepCommandType::Attack:
+		{
+			//~ The order system fills in the target's position at the start of the step.
+			FStratUnitOrder Order;
+			Order.Type = EStratUnitOrderType::Attack;
+			Order.TargetUnit = Command.TargetUnit;
+			IssueToUnits(Command, Order);
+		}
+		break;
+
+	case EStratLockstepCommandType::Formation:
+		{
+			//~ Square grid centered on the target, in integers so every peer gets the same slots.
+			const int32 NumUnits = Command.Units.Num();
+			const int32 NumSlots = Command.FormationSlots > 0 ? Command.FormationSlots : NumUnits;
+			const int32 Columns = NumSlots > 0 ? static_cast<int32>(StratFixed::SqrtInt(NumSlots - 1)) + 1 : 1;
+			const int32 Rows = (NumSlots + Columns - 1) / Columns;
+			for (int32 Index = 0; Index < NumUnits; ++Index)
+			{
+				const int32 SlotIndex = Command.FormationFirstSlot + Index;
+				const int32 Column = SlotIndex % Columns;
+				const int32 Row = SlotIndex / Columns;
+				const FIntVector Slot = Command.TargetLocation + FIntVector(
+					(2 * Column - (Columns - 1)) * Command.FormationSpacing / 2,
+					(2 * Row - (Rows - 1)) * Command.FormationSpacing / 2,
+					0);
+
+				FStratUnitOrder Order;
+				Order.Type = EStratUnitOrderType::Move;
+				Order.TargetLocation = FVector3f(FVector(Slot));
+				Order.FixedTargetLocation = FStratFixedVector::FromIntCm(Slot);
+				if (Command.bQueued)
+				{
+					UnitSim->QueueOrder(Command.Units[Index], Order);
+				}
+				else
+				{
+					UnitSim->IssueOrder(Command.Units[Index], Order);
+				}
+			}
+		}
+		break;
+
+	case EStratLockstepCommandType::SetRelation:
+		if (Factions)
+		{
+			Factions->ApplyRelation(Command.Faction, Command.OtherFaction, Command.Relation);
+		}
+		break;
+
+	case EStratLockstepCommandType::SetSharedControl:
+		if (Factions)
+		{
+			Factions->ApplySharedControl(Command.Faction, Command.OtherFaction, Command.bSharedControl);
+		}
+		break;
+
+	case EStratLockstepCommandType::AddResourceNode:
+		if (Economy)
+		{
+			Economy->ApplyResourceNode(Command.TargetUnit, Command.Resource, Command.Amount);
+		}
+		break;
+
+	case EStratLockstepCommandType::AssignGatherer:
+		if (Economy)
+		{
+			for (const FStratUnitHandle& Worker : Command.Units)
+			{
+				Economy->ApplyGatherer(Worker, Command.TargetUnit);
+			}
+		}
+		break;
+
+	case EStratLockstepCommandType::QueueProduction:
+		if (Economy)
+		{
+			for (const FStratUnitHandle& Producer : Command.Units)
+			{
+				Economy->ApplyQueueProduction(Producer, Command.TypeId);
+			}
+		}
+		break;
+
+	case EStratLockstepCommandType::CancelProduction:
+		if (Economy)
+		{
+			for (const FStratUnitHandle& Producer : Command.Units)
+			{
+				Economy->ApplyCancelProduction(Producer);
+			}
+		}
+		break;
+
+	case EStratLockstepCommandType::AddResources:
+		if (Economy)
+		{
+			Economy->ApplyResources(Command.Faction, Command.Resource, Command.Amount);
+		}
+		break;
+	}
+}
+
+void UStratLockstepSubsystem::IssueToUnits(const FStratLockstepCommand& Command, const FStratUnitOrder& Order)
+{
+	if (Command.bQueued)
+	{
+		UnitSim->QueueOrders(Command.Units, Order);
+		return;
+	}
+
+	for (const FStratUnitHandle& Unit : Command.Units)
+	{
+		UnitSim->IssueOrder(Unit, Order);
+	}
+}
+
+void UStratLockstepSubsystem::TakeJoinKeyframe()
+{
+	const uint32 Tick = GetCurrentTick();
+	JoinKeyframe.Reset();
+	WriteKeyframe(JoinKeyframe);
+	JoinKeyframeTick = Tick;
+
+	//~ Everything before the keyframe is in it. Clients still behind it get the keyframe instead.
+	const int32 NumCovered = Algo::LowerBoundBy(CommandHistory, Tick, &FStratLockstepCommand::Tick);
+	CommandHistory.RemoveAt(0, NumCovered, EAllowShrinking::No);
+	CommandHistoryBytes.RemoveAt(0, NumCovered, EAllowShrinking::No);
+}
+
+void UStratLockstepSubsystem::SendClosedTicks()
+{
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	if (!GameState)
+	{
+		return;
+	}
+
+	const uint32 EndTick = GetCurrentTick();
+	const int32 MaxBytesPerRpc = GetDefault<UStratLockstepSettings>()->MaxBytesPerRpc;
+
+	for (APlayerState* Player : GameState->PlayerArray)
+	{
+		UStratLockstepComponent* Component = Player ? Player->FindComponentByClass<UStratLockstepComponent>() : nullptr;
+		const APlayerController* PC = Player ? Player->GetPlayerController() : nullptr;
+		if (!Component || !PC || PC->IsLocalController() || Component->SentEndTick >= EndTick)
+		{
+			continue;
+		}
+
+		int32 NumRpcs = 0;
+		if (Component->SentEndTick < JoinKeyframeTick)
+		{
+			//~ The commands it needs are gone. It loads the keyframe and carries on from there.
+			if (Component->SentKeyframeTick != JoinKeyframeTick)
+			{
+				Component->SentKeyframeTick = JoinKeyframeTick;
+				Component->SentKeyframeBytes = 0;
+			}
+			while (Component->SentKeyframeBytes < JoinKeyframe.Num() && NumRpcs < MaxRpcsPerClientPerFrame)
+			{
+				const int32 PartSize = FMath::Min(KeyframePartBytes, JoinKeyframe.Num() - Component->SentKeyframeBytes);
+				Component->Client_ReceiveKeyframePart(JoinKeyframeTick, JoinKeyframe.Num(), Component->SentKeyframeBytes,
+					TArray<uint8>(JoinKeyframe.GetData() + Component->SentKeyframeBytes, PartSize));
+				Component->SentKeyframeBytes += PartSize;
+				++NumRpcs;
+			}
+
+			if (Component->SentKeyframeBytes < JoinKeyframe.Num() || NumRpcs >= MaxRpcsPerClientPerFrame)
+			{
+				continue;
+			}
+			Component->SentEndTick = JoinKeyframeTick;
+		}
+
+		//~ RPC boundaries must fall between ticks, since each RPC closes every tick before its EndTick.
+		int32 Index = Algo::LowerBoundBy(CommandHistory, Component->SentEndTick, &FStratLockstepCommand::Tick);
+		uint32 FirstTick = Component->SentEndTick;
+		TArray<FStratLockstepCommand> Batch;
+		int32 BatchBytes = 0;
+		for (; Index < CommandHistory.Num(); ++Index)
+		{
+			const FStratLockstepCommand& Command = CommandHistory[Index];
+			if (!Batch.IsEmpty() && BatchBytes + CommandHistoryBytes[Index] > MaxBytesPerRpc && Command.Tick != Batch.Last().Tick)
+			{
+				Component->Client_ReceiveTicks(FirstTick, Command.Tick, Batch);
+				FirstTick = Command.Tick;
+				Batch.Reset();
+				BatchBytes = 0;
+
+				if (++NumRpcs >= MaxRpcsPerClientPerFrame)
+				{
+					break;
+				}
+			}
+			Batch.Add(Command);
+			BatchBytes += CommandHistoryBytes[Index];
+		}
+
+		if (NumRpcs >= MaxRpcsPerClientPerFrame)
+		{
+			//~ The rest goes next frame.
+			Component->SentEndTick = FirstTick;
+			continue;
+		}
+
+		Component->Client_ReceiveTicks(FirstTick, EndTick, Batch);
+		Component->SentEndTick = EndTick;
+	}
+}
+
+void UStratLockstepSubsystem::FlushLocalCommands()
+{
+	if (OutgoingCommands.IsEmpty())
+	{
+		return;
+	}
+
+	if (UStratLockstepComponent* Component = GetLocalComponent())
+	{
+		Component->Server_SubmitCommands(GetCurrentTick(), OutgoingCommands);
+		OutgoingCommands.Reset();
+	}
+}
+
+UStratLockstepComponent* UStratLockstepSubsystem::GetLocalComponent() const
+{
+	const APlayerController* PC = GetWorld()->GetFirstPlayerController();
+	const APlayerState* Player = PC ? PC->GetPlayerState<APlayerState>() : nullptr;
+	return Player ? Player->FindComponentByClass<UStratLockstepComponent>() : nullptr;
+}
@@ -0,0 +1,186 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StratLockstepTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "StratLockstepSubsystem.generated.h"
+
+class APlayerState;
+class UStratEconomySubsystem;
+class UStratFactionSubsystem;
+class UStratLockstepComponent;
+class UStratUnitDefinition;
+class UStratUnitSimSubsystem;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogStratLockstep, Log, All);
+
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnStratLockstepDesync, APlayerState* /*Player*/, uint32 /*Tick*/);
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnStratLockstepTickStarting, uint32 /*Tick*/, TConstArrayView<FStratLockstepCommand> /*Commands*/);
+
+/**
+ * Optional lockstep networking for the unit simulation. Only exists when UStratLockstepSettings::bEnabled.
+ *
+ * The tick is the simulation frame. The server runs ticks at the fixed rate and, before running tick T, takes every command
+ * that arrived since tick T-1 into it. Closed ticks stream to each client, which runs a tick only once it has it, so every
+ * peer applies the same commands before the same step. The simulation runs in fixed point, and clients report state hashes
+ * the server checks against its own.
+ *
+ * Every UStratLockstepSettings::JoinKeyframeEveryNTicks the server snapshots the match and drops the commands before it.
+ * A client that joins late, or asks for ticks the server no longer has, loads the snapshot and plays on from its tick.
+ * A client that sees a gap in the tick stream drops the batch and asks the server to send again from the first missing tick.
+ */
+UCLASS()
+class UE_RTS_API UStratLockstepSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	//~ Begin UTickableWorldSubsystem interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~ End UTickableWorldSubsystem interface
+
+	/** bQueued adds the order after each unit's queued ones, like a shift-click. */
+	UFUNCTION(BlueprintCallable, Category=StratLockstep)
+	void IssueMove(const TArray<FStratUnitHandle>& Units, const FVector& Location, bool bQueued = false);
+
+	UFUNCTION(BlueprintCallable, Category=StratLockstep)
+	void IssueAttack(const TArray<FStratUnitHandle>& Units, FStratUnitHandle Target, bool bQueued = false);
+
+	UFUNCTION(BlueprintCallable, Category=StratLockstep)
+	void IssueFormationMove(const TArray<FStratUnitHandle>& Units, const FVector& Location, float Spacing = 200.f, bool bQueued = false);
+
+	/** Server only. Spawns on every peer on the same tick, so the handle matches everywhere. */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category=StratLockstep)
+	void SpawnUnit(const UStratUnitDefinition* Definition, const FVector& Location, uint8 Faction);
+
+	/** Server. Schedules a UStratFactionSubsystem relation change for the next tick. UStratFactionSubsystem::SetRelation routes here. */
+	void SubmitRelation(uint8 Faction, uint8 Other, EStratFactionRelation Relation);
+
+	/** Server. Same as SubmitRelation, for UStratFactionSubsystem::SetSharedControl. */
+	void SubmitSharedControl(uint8 Faction, uint8 Other, bool bShared);
+
+	/** Sends a command from the local player. Applied on every peer on the same future tick. Big orders are split across commands. */
+	void SubmitCommand(const FStratLockstepCommand& Command);
+
+	/** The next tick to run. */
+	uint32 GetCurrentTick() const;
+
+	/** Server. Commands from a remote player, checked before they're scheduled. */
+	void EnqueueClientCommands(const APlayerState& Player, TConstArrayView<FStratLockstepCommand> Commands);
+
+	/** Client. The next closed ticks from the server. A batch that leaves a gap is dropped and the missing ticks are asked for. */
+	void ReceiveTicks(uint32 FirstTick, uint32 EndTick, TConstArrayView<FStratLockstepCommand> Commands);
+
+	/** Client. Part of the server's join keyframe at Tick, Offset bytes in. Loaded once all TotalSize bytes are in. */
+	void ReceiveKeyframePart(uint32 Tick, int32 TotalSize, int32 Offset, TConstArrayView<uint8> Bytes);
+
+	/** The units, faction relations and economy, as a save file chunk set. For join keyframes and replays. */
+	void WriteKeyframe(TArray<uint8>& OutBytes);
+
+	/** Replaces the units, relations and economy with a WriteKeyframe's. False if Bytes are damaged. */
+	bool ReadKeyframe(TArray<uint8>&& Bytes);
+
+	/** Server. */
+	void CheckClientHash(APlayerState& Player, uint32 Tick, uint32 Hash);
+
+	/** What peers compare: the unit simulation's state hash with the economy folded in. Waits for an economy step in flight. */
+	uint32 ComputeStateHash();
+
+	/** Server. A client's simulation differs from the server's. The client's game is broken from this tick on. */
+	FOnStratLockstepDesync OnDesyncDetected;
+
+	/** Every peer. A tick is about to run. None of its commands are applied yet, so the simulation is still at its start. */
+	FOnStratLockstepTickStarting OnTickStarting;
+
+	/** Replay playback. While set the lockstep clock is stopped, and ticks only run through RunReplayTick. */
+	void SetReplayDriven(const bool bInReplayDriven) { bReplayDriven = bInReplayDriven; }
+
+	/** Replay playback. Runs the current tick with recorded commands. */
+	void RunReplayTick(const TConstArrayView<FStratLockstepCommand> Commands) { RunTick(Commands); }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	bool IsServer() const;
+
+	/** The configured cap, clamped to the wire format's. */
+	static int32 GetMaxUnitsPerCommand();
+
+	void TickServer(float DeltaTime);
+	void TickClient(float DeltaTime);
+
+	/** Applies Commands, steps the simulation once and hashes when due. Every command must be for the current tick. */
+	void RunTick(TConstArrayView<FStratLockstepCommand> Commands);
+	void ApplyCommand(const FStratLockstepCommand& Command);
+
+	/** The same order for every unit of the command, queued or replacing. */
+	void IssueToUnits(const FStratLockstepCommand& Command, const FStratUnitOrder& Order);
+	void SendClosedTicks();
+
+	/** Server. Snapshots the match into JoinKeyframe and drops the command history it covers. */
+	void TakeJoinKeyframe();
+
+	void FlushLocalCommands();
+	UStratLockstepComponent* GetLocalComponent() const;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratUnitSimSubsystem> UnitSim;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratFactionSubsystem> Factions;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratEconomySubsystem> Economy;
+
+	/** Server. Commands for the next tick, in arrival order. */
+	TArray<FStratLockstepCommand> PendingCommands;
+
+	/** Server. Every command run from JoinKeyframeTick on, in order. */
+	TArray<FStratLockstepCommand> CommandHistory;
+
+	/** Server. GetNetBytes of each CommandHistory entry, measured once when it's closed. */
+	TArray<int32> CommandHistoryBytes;
+
+	/** Server. The last WriteKeyframe, at the start of JoinKeyframeTick. Empty until the first is taken. */
+	TArray<uint8> JoinKeyframe;
+	uint32 JoinKeyframeTick{0};
+
+	struct FTickHash
+	{
+		uint32 Tick{MAX_uint32};
+		uint32 Hash{0};
+	};
+
+	/** Server. Recent own hashes, a ring indexed by hash number. */
+	TArray<FTickHash> HashHistory;
+
+	/** Client. Commands received but not run yet, from NextCommandIndex on. */
+	TArray<FStratLockstepCommand> ReceivedCommands;
+	int32 NextCommandIndex{0};
+
+	/** Client. Every tick before this has arrived. */
+	uint32 ClosedEndTick{0};
+
+	/** Client. The tick last asked for after a gap, so one gap is only asked for once. */
+	uint32 ResendRequestedTick{MAX_uint32};
+
+	/** Client. Parts of a join keyframe so far. */
+	TArray<uint8> ReceivingKeyframe;
+	uint32 ReceivingKeyframeTick{MAX_uint32};
+
+	/** Client. Local commands waiting for the next batch to the server. */
+	TArray<FStratLockstepCommand> OutgoingCommands;
+
+	float StepAccumulator{0.f};
+	float FlushTimer{0.f};
+	bool bReplayDriven{false};
+};
@@ -0,0 +1,186 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratLockstepTypes.h"
+
+#include "Serialization/BitWriter.h"
+
+namespace
+{
+	constexpr uint8 QueuedBit = 0x80;
+	constexpr EStratLockstepCommandType LastType = EStratLockstepCommandType::AddResources;
+
+	/** Zigzag so small negative values pack as small as small positive ones. */
+	void SerializeSignedPacked(FArchive& Ar, int32& Value)
+	{
+		uint32 ZigZag = (static_cast<uint32>(Value) << 1) ^ static_cast<uint32>(Value >> 31);
+		Ar.SerializeIntPacked(ZigZag);
+		if (Ar.IsLoading())
+		{
+			Value = static_cast<int32>(ZigZag >> 1) ^ -static_cast<int32>(ZigZag & 1);
+		}
+	}
+
+	void SerializeHandle(FArchive& Ar, FStratUnitHandle& Unit)
+	{
+		uint32 Value = Unit.GetValue();
+		Ar << Value;
+		if (Ar.IsLoading())
+		{
+			Unit = FStratUnitHandle::FromValue(Value);
+		}
+	}
+}
+
+bool FStratLockstepCommand::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	uint8 Header = static_cast<uint8>(Type) | (bQueued ? QueuedBit : 0);
+	Ar << Header;
+	Ar.SerializeIntPacked(Tick);
+
+	uint32 NumUnits = Units.Num();
+	Ar.SerializeIntPacked(NumUnits);
+
+	if (Ar.IsLoading())
+	{
+		Type = static_cast<EStratLockstepCommandType>(Header & ~QueuedBit);
+		bQueued = (Header & QueuedBit) != 0;
+
+		//~ No peer sends bigger commands. Never let a bad count allocate.
+		if (Type > LastType || NumUnits > static_cast<uint32>(StratLockstep::MaxUnitsPerCommand))
+		{
+			Ar.SetError();
+			bOutSuccess = false;
+			return true;
+		}
+		Units.SetNum(NumUnits);
+	}
+
+	for (FStratUnitHandle& Unit : Units)
+	{
+		SerializeHandle(Ar, Unit);
+	}
+
+	switch (Type)
+	{
+	case EStratLockstepCommandType::Spawn:
+		SerializeSignedPacked(Ar, TargetLocation.X);
+		SerializeSignedPacked(Ar, TargetLocation.Y);
+		SerializeSignedPacked(Ar, TargetLocation.Z);
+		Ar << TypeId;
+		Ar << Faction;
+		break;
+
+	case EStratLockstepCommandType::Move:
+		SerializeSignedPacked(Ar, TargetLocation.X);
+		SerializeSignedPacked(Ar, TargetLocation.Y);
+		SerializeSignedPacked(Ar, TargetLocation.Z);
+		break;
+
+	case EStratLockstepCommandType::Attack:
+		SerializeHandle(Ar, TargetUnit);
+		break;
+
+	case EStratLockstepCommandType::Formation:
+		SerializeSignedPacked(Ar, TargetLocation.X);
+		SerializeSignedPacked(Ar, TargetLocation.Y);
+		SerializeSignedPacked(Ar, TargetLocation.Z);
+		SerializeSignedPacked(Ar, FormationSpacing);
+		SerializeSignedPacked(Ar, FormationFirstSlot);
+		SerializeSignedPacked(Ar, FormationSlots);
+		break;
+
+	case EStratLockstepCommandType::SetRelation:
+	case EStratLockstepCommandType::SetSharedControl:
+		{
+			//~ One byte for either, the relation or the shared flag.
+			uint8 Value = Type == EStratLockstepCommandType::SetRelation ? static_cast<uint8>(Relation) : static_cast<uint8>(bSharedControl);
+			Ar << Faction;
+			Ar << OtherFaction;
+			Ar << Value;
+			Relation = Type == EStratLockstepCommandType::SetRelation ? static_cast<EStratFactionRelation>(Value) : Relation;
+			bSharedControl = Type == EStratLockstepCommandType::SetSharedControl ? Value != 0 : bSharedControl;
+		}
+		break;
+
+	case EStratLockstepCommandType::AddResourceNode:
+	case EStratLockstepCommandType::AddResources:
+		{
+			uint8 ResourceValue = static_cast<uint8>(Resource);
+			if (Type == EStratLockstepCommandType::AddResourceNode)
+			{
+				SerializeHandle(Ar, TargetUnit);
+			}
+			else
+			{
+				Ar << Faction;
+			}
+			Ar << ResourceValue;
+			SerializeSignedPacked(Ar, Amount);
+			Resource = static_cast<EStratResource>(ResourceValue);
+			if (Resource >= EStratResource::MAX)
+			{
+				Ar.SetError();
+			}
+		}
+		break;
+
+	case EStratLockstepCommandType::AssignGatherer:
+		SerializeHandle(Ar, TargetUnit);
+		break;
+
+	case EStratLockstepCommandType::QueueProduction:
+		Ar << TypeId;
+		break;
+
+	case EStratLockstepCommandType::CancelProduction:
+		break;
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
+
+int32 FStratLockstepCommand::GetNetBytes() const
+{
+	//~ Saving only reads the command.
+	FBitWriter Writer(0, true);
+	bool bSuccess = false;
+	const_cast<FStratLockstepCommand*>(this)->NetSerialize(Writer, nullptr, bSuccess);
+	return static_cast<int32>(Writer.GetNumBytes());
+}
+
+FArchive& operator<<(FArchive& Ar, FStratLockstepCommand& Command)
+{
+	uint8 Type = static_cast<uint8>(Command.Type);
+	uint8 Relation = static_cast<uint8>(Command.Relation);
+	uint8 Resource = static_cast<uint8>(Command.Resource);
+	uint8 Flags = (Command.bQueued ? 1 : 0) | (Command.bSharedControl ? 2 : 0);
+	Ar << Command.Tick << Type << Command.TargetLocation << Command.TypeId << Command.Faction << Command.OtherFaction << Relation
+		<< Command.FormationSpacing << Command.FormationFirstSlot << Command.FormationSlots << Flags << Resource << Command.Amount;
+	SerializeHandle(Ar, Command.TargetUnit);
+
+	int32 NumUnits = Command.Units.Num();
+	Ar << NumUnits;
+	if (Ar.IsLoading())
+	{
+		Command.Type = static_cast<EStratLockstepCommandType>(Type);
+		Command.Relation = static_cast<EStratFactionRelation>(Relation);
+		Command.Resource = static_cast<EStratResource>(Resource);
+		Command.bQueued = (Flags & 1) != 0;
+		Command.bSharedControl = (Flags & 2) != 0;
+
+		//~ Four bytes a handle, so a count the rest of the file can't hold is damage. Never let it allocate.
+		if (Command.Type > LastType || Command.Resource >= EStratResource::MAX || NumUnits < 0 || NumUnits > (Ar.TotalSize() - Ar.Tell()) / static_cast<int64>(sizeof(uint32)))
+		{
+			Ar.SetError();
+			return Ar;
+		}
+		Command.Units.SetNum(NumUnits);
+	}
+
+	for (FStratUnitHandle& Unit : Command.Units)
+	{
+		SerializeHandle(Ar, Unit);
+	}
+	return Ar;
+}
@@ -0,0 +1,149 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Economy/StratEconomyTypes.h"
+#include "Faction/StratFactionTypes.h"
+#include "Units/StratUnitTypes.h"
+#include "StratLockstepTypes.generated.h"
+
+namespace StratLockstep
+{
+	/**
+	 * Hard cap on units in one command, part of the wire format. Every peer must agree on it, so it's not config.
+	 * Bigger orders are split across commands by UStratLockstepSubsystem::SubmitCommand.
+	 */
+	constexpr int32 MaxUnitsPerCommand = 1024;
+
+	/** Hard cap on slots in one formation, however many commands it's split across. */
+	constexpr int32 MaxFormationSlots = 1 << 16;
+}
+
+UENUM()
+enum class EStratLockstepCommandType : uint8
+{
+	/** Server only. TypeId, Faction, TargetLocation. */
+	Spawn,
+
+	/** Units, TargetLocation. */
+	Move,
+
+	/** Units, TargetUnit. */
+	Attack,
+
+	/**
+	 * Units, TargetLocation, FormationSpacing, FormationFirstSlot, FormationSlots. Units line up in a square grid of
+	 * FormationSlots centered on the target, from slot FormationFirstSlot on, so one formation can span several commands.
+	 */
+	Formation,
+
+	/** Server only. Faction, OtherFaction, Relation. Relations are read inside the simulation, so they change on a tick too. */
+	SetRelation,
+
+	/** Server only. Faction, OtherFaction, bSharedControl. */
+	SetSharedControl,
+
+	/** Server only. TargetUnit becomes a node of Resource holding Amount. The economy steps on every peer, so its inputs are commands too. */
+	AddResourceNode,
+
+	/** Units gather from TargetUnit. An invalid TargetUnit unassigns them. */
+	AssignGatherer,
+
+	/** Units each queue a unit of TypeId. */
+	QueueProduction,
+
+	/** Units each cancel their last queued unit. */
+	CancelProduction,
+
+	/** Server only. Faction, Resource, Amount. */
+	AddResources,
+};
+
+/**
+ * One player input in lockstep. Everything is integers, so every peer applies exactly the same thing.
+ * The server stamps Tick, the simulation step it runs before, and relays it to every client.
+ *
+ * One command carries one order for every unit in it, so a shift-queued waypoint for a whole selection is one command.
+ * Net serialized by hand, packed and with only the fields its Type reads.
+ */
+USTRUCT()
+struct FStratLockstepCommand
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	uint32 Tick{0};
+
+	UPROPERTY()
+	EStratLockstepCommandType Type{EStratLockstepCommandType::Move};
+
+	UPROPERTY()
+	TArray<FStratUnitHandle> Units;
+
+	/** Whole centimeters. */
+	UPROPERTY()
+	FIntVector TargetLocation{FIntVector::ZeroValue};
+
+	UPROPERTY()
+	FStratUnitHandle TargetUnit;
+
+	UPROPERTY()
+	uint16 TypeId{0};
+
+	UPROPERTY()
+	uint8 Faction{0};
+
+	/** Whole centimeters between formation slots. */
+	UPROPERTY()
+	int32 FormationSpacing{0};
+
+	/** Slot of the first unit in the formation's grid. */
+	UPROPERTY()
+	int32 FormationFirstSlot{0};
+
+	/** Slots in the whole formation. Zero is one slot per unit of this command. */
+	UPROPERTY()
+	int32 FormationSlots{0};
+
+	UPROPERTY()
+	uint8 OtherFaction{0};
+
+	UPROPERTY()
+	EStratFactionRelation Relation{EStratFactionRelation::Neutral};
+
+	UPROPERTY()
+	bool bSharedControl{false};
+
+	UPROPERTY()
+	EStratResource Resource{EStratResource::Supply};
+
+	/** Whole resource units. */
+	UPROPERTY()
+	int32 Amount{0};
+
+	/** Orders go after each unit's queued orders instead of replacing them. */
+	UPROPERTY()
+	bool bQueued{false};
+
+	/** Spawns, relation changes and resources out of nowhere. Dropped when a client sends them. */
+	bool IsServerOnly() const
+	{
+		return Type == EStratLockstepCommandType::Spawn || Type == EStratLockstepCommandType::SetRelation || Type == EStratLockstepCommandType::SetSharedControl
+			|| Type == EStratLockstepCommandType::AddResourceNode || Type == EStratLockstepCommandType::AddResources;
+	}
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+
+	/** Bytes NetSerialize writes, rounded up from bits. */
+	int32 GetNetBytes() const;
+
+	/** Plain form for files, such as replays. Every field, with no caps from config or the wire format. Sets an error on bad data. */
+	friend FArchive& operator<<(FArchive& Ar, FStratLockstepCommand& Command);
+};
+
+template<>
+struct TStructOpsTypeTraits<FStratLockstepCommand> : public TStructOpsTypeTraitsBase2<FStratLockstepCommand>
+{
+	enum { WithNetSerializer = true };
+};
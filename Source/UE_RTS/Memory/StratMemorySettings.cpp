@@ -0,0 +1,8 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratMemorySettings.h"
+
+UStratMemorySettings::UStratMemorySettings()
+{
+	CategoryName = TEXT("Game");
+}
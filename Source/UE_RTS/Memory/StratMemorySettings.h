@@ -0,0 +1,40 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "StratMemorySettings.generated.h"
+
+/**
+ * Memory budgets for the game's systems. Found under Project Settings > Game > Strat Memory.
+ * See UStratMemorySubsystem and the Strat.MemReport console command.
+ */
+UCLASS(Config=Game, DefaultConfig, meta=(DisplayName="Strat Memory"))
+class UE_RTS_API UStratMemorySettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UStratMemorySettings();
+
+	/** How often each system's memory is measured. Peaks are only as fine as this. */
+	UPROPERTY(Config, EditAnywhere, Category="Memory", meta=(ClampMin="0.1", Units="s"))
+	float SampleInterval{1.f};
+
+	/**
+	 * Budget per system in megabytes, keyed by the names Strat.MemReport prints: Units, Replication, Nav, Fog, AI, Events,
+	 * Terrain, Flight, Picking, Targeting, Projectiles, Economy. Going over logs a warning once, until the system drops back under.
+	 * Missing or 0 is no budget.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category="Memory", meta=(ClampMin="0.0", Units="MB"))
+	TMap<FName, float> SystemBudgets;
+
+	/** Warns when all systems together use more than this per live unit. 0 never warns. */
+	UPROPERTY(Config, EditAnywhere, Category="Memory", meta=(ClampMin="0"))
+	int32 MaxBytesPerUnit{0};
+
+	/** Below this many units bytes per unit is mostly fixed cost, so the per unit budget isn't checked. */
+	UPROPERTY(Config, EditAnywhere, Category="Memory", meta=(ClampMin="1"))
+	int32 MinUnitsForPerUnitBudget{200};
+};
@@ -0,0 +1,217 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratMemorySubsystem.h"
+
+#include "StratMemorySettings.h"
+#include "AI/StratAISchedulerSubsystem.h"
+#include "Combat/StratProjectileSubsystem.h"
+#include "Combat/StratTargetingSubsystem.h"
+#include "Economy/StratEconomySubsystem.h"
+#include "Engine/World.h"
+#include "Events/StratEventBusSubsystem.h"
+#include "Flight/StratFlightSubsystem.h"
+#include "Fog/StratFogOfWarSubsystem.h"
+#include "Selection/StratPickingSubsystem.h"
+#include "Units/StratUnitReplicationSubsystem.h"
+#include "Units/StratUnitSimSubsystem.h"
+#include "World/StratNavUpdateSubsystem.h"
+#include "World/StratPathSubsystem.h"
+#include "World/StratTerrainSubsystem.h"
+
+DEFINE_LOG_CATEGORY(LogStratMemory);
+
+DECLARE_MEMORY_STAT(TEXT("Game Systems"), STAT_StratMemory_Total, STATGROUP_StratUnits);
+
+namespace
+{
+	double ToMegabytes(const SIZE_T Bytes)
+	{
+		return static_cast<double>(Bytes) / (1024.0 * 1024.0);
+	}
+
+	FAutoConsoleCommandWithWorldArgsAndOutputDevice MemReportCommand(
+		TEXT("Strat.MemReport"),
+		TEXT("Prints the memory of each game system with its peak and budget, and bytes per unit. Strat.MemReport reset clears the peaks."),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+		{
+			UStratMemorySubsystem* Memory = World ? World->GetSubsystem<UStratMemorySubsystem>() : nullptr;
+			if (!Memory)
+			{
+				Ar.Log(TEXT("No game world."));
+				return;
+			}
+
+			if (Args.Num() > 0 && Args[0] == TEXT("reset"))
+			{
+				Memory->ResetPeaks();
+			}
+
+			Memory->Sample();
+			Memory->WriteReport(Ar);
+		}));
+}
+
+void UStratMemorySubsystem::Tick(const float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TimeUntilSample -= DeltaTime;
+	if (TimeUntilSample <= 0.f)
+	{
+		TimeUntilSample = GetDefault<UStratMemorySettings>()->SampleInterval;
+		Sample();
+	}
+}
+
+TStatId UStratMemorySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UStratMemorySubsystem, STATGROUP_StratUnits);
+}
+
+bool UStratMemorySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UStratMemorySubsystem::Sample()
+{
+	const UWorld* World = GetWorld();
+	TotalBytes = 0;
+
+	//~ Some systems don't exist on every machine, e.g. picking on a dedicated server. Those keep their last sample and peak.
+	const UStratUnitSimSubsystem* UnitSim = World->GetSubsystem<UStratUnitSimSubsystem>();
+	if (UnitSim)
+	{
+		RecordSystem(TEXT("Units"), UnitSim->GetAllocatedSize());
+	}
+	if (const UStratUnitReplicationSubsystem* Replication = World->GetSubsystem<UStratUnitReplicationSubsystem>())
+	{
+		RecordSystem(TEXT("Replication"), Replication->GetAllocatedSize());
+	}
+
+	SIZE_T NavBytes = 0;
+	if (const UStratNavUpdateSubsystem* NavUpdate = World->GetSubsystem<UStratNavUpdateSubsystem>())
+	{
+		NavBytes += NavUpdate->GetAllocatedSize();
+	}
+	if (const UStratPathSubsystem* Paths = World->GetSubsystem<UStratPathSubsystem>())
+	{
+		NavBytes += Paths->GetAllocatedSize();
+	}
+	RecordSystem(TEXT("Nav"), NavBytes);
+
+	if (const UStratFogOfWarSubsystem* Fog = World->GetSubsystem<UStratFogOfWarSubsystem>())
+	{
+		RecordSystem(TEXT("Fog"), Fog->GetAllocatedSize());
+	}
+	if (const UStratAISchedulerSubsystem* AIScheduler = World->GetSubsystem<UStratAISchedulerSubsystem>())
+	{
+		RecordSystem(TEXT("AI"), AIScheduler->GetAllocatedSize());
+	}
+	if (const UStratEventBusSubsystem* EventBus = World->GetSubsystem<UStratEventBusSubsystem>())
+	{
+		RecordSystem(TEXT("Events"), EventBus->GetAllocatedSize());
+	}
+	if (const UStratTerrainSubsystem* Terrain = World->GetSubsystem<UStratTerrainSubsystem>())
+	{
+		RecordSystem(TEXT("Terrain"), Terrain->GetHeightGrid().GetAllocatedSize());
+	}
+	if (const UStratFlightSubsystem* Flight = World->GetSubsystem<UStratFlightSubsystem>())
+	{
+		RecordSystem(TEXT("Flight"), Flight->GetClearance().GetAllocatedSize());
+	}
+	if (const UStratPickingSubsystem* Picking = World->GetSubsystem<UStratPickingSubsystem>())
+	{
+		RecordSystem(TEXT("Picking"), Picking->GetAllocatedSize());
+	}
+	if (const UStratTargetingSubsystem* Targeting = World->GetSubsystem<UStratTargetingSubsystem>())
+	{
+		RecordSystem(TEXT("Targeting"), Targeting->GetAllocatedSize());
+	}
+	if (const UStratProjectileSubsystem* Projectiles = World->GetSubsystem<UStratProjectileSubsystem>())
+	{
+		RecordSystem(TEXT("Projectiles"), Projectiles->GetAllocatedSize());
+	}
+	if (const UStratEconomySubsystem* Economy = World->GetSubsystem<UStratEconomySubsystem>())
+	{
+		RecordSystem(TEXT("Economy"), Economy->GetAllocatedSize());
+	}
+
+	PeakTotalBytes = FMath::Max(PeakTotalBytes, TotalBytes);
+	SET_MEMORY_STAT(STAT_StratMemory_Total, TotalBytes);
+
+	NumUnits = UnitSim ? UnitSim->GetNumUnits() : 0;
+	PeakNumUnits = FMath::Max(PeakNumUnits, NumUnits);
+
+	const UStratMemorySettings* Settings = GetDefault<UStratMemorySettings>();
+	if (Settings->MaxBytesPerUnit > 0 && NumUnits >= Settings->MinUnitsForPerUnitBudget)
+	{
+		const SIZE_T BytesPerUnit = TotalBytes / NumUnits;
+		const bool bOver = BytesPerUnit > static_cast<SIZE_T>(Settings->MaxBytesPerUnit);
+		if (bOver && !bOverUnitBudget)
+		{
+			UE_LOG(LogStratMemory, Warning, TEXT("Game systems use %llu bytes per unit with %d units, over the budget of %d."),
+				static_cast<uint64>(BytesPerUnit), NumUnits, Settings->MaxBytesPerUnit);
+		}
+		bOverUnitBudget = bOver;
+	}
+}
+
+void UStratMemorySubsystem::RecordSystem(const FName Name, const SIZE_T Bytes)
+{
+	FSystemMemory* System = Systems.FindByPredicate([Name](const FSystemMemory& Entry) { return Entry.Name == Name; });
+	if (!System)
+	{
+		System = &Systems.AddDefaulted_GetRef();
+		System->Name = Name;
+	}
+
+	System->Bytes = Bytes;
+	System->PeakBytes = FMath::Max(System->PeakBytes, Bytes);
+	TotalBytes += Bytes;
+
+	const float* BudgetMB = GetDefault<UStratMemorySettings>()->SystemBudgets.Find(Name);
+	const bool bOver = BudgetMB && *BudgetMB > 0.f && ToMegabytes(Bytes) > *BudgetMB;
+	if (bOver && !System->bOverBudget)
+	{
+		UE_LOG(LogStratMemory, Warning, TEXT("%s uses %.2f MB, over its budget of %.2f MB."), *Name.ToString(), ToMegabytes(Bytes), *BudgetMB);
+	}
+	System->bOverBudget = bOver;
+}
+
+void UStratMemorySubsystem::ResetPeaks()
+{
+	for (FSystemMemory& System : Systems)
+	{
+		System.PeakBytes = System.Bytes;
+	}
+	PeakTotalBytes = TotalBytes;
+	PeakNumUnits = NumUnits;
+}
+
+void UStratMemorySubsystem::WriteReport(FOutputDevice& Ar) const
+{
+	const UStratMemorySettings* Settings = GetDefault<UStratMemorySettings>();
+
+	Ar.Logf(TEXT("%-12s %10s %10s %10s %12s"), TEXT("System"), TEXT("MB"), TEXT("Peak MB"), TEXT("Budget MB"), TEXT("B/Unit"));
+	for (const FSystemMemory& System : Systems)
+	{
+		const float* BudgetMB = Settings->SystemBudgets.Find(System.Name);
+		Ar.Logf(TEXT("%-12s %10.2f %10.2f %10s %12.1f%s"),
+			*System.Name.ToString(),
+			ToMegabytes(System.Bytes),
+			ToMegabytes(System.PeakBytes),
+			BudgetMB && *BudgetMB > 0.f ? *FString::Printf(TEXT("%.2f"), *BudgetMB) : TEXT("-"),
+			NumUnits > 0 ? static_cast<double>(System.Bytes) / NumUnits : 0.0,
+			System.bOverBudget ? TEXT("  OVER") : TEXT(""));
+	}
+
+	Ar.Logf(TEXT("%-12s %10.2f %10.2f %10s %12.1f%s"),
+		TEXT("Total"),
+		ToMegabytes(TotalBytes),
+		ToMegabytes(PeakTotalBytes),
+		Settings->MaxBytesPerUnit > 0 ? *FString::Printf(TEXT("%d B/Unit"), Settings->MaxBytesPerUnit) : TEXT("-"),
+		NumUnits > 0 ? static_cast<double>(TotalBytes) / NumUnits : 0.0,
+		bOverUnitBudget ? TEXT("  OVER") : TEXT(""));
+	Ar.Logf(TEXT("%d units, peak %d. Engine side memory is under the Strat LLM tags, run with -llm and use stat LLMFULL."), NumUnits, PeakNumUnits);
+}
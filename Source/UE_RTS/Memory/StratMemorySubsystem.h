@@ -0,0 +1,64 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "StratMemorySubsystem.generated.h"
+
+class FOutputDevice;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogStratMemory, Log, All);
+
+/**
+ * Measures the heap memory of each game system every UStratMemorySettings::SampleInterval, keeps the high-water mark, and
+ * warns once when a system goes over its budget. The numbers come from each system's GetAllocatedSize, so they're what the
+ * system itself holds. Engine side costs, like actors and nav mesh tiles, are in the LLM tags instead, see StratMemoryTags.h.
+ *
+ * Strat.MemReport prints current, peak and budget per system, and bytes per live unit. Strat.MemReport reset clears the peaks.
+ */
+UCLASS()
+class UE_RTS_API UStratMemorySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin UTickableWorldSubsystem interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~ End UTickableWorldSubsystem interface
+
+	/** Measures every system now and checks the budgets. */
+	void Sample();
+
+	void ResetPeaks();
+
+	void WriteReport(FOutputDevice& Ar) const;
+
+	/** Everything measured in the last sample. */
+	SIZE_T GetTotalBytes() const { return TotalBytes; }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	struct FSystemMemory
+	{
+		FName Name;
+		SIZE_T Bytes{0};
+		SIZE_T PeakBytes{0};
+		bool bOverBudget{false};
+	};
+
+	/** Records one system's sample. Systems are added on first sight and keep their order. */
+	void RecordSystem(FName Name, SIZE_T Bytes);
+
+	TArray<FSystemMemory> Systems;
+
+	SIZE_T TotalBytes{0};
+	SIZE_T PeakTotalBytes{0};
+	int32 NumUnits{0};
+	int32 PeakNumUnits{0};
+	bool bOverUnitBudget{false};
+
+	float TimeUntilSample{0.f};
+};
@@ -0,0 +1,9 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratMemoryTags.h"
+
+LLM_DEFINE_TAG(StratUnits);
+LLM_DEFINE_TAG(StratCamera);
+LLM_DEFINE_TAG(StratNav);
+LLM_DEFINE_TAG(StratFog);
+LLM_DEFINE_TAG(StratReplication);
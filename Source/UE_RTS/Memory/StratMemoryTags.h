@@ -0,0 +1,16 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/LowLevelMemTracker.h"
+
+/**
+ * Low level memory tracker tags for the game's systems. Run with -llm and look at stat LLMFULL, or write -llmcsv.
+ * Tag a system's allocations with LLM_SCOPE_BYTAG(StratUnits) and friends. The log helpers tag theirs as SandCoreLogTools.
+ */
+LLM_DECLARE_TAG_API(StratUnits, UE_RTS_API);
+LLM_DECLARE_TAG_API(StratCamera, UE_RTS_API);
+LLM_DECLARE_TAG_API(StratNav, UE_RTS_API);
+LLM_DECLARE_TAG_API(StratFog, UE_RTS_API);
+LLM_DECLARE_TAG_API(StratReplication, UE_RTS_API);
@@ -0,0 +1,23 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratGameState.h"
+
+#include "StratPlayerState.h"
+#include "Faction/StratFactionRegistryComponent.h"
+
+AStratGameState::AStratGameState()
+{
+	FactionRegistryComp = CreateDefaultSubobject<UStratFactionRegistryComponent>("FactionRegistryComp");
+}
+
+void AStratGameState::AddPlayerState(APlayerState* PlayerState)
+{
+	//~ Temp until there is a lobby. Factions alternate by join order, like `Team = PIE_ID % 2` for PIE windows.
+	AStratPlayerState* StratPlayer = Cast<AStratPlayerState>(PlayerState);
+	if (HasAuthority() && StratPlayer && !PlayerState->IsInactive() && !PlayerArray.Contains(PlayerState))
+	{
+		StratPlayer->SetFactionId(static_cast<uint8>(PlayerArray.Num() % 2));
+	}
+
+	Super::AddPlayerState(PlayerState);
+}
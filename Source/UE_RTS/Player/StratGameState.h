@@ -0,0 +1,30 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ModularGameState.h"
+#include "StratGameState.generated.h"
+
+class UStratFactionRegistryComponent;
+
+/** Match wide state every player sees. */
+UCLASS(meta=(PrioritizeCategories="User"))
+class UE_RTS_API AStratGameState : public AModularGameStateBase
+{
+	GENERATED_BODY()
+
+public:
+	AStratGameState();
+
+	//~ Begin AGameStateBase interface
+	virtual void AddPlayerState(APlayerState* PlayerState) override;
+	//~ End AGameStateBase interface
+
+	UStratFactionRegistryComponent* GetFactionRegistry() const { return FactionRegistryComp; }
+
+protected:
+	/** Which factions are allied, at war, or share control of their units. */
+	UPROPERTY(VisibleAnywhere, Category="User|Info")
+	TObjectPtr<UStratFactionRegistryComponent> FactionRegistryComp;
+};
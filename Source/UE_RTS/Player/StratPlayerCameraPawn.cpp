@@ -7,6 +7,7 @@
 #include "KismetTraceUtils.h"
 #include "SandCoreLogToolsBPLibrary.h"
 #include "GameFramework/SpringArmComponent.h"
+#include "Memory/StratMemoryTags.h"
 #include "Net/UnrealNetwork.h"
 
 DEFINE_LOG_CATEGORY(LogGame);
@@ -82,6 +83,8 @@ namespace
 
 AStratPlayerCameraPawn::AStratPlayerCameraPawn()
 {
+	LLM_SCOPE_BYTAG(StratCamera);
+
 	PrimaryActorTick.bCanEverTick = true;
 	SetReplicatingMovement(false);
 
@@ -139,6 +142,8 @@ void AStratPlayerCameraPawn::SetupPlayerInputComponent(class UInputComponent* Pl
 
 void AStratPlayerCameraPawn::BeginPlay()
 {
+	LLM_SCOPE_BYTAG(StratCamera);
+
 	Super::BeginPlay();
 
 	{
@@ -178,6 +183,8 @@ void AStratPlayerCameraPawn::OnRep_Controller()
 
 void AStratPlayerCameraPawn::Tick(float DeltaTime)
 {
+	LLM_SCOPE_BYTAG(StratCamera);
+
 	Super::Tick(DeltaTime);
 
 	if (IsLocallyControlled())
@@ -257,6 +264,19 @@ void AStratPlayerCameraPawn::Tick(float DeltaTime)
 #endif
 }
 
+void AStratPlayerCameraPawn::SetPlaybackMovement(const FSimpleRepMovement& Movement, const bool bSnap)
+{
+	check(!IsLocallyControlled());
+	SimpleRepMovement = Movement;
+
+	//~ Tick's network proxy branch eases toward SimpleRepMovement, same as for a remote player.
+	if (bSnap)
+	{
+		TargetMoveLoc = Movement.Location;
+		SetActorLocationAndRotation(Movement.Location, FRotator(0.f, Movement.Yaw, 0.f));
+	}
+}
+
 void AStratPlayerCameraPawn::TimerLoop_TraceForHeight()
 {
 	const UWorld* World = GetWorld();
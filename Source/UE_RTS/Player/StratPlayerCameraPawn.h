@@ -56,6 +56,12 @@ public:
 	virtual void Tick(float DeltaTime) override;
 #pragma endregion
 
+	/** Where this player is looking. On the server this is the last location the owning client sent. */
+	const FSimpleRepMovement& GetSimpleRepMovement() const { return SimpleRepMovement; }
+
+	/** Replay playback. Drives a pawn nobody controls like a remote player's. bSnap jumps there instead of easing, e.g. after a seek. */
+	void SetPlaybackMovement(const FSimpleRepMovement& Movement, bool bSnap);
+
 protected:
 	void TimerLoop_TraceForHeight();
 	void TimerLoop_ServerSetSimpleRepMovement();
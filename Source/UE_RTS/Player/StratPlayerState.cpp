@@ -4,7 +4,13 @@
 #include "StratPlayerState.h"
 
 #include "SandCoreLogToolsBPLibrary.h"
+#include "Economy/StratEconomyComponent.h"
+#include "Faction/StratFactionSubsystem.h"
+#include "Fog/StratFogReplicationComponent.h"
+#include "Lockstep/StratLockstepComponent.h"
 #include "Net/UnrealNetwork.h"
+#include "Units/StratJoinSnapshotComponent.h"
+#include "Units/StratUnitRosterComponent.h"
 
 namespace
 {
@@ -30,6 +36,11 @@ namespace
 
 AStratPlayerState::AStratPlayerState()
 {
+	FogReplicationComp = CreateDefaultSubobject<UStratFogReplicationComponent>("FogReplicationComp");
+	LockstepComp = CreateDefaultSubobject<UStratLockstepComponent>("LockstepComp");
+	JoinSnapshotComp = CreateDefaultSubobject<UStratJoinSnapshotComponent>("JoinSnapshotComp");
+	EconomyComp = CreateDefaultSubobject<UStratEconomyComponent>("EconomyComp");
+	UnitRosterComp = CreateDefaultSubobject<UStratUnitRosterComponent>("UnitRosterComp");
 }
 
 void AStratPlayerState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
@@ -37,6 +48,7 @@ void AStratPlayerState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& Ou
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
 	DOREPLIFETIME(AStratPlayerState, PlayerColor);
+	DOREPLIFETIME(AStratPlayerState, FactionId);
 }
 
 void AStratPlayerState::BeginReplication()
@@ -82,3 +94,44 @@ void AStratPlayerState::BroadcastPlayerColorChanged(const FLinearColor& OldPlaye
 }
 
 void AStratPlayerState::Server_SetPlayerColor_Implementation(const FLinearColor& NewPlayerColor) { SetPlayerColor(NewPlayerColor); }
+
+void AStratPlayerState::SetFactionId(const uint8 NewFactionId)
+{
+	if (!ensureMsgf(StratFaction::IsValidId(NewFactionId), TEXT("Faction ids go up to %d."), StratFaction::MaxFactions - 1))
+	{
+		return;
+	}
+
+	if (NewFactionId != FactionId)
+	{
+		const uint8 OldFactionId = FactionId;
+		FactionId = NewFactionId;
+		BroadcastFactionIdChanged(OldFactionId);
+	}
+}
+
+bool AStratPlayerState::CanCommandFaction(const uint8 Faction) const
+{
+	const UStratFactionSubsystem* Factions = GetWorld()->GetSubsystem<UStratFactionSubsystem>();
+	return Factions && StratFaction::IsValidId(Faction) ? Factions->CanCommand(FactionId, Faction) : Faction == FactionId;
+}
+
+bool AStratPlayerState::IsHostileToFaction(const uint8 Faction) const
+{
+	const UStratFactionSubsystem* Factions = GetWorld()->GetSubsystem<UStratFactionSubsystem>();
+	return Factions && StratFaction::IsValidId(Faction) ? Factions->IsHostile(FactionId, Faction) : Faction != FactionId;
+}
+
+void AStratPlayerState::OnRep_FactionId(const uint8 OldFactionId)
+{
+	if (FactionId != OldFactionId)
+	{
+		BroadcastFactionIdChanged(OldFactionId);
+	}
+}
+
+void AStratPlayerState::BroadcastFactionIdChanged(const uint8 OldFactionId)
+{
+	INFO_LOG(LogTemp, Log, TEXT("NewFaction=%d  OldFaction=%d"), FactionId, OldFactionId)
+}
+
@@ -6,6 +6,12 @@
 #include "ModularPlayerState.h"
 #include "StratPlayerState.generated.h"
 
+class UStratEconomyComponent;
+class UStratFogReplicationComponent;
+class UStratJoinSnapshotComponent;
+class UStratLockstepComponent;
+class UStratUnitRosterComponent;
+
 /**
  * todo doc
  */
@@ -29,6 +35,27 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category=StratPlayerState, meta=(AutoCreateRefTerm="NewPlayerColor"))
 	void SetPlayerColor(const FLinearColor& NewPlayerColor);
 
+	/** The faction this player commands. Units of this faction are the player's, and its fog of war is what the player sees. */
+	UFUNCTION(BlueprintPure, Category=StratPlayerState)
+	uint8 GetFactionId() const { return FactionId; }
+
+	/**
+	 * Authority. The faction this player commands. A faction grants its fog and its units, so clients can't ask for one.
+	 * AStratGameState hands them out as players join.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category=StratPlayerState)
+	void SetFactionId(uint8 NewFactionId);
+
+	/** True if this player can select and order units of Faction. Their own, or one sharing control with theirs, see UStratFactionSubsystem. */
+	UFUNCTION(BlueprintPure, Category=StratPlayerState)
+	bool CanCommandFaction(uint8 Faction) const;
+
+	UStratUnitRosterComponent* GetUnitRoster() const { return UnitRosterComp; }
+
+	/** True if this player's faction is at war with Faction. */
+	UFUNCTION(BlueprintPure, Category=StratPlayerState)
+	bool IsHostileToFaction(uint8 Faction) const;
+
 protected:
 	/** Player Color is a quick way other players identify another player. Can be used in text and decals. */
 	UPROPERTY(EditInstanceOnly, ReplicatedUsing=OnRep_PlayerColor, Category="User|Options", Getter, Setter)
@@ -38,4 +65,31 @@ protected:
 	void BroadcastPlayerColorChanged(const FLinearColor& OldPlayerColor);
 	UFUNCTION(Server, Reliable)
 	void Server_SetPlayerColor(const FLinearColor& NewPlayerColor);
+
+	/** The faction this player commands. Units of this faction are the player's, and its fog of war is what the player sees. */
+	UPROPERTY(EditInstanceOnly, ReplicatedUsing=OnRep_FactionId, Category="User|Options", Getter, Setter)
+	uint8 FactionId{0};
+	UFUNCTION()
+	void OnRep_FactionId(uint8 OldFactionId);
+	void BroadcastFactionIdChanged(uint8 OldFactionId);
+
+	/** Streams this player's faction fog of war to the owning client. */
+	UPROPERTY(VisibleAnywhere, Category="User|Info")
+	TObjectPtr<UStratFogReplicationComponent> FogReplicationComp;
+
+	/** Carries this player's lockstep commands and tick stream. Idle unless lockstep is enabled. */
+	UPROPERTY(VisibleAnywhere, Category="User|Info")
+	TObjectPtr<UStratLockstepComponent> LockstepComp;
+
+	/** Streams every unit to this player when they join or reconnect. Idle unless join snapshots are enabled. */
+	UPROPERTY(VisibleAnywhere, Category="User|Info")
+	TObjectPtr<UStratJoinSnapshotComponent> JoinSnapshotComp;
+
+	/** This player's faction economy, replicated to them for the UI. Set by UStratEconomySubsystem. */
+	UPROPERTY(VisibleAnywhere, Category="User|Info")
+	TObjectPtr<UStratEconomyComponent> EconomyComp;
+
+	/** Every living unit this player commands, for rosters and portrait lists. Replicated to them only. */
+	UPROPERTY(VisibleAnywhere, Category="User|Info")
+	TObjectPtr<UStratUnitRosterComponent> UnitRosterComp;
 };
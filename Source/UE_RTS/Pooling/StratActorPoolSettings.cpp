@@ -0,0 +1,8 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratActorPoolSettings.h"
+
+UStratActorPoolSettings::UStratActorPoolSettings()
+{
+	CategoryName = TEXT("Game");
+}
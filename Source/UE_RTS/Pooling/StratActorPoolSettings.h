@@ -0,0 +1,49 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "StratActorPoolSettings.generated.h"
+
+/** Limits of one pooled actor class. */
+USTRUCT()
+struct FStratActorPoolClassSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category="Pool")
+	TSoftClassPtr<AActor> ActorClass;
+
+	/** Spawned hidden when the world begins play, so the first uses don't hitch. */
+	UPROPERTY(EditAnywhere, Category="Pool", meta=(ClampMin="0"))
+	int32 PrewarmCount{0};
+
+	/** Acquiring past this many live actors recycles the oldest one instead of spawning. */
+	UPROPERTY(EditAnywhere, Category="Pool", meta=(ClampMin="1"))
+	int32 MaxActive{32};
+
+	/** Released actors past this many idle ones are destroyed instead of kept. */
+	UPROPERTY(EditAnywhere, Category="Pool", meta=(ClampMin="0"))
+	int32 MaxPooled{32};
+};
+
+/** Project settings for actor pooling. Found under Project Settings > Game > Strat Actor Pool. */
+UCLASS(Config=Game, DefaultConfig, meta=(DisplayName="Strat Actor Pool"))
+class UE_RTS_API UStratActorPoolSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UStratActorPoolSettings();
+
+	/** Per class limits and pre-warming. Classes not listed here use the defaults below and aren't pre-warmed. */
+	UPROPERTY(Config, EditAnywhere, Category="Pool")
+	TArray<FStratActorPoolClassSettings> Classes;
+
+	UPROPERTY(Config, EditAnywhere, Category="Pool", meta=(ClampMin="1"))
+	int32 DefaultMaxActive{64};
+
+	UPROPERTY(Config, EditAnywhere, Category="Pool", meta=(ClampMin="0"))
+	int32 DefaultMaxPooled{16};
+};
@@ -0,0 +1,261 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratActorPoolSubsystem.h"
+
+#include "StratActorPoolSettings.h"
+#include "StratPoolableInterface.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+DEFINE_LOG_CATEGORY(LogStratPool);
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Spawned"), STAT_StratPool_Spawned, STATGROUP_StratPool);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Reused"), STAT_StratPool_Reused, STATGROUP_StratPool);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Recycled At Cap"), STAT_StratPool_Recycled, STATGROUP_StratPool);
+
+void UStratActorPoolSubsystem::Deinitialize()
+{
+	//~ The world destroys the actors itself.
+	Pools.Reset();
+
+	Super::Deinitialize();
+}
+
+void UStratActorPoolSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (InWorld.GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	for (const FStratActorPoolClassSettings& ClassSettings : GetDefault<UStratActorPoolSettings>()->Classes)
+	{
+		if (UClass* ActorClass = ClassSettings.ActorClass.LoadSynchronous())
+		{
+			Prewarm(ActorClass, ClassSettings.PrewarmCount);
+		}
+	}
+}
+
+void UStratActorPoolSubsystem::Tick(const float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	for (TPair<TObjectPtr<UClass>, FStratActorPool>& Pair : Pools)
+	{
+		FStratActorPool& Pool = Pair.Value;
+		for (int32 Index = Pool.Active.Num() - 1; Index >= 0; --Index)
+		{
+			if (Pool.ExpireTimes[Index] > 0.0 && Pool.ExpireTimes[Index] <= Now)
+			{
+				ReleaseAt(Pool, Index);
+			}
+		}
+	}
+}
+
+TStatId UStratActorPoolSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UStratActorPoolSubsystem, STATGROUP_StratPool);
+}
+
+bool UStratActorPoolSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+AActor* UStratActorPoolSubsystem::AcquireActor(const TSubclassOf<AActor> ActorClass, const FTransform& Transform, const float Lifetime)
+{
+	if (!ActorClass)
+	{
+		return nullptr;
+	}
+
+	FStratActorPool& Pool = GetOrAddPool(ActorClass);
+
+	AActor* Actor = nullptr;
+	while (!Actor && !Pool.Idle.IsEmpty())
+	{
+		Actor = Pool.Idle.Pop(EAllowShrinking::No);
+		if (!IsValid(Actor))
+		{
+			Pool.SavedStates.Remove(Actor);
+			Actor = nullptr;
+		}
+	}
+
+	if (Actor)
+	{
+		INC_DWORD_STAT(STAT_StratPool_Reused);
+	}
+	else if (Pool.Active.Num() >= Pool.MaxActive)
+	{
+		//~ Over the cap the oldest one goes, e.g. the marker of the order before last. Better than unbounded actors in a big fight.
+		Actor = Pool.Active[0];
+		Pool.Active.RemoveAt(0, EAllowShrinking::No);
+		Pool.ExpireTimes.RemoveAt(0, EAllowShrinking::No);
+		if (IsValid(Actor))
+		{
+			Deactivate(Pool, *Actor);
+			INC_DWORD_STAT(STAT_StratPool_Recycled);
+		}
+		else
+		{
+			Actor = SpawnIdleActor(Pool, ActorClass);
+		}
+	}
+	else
+	{
+		Actor = SpawnIdleActor(Pool, ActorClass);
+	}
+
+	if (!Actor)
+	{
+		return nullptr;
+	}
+
+	Pool.Active.Add(Actor);
+	Pool.ExpireTimes.Add(Lifetime > 0.f ? GetWorld()->GetTimeSeconds() + Lifetime : 0.0);
+	Activate(Pool, *Actor, Transform);
+	return Actor;
+}
+
+void UStratActorPoolSubsystem::ReleaseActor(AActor* Actor)
+{
+	if (!Actor)
+	{
+		return;
+	}
+
+	FStratActorPool* Pool = Pools.Find(Actor->GetClass());
+	const int32 ActiveIndex = Pool ? Pool->Active.Find(Actor) : INDEX_NONE;
+	if (ActiveIndex == INDEX_NONE)
+	{
+		UE_LOG(LogStratPool, Warning, TEXT("%s was released but isn't an active pooled actor."), *GetNameSafe(Actor));
+		return;
+	}
+
+	ReleaseAt(*Pool, ActiveIndex);
+}
+
+void UStratActorPoolSubsystem::Prewarm(const TSubclassOf<AActor> ActorClass, const int32 Count)
+{
+	if (!ActorClass)
+	{
+		return;
+	}
+
+	FStratActorPool& Pool = GetOrAddPool(ActorClass);
+	const int32 Target = FMath::Min(Count, Pool.MaxPooled);
+	while (Pool.Idle.Num() + Pool.Active.Num() < Target)
+	{
+		AActor* Actor = SpawnIdleActor(Pool, ActorClass);
+		if (!Actor)
+		{
+			break;
+		}
+		Pool.Idle.Add(Actor);
+	}
+}
+
+FStratActorPool& UStratActorPoolSubsystem::GetOrAddPool(UClass* ActorClass)
+{
+	if (FStratActorPool* Pool = Pools.Find(ActorClass))
+	{
+		return *Pool;
+	}
+
+	const UStratActorPoolSettings* Settings = GetDefault<UStratActorPoolSettings>();
+	FStratActorPool& Pool = Pools.Add(ActorClass);
+	Pool.MaxActive = Settings->DefaultMaxActive;
+	Pool.MaxPooled = Settings->DefaultMaxPooled;
+
+	for (const FStratActorPoolClassSettings& ClassSettings : Settings->Classes)
+	{
+		if (ClassSettings.ActorClass.ToSoftObjectPath() == FSoftObjectPath(ActorClass))
+		{
+			Pool.MaxActive = FMath::Max(ClassSettings.MaxActive, 1);
+			Pool.MaxPooled = FMath::Max(ClassSettings.MaxPooled, 0);
+			break;
+		}
+	}
+
+	return Pool;
+}
+
+AActor* UStratActorPoolSubsystem::SpawnIdleActor(FStratActorPool& Pool, UClass* ActorClass)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+
+	AActor* Actor = GetWorld()->SpawnActor<AActor>(ActorClass, FTransform::Identity, SpawnParams);
+	if (!Actor)
+	{
+		return nullptr;
+	}
+
+	UE_CLOG(Actor->GetIsReplicated(), LogStratPool, Warning, TEXT("%s replicates. Pooled actors are local, pool a local version instead."), *GetNameSafe(ActorClass));
+	INC_DWORD_STAT(STAT_StratPool_Spawned);
+
+	Deactivate(Pool, *Actor);
+	return Actor;
+}
+
+void UStratActorPoolSubsystem::ReleaseAt(FStratActorPool& Pool, const int32 ActiveIndex)
+{
+	AActor* Actor = Pool.Active[ActiveIndex];
+	Pool.Active.RemoveAt(ActiveIndex, EAllowShrinking::No);
+	Pool.ExpireTimes.RemoveAt(ActiveIndex, EAllowShrinking::No);
+
+	if (!IsValid(Actor))
+	{
+		return;
+	}
+
+	if (Pool.Idle.Num() >= Pool.MaxPooled)
+	{
+		Actor->Destroy();
+		return;
+	}
+
+	Deactivate(Pool, *Actor);
+	Pool.Idle.Add(Actor);
+}
+
+void UStratActorPoolSubsystem::Activate(FStratActorPool& Pool, AActor& Actor, const FTransform& Transform)
+{
+	FStratPooledActorState State;
+	Pool.SavedStates.RemoveAndCopyValue(&Actor, State);
+
+	Actor.SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+	Actor.SetActorHiddenInGame(State.bHidden);
+	Actor.SetActorEnableCollision(State.bCollision);
+	Actor.SetActorTickEnabled(State.bTick);
+
+	if (Actor.Implements<UStratPoolableInterface>())
+	{
+		IStratPoolableInterface::Execute_OnAcquiredFromPool(&Actor);
+	}
+}
+
+void UStratActorPoolSubsystem::Deactivate(FStratActorPool& Pool, AActor& Actor)
+{
+	if (Actor.Implements<UStratPoolableInterface>())
+	{
+		IStratPoolableInterface::Execute_OnReleasedToPool(&Actor);
+	}
+
+	//~ Fresh from spawn this is the class's own setup, e.g. a marker without collision, which acquiring mustn't turn on.
+	FStratPooledActorState& State = Pool.SavedStates.Add(&Actor);
+	State.bHidden = Actor.IsHidden();
+	State.bCollision = Actor.GetActorEnableCollision();
+	State.bTick = Actor.IsActorTickEnabled();
+
+	Actor.SetActorHiddenInGame(true);
+	Actor.SetActorEnableCollision(false);
+	Actor.SetActorTickEnabled(false);
+}
@@ -0,0 +1,103 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "StratActorPoolSubsystem.generated.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogStratPool, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("StratPool"), STATGROUP_StratPool, STATCAT_Advanced);
+
+/** What an actor had on before the pool hid it, so acquiring it turns back on only that. */
+struct FStratPooledActorState
+{
+	bool bHidden{false};
+	bool bCollision{true};
+	bool bTick{true};
+};
+
+/** The actors of one class. */
+USTRUCT()
+struct FStratActorPool
+{
+	GENERATED_BODY()
+
+	/** Hidden, frozen and waiting for reuse. */
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<AActor>> Idle;
+
+	/** In use, oldest first. */
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<AActor>> Active;
+
+	/** World time each Active actor goes back to the pool on its own. Zero for never. Parallel to Active. */
+	TArray<double> ExpireTimes;
+
+	/** Each Idle actor's state from before it was hidden. */
+	TMap<TObjectKey<AActor>, FStratPooledActorState> SavedStates;
+
+	int32 MaxActive{64};
+	int32 MaxPooled{16};
+};
+
+/**
+ * Reuses short lived local actors like order markers and effects instead of spawning and destroying them.
+ * Released actors are hidden with collision and tick off, then moved and put back the way they were on the next acquire.
+ * Implement IStratPoolableInterface to reset anything else.
+ *
+ * Only for actors that don't replicate. Per class limits and pre-warming come from UStratActorPoolSettings.
+ */
+UCLASS()
+class UE_RTS_API UStratActorPoolSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	//~ Begin UWorldSubsystem interface
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	//~ End UWorldSubsystem interface
+
+	//~ Begin UTickableWorldSubsystem interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~ End UTickableWorldSubsystem interface
+
+	/**
+	 * An idle actor of the class moved to Transform, or a new one if none is idle. At the class's MaxActive, the oldest
+	 * active actor is recycled instead. A positive Lifetime releases the actor after that many seconds.
+	 */
+	UFUNCTION(BlueprintCallable, Category=StratPool, meta=(DeterminesOutputType="ActorClass"))
+	AActor* AcquireActor(TSubclassOf<AActor> ActorClass, const FTransform& Transform, float Lifetime = 0.f);
+
+	template <typename T>
+	T* Acquire(const TSubclassOf<T> ActorClass, const FTransform& Transform, const float Lifetime = 0.f)
+	{
+		return Cast<T>(AcquireActor(ActorClass, Transform, Lifetime));
+	}
+
+	/** Returns an acquired actor. Don't touch it afterwards, it may be handed out again or destroyed. */
+	UFUNCTION(BlueprintCallable, Category=StratPool)
+	void ReleaseActor(AActor* Actor);
+
+	/** Spawns idle actors until the class has Count of them, capped by its MaxPooled. */
+	UFUNCTION(BlueprintCallable, Category=StratPool)
+	void Prewarm(TSubclassOf<AActor> ActorClass, int32 Count);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	FStratActorPool& GetOrAddPool(UClass* ActorClass);
+	AActor* SpawnIdleActor(FStratActorPool& Pool, UClass* ActorClass);
+	void ReleaseAt(FStratActorPool& Pool, int32 ActiveIndex);
+	static void Activate(FStratActorPool& Pool, AActor& Actor, const FTransform& Transform);
+	static void Deactivate(FStratActorPool& Pool, AActor& Actor);
+
+	UPROPERTY(Transient)
+	TMap<TObjectPtr<UClass>, FStratActorPool> Pools;
+};
@@ -0,0 +1,31 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "StratPoolableInterface.generated.h"
+
+UINTERFACE(MinimalAPI, BlueprintType)
+class UStratPoolableInterface : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Optional for actors in UStratActorPoolSubsystem. The pool already hides, freezes and moves pooled actors,
+ * implement this to reset anything else, e.g. restart an effect or clear state from the last use.
+ */
+class UE_RTS_API IStratPoolableInterface
+{
+	GENERATED_BODY()
+
+public:
+	/** The actor left the pool and is at its new transform. Treat this like BeginPlay. */
+	UFUNCTION(BlueprintNativeEvent, Category=StratPool)
+	void OnAcquiredFromPool();
+
+	/** The actor is going back to the pool. Stop effects and timers here. */
+	UFUNCTION(BlueprintNativeEvent, Category=StratPool)
+	void OnReleasedToPool();
+};
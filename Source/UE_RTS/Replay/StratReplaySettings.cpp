@@ -0,0 +1,8 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratReplaySettings.h"
+
+UStratReplaySettings::UStratReplaySettings()
+{
+	CategoryName = TEXT("Game");
+}
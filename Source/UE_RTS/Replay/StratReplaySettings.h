@@ -0,0 +1,32 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "StratReplaySettings.generated.h"
+
+/** Project settings for match replays. Found under Project Settings > Game > Strat Replay. */
+UCLASS(Config=Game, DefaultConfig, meta=(DisplayName="Strat Replay"))
+class UE_RTS_API UStratReplaySettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UStratReplaySettings();
+
+	/**
+	 * A full unit snapshot is kept every this many ticks. Seeking restores the one before the target and simulates the rest,
+	 * so this bounds the cost of a seek. Lower makes seeks cheaper and files bigger.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category="Replay", meta=(ClampMin="30", ClampMax="18000"))
+	int32 KeyframeEveryNTicks{300};
+
+	/** Each player's camera is sampled every this many ticks, and only when it moved. */
+	UPROPERTY(Config, EditAnywhere, Category="Replay", meta=(ClampMin="1", ClampMax="60"))
+	int32 CameraSampleEveryNTicks{5};
+
+	/** Cap on ticks playback runs in one frame, so fast forward can't stall the game thread. Seeks aren't capped. */
+	UPROPERTY(Config, EditAnywhere, Category="Replay", meta=(ClampMin="1", ClampMax="200"))
+	int32 MaxPlaybackStepsPerFrame{20};
+};
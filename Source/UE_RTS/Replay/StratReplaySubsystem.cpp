@@ -0,0 +1,616 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratReplaySubsystem.h"
+
+#include "StratReplaySettings.h"
+#include "Algo/BinarySearch.h"
+#include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Lockstep/StratLockstepSettings.h"
+#include "Lockstep/StratLockstepSubsystem.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Player/StratPlayerCameraPawn.h"
+#include "Player/StratPlayerState.h"
+#include "Save/StratSaveFile.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Units/StratUnitDefinition.h"
+#include "Units/StratUnitSimSubsystem.h"
+
+DEFINE_LOG_CATEGORY(LogStratReplay);
+
+DECLARE_CYCLE_STAT(TEXT("Replay Keyframe"), STAT_StratReplay_Keyframe, STATGROUP_StratUnits);
+DECLARE_CYCLE_STAT(TEXT("Replay Seek"), STAT_StratReplay_Seek, STATGROUP_StratUnits);
+
+static_assert(sizeof(UStratReplaySubsystem::FCameraSample) == 24, "Camera samples are written as raw bytes.");
+static_assert(sizeof(UStratReplaySubsystem::FKeyframe) == 24, "Keyframes are written as raw bytes.");
+
+namespace
+{
+	FAutoConsoleCommandWithWorldAndArgs ReplayCommand(
+		TEXT("Strat.Replay"),
+		TEXT("record | stop <name> | play <name> | seek <seconds> | rate <x> | follow <player index or -1>"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			UStratReplaySubsystem* Replay = World ? World->GetSubsystem<UStratReplaySubsystem>() : nullptr;
+			if (!Replay || Args.IsEmpty())
+			{
+				UE_LOG(LogStratReplay, Warning, TEXT("Strat.Replay needs a lockstep game world and a verb."));
+				return;
+			}
+
+			const FString& Verb = Args[0];
+			const FString Arg = Args.IsValidIndex(1) ? Args[1] : FString();
+			if (Verb == TEXT("record"))
+			{
+				Replay->StartRecording();
+			}
+			else if (Verb == TEXT("stop"))
+			{
+				if (Replay->IsPlaying())
+				{
+					Replay->StopPlayback();
+				}
+				else
+				{
+					Replay->StopRecording(Arg.IsEmpty() ? FDateTime::Now().ToString() : Arg);
+				}
+			}
+			else if (Verb == TEXT("play"))
+			{
+				Replay->StartPlayback(Arg);
+			}
+			else if (Verb == TEXT("seek"))
+			{
+				Replay->SeekToTime(FCString::Atof(*Arg));
+			}
+			else if (Verb == TEXT("rate"))
+			{
+				Replay->SetPlaybackRate(FCString::Atof(*Arg));
+			}
+			else if (Verb == TEXT("follow"))
+			{
+				Replay->FollowPlayer(Arg.IsEmpty() ? INDEX_NONE : FCString::Atoi(*Arg));
+			}
+		}));
+}
+
+bool UStratReplaySubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return Super::ShouldCreateSubsystem(Outer) && GetDefault<UStratLockstepSettings>()->bEnabled;
+}
+
+void UStratReplaySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UnitSim = Collection.InitializeDependency<UStratUnitSimSubsystem>();
+	Lockstep = Collection.InitializeDependency<UStratLockstepSubsystem>();
+
+	if (Lockstep)
+	{
+		Lockstep->OnTickStarting.AddUObject(this, &ThisClass::OnTickStarting);
+	}
+}
+
+void UStratReplaySubsystem::Deinitialize()
+{
+	if (Lockstep)
+	{
+		Lockstep->OnTickStarting.RemoveAll(this);
+	}
+
+	ResetTimeline();
+
+	Super::Deinitialize();
+}
+
+bool UStratReplaySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UStratReplaySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UStratReplaySubsystem, STATGROUP_StratUnits);
+}
+
+FString UStratReplaySubsystem::GetReplayPath(const FString& ReplayName)
+{
+	return FPaths::ProjectSavedDir() / TEXT("Replays") / ReplayName + TEXT(".stratreplay");
+}
+
+void UStratReplaySubsystem::Tick(const float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (Mode != EMode::Playing)
+	{
+		return;
+	}
+
+	const float FixedDeltaTime = UnitSim->GetFixedDeltaTime();
+	const uint32 CurrentTick = Lockstep->GetCurrentTick();
+	const int32 Remaining = static_cast<int32>(EndTick - FMath::Min(EndTick, CurrentTick));
+
+	StepAccumulator += DeltaTime * PlaybackRate;
+	const int32 NumSteps = FMath::Min3(FMath::FloorToInt32(StepAccumulator / FixedDeltaTime), Remaining, GetDefault<UStratReplaySettings>()->MaxPlaybackStepsPerFrame);
+	for (int32 Step = 0; Step < NumSteps; ++Step)
+	{
+		RunPlaybackTick();
+	}
+
+	//~ Behind after hitting the cap drops the time instead of fast forwarding later. Same as the lockstep clock.
+	StepAccumulator = FMath::Clamp(StepAccumulator - NumSteps * FixedDeltaTime, 0.f, FixedDeltaTime);
+
+	UpdateFollowCamera(false);
+}
+
+bool UStratReplaySubsystem::StartRecording()
+{
+	if (Mode != EMode::Idle || !Lockstep)
+	{
+		UE_LOG(LogStratReplay, Warning, TEXT("Can't record while already recording or playing."));
+		return false;
+	}
+
+	ResetTimeline();
+	Mode = EMode::Recording;
+	StartTick = Lockstep->GetCurrentTick();
+	EndTick = StartTick;
+
+	UE_LOG(LogStratReplay, Log, TEXT("Recording from tick %u."), StartTick);
+	return true;
+}
+
+void UStratReplaySubsystem::OnTickStarting(const uint32 Tick, const TConstArrayView<FStratLockstepCommand> TickCommands)
+{
+	if (Mode != EMode::Recording)
+	{
+		return;
+	}
+
+	const UStratReplaySettings* Settings = GetDefault<UStratReplaySettings>();
+
+	//~ Before the tick's commands are applied, so playback restores it and then runs those same commands.
+	if (Keyframes.IsEmpty() || Tick - Keyframes.Last().Tick >= static_cast<uint32>(Settings->KeyframeEveryNTicks))
+	{
+		RecordKeyframe(Tick);
+	}
+
+	if ((Tick - StartTick) % Settings->CameraSampleEveryNTicks == 0)
+	{
+		RecordCameras(Tick);
+	}
+
+	Commands.Append(TickCommands);
+	EndTick = Tick + 1;
+}
+
+void UStratReplaySubsystem::RecordKeyframe(const uint32 Tick)
+{
+	SCOPE_CYCLE_COUNTER(STAT_StratReplay_Keyframe);
+
+	TArray<uint8> Bytes;
+	Lockstep->WriteKeyframe(Bytes);
+
+	FKeyframe& Keyframe = Keyframes.AddDefaulted_GetRef();
+	Keyframe.Tick = Tick;
+	Keyframe.StateHash = Lockstep->ComputeStateHash();
+	Keyframe.Size = static_cast<uint32>(Bytes.Num());
+	Keyframe.Offset = KeyframeBytes.Num();
+	KeyframeBytes.Append(Bytes);
+}
+
+void UStratReplaySubsystem::RecordCameras(const uint32 Tick)
+{
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	if (!GameState)
+	{
+		return;
+	}
+
+	//~ Remote cameras are whatever their owners last sent. A pawn that isn't relevant here just isn't sampled.
+	for (const APlayerState* PlayerState : GameState->PlayerArray)
+	{
+		const AStratPlayerCameraPawn* Camera = PlayerState ? PlayerState->GetPawn<AStratPlayerCameraPawn>() : nullptr;
+		if (!Camera)
+		{
+			continue;
+		}
+
+		int32& PlayerIndex = PlayerIndices.FindOrAdd(TWeakObjectPtr<const APlayerState>(PlayerState), INDEX_NONE);
+		if (PlayerIndex == INDEX_NONE)
+		{
+			FPlayer Player;
+			Player.Name = PlayerState->GetPlayerName();
+			if (const AStratPlayerState* StratPlayerState = Cast<AStratPlayerState>(PlayerState))
+			{
+				Player.FactionId = StratPlayerState->GetFactionId();
+				Player.Color = StratPlayerState->GetPlayerColor();
+			}
+			PlayerIndex = Players.Add(MoveTemp(Player));
+			LastSamples.AddDefaulted_GetRef().Yaw = MAX_flt;
+		}
+
+		const FSimpleRepMovement& Movement = Camera->GetSimpleRepMovement();
+		FCameraSample& Last = LastSamples[PlayerIndex];
+		if (Last.Location.Equals(FVector3f(Movement.Location), 1.f) && FMath::IsNearlyEqual(Last.Yaw, Movement.Yaw, 0.5f))
+		{
+			continue;
+		}
+
+		Last.Tick = Tick;
+		Last.Player = static_cast<uint16>(PlayerIndex);
+		Last.Location = FVector3f(Movement.Location);
+		Last.Yaw = Movement.Yaw;
+		Cameras.Add(Last);
+	}
+}
+
+bool UStratReplaySubsystem::StopRecording(const FString& ReplayName)
+{
+	if (Mode != EMode::Recording)
+	{
+		UE_LOG(LogStratReplay, Warning, TEXT("Not recording."));
+		return false;
+	}
+	Mode = EMode::Idle;
+
+	FStratSaveWriter Writer;
+	{
+		TArray<uint8> Bytes;
+		FMemoryWriter Ar(Bytes);
+		FString MapName = UWorld::RemovePIEPrefix(GetWorld()->GetOutermost()->GetName());
+		float FixedDeltaTime = UnitSim->GetFixedDeltaTime();
+		TArray<FString> TypePaths = GetTypePaths();
+		Ar << MapName << FixedDeltaTime << StartTick << EndTick << TypePaths;
+		Writer.AddChunk(StratSave::EChunk::ReplayInfo, MoveTemp(Bytes));
+	}
+	{
+		TArray<uint8> Bytes;
+		FMemoryWriter Ar(Bytes);
+		int32 NumCommands = Commands.Num();
+		Ar << NumCommands;
+		for (FStratLockstepCommand& Command : Commands)
+		{
+			Ar << Command;
+		}
+		Writer.AddChunk(StratSave::EChunk::ReplayCommands, MoveTemp(Bytes));
+	}
+	{
+		TArray<uint8> Bytes;
+		FMemoryWriter Ar(Bytes);
+		int32 NumPlayers = Players.Num();
+		Ar << NumPlayers;
+		for (FPlayer& Player : Players)
+		{
+			Ar << Player.Name << Player.FactionId << Player.Color;
+		}
+		Writer.AddChunk(StratSave::EChunk::Players, MoveTemp(Bytes));
+	}
+	Writer.AddColumn(StratSave::EChunk::ReplayCameras, Cameras);
+	Writer.AddColumn(StratSave::EChunk::ReplayKeyframeIndex, Keyframes);
+
+	//~ Keyframes are compressed already. The writer sees compressing again doesn't pay and stores them as they are.
+	Writer.AddChunk(StratSave::EChunk::ReplayKeyframes, MoveTemp(KeyframeBytes));
+
+	TArray<uint8> File;
+	Writer.Finish(File);
+	ResetTimeline();
+
+	const FString Path = GetReplayPath(ReplayName);
+	const FString TempPath = Path + TEXT(".tmp");
+	if (!FFileHelper::SaveArrayToFile(File, *TempPath) || !IFileManager::Get().Move(*Path, *TempPath, true))
+	{
+		UE_LOG(LogStratReplay, Error, TEXT("Couldn't write %s."), *Path);
+		return false;
+	}
+
+	UE_LOG(LogStratReplay, Log, TEXT("Wrote %s, %.1f KB."), *Path, File.Num() / 1024.0);
+	return true;
+}
+
+bool UStratReplaySubsystem::StartPlayback(const FString& ReplayName)
+{
+	//~ Playback rewrites the simulation. With peers connected they'd all desync.
+	if (Mode != EMode::Idle || !Lockstep || GetWorld()->GetNetMode() != NM_Standalone)
+	{
+		UE_LOG(LogStratReplay, Warning, TEXT("Replays play back in a standalone game that isn't recording or playing."));
+		return false;
+	}
+
+	const FString Path = GetReplayPath(ReplayName);
+	FStratSaveReader Reader;
+	TArray<uint8> InfoBytes;
+	TArray<uint8> CommandBytes;
+	if (!Reader.Open(Path) || !Reader.ReadChunk(StratSave::EChunk::ReplayInfo, InfoBytes) || !Reader.ReadChunk(StratSave::EChunk::ReplayCommands, CommandBytes))
+	{
+		UE_LOG(LogStratReplay, Error, TEXT("%s is missing, corrupt or not a replay."), *Path);
+		return false;
+	}
+
+	//~ Commands changed form in versions 2 and 3.
+	if (Reader.GetVersion() < 3)
+	{
+		UE_LOG(LogStratReplay, Error, TEXT("%s was recorded by an older build. It can't play here."), *Path);
+		return false;
+	}
+
+	FString MapName;
+	float FixedDeltaTime = 0.f;
+	TArray<FString> TypePaths;
+	FMemoryReader InfoAr(InfoBytes);
+	InfoAr << MapName << FixedDeltaTime << StartTick << EndTick << TypePaths;
+
+	//~ Determinism needs the same map, the same tick length and the same type ids. Remapping ids wouldn't be enough.
+	if (MapName != UWorld::RemovePIEPrefix(GetWorld()->GetOutermost()->GetName()) || !FMath::IsNearlyEqual(FixedDeltaTime, UnitSim->GetFixedDeltaTime()) || TypePaths != GetTypePaths())
+	{
+		UE_LOG(LogStratReplay, Error, TEXT("%s was recorded on %s with other unit types or tick rate. It can't play here."), *Path, *MapName);
+		return false;
+	}
+
+	ResetTimeline();
+
+	FMemoryReader CommandAr(CommandBytes);
+	int32 NumCommands = 0;
+	CommandAr << NumCommands;
+	Commands.Reserve(FMath::Min(NumCommands, CommandBytes.Num()));
+	for (int32 Index = 0; Index < NumCommands && !CommandAr.IsError(); ++Index)
+	{
+		CommandAr << Commands.AddDefaulted_GetRef();
+	}
+
+	TArray<uint8> PlayerBytes;
+	if (Reader.ReadChunk(StratSave::EChunk::Players, PlayerBytes))
+	{
+		FMemoryReader PlayerAr(PlayerBytes);
+		int32 NumPlayers = 0;
+		PlayerAr << NumPlayers;
+		for (int32 Index = 0; Index < NumPlayers && !PlayerAr.IsError(); ++Index)
+		{
+			FPlayer& Player = Players.AddDefaulted_GetRef();
+			PlayerAr << Player.Name << Player.FactionId << Player.Color;
+		}
+	}
+
+	const bool bBound = Reader.BindColumn(StratSave::EChunk::ReplayCameras, Cameras) && Reader.BindColumn(StratSave::EChunk::ReplayKeyframeIndex, Keyframes) && Reader.BindColumn(StratSave::EChunk::ReplayKeyframes, KeyframeBytes);
+	const bool bValid = bBound && Reader.Decompress() && !CommandAr.IsError() && !Keyframes.IsEmpty() && Keyframes[0].Tick == StartTick
+		&& !Keyframes.ContainsByPredicate([this](const FKeyframe& Keyframe) { return Keyframe.Offset + Keyframe.Size > static_cast<uint64>(KeyframeBytes.Num()); });
+	if (!bValid)
+	{
+		UE_LOG(LogStratReplay, Error, TEXT("%s has missing or damaged data."), *Path);
+		ResetTimeline();
+		return false;
+	}
+
+	Mode = EMode::Playing;
+	PlaybackRate = 1.f;
+	Lockstep->SetReplayDriven(true);
+	SeekToTick(StartTick);
+	if (Mode != EMode::Playing)
+	{
+		return false;
+	}
+
+	UE_LOG(LogStratReplay, Log, TEXT("Playing %s, %.0f s with %d commands and %d keyframes."), *Path, GetPlaybackDuration(), Commands.Num(), Keyframes.Num());
+	return true;
+}
+
+void UStratReplaySubsystem::StopPlayback()
+{
+	if (Mode != EMode::Playing)
+	{
+		return;
+	}
+
+	FollowPlayer(INDEX_NONE);
+	Lockstep->SetReplayDriven(false);
+	Mode = EMode::Idle;
+	ResetTimeline();
+}
+
+void UStratReplaySubsystem::SeekToTime(const float Seconds)
+{
+	const int64 Ticks = FMath::RoundToInt64(FMath::Max(Seconds, 0.f) / UnitSim->GetFixedDeltaTime());
+	SeekToTick(StartTick + static_cast<uint32>(FMath::Min<int64>(Ticks, EndTick - StartTick)));
+}
+
+void UStratReplaySubsystem::SeekToTick(uint32 Tick)
+{
+	if (Mode != EMode::Playing)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_StratReplay_Seek);
+
+	Tick = FMath::Clamp(Tick, StartTick, EndTick);
+	const int32 KeyframeIndex = FMath::Max(Algo::UpperBoundBy(Keyframes, Tick, &FKeyframe::Tick) - 1, 0);
+	const FKeyframe& Keyframe = Keyframes[KeyframeIndex];
+
+	//~ Short hops forward just keep simulating. Anything else starts over from the closest keyframe.
+	const uint32 CurrentTick = Lockstep->GetCurrentTick();
+	const bool bRunForward = bOnTimeline && Tick >= CurrentTick && CurrentTick >= Keyframe.Tick;
+	if (!bRunForward && !RestoreKeyframe(Keyframe))
+	{
+		StopPlayback();
+		return;
+	}
+
+	while (Lockstep->GetCurrentTick() < Tick)
+	{
+		RunPlaybackTick();
+	}
+
+	StepAccumulator = 0.f;
+	UpdateFollowCamera(true);
+}
+
+bool UStratReplaySubsystem::RestoreKeyframe(const FKeyframe& Keyframe)
+{
+	TArray<uint8> Bytes(KeyframeBytes.GetData() + Keyframe.Offset, static_cast<int32>(Keyframe.Size));
+	if (!Lockstep->ReadKeyframe(MoveTemp(Bytes)))
+	{
+		UE_LOG(LogStratReplay, Error, TEXT("Keyframe at tick %u is damaged. Stopping playback."), Keyframe.Tick);
+		return false;
+	}
+
+	NextCommandIndex = Algo::LowerBoundBy(Commands, Keyframe.Tick, &FStratLockstepCommand::Tick);
+	NextKeyframeIndex = Algo::UpperBoundBy(Keyframes, Keyframe.Tick, &FKeyframe::Tick);
+	bOnTimeline = true;
+
+	//~ A restore that doesn't hash the same can't play the same.
+	bReportedDivergence = false;
+	CheckKeyframeHash(Keyframe);
+	return true;
+}
+
+void UStratReplaySubsystem::RunPlaybackTick()
+{
+	const uint32 Tick = Lockstep->GetCurrentTick();
+	if (Keyframes.IsValidIndex(NextKeyframeIndex) && Keyframes[NextKeyframeIndex].Tick == Tick)
+	{
+		CheckKeyframeHash(Keyframes[NextKeyframeIndex++]);
+	}
+
+	const int32 FirstCommand = NextCommandIndex;
+	while (Commands.IsValidIndex(NextCommandIndex) && Commands[NextCommandIndex].Tick == Tick)
+	{
+		++NextCommandIndex;
+	}
+
+	Lockstep->RunReplayTick(TConstArrayView<FStratLockstepCommand>(Commands).Slice(FirstCommand, NextCommandIndex - FirstCommand));
+}
+
+void UStratReplaySubsystem::CheckKeyframeHash(const FKeyframe& Keyframe)
+{
+	const uint32 Hash = Lockstep->ComputeStateHash();
+	if (Hash != Keyframe.StateHash && !bReportedDivergence)
+	{
+		UE_LOG(LogStratReplay, Error, TEXT("Playback parted from the recording by tick %u. Hash %08x, recorded %08x."), Keyframe.Tick, Hash, Keyframe.StateHash);
+		bReportedDivergence = true;
+	}
+}
+
+void UStratReplaySubsystem::SetPlaybackRate(const float Rate)
+{
+	PlaybackRate = FMath::Max(Rate, 0.f);
+}
+
+float UStratReplaySubsystem::GetPlaybackTime() const
+{
+	const uint32 CurrentTick = Lockstep ? Lockstep->GetCurrentTick() : StartTick;
+	return (FMath::Clamp(CurrentTick, StartTick, EndTick) - StartTick) * (UnitSim ? UnitSim->GetFixedDeltaTime() : 0.f);
+}
+
+float UStratReplaySubsystem::GetPlaybackDuration() const
+{
+	return (EndTick - StartTick) * (UnitSim ? UnitSim->GetFixedDeltaTime() : 0.f);
+}
+
+void UStratReplaySubsystem::FollowPlayer(const int32 PlayerIndex)
+{
+	APlayerController* PC = GetWorld()->GetFirstPlayerController();
+	if (!PC || Mode != EMode::Playing)
+	{
+		return;
+	}
+
+	if (!Players.IsValidIndex(PlayerIndex))
+	{
+		FollowedPlayer = INDEX_NONE;
+		PC->SetViewTargetWithBlend(PC->GetPawn());
+		if (FollowCamera)
+		{
+			FollowCamera->Destroy();
+			FollowCamera = nullptr;
+		}
+		return;
+	}
+
+	//~ Same class as the local camera, so it gets whatever camera and post process setup the Blueprint adds.
+	if (!FollowCamera)
+	{
+		const AStratPlayerCameraPawn* LocalCamera = Cast<AStratPlayerCameraPawn>(PC->GetPawn());
+		FActorSpawnParameters Params;
+		Params.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		FollowCamera = GetWorld()->SpawnActor<AStratPlayerCameraPawn>(LocalCamera ? LocalCamera->GetClass() : AStratPlayerCameraPawn::StaticClass(), FTransform::Identity, Params);
+	}
+
+	FollowedPlayer = PlayerIndex;
+	PC->SetViewTargetWithBlend(FollowCamera);
+	UpdateFollowCamera(true);
+}
+
+void UStratReplaySubsystem::UpdateFollowCamera(const bool bSnap)
+{
+	if (!FollowCamera || FollowedPlayer == INDEX_NONE)
+	{
+		return;
+	}
+
+	const auto Feed = [this](const FCameraSample& Sample, const bool bSnapTo)
+	{
+		FSimpleRepMovement Movement;
+		Movement.Location = FVector(Sample.Location);
+		Movement.Yaw = Sample.Yaw;
+		Movement.ServerFrame = Sample.Tick;
+		FollowCamera->SetPlaybackMovement(Movement, bSnapTo);
+	};
+
+	const uint32 CurrentTick = Lockstep->GetCurrentTick();
+	if (bSnap)
+	{
+		//~ Samples are only taken when a camera moved, so the latest one can be from a while back.
+		NextCameraIndex = Algo::UpperBoundBy(Cameras, CurrentTick, &FCameraSample::Tick);
+		for (int32 Index = NextCameraIndex - 1; Index >= 0; --Index)
+		{
+			if (Cameras[Index].Player == FollowedPlayer)
+			{
+				Feed(Cameras[Index], true);
+				break;
+			}
+		}
+		return;
+	}
+
+	for (; Cameras.IsValidIndex(NextCameraIndex) && Cameras[NextCameraIndex].Tick <= CurrentTick; ++NextCameraIndex)
+	{
+		if (Cameras[NextCameraIndex].Player == FollowedPlayer)
+		{
+			Feed(Cameras[NextCameraIndex], false);
+		}
+	}
+}
+
+TArray<FString> UStratReplaySubsystem::GetTypePaths() const
+{
+	TArray<FString> TypePaths;
+	for (int32 TypeId = 0; TypeId < UnitSim->GetTypeInfos().Num(); ++TypeId)
+	{
+		TypePaths.Add(FSoftObjectPath(UnitSim->GetDefinition(static_cast<uint16>(TypeId))).ToString());
+	}
+	return TypePaths;
+}
+
+void UStratReplaySubsystem::ResetTimeline()
+{
+	Commands.Empty();
+	Cameras.Empty();
+	Keyframes.Empty();
+	KeyframeBytes.Empty();
+	Players.Empty();
+	PlayerIndices.Empty();
+	LastSamples.Empty();
+	NextCommandIndex = 0;
+	NextCameraIndex = 0;
+	NextKeyframeIndex = 0;
+	StepAccumulator = 0.f;
+	bOnTimeline = false;
+	bReportedDivergence = false;
+}
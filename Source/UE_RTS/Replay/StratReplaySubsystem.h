@@ -0,0 +1,193 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Lockstep/StratLockstepTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "StratReplaySubsystem.generated.h"
+
+class APlayerState;
+class AStratPlayerCameraPawn;
+class UStratLockstepSubsystem;
+class UStratUnitSimSubsystem;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogStratReplay, Log, All);
+
+/**
+ * Match replays for lockstep. Only exists when UStratLockstepSettings::bEnabled, since playback simulates the match again
+ * from its commands and only lockstep's fixed point simulation comes out the same every time.
+ *
+ * Recording keeps the command stream, a unit snapshot every UStratReplaySettings::KeyframeEveryNTicks, and every player's
+ * camera, then writes them to Saved/Replays as one chunked file, see StratSaveFile.h. Any peer can record, every peer has
+ * the commands. Keyframes are compressed as they're taken, so a long recording stays small in memory too.
+ *
+ * Playback is for a standalone game on the same map and unit types. It stops the lockstep clock and runs the recorded ticks
+ * itself. Seeking restores the keyframe before the target and simulates forward from there. Following a player feeds their
+ * recorded camera to a camera pawn nobody controls, which eases between samples like a remote player's.
+ *
+ * Keyframes hold the units, faction relations and the economy. Projectiles are cosmetic in lockstep, so they're left out
+ * and a seek clears the ones in flight. Playback compares the lockstep state hash with each keyframe's and logs where they part.
+ *
+ * Console: Strat.Replay record | stop <name> | play <name> | seek <seconds> | rate <x> | follow <player index or -1>
+ */
+UCLASS()
+class UE_RTS_API UStratReplaySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	//~ Begin UTickableWorldSubsystem interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~ End UTickableWorldSubsystem interface
+
+	UFUNCTION(BlueprintCallable, Category=StratReplay)
+	bool StartRecording();
+
+	/** Writes what was recorded to the named replay and stops. */
+	UFUNCTION(BlueprintCallable, Category=StratReplay)
+	bool StopRecording(const FString& ReplayName);
+
+	/** Standalone only. Replaces the running match with the replay's first keyframe and plays from there. */
+	UFUNCTION(BlueprintCallable, Category=StratReplay)
+	bool StartPlayback(const FString& ReplayName);
+
+	/** The match carries on live from wherever playback was. */
+	UFUNCTION(BlueprintCallable, Category=StratReplay)
+	void StopPlayback();
+
+	/** Seconds from the start of the replay. */
+	UFUNCTION(BlueprintCallable, Category=StratReplay)
+	void SeekToTime(float Seconds);
+
+	void SeekToTick(uint32 Tick);
+
+	/** Zero pauses. */
+	UFUNCTION(BlueprintCallable, Category=StratReplay)
+	void SetPlaybackRate(float Rate);
+
+	/** Views the match through a recorded player's camera. INDEX_NONE goes back to the local camera. */
+	UFUNCTION(BlueprintCallable, Category=StratReplay)
+	void FollowPlayer(int32 PlayerIndex);
+
+	UFUNCTION(BlueprintPure, Category=StratReplay)
+	bool IsRecording() const { return Mode == EMode::Recording; }
+
+	UFUNCTION(BlueprintPure, Category=StratReplay)
+	bool IsPlaying() const { return Mode == EMode::Playing; }
+
+	UFUNCTION(BlueprintPure, Category=StratReplay)
+	float GetPlaybackTime() const;
+
+	UFUNCTION(BlueprintPure, Category=StratReplay)
+	float GetPlaybackDuration() const;
+
+	UFUNCTION(BlueprintPure, Category=StratReplay)
+	int32 GetNumPlayers() const { return Players.Num(); }
+
+	UFUNCTION(BlueprintPure, Category=StratReplay)
+	FString GetPlayerName(int32 PlayerIndex) const { return Players.IsValidIndex(PlayerIndex) ? Players[PlayerIndex].Name : FString(); }
+
+	static FString GetReplayPath(const FString& ReplayName);
+
+	/** Written as raw bytes. */
+	struct FCameraSample
+	{
+		uint32 Tick{0};
+		uint16 Player{0};
+		uint16 Reserved{0};
+		FVector3f Location{FVector3f::ZeroVector};
+		float Yaw{0.f};
+	};
+
+	/** Where one keyframe sits in KeyframeBytes. Written as raw bytes. */
+	struct FKeyframe
+	{
+		uint32 Tick{0};
+		uint32 Size{0};
+		uint64 Offset{0};
+
+		/** UStratLockstepSubsystem::ComputeStateHash when it was taken. Playback checks it on every restore and pass. */
+		uint32 StateHash{0};
+		uint32 Reserved{0};
+	};
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	enum class EMode : uint8
+	{
+		Idle,
+		Recording,
+		Playing,
+	};
+
+	struct FPlayer
+	{
+		FString Name;
+		uint8 FactionId{0};
+		FLinearColor Color{FLinearColor::Gray};
+	};
+
+	void OnTickStarting(uint32 Tick, TConstArrayView<FStratLockstepCommand> TickCommands);
+	void RecordKeyframe(uint32 Tick);
+	void RecordCameras(uint32 Tick);
+
+	bool RestoreKeyframe(const FKeyframe& Keyframe);
+	void RunPlaybackTick();
+
+	/** Logs once if the simulation isn't in the state the keyframe recorded. */
+	void CheckKeyframeHash(const FKeyframe& Keyframe);
+
+	/** Feeds the followed player's samples up to the current tick. bSnap jumps to the latest one, for seeks. */
+	void UpdateFollowCamera(bool bSnap);
+
+	/** Definition path per type id. Recording and playback have to agree on every one. */
+	TArray<FString> GetTypePaths() const;
+
+	void ResetTimeline();
+
+	EMode Mode{EMode::Idle};
+
+	TArray<FStratLockstepCommand> Commands;
+	TArray<FCameraSample> Cameras;
+	TArray<FKeyframe> Keyframes;
+	TArray<uint8> KeyframeBytes;
+	TArray<FPlayer> Players;
+	uint32 StartTick{0};
+	uint32 EndTick{0};
+
+	/** Recording. Index in Players of every player seen so far, and their last sample so unmoved cameras are skipped. */
+	TMap<TWeakObjectPtr<const APlayerState>, int32> PlayerIndices;
+	TArray<FCameraSample> LastSamples;
+
+	/** Playback. The first command, camera sample and keyframe not reached yet. */
+	int32 NextCommandIndex{0};
+	int32 NextCameraIndex{0};
+	int32 NextKeyframeIndex{0};
+	float PlaybackRate{1.f};
+	float StepAccumulator{0.f};
+	int32 FollowedPlayer{INDEX_NONE};
+
+	/** Playback. The simulation parted from the recording and that was logged. */
+	bool bReportedDivergence{false};
+
+	/** Playback. The simulation was restored from a keyframe, so running forward stays on the recorded timeline. */
+	bool bOnTimeline{false};
+
+	UPROPERTY(Transient)
+	TObjectPtr<AStratPlayerCameraPawn> FollowCamera;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratUnitSimSubsystem> UnitSim;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratLockstepSubsystem> Lockstep;
+};
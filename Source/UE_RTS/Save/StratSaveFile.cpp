@@ -0,0 +1,222 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratSaveFile.h"
+
+#include "Async/MappedFileHandle.h"
+#include "Async/ParallelFor.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Units/StratUnitSnapshot.h"
+#include <atomic>
+
+void FStratSaveWriter::AddChunk(const StratSave::EChunk Id, TArray<uint8>&& Bytes)
+{
+	FPendingChunk& Chunk = Chunks.AddDefaulted_GetRef();
+	Chunk.Id = Id;
+	Chunk.Raw = MoveTemp(Bytes);
+}
+
+void FStratSaveWriter::Finish(TArray<uint8>& OutFile)
+{
+	//~ Chunks don't share any state, so each gets its own worker.
+	ParallelFor(Chunks.Num(), [this](const int32 Index)
+	{
+		FPendingChunk& Chunk = Chunks[Index];
+		if (Chunk.Raw.IsEmpty())
+		{
+			return;
+		}
+
+		int32 CompressedSize = FCompression::GetMaximumCompressedSize(NAME_Oodle, Chunk.Raw.Num());
+		Chunk.Compressed.SetNumUninitialized(CompressedSize);
+		if (FCompression::CompressMemory(NAME_Oodle, Chunk.Compressed.GetData(), CompressedSize, Chunk.Raw.GetData(), Chunk.Raw.Num()) && CompressedSize < Chunk.Raw.Num())
+		{
+			Chunk.Compressed.SetNum(CompressedSize, EAllowShrinking::No);
+		}
+		else
+		{
+			Chunk.Compressed.Reset();
+		}
+	});
+
+	FStratSaveHeader Header;
+	Header.NumChunks = Chunks.Num();
+
+	TArray<FStratSaveChunkEntry> Entries;
+	uint64 Offset = sizeof(FStratSaveHeader) + Chunks.Num() * sizeof(FStratSaveChunkEntry);
+	for (const FPendingChunk& Chunk : Chunks)
+	{
+		FStratSaveChunkEntry& Entry = Entries.AddDefaulted_GetRef();
+		Entry.Id = static_cast<uint32>(Chunk.Id);
+		Entry.RawSize = Chunk.Raw.Num();
+		Entry.CompressedSize = Chunk.Compressed.Num();
+		Entry.Offset = Offset;
+		Offset += Chunk.Compressed.IsEmpty() ? Chunk.Raw.Num() : Chunk.Compressed.Num();
+	}
+
+	OutFile.Reset(static_cast<int32>(Offset));
+	OutFile.Append(reinterpret_cast<const uint8*>(&Header), sizeof(Header));
+	OutFile.Append(reinterpret_cast<const uint8*>(Entries.GetData()), Entries.Num() * sizeof(FStratSaveChunkEntry));
+	for (const FPendingChunk& Chunk : Chunks)
+	{
+		OutFile.Append(Chunk.Compressed.IsEmpty() ? Chunk.Raw : Chunk.Compressed);
+	}
+
+	Chunks.Reset();
+}
+
+FStratSaveReader::FStratSaveReader() = default;
+
+FStratSaveReader::~FStratSaveReader()
+{
+	//~ The region has to go before the file it maps.
+	MappedRegion.Reset();
+	MappedFile.Reset();
+}
+
+bool FStratSaveReader::Open(const FString& Path)
+{
+	MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Path));
+	if (MappedFile)
+	{
+		MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+	}
+
+	if (MappedRegion)
+	{
+		FileData = TConstArrayView<uint8>(MappedRegion->GetMappedPtr(), static_cast<int32>(MappedRegion->GetMappedSize()));
+	}
+	else if (FFileHelper::LoadFileToArray(LoadedFile, *Path, FILEREAD_Silent))
+	{
+		FileData = LoadedFile;
+	}
+	else
+	{
+		return false;
+	}
+
+	return ReadTable();
+}
+
+bool FStratSaveReader::OpenBytes(TArray<uint8>&& Bytes)
+{
+	LoadedFile = MoveTemp(Bytes);
+	FileData = LoadedFile;
+	return ReadTable();
+}
+
+bool FStratSaveReader::ReadTable()
+{
+	if (FileData.Num() < static_cast<int32>(sizeof(FStratSaveHeader)))
+	{
+		return false;
+	}
+
+	FMemory::Memcpy(&Header, FileData.GetData(), sizeof(Header));
+	if (Header.Magic != StratSave::Magic || Header.Version > StratSave::Version)
+	{
+		return false;
+	}
+
+	const uint64 TableEnd = sizeof(FStratSaveHeader) + static_cast<uint64>(Header.NumChunks) * sizeof(FStratSaveChunkEntry);
+	if (TableEnd > static_cast<uint64>(FileData.Num()))
+	{
+		return false;
+	}
+
+	Entries.SetNumUninitialized(Header.NumChunks);
+	FMemory::Memcpy(Entries.GetData(), FileData.GetData() + sizeof(FStratSaveHeader), Header.NumChunks * sizeof(FStratSaveChunkEntry));
+	//~ Offset comes from the file, so adding the size to it could wrap. Compare against what's left after it instead.
+	const uint64 FileSize = static_cast<uint64>(FileData.Num());
+	for (const FStratSaveChunkEntry& Entry : Entries)
+	{
+		const uint64 StoredSize = Entry.CompressedSize > 0 ? Entry.CompressedSize : Entry.RawSize;
+		if (Entry.Offset < TableEnd || Entry.Offset > FileSize || StoredSize > FileSize - Entry.Offset)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FStratSaveReader::ReadChunk(const StratSave::EChunk Id, TArray<uint8>& OutBytes) const
+{
+	const FStratSaveChunkEntry* Entry = FindEntry(Id);
+	if (!Entry)
+	{
+		return false;
+	}
+
+	OutBytes.SetNumUninitialized(Entry->RawSize);
+	return DecompressEntry(*Entry, OutBytes.GetData());
+}
+
+bool FStratSaveReader::Decompress()
+{
+	std::atomic<bool> bAllDecompressed{true};
+	ParallelFor(BoundColumns.Num(), [this, &bAllDecompressed](const int32 Index)
+	{
+		if (!DecompressEntry(*BoundColumns[Index].Entry, BoundColumns[Index].Destination))
+		{
+			bAllDecompressed = false;
+		}
+	});
+
+	BoundColumns.Reset();
+	return bAllDecompressed;
+}
+
+const FStratSaveChunkEntry* FStratSaveReader::FindEntry(const StratSave::EChunk Id) const
+{
+	return Entries.FindByPredicate([Id](const FStratSaveChunkEntry& Entry) { return Entry.Id == static_cast<uint32>(Id); });
+}
+
+bool FStratSaveReader::DecompressEntry(const FStratSaveChunkEntry& Entry, void* Destination) const
+{
+	const uint8* Source = FileData.GetData() + Entry.Offset;
+	if (Entry.CompressedSize == 0)
+	{
+		FMemory::Memcpy(Destination, Source, Entry.RawSize);
+		return true;
+	}
+
+	return FCompression::UncompressMemory(NAME_Oodle, Destination, Entry.RawSize, Source, Entry.CompressedSize);
+}
+
+void StratSave::AddUnitColumns(FStratSaveWriter& Writer, const FStratUnitSnapshot& Snapshot)
+{
+	Writer.AddColumn(EChunk::SlotSerials, Snapshot.SlotSerials);
+	Writer.AddColumn(EChunk::Handles, Snapshot.Handles);
+	Writer.AddColumn(EChunk::TypeIds, Snapshot.TypeIds);
+	Writer.AddColumn(EChunk::Factions, Snapshot.Factions);
+	Writer.AddColumn(EChunk::Positions, Snapshot.Positions);
+	Writer.AddColumn(EChunk::FixedPositions, Snapshot.FixedPositions);
+	Writer.AddColumn(EChunk::Velocities, Snapshot.Velocities);
+	Writer.AddColumn(EChunk::Yaws, Snapshot.Yaws);
+	Writer.AddColumn(EChunk::Health, Snapshot.Health);
+	Writer.AddColumn(EChunk::Orders, Snapshot.Orders);
+	Writer.AddColumn(EChunk::NumQueuedOrders, Snapshot.NumQueuedOrders);
+	Writer.AddColumn(EChunk::QueuedOrders, Snapshot.QueuedOrders);
+	Writer.AddColumn(EChunk::FreeSlots, Snapshot.FreeSlots);
+	Writer.AddColumn(EChunk::ChunkArchetypes, Snapshot.ChunkArchetypes);
+	Writer.AddColumn(EChunk::ChunkSizes, Snapshot.ChunkSizes);
+}
+
+bool StratSave::BindUnitColumns(FStratSaveReader& Reader, FStratUnitSnapshot& Snapshot)
+{
+	return Reader.BindColumn(EChunk::SlotSerials, Snapshot.SlotSerials)
+		&& Reader.BindColumn(EChunk::Handles, Snapshot.Handles)
+		&& Reader.BindColumn(EChunk::TypeIds, Snapshot.TypeIds)
+		&& Reader.BindColumn(EChunk::Factions, Snapshot.Factions)
+		&& Reader.BindColumn(EChunk::Positions, Snapshot.Positions)
+		&& Reader.BindColumn(EChunk::FixedPositions, Snapshot.FixedPositions)
+		&& Reader.BindColumn(EChunk::Velocities, Snapshot.Velocities)
+		&& Reader.BindColumn(EChunk::Yaws, Snapshot.Yaws)
+		&& Reader.BindColumn(EChunk::Health, Snapshot.Health)
+		&& Reader.BindColumn(EChunk::Orders, Snapshot.Orders)
+		&& Reader.BindColumn(EChunk::NumQueuedOrders, Snapshot.NumQueuedOrders)
+		&& Reader.BindColumn(EChunk::QueuedOrders, Snapshot.QueuedOrders)
+		&& (!Reader.HasChunk(EChunk::FreeSlots) || Reader.BindColumn(EChunk::FreeSlots, Snapshot.FreeSlots))
+		&& (!Reader.HasChunk(EChunk::ChunkSizes) || (Reader.BindColumn(EChunk::ChunkArchetypes, Snapshot.ChunkArchetypes) && Reader.BindColumn(EChunk::ChunkSizes, Snapshot.ChunkSizes)));
+}
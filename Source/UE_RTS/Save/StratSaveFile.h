@@ -0,0 +1,213 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <type_traits>
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+struct FStratUnitSnapshot;
+
+/**
+ * Save file layout, all little endian:
+ *
+ *   FStratSaveHeader
+ *   FStratSaveChunkEntry x NumChunks
+ *   chunk payloads, each compressed on its own
+ *
+ * A chunk is either one column of unit state, raw element bytes, or a small archive written with FMemoryWriter. Loading
+ * skips ids it doesn't know, so adding a chunk needs no version bump. Changing what an existing chunk holds does.
+ */
+namespace StratSave
+{
+	/** "STRS" */
+	constexpr uint32 Magic = 0x53525453;
+
+	/**
+	 * Files from newer versions are refused. Older ones are read as long as their chunks still mean the same.
+	 * 2: ReplayCommands written with FStratLockstepCommand's plain archive form instead of its net form, and keyframe index
+	 *    entries carry a state hash.
+	 * 3: FStratLockstepCommand's plain form carries Resource and Amount, for economy commands.
+	 */
+	constexpr uint32 Version = 3;
+
+	enum class EChunk : uint32
+	{
+		/** Archive. Map name and sim frame. */
+		Match = 1,
+
+		/** Archive. Definition path per saved type id, so ids survive reordering UStratUnitSettings::UnitDefinitions. */
+		UnitTypes,
+
+		/** Archive. Name, faction and color per player. */
+		Players,
+
+		/** Column of FStratFactionRelations, one per faction. Who is allied, at war or sharing control. */
+		FactionRelations,
+
+		/** Archive. UStratEconomySubsystem::WriteState. Without it a load starts the economy over. */
+		Economy,
+
+		//~ Columns of FStratUnitSnapshot.
+		SlotSerials = 100,
+		Handles,
+		TypeIds,
+		Factions,
+		Positions,
+		FixedPositions,
+		Velocities,
+		Yaws,
+		Health,
+		Orders,
+		NumQueuedOrders,
+		QueuedOrders,
+
+		/** Optional. Without them a read packs units into full chunks and frees slots lowest first. */
+		FreeSlots,
+		ChunkArchetypes,
+		ChunkSizes,
+
+		//~ Replays, see UStratReplaySubsystem. Players is shared with saves.
+		/** Archive. Map name, tick length, first and end tick, and the definition path per type id. */
+		ReplayInfo = 200,
+
+		/** Archive. Every lockstep command, in tick order, in FStratLockstepCommand's plain archive form. */
+		ReplayCommands,
+
+		/** Column of UStratReplaySubsystem::FCameraSample. */
+		ReplayCameras,
+
+		/** Column of UStratReplaySubsystem::FKeyframe. */
+		ReplayKeyframeIndex,
+
+		/** Raw. Every keyframe back to back, each one a whole file of unit columns in this same format. */
+		ReplayKeyframes,
+	};
+}
+
+struct FStratSaveHeader
+{
+	uint32 Magic{StratSave::Magic};
+	uint32 Version{StratSave::Version};
+	uint32 NumChunks{0};
+	uint32 Reserved{0};
+};
+
+struct FStratSaveChunkEntry
+{
+	uint32 Id{0};
+	uint32 RawSize{0};
+
+	/** 0 when the payload is stored uncompressed because compressing didn't pay off. */
+	uint32 CompressedSize{0};
+	uint32 Reserved{0};
+
+	/** From the start of the file. */
+	uint64 Offset{0};
+};
+
+/** Collects chunks, then compresses them all in parallel and lays out the file. */
+class UE_RTS_API FStratSaveWriter
+{
+public:
+	void AddChunk(StratSave::EChunk Id, TArray<uint8>&& Bytes);
+
+	template <typename ElementType>
+	void AddColumn(const StratSave::EChunk Id, const TArray<ElementType>& Column)
+	{
+		static_assert(std::is_trivially_copyable_v<ElementType>, "Columns are written as raw bytes.");
+		TArray<uint8> Bytes;
+		Bytes.SetNumUninitialized(Column.Num() * sizeof(ElementType));
+		FMemory::Memcpy(Bytes.GetData(), Column.GetData(), Bytes.Num());
+		AddChunk(Id, MoveTemp(Bytes));
+	}
+
+	/** Compresses every chunk and writes the whole file to OutFile. */
+	void Finish(TArray<uint8>& OutFile);
+
+private:
+	struct FPendingChunk
+	{
+		StratSave::EChunk Id;
+		TArray<uint8> Raw;
+		TArray<uint8> Compressed;
+	};
+
+	TArray<FPendingChunk> Chunks;
+};
+
+/**
+ * Reads a save file through a memory mapping, so nothing is copied before decompression. Columns are bound to their
+ * destination arrays first, then Decompress inflates all of them in parallel straight into those arrays.
+ */
+class UE_RTS_API FStratSaveReader
+{
+public:
+	FStratSaveReader();
+	~FStratSaveReader();
+
+	/** Maps the file and checks the header and chunk table. False if it's missing, corrupt or from a newer version. */
+	bool Open(const FString& Path);
+
+	/** Same as Open, for a file that's already in memory, like one streamed over the network. */
+	bool OpenBytes(TArray<uint8>&& Bytes);
+
+	uint32 GetVersion() const { return Header.Version; }
+	bool HasChunk(StratSave::EChunk Id) const { return FindEntry(Id) != nullptr; }
+
+	/** Decompresses one chunk right away. For the small archive chunks. */
+	bool ReadChunk(StratSave::EChunk Id, TArray<uint8>& OutBytes) const;
+
+	/** Sizes Column to the chunk and queues it for Decompress. False if the chunk is missing or isn't whole elements. */
+	template <typename ElementType>
+	bool BindColumn(const StratSave::EChunk Id, TArray<ElementType>& Column)
+	{
+		static_assert(std::is_trivially_copyable_v<ElementType>, "Columns are read as raw bytes.");
+		const FStratSaveChunkEntry* Entry = FindEntry(Id);
+		if (!Entry || Entry->RawSize % sizeof(ElementType) != 0)
+		{
+			return false;
+		}
+
+		Column.SetNumUninitialized(Entry->RawSize / sizeof(ElementType));
+		BoundColumns.Add({Entry, Column.GetData()});
+		return true;
+	}
+
+	/** Inflates every bound column. False if any chunk failed, in which case the columns hold garbage. */
+	bool Decompress();
+
+private:
+	/** Checks the header and chunk table of FileData. */
+	bool ReadTable();
+
+	const FStratSaveChunkEntry* FindEntry(StratSave::EChunk Id) const;
+	bool DecompressEntry(const FStratSaveChunkEntry& Entry, void* Destination) const;
+
+	struct FBoundColumn
+	{
+		const FStratSaveChunkEntry* Entry;
+		void* Destination;
+	};
+
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+
+	/** Fallback for platforms that can't map files. */
+	TArray<uint8> LoadedFile;
+
+	TConstArrayView<uint8> FileData;
+	FStratSaveHeader Header;
+	TArray<FStratSaveChunkEntry> Entries;
+	TArray<FBoundColumn> BoundColumns;
+};
+
+namespace StratSave
+{
+	/** Adds one chunk per column of the snapshot. */
+	UE_RTS_API void AddUnitColumns(FStratSaveWriter& Writer, const FStratUnitSnapshot& Snapshot);
+
+	/** Binds every column of the snapshot for FStratSaveReader::Decompress. False if any is missing. */
+	UE_RTS_API bool BindUnitColumns(FStratSaveReader& Reader, FStratUnitSnapshot& Snapshot);
+}
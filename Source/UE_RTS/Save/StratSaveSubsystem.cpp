@@ -0,0 +1,305 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratSaveSubsystem.h"
+
+#include "StratSaveFile.h"
+#include "Economy/StratEconomySubsystem.h"
+#include "Engine/World.h"
+#include "Faction/StratFactionSubsystem.h"
+#include "GameFramework/GameStateBase.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Player/StratPlayerState.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Units/StratUnitDefinition.h"
+#include "Units/StratUnitSimSubsystem.h"
+#include "Units/StratUnitSnapshot.h"
+
+DEFINE_LOG_CATEGORY(LogStratSave);
+
+DECLARE_CYCLE_STAT(TEXT("Save Match"), STAT_StratSave_Save, STATGROUP_StratUnits);
+DECLARE_CYCLE_STAT(TEXT("Load Match"), STAT_StratSave_Load, STATGROUP_StratUnits);
+
+void UStratSaveSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UnitSim = Collection.InitializeDependency<UStratUnitSimSubsystem>();
+}
+
+bool UStratSaveSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+FString UStratSaveSubsystem::GetSavePath(const FString& SlotName)
+{
+	return FPaths::ProjectSavedDir() / TEXT("SaveGames") / SlotName + TEXT(".stratsave");
+}
+
+bool UStratSaveSubsystem::DoesSaveExist(const FString& SlotName) const
+{
+	return IFileManager::Get().FileExists(*GetSavePath(SlotName));
+}
+
+bool UStratSaveSubsystem::CanSaveOrLoad(const TCHAR* Action) const
+{
+	if (GetWorld()->GetNetMode() == NM_Client || !UnitSim || UnitSim->IsLockstep())
+	{
+		UE_LOG(LogStratSave, Warning, TEXT("%s is authority only and not for lockstep."), Action);
+		return false;
+	}
+	return true;
+}
+
+FString UStratSaveSubsystem::GetMapPackageName() const
+{
+	return UWorld::RemovePIEPrefix(GetWorld()->GetOutermost()->GetName());
+}
+
+bool UStratSaveSubsystem::SaveMatch(const FString& SlotName)
+{
+	if (!CanSaveOrLoad(TEXT("SaveMatch")))
+	{
+		return false;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_StratSave_Save);
+	const double StartTime = FPlatformTime::Seconds();
+
+	FStratUnitSnapshot Snapshot;
+	UnitSim->WriteSnapshot(Snapshot);
+
+	FStratSaveWriter Writer;
+	{
+		TArray<uint8> Bytes;
+		FMemoryWriter Ar(Bytes);
+		FString MapName = GetMapPackageName();
+		Ar << MapName;
+		Ar << Snapshot.SimFrame;
+		Writer.AddChunk(StratSave::EChunk::Match, MoveTemp(Bytes));
+	}
+	{
+		TArray<FString> TypePaths;
+		for (int32 TypeId = 0; TypeId < UnitSim->GetTypeInfos().Num(); ++TypeId)
+		{
+			TypePaths.Add(FSoftObjectPath(UnitSim->GetDefinition(static_cast<uint16>(TypeId))).ToString());
+		}
+
+		TArray<uint8> Bytes;
+		FMemoryWriter Ar(Bytes);
+		Ar << TypePaths;
+		Writer.AddChunk(StratSave::EChunk::UnitTypes, MoveTemp(Bytes));
+	}
+	{
+		TArray<uint8> Bytes;
+		FMemoryWriter Ar(Bytes);
+		WritePlayers(Ar);
+		Writer.AddChunk(StratSave::EChunk::Players, MoveTemp(Bytes));
+	}
+	if (const UStratFactionSubsystem* Factions = GetWorld()->GetSubsystem<UStratFactionSubsystem>())
+	{
+		Writer.AddColumn(StratSave::EChunk::FactionRelations, TArray<FStratFactionRelations>(Factions->GetAllRelations()));
+	}
+	if (UStratEconomySubsystem* Economy = GetWorld()->GetSubsystem<UStratEconomySubsystem>())
+	{
+		TArray<uint8> Bytes;
+		FMemoryWriter Ar(Bytes);
+		Economy->WriteState(Ar);
+		Writer.AddChunk(StratSave::EChunk::Economy, MoveTemp(Bytes));
+	}
+
+	StratSave::AddUnitColumns(Writer, Snapshot);
+
+	TArray<uint8> File;
+	Writer.Finish(File);
+
+	//~ Write next to the old save and swap, so a crash mid write never leaves a half file under the slot's name.
+	const FString Path = GetSavePath(SlotName);
+	const FString TempPath = Path + TEXT(".tmp");
+	if (!FFileHelper::SaveArrayToFile(File, *TempPath) || !IFileManager::Get().Move(*Path, *TempPath, true))
+	{
+		UE_LOG(LogStratSave, Error, TEXT("Couldn't write %s."), *Path);
+		return false;
+	}
+
+	UE_LOG(LogStratSave, Log, TEXT("Saved %d units to %s, %.1f KB in %.1f ms."), Snapshot.Num(), *Path, File.Num() / 1024.0, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	return true;
+}
+
+bool UStratSaveSubsystem::LoadMatch(const FString& SlotName)
+{
+	if (!CanSaveOrLoad(TEXT("LoadMatch")))
+	{
+		return false;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_StratSave_Load);
+	const double StartTime = FPlatformTime::Seconds();
+
+	const FString Path = GetSavePath(SlotName);
+	FStratSaveReader Reader;
+	if (!Reader.Open(Path))
+	{
+		UE_LOG(LogStratSave, Error, TEXT("%s is missing, corrupt or from a newer version."), *Path);
+		return false;
+	}
+
+	FStratUnitSnapshot Snapshot;
+	TArray<uint8> MatchBytes;
+	TArray<uint8> TypeBytes;
+	if (!Reader.ReadChunk(StratSave::EChunk::Match, MatchBytes) || !Reader.ReadChunk(StratSave::EChunk::UnitTypes, TypeBytes))
+	{
+		UE_LOG(LogStratSave, Error, TEXT("%s has no match info."), *Path);
+		return false;
+	}
+
+	FString SavedMapName;
+	FMemoryReader MatchAr(MatchBytes);
+	MatchAr << SavedMapName;
+	MatchAr << Snapshot.SimFrame;
+	if (SavedMapName != GetMapPackageName())
+	{
+		UE_LOG(LogStratSave, Error, TEXT("%s was saved on %s, not on this map."), *Path, *SavedMapName);
+		return false;
+	}
+
+	TArray<FStratFactionRelations> Relations;
+	const bool bBound = StratSave::BindUnitColumns(Reader, Snapshot)
+		&& (!Reader.HasChunk(StratSave::EChunk::FactionRelations) || Reader.BindColumn(StratSave::EChunk::FactionRelations, Relations));
+	if (!bBound || !Reader.Decompress())
+	{
+		UE_LOG(LogStratSave, Error, TEXT("%s has missing or damaged unit data."), *Path);
+		return false;
+	}
+
+	TArray<FString> SavedTypes;
+	FMemoryReader TypeAr(TypeBytes);
+	TypeAr << SavedTypes;
+
+	TArray<uint16> TypeIdRemap;
+	BuildTypeIdRemap(SavedTypes, TypeIdRemap);
+	for (uint16& TypeId : Snapshot.TypeIds)
+	{
+		TypeId = TypeIdRemap.IsValidIndex(TypeId) ? TypeIdRemap[TypeId] : MAX_uint16;
+	}
+
+	if (!UnitSim->ReadSnapshot(Snapshot))
+	{
+		return false;
+	}
+
+	//~ Saves from before relations were in them keep the running match's.
+	UStratFactionSubsystem* Factions = GetWorld()->GetSubsystem<UStratFactionSubsystem>();
+	if (Factions && Reader.HasChunk(StratSave::EChunk::FactionRelations))
+	{
+		Factions->RestoreRelations(Relations);
+	}
+
+	//~ The economy refers to units by handle, so whatever it held before the load means nothing now.
+	if (UStratEconomySubsystem* Economy = GetWorld()->GetSubsystem<UStratEconomySubsystem>())
+	{
+		TArray<uint8> EconomyBytes;
+		const bool bRead = Reader.ReadChunk(StratSave::EChunk::Economy, EconomyBytes);
+		FMemoryReader EconomyAr(EconomyBytes);
+		if (!bRead || !Economy->ReadState(EconomyAr, TypeIdRemap))
+		{
+			UE_CLOG(Reader.HasChunk(StratSave::EChunk::Economy), LogStratSave, Warning, TEXT("%s has a damaged economy. It starts over."), *Path);
+			Economy->ResetState();
+		}
+	}
+
+	TArray<uint8> PlayerBytes;
+	if (Reader.ReadChunk(StratSave::EChunk::Players, PlayerBytes))
+	{
+		FMemoryReader PlayerAr(PlayerBytes);
+		ReadPlayers(PlayerAr);
+	}
+
+	UE_LOG(LogStratSave, Log, TEXT("Loaded %d units from %s in %.1f ms."), UnitSim->GetNumUnits(), *Path, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	return true;
+}
+
+void UStratSaveSubsystem::WritePlayers(FArchive& Ar) const
+{
+	TArray<AStratPlayerState*> Players;
+	if (const AGameStateBase* GameState = GetWorld()->GetGameState())
+	{
+		for (APlayerState* PlayerState : GameState->PlayerArray)
+		{
+			if (AStratPlayerState* StratPlayerState = Cast<AStratPlayerState>(PlayerState))
+			{
+				Players.Add(StratPlayerState);
+			}
+		}
+	}
+
+	int32 NumPlayers = Players.Num();
+	Ar << NumPlayers;
+	for (const AStratPlayerState* Player : Players)
+	{
+		FString Name = Player->GetPlayerName();
+		uint8 FactionId = Player->GetFactionId();
+		FLinearColor Color = Player->GetPlayerColor();
+		Ar << Name << FactionId << Color;
+	}
+}
+
+void UStratSaveSubsystem::ReadPlayers(FArchive& Ar) const
+{
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	if (!GameState)
+	{
+		return;
+	}
+
+	int32 NumPlayers = 0;
+	Ar << NumPlayers;
+	for (int32 Index = 0; Index < NumPlayers && !Ar.IsError(); ++Index)
+	{
+		FString Name;
+		uint8 FactionId = 0;
+		FLinearColor Color;
+		Ar << Name << FactionId << Color;
+
+		//~ Players are matched by name. Whoever sat in the same seat is the fallback, so renamed players still get theirs.
+		AStratPlayerState* Player = nullptr;
+		for (APlayerState* PlayerState : GameState->PlayerArray)
+		{
+			if (PlayerState && PlayerState->GetPlayerName() == Name)
+			{
+				Player = Cast<AStratPlayerState>(PlayerState);
+				break;
+			}
+		}
+		if (!Player && GameState->PlayerArray.IsValidIndex(Index))
+		{
+			Player = Cast<AStratPlayerState>(GameState->PlayerArray[Index]);
+		}
+
+		if (Player)
+		{
+			Player->SetFactionId(FactionId);
+			Player->SetPlayerColor(Color);
+		}
+	}
+}
+
+void UStratSaveSubsystem::BuildTypeIdRemap(const TArray<FString>& SavedTypes, TArray<uint16>& OutRemap) const
+{
+	TMap<FString, uint16> CurrentTypes;
+	for (int32 TypeId = 0; TypeId < UnitSim->GetTypeInfos().Num(); ++TypeId)
+	{
+		CurrentTypes.Add(FSoftObjectPath(UnitSim->GetDefinition(static_cast<uint16>(TypeId))).ToString(), static_cast<uint16>(TypeId));
+	}
+
+	OutRemap.Reset(SavedTypes.Num());
+	for (const FString& SavedType : SavedTypes)
+	{
+		const uint16* TypeId = CurrentTypes.Find(SavedType);
+		UE_CLOG(!TypeId, LogStratSave, Warning, TEXT("Unit type %s isn't registered anymore. Its units won't load."), *SavedType);
+		OutRemap.Add(TypeId ? *TypeId : MAX_uint16);
+	}
+}
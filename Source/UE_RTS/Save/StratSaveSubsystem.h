@@ -0,0 +1,59 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "StratSaveSubsystem.generated.h"
+
+class UStratUnitSimSubsystem;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogStratSave, Log, All);
+
+/**
+ * Saves a match to a chunked binary file under Saved/SaveGames and loads it back, see StratSaveFile.h for the layout.
+ * Units go out as columns copied straight from the simulation's chunks and come back the same way, a chunk at a time,
+ * so a late game match loads in milliseconds instead of serializing thousands of objects. Faction relations and the
+ * economy go with them.
+ *
+ * Loading replaces the running match in place. The map has to be the one the save was made on. Authority only and not
+ * for lockstep, where every peer would have to load the same file on the same step.
+ */
+UCLASS()
+class UE_RTS_API UStratSaveSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	//~ End USubsystem interface
+
+	UFUNCTION(BlueprintCallable, Category=StratSave)
+	bool SaveMatch(const FString& SlotName);
+
+	UFUNCTION(BlueprintCallable, Category=StratSave)
+	bool LoadMatch(const FString& SlotName);
+
+	UFUNCTION(BlueprintPure, Category=StratSave)
+	bool DoesSaveExist(const FString& SlotName) const;
+
+	static FString GetSavePath(const FString& SlotName);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Logs why and returns false on clients and in lockstep. */
+	bool CanSaveOrLoad(const TCHAR* Action) const;
+
+	FString GetMapPackageName() const;
+
+	void WritePlayers(FArchive& Ar) const;
+	void ReadPlayers(FArchive& Ar) const;
+
+	/** Saved type id to this build's type id. Types that no longer exist map to MAX_uint16, which the simulation drops. */
+	void BuildTypeIdRemap(const TArray<FString>& SavedTypes, TArray<uint16>& OutRemap) const;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratUnitSimSubsystem> UnitSim;
+};
@@ -0,0 +1,39 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratMoveMarkerActor.h"
+
+#include "Components/DecalComponent.h"
+
+AStratMoveMarkerActor::AStratMoveMarkerActor()
+{
+	PrimaryActorTick.bCanEverTick = false;
+	SetCanBeDamaged(false);
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("RootComp"));
+	RootComponent->SetMobility(EComponentMobility::Movable);
+
+	//~ Decals project along their X axis, so pitch them to project straight down.
+	LocationDecalComp = CreateDefaultSubobject<UDecalComponent>(TEXT("LocationDecalComp"));
+	LocationDecalComp->SetupAttachment(RootComponent);
+	LocationDecalComp->SetRelativeRotation(FRotator(-90.f, 0.f, 0.f));
+	LocationDecalComp->DecalSize = FVector(128.f, 64.f, 64.f);
+
+	DirectionDecalComp = CreateDefaultSubobject<UDecalComponent>(TEXT("DirectionDecalComp"));
+	DirectionDecalComp->SetupAttachment(RootComponent);
+	DirectionDecalComp->SetRelativeRotation(FRotator(-90.f, 0.f, 0.f));
+	DirectionDecalComp->DecalSize = FVector(128.f, 32.f, 128.f);
+	DirectionDecalComp->SetVisibility(false);
+}
+
+void AStratMoveMarkerActor::SetFacing(const FVector& Facing)
+{
+	const FVector FacingXY(Facing.X, Facing.Y, 0.0);
+	if (FacingXY.IsNearlyZero())
+	{
+		DirectionDecalComp->SetVisibility(false);
+		return;
+	}
+
+	DirectionDecalComp->SetWorldRotation(FRotator(-90.f, FacingXY.Rotation().Yaw, 0.f));
+	DirectionDecalComp->SetVisibility(true);
+}
@@ -0,0 +1,35 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "StratMoveMarkerActor.generated.h"
+
+class UDecalComponent;
+
+/**
+ * Local only. Shows where a move order went, and which way the units will face if the order has a facing.
+ * Comes from UStratActorPoolSubsystem, so set the decal materials in a Blueprint subclass rather than spawning it.
+ */
+UCLASS(Abstract, Blueprintable, meta=(PrioritizeCategories="User"))
+class UE_RTS_API AStratMoveMarkerActor : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AStratMoveMarkerActor();
+
+	/** Points the direction decal along Facing. A zero Facing hides it. */
+	UFUNCTION(BlueprintCallable, Category=StratMoveMarker)
+	void SetFacing(const FVector& Facing);
+
+protected:
+	/** Projected onto the ground at the move location. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="User|Info")
+	TObjectPtr<UDecalComponent> LocationDecalComp;
+
+	/** Projected onto the ground, turned toward the order's facing. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="User|Info")
+	TObjectPtr<UDecalComponent> DirectionDecalComp;
+};
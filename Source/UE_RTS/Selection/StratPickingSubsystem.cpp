@@ -0,0 +1,253 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratPickingSubsystem.h"
+
+#include "StratSelectionSettings.h"
+#include "StratSelectionSubsystem.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Units/StratUnitSimSubsystem.h"
+#include "World/StratTerrainSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Cursor Picking"), STAT_StratPicking_Cursor, STATGROUP_StratUnits);
+DECLARE_CYCLE_STAT(TEXT("Pick Grid Build"), STAT_StratPicking_GridBuild, STATGROUP_StratUnits);
+
+namespace
+{
+	/** Refinement steps once a ray step went from above to below the ground. Each halves the error. */
+	constexpr int32 GroundBisectSteps = 8;
+}
+
+void UStratPickingSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UnitSim = Collection.InitializeDependency<UStratUnitSimSubsystem>();
+	Terrain = Collection.InitializeDependency<UStratTerrainSubsystem>();
+	Selection = Collection.InitializeDependency<UStratSelectionSubsystem>();
+
+	if (Terrain)
+	{
+		Terrain->OnHeightsChanged.AddUObject(this, &ThisClass::OnTerrainHeightsChanged);
+	}
+}
+
+void UStratPickingSubsystem::Deinitialize()
+{
+	if (Terrain)
+	{
+		Terrain->OnHeightsChanged.RemoveAll(this);
+	}
+
+	Super::Deinitialize();
+}
+
+bool UStratPickingSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UStratPickingSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UStratPickingSubsystem, STATGROUP_StratUnits);
+}
+
+void UStratPickingSubsystem::Tick(const float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (GetWorld()->GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_StratPicking_Cursor);
+
+	bHasCursorGroundPoint = false;
+	CursorUnit = FStratUnitHandle();
+
+	FVector Origin;
+	FVector Direction;
+	const APlayerController* PC = GetWorld()->GetFirstPlayerController();
+	if (PC && PC->DeprojectMousePositionToWorld(Origin, Direction))
+	{
+		{
+			SCOPE_CYCLE_COUNTER(STAT_StratPicking_GridBuild);
+			UnitGrid.Build(*UnitSim, GetDefault<UStratSelectionSettings>()->PickGridCellSize);
+		}
+
+		bHasCursorGroundPoint = TraceGround(Origin, Direction, CursorGroundPoint);
+
+		//~ Units behind a hill from the camera's point of view can't be hovered. The ray stops at the ground.
+		const double MaxDistance = bHasCursorGroundPoint ? FVector::Dist(Origin, CursorGroundPoint) : GetDefault<UStratSelectionSettings>()->MaxPickDistance;
+		CursorUnit = PickUnit(Origin, Direction, MaxDistance);
+	}
+
+	if (Selection)
+	{
+		Selection->SetHoveredUnit(CursorUnit);
+	}
+}
+
+bool UStratPickingSubsystem::GetCursorGroundPoint(FVector& OutLocation) const
+{
+	OutLocation = CursorGroundPoint;
+	return bHasCursorGroundPoint;
+}
+
+void UStratPickingSubsystem::SelectUnderCursor(const bool bAddToSelection)
+{
+	if (CursorUnit.IsValid())
+	{
+		Selection->SelectUnits({CursorUnit}, bAddToSelection);
+	}
+	else if (!bAddToSelection)
+	{
+		Selection->ClearSelection();
+	}
+}
+
+void UStratPickingSubsystem::OnTerrainHeightsChanged(const FBox2D& ChangedArea)
+{
+	//~ A change can lower the highest cell as well as raise it, so look at all of them. Rare enough not to matter.
+	const TArray<float>& Heights = Terrain->GetHeightGrid().Heights;
+	MaxTerrainHeight = Heights.IsEmpty() ? 0.f : FMath::Max(Heights);
+}
+
+bool UStratPickingSubsystem::TraceGround(const FVector& Origin, const FVector& Direction, FVector& OutLocation) const
+{
+	const FStratHeightGrid& Grid = Terrain->GetHeightGrid();
+	if (!Grid.IsValid())
+	{
+		return false;
+	}
+
+	const auto IsBelowGround = [&Grid](const FVector& Point)
+	{
+		return Point.Z <= Grid.SampleHeight(FVector2D(Point));
+	};
+
+	//~ Nothing above the highest cell can hit, so start there. From a top down camera that's most of the ray.
+	double Start = 0.0;
+	if (Origin.Z > MaxTerrainHeight)
+	{
+		if (Direction.Z >= 0.0)
+		{
+			return false;
+		}
+		Start = (Origin.Z - MaxTerrainHeight) / -Direction.Z;
+	}
+
+	const double MaxDistance = GetDefault<UStratSelectionSettings>()->MaxPickDistance;
+	if (Start > MaxDistance)
+	{
+		return false;
+	}
+
+	if (IsBelowGround(Origin + Direction * Start))
+	{
+		OutLocation = Origin + Direction * Start;
+		return true;
+	}
+
+	//~ Half cell steps can't jump over a cell. Slopes between samples are linear, so bisecting the crossing step is exact enough.
+	const double Step = Grid.CellSize * 0.5;
+	for (double Above = Start; Above < MaxDistance; Above += Step)
+	{
+		double Below = FMath::Min(Above + Step, MaxDistance);
+		if (!IsBelowGround(Origin + Direction * Below))
+		{
+			continue;
+		}
+
+		double High = Above;
+		for (int32 Iteration = 0; Iteration < GroundBisectSteps; ++Iteration)
+		{
+			const double Mid = (High + Below) * 0.5;
+			if (IsBelowGround(Origin + Direction * Mid))
+			{
+				Below = Mid;
+			}
+			else
+			{
+				High = Mid;
+			}
+		}
+
+		OutLocation = Origin + Direction * Below;
+		OutLocation.Z = Grid.SampleHeight(FVector2D(OutLocation));
+		return true;
+	}
+
+	return false;
+}
+
+FStratUnitHandle UStratPickingSubsystem::PickUnit(const FVector& Origin, const FVector& Direction, const double MaxDistance) const
+{
+	if (UnitGrid.IsEmpty())
+	{
+		return FStratUnitHandle();
+	}
+
+	const float RadiusScale = GetDefault<UStratSelectionSettings>()->PickRadiusScale;
+	const FVector End = Origin + Direction * MaxDistance;
+
+	//~ The ray's shadow on the ground, widened by the biggest pick radius, walked one column of cells at a time. Each column
+	//~ takes the rows the widened shadow covers within it, so every cell comes up exactly once.
+	TArray<int32, TInlineAllocator<64>> Cells;
+	const FVector2D Start2D(Origin);
+	const FVector2D Delta2D = FVector2D(End) - Start2D;
+	const double Margin = UnitGrid.MaxRadius * RadiusScale;
+	const int32 FirstColumn = UnitGrid.WorldToCell(FVector2D(FMath::Min(Start2D.X, Start2D.X + Delta2D.X) - Margin, 0.0)).X;
+	const int32 LastColumn = UnitGrid.WorldToCell(FVector2D(FMath::Max(Start2D.X, Start2D.X + Delta2D.X) + Margin, 0.0)).X;
+	for (int32 X = FirstColumn; X <= LastColumn; ++X)
+	{
+		//~ Where along the ray it's within Margin of this column. All of it when the ray runs straight along Y.
+		double T0 = 0.0;
+		double T1 = 1.0;
+		if (!FMath::IsNearlyZero(Delta2D.X))
+		{
+			const double ColumnMin = UnitGrid.Origin.X + X * UnitGrid.CellSize - Margin;
+			const double ColumnMax = ColumnMin + UnitGrid.CellSize + Margin * 2.0;
+			T0 = FMath::Clamp((ColumnMin - Start2D.X) / Delta2D.X, 0.0, 1.0);
+			T1 = FMath::Clamp((ColumnMax - Start2D.X) / Delta2D.X, 0.0, 1.0);
+		}
+
+		const double Y0 = Start2D.Y + Delta2D.Y * T0;
+		const double Y1 = Start2D.Y + Delta2D.Y * T1;
+		const int32 FirstRow = UnitGrid.WorldToCell(FVector2D(0.0, FMath::Min(Y0, Y1) - Margin)).Y;
+		const int32 LastRow = UnitGrid.WorldToCell(FVector2D(0.0, FMath::Max(Y0, Y1) + Margin)).Y;
+		for (int32 Y = FirstRow; Y <= LastRow; ++Y)
+		{
+			Cells.Add(UnitGrid.ToIndex(X, Y));
+		}
+	}
+
+	FStratUnitHandle Best;
+	double BestDistance = MaxDistance;
+	for (const int32 CellIndex : Cells)
+	{
+		for (const FStratUnitGrid::FEntry& Entry : UnitGrid.GetCellEntries(CellIndex))
+		{
+			const FVector Bottom(Entry.Position);
+			const FVector Top = Bottom + FVector(0.0, 0.0, Entry.Height);
+			const double Radius = Entry.Radius * RadiusScale;
+
+			FVector OnRay;
+			FVector OnUnit;
+			FMath::SegmentDistToSegmentSafe(Origin, End, Bottom, Top, OnRay, OnUnit);
+			if (FVector::DistSquared(OnRay, OnUnit) > FMath::Square(Radius))
+			{
+				continue;
+			}
+
+			const double Distance = FVector::Dist(Origin, OnRay);
+			if (Distance < BestDistance)
+			{
+				BestDistance = Distance;
+				Best = Entry.Unit;
+			}
+		}
+	}
+	return Best;
+}
@@ -0,0 +1,80 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Units/StratUnitGrid.h"
+#include "Units/StratUnitTypes.h"
+#include "StratPickingSubsystem.generated.h"
+
+class UStratSelectionSubsystem;
+class UStratTerrainSubsystem;
+class UStratUnitSimSubsystem;
+
+/**
+ * What's under the local player's cursor, without physics traces. The ground point is found by marching the cursor ray
+ * over UStratTerrainSubsystem's cached height grid, and the unit by testing capsules from a FStratUnitGrid rebuilt each
+ * frame. Runs every frame and keeps UStratSelectionSubsystem's hovered unit up to date.
+ *
+ * Only as accurate as the height grid, which is fine for orders and hover. Anything that must hit exact collision still traces.
+ */
+UCLASS()
+class UE_RTS_API UStratPickingSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	//~ Begin UTickableWorldSubsystem interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~ End UTickableWorldSubsystem interface
+
+	/** Where the cursor meets the ground this frame. False when the cursor is off the viewport or over the sky. */
+	UFUNCTION(BlueprintPure, Category=StratPicking)
+	bool GetCursorGroundPoint(FVector& OutLocation) const;
+
+	/** The unit under the cursor this frame. Invalid if none. */
+	UFUNCTION(BlueprintPure, Category=StratPicking)
+	FStratUnitHandle GetUnitUnderCursor() const { return CursorUnit; }
+
+	/** Selects the unit under the cursor. Clicking open ground clears the selection unless bAddToSelection. */
+	UFUNCTION(BlueprintCallable, Category=StratPicking)
+	void SelectUnderCursor(bool bAddToSelection = false);
+
+	/** First point where a ray meets the cached terrain. Direction must be normalized. */
+	bool TraceGround(const FVector& Origin, const FVector& Direction, FVector& OutLocation) const;
+
+	/** Closest unit whose capsule a ray passes through before MaxDistance. Uses the grid from the last Tick. */
+	FStratUnitHandle PickUnit(const FVector& Origin, const FVector& Direction, double MaxDistance) const;
+
+	SIZE_T GetAllocatedSize() const { return UnitGrid.GetAllocatedSize(); }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void OnTerrainHeightsChanged(const FBox2D& ChangedArea);
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratUnitSimSubsystem> UnitSim;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratTerrainSubsystem> Terrain;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratSelectionSubsystem> Selection;
+
+	FStratUnitGrid UnitGrid;
+
+	/** Highest cell of the height grid. Rays start marching where they drop below it. */
+	float MaxTerrainHeight{0.f};
+
+	FVector CursorGroundPoint{FVector::ZeroVector};
+	bool bHasCursorGroundPoint{false};
+	FStratUnitHandle CursorUnit;
+};
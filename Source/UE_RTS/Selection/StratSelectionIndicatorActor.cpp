@@ -0,0 +1,126 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratSelectionIndicatorActor.h"
+
+#include "Components/InstancedStaticMeshComponent.h"
+
+static_assert(sizeof(FStratSelectionIndicatorData) == FStratSelectionIndicatorData::NumFloats * sizeof(float), "Indicator data is written to the component as a float array.");
+
+AStratSelectionIndicatorActor::AStratSelectionIndicatorActor()
+{
+	PrimaryActorTick.bCanEverTick = false;
+	SetCanBeDamaged(false);
+
+	IndicatorsComp = CreateDefaultSubobject<UInstancedStaticMeshComponent>(TEXT("IndicatorsComp"));
+	IndicatorsComp->SetMobility(EComponentMobility::Movable);
+	IndicatorsComp->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	IndicatorsComp->SetGenerateOverlapEvents(false);
+	IndicatorsComp->SetCanEverAffectNavigation(false);
+	IndicatorsComp->SetCastShadow(false);
+	IndicatorsComp->bReceivesDecals = false;
+	IndicatorsComp->NumCustomDataFloats = FStratSelectionIndicatorData::NumFloats;
+	RootComponent = IndicatorsComp;
+}
+
+void AStratSelectionIndicatorActor::SetIndicatorMesh(UStaticMesh* Mesh, UMaterialInterface* Material)
+{
+	IndicatorsComp->SetStaticMesh(Mesh);
+	if (Material)
+	{
+		IndicatorsComp->SetMaterial(0, Material);
+	}
+}
+
+void AStratSelectionIndicatorActor::UpdateIndicators(const TArray<FTransform>& Transforms, const TConstArrayView<FStratSelectionIndicatorData> Data)
+{
+	check(Transforms.Num() == Data.Num());
+
+	//~ The actor stays at the origin, so local space is world space and the component skips converting every transform.
+	const int32 NumOld = AppliedTransforms.Num();
+	const int32 NumNew = Transforms.Num();
+	bool bChanged = false;
+
+	if (NumNew < NumOld)
+	{
+		if (NumNew == 0)
+		{
+			IndicatorsComp->ClearInstances();
+		}
+		else
+		{
+			//~ Removing from the back never moves the instances that stay.
+			TArray<int32> ToRemove;
+			ToRemove.Reserve(NumOld - NumNew);
+			for (int32 Index = NumOld - 1; Index >= NumNew; --Index)
+			{
+				ToRemove.Add(Index);
+			}
+			IndicatorsComp->RemoveInstances(ToRemove, true);
+		}
+
+		AppliedTransforms.SetNum(NumNew);
+		AppliedData.SetNum(NumNew);
+		bChanged = true;
+	}
+
+	//~ Units move in groups, so one batch over the range that moved is cheaper than writing instances one by one.
+	int32 FirstMoved = INDEX_NONE;
+	int32 LastMoved = INDEX_NONE;
+	for (int32 Index = 0; Index < FMath::Min(NumOld, NumNew); ++Index)
+	{
+		if (!AppliedTransforms[Index].Equals(Transforms[Index], 0.1))
+		{
+			FirstMoved = FirstMoved == INDEX_NONE ? Index : FirstMoved;
+			LastMoved = Index;
+		}
+	}
+
+	if (FirstMoved != INDEX_NONE)
+	{
+		const int32 NumMoved = LastMoved - FirstMoved + 1;
+		if (NumMoved == NumNew)
+		{
+			IndicatorsComp->BatchUpdateInstancesTransforms(0, Transforms, false, false, true);
+		}
+		else
+		{
+			IndicatorsComp->BatchUpdateInstancesTransforms(FirstMoved, TArray<FTransform>(&Transforms[FirstMoved], NumMoved), false, false, true);
+		}
+
+		for (int32 Index = FirstMoved; Index <= LastMoved; ++Index)
+		{
+			AppliedTransforms[Index] = Transforms[Index];
+		}
+		bChanged = true;
+	}
+
+	if (NumNew > NumOld)
+	{
+		const TArray<FTransform> Added(&Transforms[NumOld], NumNew - NumOld);
+		IndicatorsComp->AddInstances(Added, false, false, false);
+		AppliedTransforms.Append(Added);
+
+		//~ Negative brightness never matches, so the loop below writes the new instances' data.
+		AppliedData.SetNum(NumNew);
+		for (int32 Index = NumOld; Index < NumNew; ++Index)
+		{
+			AppliedData[Index].Brightness = -1.f;
+		}
+		bChanged = true;
+	}
+
+	for (int32 Index = 0; Index < NumNew; ++Index)
+	{
+		if (!(AppliedData[Index] == Data[Index]))
+		{
+			IndicatorsComp->SetCustomData(Index, MakeArrayView(&Data[Index].R, FStratSelectionIndicatorData::NumFloats), false);
+			AppliedData[Index] = Data[Index];
+			bChanged = true;
+		}
+	}
+
+	if (bChanged)
+	{
+		IndicatorsComp->MarkRenderStateDirty();
+	}
+}
@@ -0,0 +1,59 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "StratSelectionIndicatorActor.generated.h"
+
+class UInstancedStaticMeshComponent;
+class UMaterialInterface;
+class UStaticMesh;
+
+/** Per instance data of a selection indicator. Matches the material's PerInstanceCustomData layout. */
+struct FStratSelectionIndicatorData
+{
+	static constexpr int32 NumFloats = 4;
+
+	float R{1.f};
+	float G{1.f};
+	float B{1.f};
+	float Brightness{1.f};
+
+	bool operator==(const FStratSelectionIndicatorData& Other) const
+	{
+		return R == Other.R && G == Other.G && B == Other.B && Brightness == Other.Brightness;
+	}
+};
+
+/**
+ * Local only. Draws every selection ring and hover marker of a player as instances of one instanced static mesh,
+ * so selecting hundreds of units adds instances to one component rather than a component per unit.
+ * Owned by UStratSelectionSubsystem.
+ */
+UCLASS(NotBlueprintable, NotPlaceable, Transient)
+class UE_RTS_API AStratSelectionIndicatorActor : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AStratSelectionIndicatorActor();
+
+	void SetIndicatorMesh(UStaticMesh* Mesh, UMaterialInterface* Material);
+
+	/**
+	 * Makes instance i show Transforms[i] with Data[i]. Only instances that changed are written, and the render state is
+	 * marked dirty once per call rather than once per instance. Transforms are world space, the actor stays at the origin.
+	 */
+	void UpdateIndicators(const TArray<FTransform>& Transforms, TConstArrayView<FStratSelectionIndicatorData> Data);
+
+	int32 GetNumIndicators() const { return AppliedTransforms.Num(); }
+
+protected:
+	UPROPERTY(VisibleAnywhere, Category="User|Info")
+	TObjectPtr<UInstancedStaticMeshComponent> IndicatorsComp;
+
+	/** What the component currently shows, to skip rewriting instances that didn't change. */
+	TArray<FTransform> AppliedTransforms;
+	TArray<FStratSelectionIndicatorData> AppliedData;
+};
@@ -0,0 +1,8 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratSelectionSettings.h"
+
+UStratSelectionSettings::UStratSelectionSettings()
+{
+	CategoryName = TEXT("Game");
+}
@@ -0,0 +1,72 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "StratSelectionSettings.generated.h"
+
+class AStratMoveMarkerActor;
+class UMaterialInterface;
+class UStaticMesh;
+
+/** Project settings for unit selection. Found under Project Settings > Game > Strat Selection. */
+UCLASS(Config=Game, DefaultConfig, meta=(DisplayName="Strat Selection"))
+class UE_RTS_API UStratSelectionSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UStratSelectionSettings();
+
+	/** Flat ring drawn under selected and hovered units. Every indicator is an instance of this one mesh. Unset, no rings show. */
+	UPROPERTY(Config, EditAnywhere, Category="Indicators")
+	TSoftObjectPtr<UStaticMesh> IndicatorMesh;
+
+	/**
+	 * Reads PerInstanceCustomData: 0-2 are the owning player's color, 3 is brightness.
+	 * Leave empty to use the mesh's own material. A warning is logged then, since most don't read the custom data.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category="Indicators")
+	TSoftObjectPtr<UMaterialInterface> IndicatorMaterial;
+
+	/** Radius of IndicatorMesh at scale 1. Indicators scale so this matches the unit's radius. */
+	UPROPERTY(Config, EditAnywhere, Category="Indicators", meta=(ClampMin="1.0", Units="cm"))
+	float IndicatorMeshRadius{50.f};
+
+	/** Indicator radius as a multiple of the unit's radius, so the ring shows around the unit instead of under it. */
+	UPROPERTY(Config, EditAnywhere, Category="Indicators", meta=(ClampMin="0.1", ClampMax="4.0"))
+	float IndicatorRadiusScale{1.3f};
+
+	/** Lifts indicators off the ground so they don't z-fight with the terrain. */
+	UPROPERTY(Config, EditAnywhere, Category="Indicators", meta=(ClampMin="0.0", Units="cm"))
+	float IndicatorHeightOffset{4.f};
+
+	/** Brightness of selected units, and of a hovered unit that's also selected. */
+	UPROPERTY(Config, EditAnywhere, Category="Indicators", meta=(ClampMin="0.0", ClampMax="1.0"))
+	float BrightIntensity{1.f};
+
+	/** Brightness of a hovered unit that isn't selected. */
+	UPROPERTY(Config, EditAnywhere, Category="Indicators", meta=(ClampMin="0.0", ClampMax="1.0"))
+	float DimIntensity{0.35f};
+
+	/** Shown where the selection was ordered to move. Pooled, see UStratActorPoolSubsystem. */
+	UPROPERTY(Config, EditAnywhere, Category="Orders")
+	TSoftClassPtr<AStratMoveMarkerActor> MoveMarkerClass;
+
+	/** How long a move marker stays before it goes back to the pool. */
+	UPROPERTY(Config, EditAnywhere, Category="Orders", meta=(ClampMin="0.1", Units="s"))
+	float MoveMarkerLifetime{1.5f};
+
+	/** Cell size of the unit grid the cursor is tested against. About the spacing of a loose group works well. */
+	UPROPERTY(Config, EditAnywhere, Category="Picking", meta=(ClampMin="100.0", Units="cm"))
+	float PickGridCellSize{1000.f};
+
+	/** Pick capsule radius as a multiple of the unit's radius. Above 1 makes small units easier to click. */
+	UPROPERTY(Config, EditAnywhere, Category="Picking", meta=(ClampMin="0.5", ClampMax="4.0"))
+	float PickRadiusScale{1.25f};
+
+	/** How far along the cursor ray the ground and units are searched. */
+	UPROPERTY(Config, EditAnywhere, Category="Picking", meta=(ClampMin="1000.0", Units="cm"))
+	float MaxPickDistance{100000.f};
+};
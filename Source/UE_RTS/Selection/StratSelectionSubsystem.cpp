@@ -0,0 +1,339 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratSelectionSubsystem.h"
+
+#include "StratMoveMarkerActor.h"
+#include "StratSelectionSettings.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "Events/StratEventBusSubsystem.h"
+#include "Faction/StratFactionSubsystem.h"
+#include "GameFramework/PlayerController.h"
+#include "Materials/MaterialInterface.h"
+#include "Player/StratPlayerState.h"
+#include "Pooling/StratActorPoolSubsystem.h"
+#include "Units/StratUnitSimSubsystem.h"
+
+DEFINE_LOG_CATEGORY(LogStratSelection);
+
+DECLARE_CYCLE_STAT(TEXT("Selection Indicators"), STAT_StratSelection_Indicators, STATGROUP_StratUnits);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Num Selection Indicators"), STAT_StratSelection_NumIndicators, STATGROUP_StratUnits);
+
+void UStratSelectionSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UnitSim = Collection.InitializeDependency<UStratUnitSimSubsystem>();
+	ActorPool = Collection.InitializeDependency<UStratActorPoolSubsystem>();
+	EventBus = Collection.InitializeDependency<UStratEventBusSubsystem>();
+	Factions = Collection.InitializeDependency<UStratFactionSubsystem>();
+}
+
+void UStratSelectionSubsystem::Deinitialize()
+{
+	if (IsValid(IndicatorActor))
+	{
+		IndicatorActor->Destroy();
+	}
+	IndicatorActor = nullptr;
+
+	SelectedUnits.Reset();
+	SelectedActions.Reset();
+	ActionTally.Reset();
+	HoveredUnit = FStratUnitHandle();
+
+	Super::Deinitialize();
+}
+
+void UStratSelectionSubsystem::Tick(const float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (GetWorld()->GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_StratSelection_Indicators);
+
+	PruneDestroyedUnits();
+	UpdateIndicators();
+}
+
+TStatId UStratSelectionSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UStratSelectionSubsystem, STATGROUP_StratUnits);
+}
+
+bool UStratSelectionSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UStratSelectionSubsystem::SelectUnits(const TArray<FStratUnitHandle>& Units, const bool bAddToSelection)
+{
+	if (!bAddToSelection)
+	{
+		for (const FStratUnitHandle& Unit : SelectedUnits)
+		{
+			UnitSim->SetUnitSelected(Unit, false);
+		}
+		SelectedUnits.Reset();
+		SelectedActions.Reset();
+		ActionTally.Reset();
+	}
+
+	SelectedUnits.Reserve(SelectedUnits.Num() + Units.Num());
+	for (const FStratUnitHandle& Unit : Units)
+	{
+		if (!UnitSim->IsUnitValid(Unit))
+		{
+			continue;
+		}
+
+		if (!SelectedActions.Contains(Unit))
+		{
+			const uint32 Actions = GetUnitActions(Unit);
+			SelectedActions.Add(Unit, Actions);
+			ActionTally.Add(Actions);
+			SelectedUnits.Add(Unit);
+			UnitSim->SetUnitSelected(Unit, true);
+		}
+	}
+
+	NotifySelectionChanged();
+}
+
+void UStratSelectionSubsystem::DeselectUnit(const FStratUnitHandle Unit)
+{
+	uint32 Actions;
+	if (SelectedActions.RemoveAndCopyValue(Unit, Actions))
+	{
+		ActionTally.Remove(Actions);
+		SelectedUnits.Remove(Unit);
+		UnitSim->SetUnitSelected(Unit, false);
+		NotifySelectionChanged();
+	}
+}
+
+void UStratSelectionSubsystem::ClearSelection()
+{
+	if (SelectedUnits.IsEmpty())
+	{
+		return;
+	}
+
+	for (const FStratUnitHandle& Unit : SelectedUnits)
+	{
+		UnitSim->SetUnitSelected(Unit, false);
+	}
+	SelectedUnits.Reset();
+	SelectedActions.Reset();
+	ActionTally.Reset();
+
+	NotifySelectionChanged();
+}
+
+void UStratSelectionSubsystem::SetHoveredUnit(const FStratUnitHandle Unit)
+{
+	HoveredUnit = UnitSim->IsUnitValid(Unit) ? Unit : FStratUnitHandle();
+}
+
+void UStratSelectionSubsystem::ShowMoveMarker(const FVector& Location, const FVector& Facing)
+{
+	if (GetWorld()->GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	const UStratSelectionSettings* Settings = GetDefault<UStratSelectionSettings>();
+	if (!MoveMarkerClass)
+	{
+		MoveMarkerClass = Settings->MoveMarkerClass.LoadSynchronous();
+		if (!MoveMarkerClass)
+		{
+			return;
+		}
+	}
+
+	//~ Spamming orders reuses the same few markers. The pool recycles the oldest once the class is at its cap.
+	if (AStratMoveMarkerActor* Marker = ActorPool->Acquire<AStratMoveMarkerActor>(MoveMarkerClass, FTransform(Location), Settings->MoveMarkerLifetime))
+	{
+		Marker->SetFacing(Facing);
+	}
+}
+
+void UStratSelectionSubsystem::NotifySelectionChanged()
+{
+	OnSelectionChanged.Broadcast();
+
+	if (EventBus)
+	{
+		FStratSelectionChangedEvent Event;
+		Event.NumSelected = SelectedUnits.Num();
+		EventBus->Raise(Event);
+	}
+}
+
+void UStratSelectionSubsystem::PruneDestroyedUnits()
+{
+	const int32 NumRemoved = SelectedUnits.RemoveAll([this](const FStratUnitHandle& Unit)
+	{
+		if (UnitSim->IsUnitValid(Unit))
+		{
+			return false;
+		}
+
+		ActionTally.Remove(SelectedActions.FindAndRemoveChecked(Unit));
+		return true;
+	});
+
+	if (NumRemoved > 0)
+	{
+		NotifySelectionChanged();
+	}
+
+	if (HoveredUnit.IsValid() && !UnitSim->IsUnitValid(HoveredUnit))
+	{
+		HoveredUnit = FStratUnitHandle();
+	}
+}
+
+void UStratSelectionSubsystem::UpdateIndicators()
+{
+	const UStratSelectionSettings* Settings = GetDefault<UStratSelectionSettings>();
+	const FLinearColor Color = GetLocalPlayerColor();
+
+	IndicatorTransforms.Reset();
+	IndicatorData.Reset();
+
+	const FStratSelectionIndicatorData Bright{Color.R, Color.G, Color.B, Settings->BrightIntensity};
+	for (const FStratUnitHandle& Unit : SelectedUnits)
+	{
+		AddIndicator(Unit, Bright);
+	}
+
+	if (HoveredUnit.IsValid() && !SelectedActions.Contains(HoveredUnit))
+	{
+		AddIndicator(HoveredUnit, FStratSelectionIndicatorData{Color.R, Color.G, Color.B, Settings->DimIntensity});
+	}
+
+	//~ Nothing was ever selected. Don't spawn the actor just to show zero instances.
+	if (IndicatorTransforms.IsEmpty() && !IsValid(IndicatorActor))
+	{
+		return;
+	}
+
+	if (AStratSelectionIndicatorActor* Actor = GetOrSpawnIndicatorActor())
+	{
+		Actor->UpdateIndicators(IndicatorTransforms, IndicatorData);
+	}
+
+	SET_DWORD_STAT(STAT_StratSelection_NumIndicators, IndicatorTransforms.Num());
+}
+
+bool UStratSelectionSubsystem::AddIndicator(const FStratUnitHandle& Unit, const FStratSelectionIndicatorData& Data)
+{
+	int32 Row;
+	const FStratUnitChunk* Chunk = UnitSim->FindUnit(Unit, Row);
+	if (!Chunk)
+	{
+		return false;
+	}
+
+	const UStratSelectionSettings* Settings = GetDefault<UStratSelectionSettings>();
+	const float Scale = UnitSim->GetTypeInfo(Chunk->TypeIds[Row]).Radius * Settings->IndicatorRadiusScale / Settings->IndicatorMeshRadius;
+
+	FVector Location(Chunk->Positions[Row]);
+	Location.Z += Settings->IndicatorHeightOffset;
+
+	IndicatorTransforms.Emplace(FQuat::Identity, Location, FVector(Scale, Scale, 1.0));
+	IndicatorData.Add(Data);
+	return true;
+}
+
+int32 UStratSelectionSubsystem::GetActionsOnTarget(const FStratUnitHandle Target) const
+{
+	int32 Row;
+	const FStratUnitChunk* Chunk = UnitSim->FindUnit(Target, Row);
+	if (!Chunk)
+	{
+		return static_cast<int32>(ActionTally.GetUnion() & StratActions::GroundTargetActions);
+	}
+
+	uint32 Actions = ActionTally.GetUnion() & UnitSim->GetTypeInfo(Chunk->TypeIds[Row]).TargetActions;
+	const uint8 LocalFaction = GetLocalFaction();
+	const uint8 TargetFaction = Chunk->Factions[Row];
+	if (!Factions->IsHostile(LocalFaction, TargetFaction))
+	{
+		Actions &= ~StratActions::HostileActions;
+	}
+	if (!Factions->IsAllied(LocalFaction, TargetFaction))
+	{
+		Actions &= ~StratActions::FriendlyActions;
+	}
+	return static_cast<int32>(Actions);
+}
+
+uint32 UStratSelectionSubsystem::GetUnitActions(const FStratUnitHandle& Unit) const
+{
+	int32 Row;
+	const FStratUnitChunk* Chunk = UnitSim->FindUnit(Unit, Row);
+
+	//~ Units the local player can't command can still be selected, to inspect them. They just bring no actions.
+	if (!Chunk || !Factions->CanCommand(GetLocalFaction(), Chunk->Factions[Row]))
+	{
+		return 0;
+	}
+	return UnitSim->GetTypeInfo(Chunk->TypeIds[Row]).Actions;
+}
+
+uint8 UStratSelectionSubsystem::GetLocalFaction() const
+{
+	const APlayerController* PC = GetWorld()->GetFirstPlayerController();
+	const AStratPlayerState* PlayerState = PC ? PC->GetPlayerState<AStratPlayerState>() : nullptr;
+	return PlayerState ? PlayerState->GetFactionId() : 0;
+}
+
+FLinearColor UStratSelectionSubsystem::GetLocalPlayerColor() const
+{
+	const APlayerController* PC = GetWorld()->GetFirstPlayerController();
+	const AStratPlayerState* PlayerState = PC ? PC->GetPlayerState<AStratPlayerState>() : nullptr;
+	return PlayerState ? PlayerState->GetPlayerColor() : FLinearColor::White;
+}
+
+AStratSelectionIndicatorActor* UStratSelectionSubsystem::GetOrSpawnIndicatorActor()
+{
+	if (IsValid(IndicatorActor))
+	{
+		return IndicatorActor;
+	}
+
+	if (bIndicatorMeshMissing)
+	{
+		return nullptr;
+	}
+
+	const UStratSelectionSettings* Settings = GetDefault<UStratSelectionSettings>();
+	UStaticMesh* Mesh = Settings->IndicatorMesh.LoadSynchronous();
+	if (!Mesh)
+	{
+		UE_LOG(LogStratSelection, Warning, TEXT("No selection indicator mesh set in Strat Selection settings. Selected units won't show rings."));
+		bIndicatorMeshMissing = true;
+		return nullptr;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+
+	UMaterialInterface* Material = Settings->IndicatorMaterial.LoadSynchronous();
+	UE_CLOG(!Material, LogStratSelection, Warning, TEXT("No selection indicator material set in Strat Selection settings. Rings use %s's own material, so they won't show player colors unless it reads PerInstanceCustomData."), *GetNameSafe(Mesh));
+
+	IndicatorActor = GetWorld()->SpawnActor<AStratSelectionIndicatorActor>(FTransform::Identity, SpawnParams);
+	if (IndicatorActor)
+	{
+		IndicatorActor->SetIndicatorMesh(Mesh, Material);
+	}
+	return IndicatorActor;
+}
@@ -0,0 +1,132 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StratSelectionIndicatorActor.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Units/StratUnitTypes.h"
+#include "StratSelectionSubsystem.generated.h"
+
+class AStratMoveMarkerActor;
+class UStratActorPoolSubsystem;
+class UStratEventBusSubsystem;
+class UStratFactionSubsystem;
+class UStratUnitSimSubsystem;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogStratSelection, Log, All);
+
+DECLARE_MULTICAST_DELEGATE(FOnStratSelectionChanged);
+
+/**
+ * The local player's unit selection and hovered unit, and the rings that show them.
+ * Every indicator is an instance on one AStratSelectionIndicatorActor, tinted with the local player's color. Selected units
+ * are bright, a hovered unit that isn't selected is dim.
+ *
+ * Also tallies the selection's EStratUnitAction masks as units come and go, so the action menu never walks the selection.
+ */
+UCLASS()
+class UE_RTS_API UStratSelectionSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	//~ Begin UTickableWorldSubsystem interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~ End UTickableWorldSubsystem interface
+
+	/** Selects Units, replacing the current selection unless bAddToSelection. */
+	UFUNCTION(BlueprintCallable, Category=StratSelection)
+	void SelectUnits(const TArray<FStratUnitHandle>& Units, bool bAddToSelection = false);
+
+	UFUNCTION(BlueprintCallable, Category=StratSelection)
+	void DeselectUnit(FStratUnitHandle Unit);
+
+	UFUNCTION(BlueprintCallable, Category=StratSelection)
+	void ClearSelection();
+
+	UFUNCTION(BlueprintPure, Category=StratSelection)
+	bool IsUnitSelected(const FStratUnitHandle Unit) const { return SelectedActions.Contains(Unit); }
+
+	/** In selection order. Units destroyed since drop out on the next tick. */
+	UFUNCTION(BlueprintPure, Category=StratSelection)
+	const TArray<FStratUnitHandle>& GetSelectedUnits() const { return SelectedUnits; }
+
+	/** The unit under the cursor. Pass an invalid handle to clear it. */
+	UFUNCTION(BlueprintCallable, Category=StratSelection)
+	void SetHoveredUnit(FStratUnitHandle Unit);
+
+	UFUNCTION(BlueprintPure, Category=StratSelection)
+	FStratUnitHandle GetHoveredUnit() const { return HoveredUnit; }
+
+	/** EStratUnitAction bits at least one selected unit can perform. */
+	UFUNCTION(BlueprintPure, Category=StratSelection, meta=(Bitmask, BitmaskEnum="/Script/UE_RTS.EStratUnitAction"))
+	int32 GetSelectionActions() const { return static_cast<int32>(ActionTally.GetUnion()); }
+
+	/** EStratUnitAction bits every selected unit can perform. */
+	UFUNCTION(BlueprintPure, Category=StratSelection, meta=(Bitmask, BitmaskEnum="/Script/UE_RTS.EStratUnitAction"))
+	int32 GetCommonSelectionActions() const { return static_cast<int32>(ActionTally.GetIntersection()); }
+
+	/**
+	 * Actions any selected unit can perform on Target, for the action menu and cursor. An invalid Target means open ground.
+	 * Attack is only offered on enemy units, Repair and Garrison only on allied ones, see UStratFactionSubsystem.
+	 */
+	UFUNCTION(BlueprintPure, Category=StratSelection, meta=(Bitmask, BitmaskEnum="/Script/UE_RTS.EStratUnitAction"))
+	int32 GetActionsOnTarget(FStratUnitHandle Target) const;
+
+	/** Marks where an order sent units. Facing is the direction they'll face on arrival, zero for none. */
+	UFUNCTION(BlueprintCallable, Category=StratSelection, meta=(AutoCreateRefTerm="Facing"))
+	void ShowMoveMarker(const FVector& Location, const FVector& Facing);
+
+	FOnStratSelectionChanged OnSelectionChanged;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void NotifySelectionChanged();
+	void PruneDestroyedUnits();
+	void UpdateIndicators();
+	bool AddIndicator(const FStratUnitHandle& Unit, const FStratSelectionIndicatorData& Data);
+	FLinearColor GetLocalPlayerColor() const;
+	uint8 GetLocalFaction() const;
+	uint32 GetUnitActions(const FStratUnitHandle& Unit) const;
+	AStratSelectionIndicatorActor* GetOrSpawnIndicatorActor();
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratUnitSimSubsystem> UnitSim;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratActorPoolSubsystem> ActorPool;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratEventBusSubsystem> EventBus;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratFactionSubsystem> Factions;
+
+	UPROPERTY(Transient)
+	TObjectPtr<AStratSelectionIndicatorActor> IndicatorActor;
+
+	UPROPERTY(Transient)
+	TSubclassOf<AStratMoveMarkerActor> MoveMarkerClass;
+
+	TArray<FStratUnitHandle> SelectedUnits;
+
+	/** Every selected unit with the actions it brought to ActionTally. Its type can't be looked up anymore once it's destroyed. */
+	TMap<FStratUnitHandle, uint32> SelectedActions;
+
+	FStratActionTally ActionTally;
+	FStratUnitHandle HoveredUnit;
+
+	/** Scratch for building indicators each tick, kept to avoid reallocating. */
+	TArray<FTransform> IndicatorTransforms;
+	TArray<FStratSelectionIndicatorData> IndicatorData;
+
+	bool bIndicatorMeshMissing{false};
+};
@@ -0,0 +1,8 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratSoakSettings.h"
+
+UStratSoakSettings::UStratSoakSettings()
+{
+	CategoryName = TEXT("Game");
+}
@@ -0,0 +1,56 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "StratSoakSettings.generated.h"
+
+/**
+ * Defaults for soak runs. Found under Project Settings > Game > Strat Soak. Each one can be overridden on the command line,
+ * see UStratSoakSubsystem.
+ */
+UCLASS(Config=Game, DefaultConfig, meta=(DisplayName="Strat Soak"))
+class UE_RTS_API UStratSoakSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UStratSoakSettings();
+
+	/** Units spawned in total, split evenly between the players. -SoakUnits= */
+	UPROPERTY(Config, EditAnywhere, Category="Soak", meta=(ClampMin="1"))
+	int32 NumUnits{2000};
+
+	/** Scripted players, each with its own faction and base. -SoakPlayers= */
+	UPROPERTY(Config, EditAnywhere, Category="Soak", meta=(ClampMin="2", ClampMax="16"))
+	int32 NumPlayers{4};
+
+	/** Frames to run before writing the report and exiting. -SoakFrames= */
+	UPROPERTY(Config, EditAnywhere, Category="Soak", meta=(ClampMin="1"))
+	int32 NumFrames{9000};
+
+	/** Every player gives all of its units new orders this often. */
+	UPROPERTY(Config, EditAnywhere, Category="Soak", meta=(ClampMin="0.1", Units="s"))
+	float OrderInterval{5.f};
+
+	/** Share of each player's units ordered to attack. The rest move toward the next player's base. */
+	UPROPERTY(Config, EditAnywhere, Category="Soak", meta=(ClampMin="0.0", ClampMax="1.0"))
+	float AttackFraction{0.5f};
+
+	/** Distance of the player bases from the middle of the map. */
+	UPROPERTY(Config, EditAnywhere, Category="Soak", meta=(ClampMin="0.0", Units="cm"))
+	float BaseDistance{20000.f};
+
+	/** Radius units spawn and gather in around their base. */
+	UPROPERTY(Config, EditAnywhere, Category="Soak", meta=(ClampMin="0.0", Units="cm"))
+	float BaseRadius{4000.f};
+
+	/** Seeds spawn spots and orders, so runs are comparable. -SoakSeed= */
+	UPROPERTY(Config, EditAnywhere, Category="Soak")
+	int32 Seed{1};
+
+	/** The run fails, and exits with code 1, when the 99th percentile game thread time is above this. 0 never fails. -SoakMaxP99Ms= */
+	UPROPERTY(Config, EditAnywhere, Category="Soak", meta=(ClampMin="0.0", Units="ms"))
+	float MaxGameThreadP99Ms{0.f};
+};
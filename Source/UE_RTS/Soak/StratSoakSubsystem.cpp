@@ -0,0 +1,350 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratSoakSubsystem.h"
+
+#include "StratSoakSettings.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "HAL/PlatformMemory.h"
+#include "Lockstep/StratLockstepSubsystem.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "Units/StratUnitSimSubsystem.h"
+#include "World/StratPathSubsystem.h"
+#include "World/StratTerrainSubsystem.h"
+
+DEFINE_LOG_CATEGORY(LogStratSoak);
+
+namespace
+{
+	/** Value at Percentile (0-1) of already sorted samples. */
+	float GetPercentile(const TArray<float>& Sorted, const double Percentile)
+	{
+		if (Sorted.IsEmpty())
+		{
+			return 0.f;
+		}
+		const int32 Index = FMath::Clamp(FMath::CeilToInt32(Percentile * Sorted.Num()) - 1, 0, Sorted.Num() - 1);
+		return Sorted[Index];
+	}
+
+	uint64 GetOutBytes(const UWorld* World)
+	{
+		const UNetDriver* NetDriver = World->GetNetDriver();
+		return NetDriver ? static_cast<uint64>(NetDriver->OutTotalBytes) : 0;
+	}
+}
+
+bool UStratSoakSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return Super::ShouldCreateSubsystem(Outer) && FParse::Param(FCommandLine::Get(), TEXT("StratSoak"));
+}
+
+void UStratSoakSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UnitSim = Collection.InitializeDependency<UStratUnitSimSubsystem>();
+}
+
+bool UStratSoakSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UStratSoakSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UStratSoakSubsystem, STATGROUP_StratUnits);
+}
+
+void UStratSoakSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (!UnitSim || InWorld.GetNetMode() == NM_Client)
+	{
+		UE_LOG(LogStratSoak, Warning, TEXT("Soak runs on the server. Ignoring -StratSoak."));
+		return;
+	}
+
+	ReadOptions();
+	Random.Initialize(Options.Seed);
+	SpawnArmies();
+
+	FrameMs.Reserve(Options.NumFrames);
+	GameThreadMs.Reserve(Options.NumFrames);
+
+#if CSV_PROFILER
+	if (!FCsvProfiler::Get()->IsCapturing())
+	{
+		DetailCsvPath = FPaths::ChangeExtension(Options.ReportPath, TEXT("")) + TEXT("_Frames.csv");
+		FCsvProfiler::Get()->BeginCapture(-1, FPaths::GetPath(DetailCsvPath), FPaths::GetCleanFilename(DetailCsvPath));
+	}
+#endif
+
+	StratSystemTiming::Reset();
+	StartTime = FPlatformTime::Seconds();
+	NextOrderTime = InWorld.GetTimeSeconds();
+	StartOutBytes = GetOutBytes(&InWorld);
+	bRunning = true;
+
+	UE_LOG(LogStratSoak, Display, TEXT("Soak started. %d units, %d players, %d frames."), Options.NumUnits, Options.NumPlayers, Options.NumFrames);
+}
+
+void UStratSoakSubsystem::ReadOptions()
+{
+	const UStratSoakSettings* Settings = GetDefault<UStratSoakSettings>();
+	const TCHAR* CommandLine = FCommandLine::Get();
+
+	Options.NumUnits = Settings->NumUnits;
+	Options.NumPlayers = Settings->NumPlayers;
+	Options.NumFrames = Settings->NumFrames;
+	Options.Seed = Settings->Seed;
+	Options.MaxGameThreadP99Ms = Settings->MaxGameThreadP99Ms;
+
+	FParse::Value(CommandLine, TEXT("SoakUnits="), Options.NumUnits);
+	FParse::Value(CommandLine, TEXT("SoakPlayers="), Options.NumPlayers);
+	FParse::Value(CommandLine, TEXT("SoakFrames="), Options.NumFrames);
+	FParse::Value(CommandLine, TEXT("SoakSeed="), Options.Seed);
+	FParse::Value(CommandLine, TEXT("SoakMaxP99Ms="), Options.MaxGameThreadP99Ms);
+
+	Options.NumUnits = FMath::Max(1, Options.NumUnits);
+	Options.NumPlayers = FMath::Clamp(Options.NumPlayers, 2, 16);
+	Options.NumFrames = FMath::Max(1, Options.NumFrames);
+
+	if (!FParse::Value(CommandLine, TEXT("SoakCsv="), Options.ReportPath))
+	{
+		Options.ReportPath = FPaths::ProfilingDir() / TEXT("Soak") / FString::Printf(TEXT("Soak_%s.csv"), *FDateTime::Now().ToString());
+	}
+}
+
+FVector UStratSoakSubsystem::RandomPointNear(const FVector& Center, const float Radius)
+{
+	//~ Square root spreads points evenly over the disc instead of bunching them at the middle.
+	const double Angle = Random.FRandRange(0.f, UE_TWO_PI);
+	const double Distance = Radius * FMath::Sqrt(Random.FRand());
+	FVector Point(Center.X + FMath::Cos(Angle) * Distance, Center.Y + FMath::Sin(Angle) * Distance, 0.0);
+
+	if (const UStratTerrainSubsystem* Terrain = GetWorld()->GetSubsystem<UStratTerrainSubsystem>(); Terrain && Terrain->IsReady())
+	{
+		Point.Z = Terrain->GetTerrainHeight(Point);
+	}
+	return Point;
+}
+
+void UStratSoakSubsystem::SpawnArmies()
+{
+	const UStratSoakSettings* Settings = GetDefault<UStratSoakSettings>();
+
+	//~ Anything that can move. Structures would just stand at the bases.
+	TArray<uint16> TypeIds;
+	const TConstArrayView<FStratUnitTypeInfo> TypeInfos = UnitSim->GetTypeInfos();
+	for (int32 TypeId = 0; TypeId < TypeInfos.Num(); ++TypeId)
+	{
+		if (TypeInfos[TypeId].Archetype != EStratUnitArchetype::Structure)
+		{
+			TypeIds.Add(static_cast<uint16>(TypeId));
+		}
+	}
+
+	if (TypeIds.IsEmpty())
+	{
+		UE_LOG(LogStratSoak, Error, TEXT("No movable unit types in UStratUnitSettings::UnitDefinitions. Nothing to spawn."));
+		return;
+	}
+
+	FVector MapCenter = FVector::ZeroVector;
+	if (const UStratTerrainSubsystem* Terrain = GetWorld()->GetSubsystem<UStratTerrainSubsystem>(); Terrain && Terrain->IsReady())
+	{
+		MapCenter = FVector(Terrain->GetHeightGrid().GetBounds().GetCenter(), 0.0);
+	}
+
+	Players.SetNum(Options.NumPlayers);
+	for (int32 PlayerIndex = 0; PlayerIndex < Players.Num(); ++PlayerIndex)
+	{
+		FPlayer& Player = Players[PlayerIndex];
+		const double Angle = UE_TWO_PI * PlayerIndex / Players.Num();
+		Player.Faction = static_cast<uint8>(PlayerIndex + 1);
+		Player.Base = MapCenter + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.0) * Settings->BaseDistance;
+
+		const int32 NumUnits = Options.NumUnits / Players.Num() + (PlayerIndex < Options.NumUnits % Players.Num() ? 1 : 0);
+		Player.Units.Reserve(NumUnits);
+		for (int32 Index = 0; Index < NumUnits; ++Index)
+		{
+			const uint16 TypeId = TypeIds[Index % TypeIds.Num()];
+			const FStratUnitHandle Unit = UnitSim->SpawnUnitOfType(TypeId, RandomPointNear(Player.Base, Settings->BaseRadius), Player.Faction);
+			if (Unit.IsValid())
+			{
+				Player.Units.Add(Unit);
+			}
+		}
+	}
+}
+
+void UStratSoakSubsystem::IssueOrders()
+{
+	const UStratSoakSettings* Settings = GetDefault<UStratSoakSettings>();
+	UStratLockstepSubsystem* Lockstep = UnitSim->IsLockstep() ? GetWorld()->GetSubsystem<UStratLockstepSubsystem>() : nullptr;
+	UStratPathSubsystem* Paths = UnitSim->IsLockstep() ? nullptr : GetWorld()->GetSubsystem<UStratPathSubsystem>();
+
+	TArray<FStratUnitHandle> Attackers;
+	TArray<FStratUnitHandle> Movers;
+	for (int32 PlayerIndex = 0; PlayerIndex < Players.Num(); ++PlayerIndex)
+	{
+		FPlayer& Player = Players[PlayerIndex];
+		Player.Units.RemoveAllSwap([this](const FStratUnitHandle& Unit) { return !UnitSim->IsUnitValid(Unit); }, EAllowShrinking::No);
+
+		//~ Everyone goes after the next player around the circle, so every base sees a fight.
+		const FPlayer& Enemy = Players[(PlayerIndex + 1) % Players.Num()];
+		const FStratUnitHandle Target = Enemy.Units.IsEmpty() ? FStratUnitHandle() : Enemy.Units[Random.RandHelper(Enemy.Units.Num())];
+		const FVector Destination = RandomPointNear(Enemy.Base, Settings->BaseRadius);
+
+		Attackers.Reset();
+		Movers.Reset();
+		for (const FStratUnitHandle& Unit : Player.Units)
+		{
+			if (Target.IsValid() && Random.FRand() < Settings->AttackFraction)
+			{
+				Attackers.Add(Unit);
+			}
+			else
+			{
+				Movers.Add(Unit);
+			}
+		}
+
+		if (Lockstep)
+		{
+			if (!Attackers.IsEmpty())
+			{
+				Lockstep->IssueAttack(Attackers, Target);
+			}
+			if (!Movers.IsEmpty())
+			{
+				Lockstep->IssueMove(Movers, Destination);
+			}
+			continue;
+		}
+
+		FStratUnitOrder Attack;
+		Attack.Type = EStratUnitOrderType::Attack;
+		Attack.TargetUnit = Target;
+		for (const FStratUnitHandle& Unit : Attackers)
+		{
+			UnitSim->IssueOrder(Unit, Attack);
+		}
+
+		if (Paths)
+		{
+			Paths->IssuePathedMoves(Movers, Destination);
+		}
+		else
+		{
+			for (const FStratUnitHandle& Unit : Movers)
+			{
+				UnitSim->IssueMoveOrder(Unit, Destination);
+			}
+		}
+	}
+}
+
+void UStratSoakSubsystem::Tick(const float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!bRunning)
+	{
+		return;
+	}
+
+	FrameMs.Add(DeltaTime * 1000.f);
+	GameThreadMs.Add(static_cast<float>(FPlatformTime::ToMilliseconds(GGameThreadTime)));
+	PeakActorCount = FMath::Max(PeakActorCount, GetWorld()->GetActorCount());
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	if (Now >= NextOrderTime)
+	{
+		NextOrderTime = Now + GetDefault<UStratSoakSettings>()->OrderInterval;
+		IssueOrders();
+	}
+
+	if (FrameMs.Num() >= Options.NumFrames)
+	{
+		Finish();
+	}
+}
+
+void UStratSoakSubsystem::Finish()
+{
+	bRunning = false;
+
+#if CSV_PROFILER
+	if (!DetailCsvPath.IsEmpty())
+	{
+		FCsvProfiler::Get()->EndCapture();
+	}
+#endif
+
+	TArray<float> SortedFrameMs = FrameMs;
+	SortedFrameMs.Sort();
+
+	//~ The first frame's game thread time includes spawning everything. Leave it out.
+	TArray<float> SortedGameThreadMs(GameThreadMs.GetData() + 1, FMath::Max(0, GameThreadMs.Num() - 1));
+	SortedGameThreadMs.Sort();
+
+	const float GameThreadP99Ms = GetPercentile(SortedGameThreadMs, 0.99);
+	const bool bPassed = Options.MaxGameThreadP99Ms <= 0.f || GameThreadP99Ms <= Options.MaxGameThreadP99Ms;
+
+	if (!WriteReport(SortedFrameMs, SortedGameThreadMs, bPassed))
+	{
+		UE_LOG(LogStratSoak, Error, TEXT("Couldn't write the soak report to %s."), *Options.ReportPath);
+	}
+
+	UE_LOG(LogStratSoak, Display, TEXT("Soak %s. Game thread p99 %.2f ms (limit %.2f ms). Report: %s"),
+		bPassed ? TEXT("passed") : TEXT("FAILED"), GameThreadP99Ms, Options.MaxGameThreadP99Ms, *Options.ReportPath);
+
+	FPlatformMisc::RequestExitWithStatus(false, bPassed ? 0 : 1);
+}
+
+bool UStratSoakSubsystem::WriteReport(const TArray<float>& SortedFrameMs, const TArray<float>& SortedGameThreadMs, const bool bPassed) const
+{
+	int32 NumAlive = 0;
+	for (const FPlayer& Player : Players)
+	{
+		for (const FStratUnitHandle& Unit : Player.Units)
+		{
+			NumAlive += UnitSim->IsUnitValid(Unit) ? 1 : 0;
+		}
+	}
+
+	const double Duration = FPlatformTime::Seconds() - StartTime;
+	const uint64 OutBytes = GetOutBytes(GetWorld()) - StartOutBytes;
+	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+
+	FString Report = TEXT("Map,Units,Players,Frames,Seconds,")
+		TEXT("FrameMsP50,FrameMsP90,FrameMsP99,FrameMsMax,")
+		TEXT("GameThreadMsP50,GameThreadMsP90,GameThreadMsP99,GameThreadMsMax,")
+		TEXT("SentBytes,SentKBps,PeakActors,UnitsAlive,PeakUsedPhysicalMB,PeakUsedVirtualMB,FrameCsv,Passed");
+	for (int32 System = 0; System < static_cast<int32>(EStratTimedSystem::Count); ++System)
+	{
+		Report += FString::Printf(TEXT(",%sMsTotal"), StratSystemTiming::GetName(static_cast<EStratTimedSystem>(System)));
+	}
+	Report += TEXT("\n");
+
+	Report += FString::Printf(TEXT("%s,%d,%d,%d,%.1f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%llu,%.1f,%d,%d,%.1f,%.1f,%s,%d"),
+		*GetWorld()->GetMapName(), Options.NumUnits, Options.NumPlayers, FrameMs.Num(), Duration,
+		GetPercentile(SortedFrameMs, 0.5), GetPercentile(SortedFrameMs, 0.9), GetPercentile(SortedFrameMs, 0.99), GetPercentile(SortedFrameMs, 1.0),
+		GetPercentile(SortedGameThreadMs, 0.5), GetPercentile(SortedGameThreadMs, 0.9), GetPercentile(SortedGameThreadMs, 0.99), GetPercentile(SortedGameThreadMs, 1.0),
+		OutBytes, Duration > 0.0 ? OutBytes / 1024.0 / Duration : 0.0, PeakActorCount, NumAlive,
+		MemoryStats.PeakUsedPhysical / (1024.0 * 1024.0), MemoryStats.PeakUsedVirtual / (1024.0 * 1024.0),
+		*FPaths::GetCleanFilename(DetailCsvPath), bPassed ? 1 : 0);
+	for (int32 System = 0; System < static_cast<int32>(EStratTimedSystem::Count); ++System)
+	{
+		Report += FString::Printf(TEXT(",%.1f"), StratSystemTiming::GetTotalMs(static_cast<EStratTimedSystem>(System)));
+	}
+	Report += TEXT("\n");
+
+	return FFileHelper::SaveStringToFile(Report, *Options.ReportPath);
+}
@@ -0,0 +1,96 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Units/StratUnitTypes.h"
+#include "StratSoakSubsystem.generated.h"
+
+class UStratUnitSimSubsystem;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogStratSoak, Log, All);
+
+/**
+ * Headless load test. Only exists when the command line has -StratSoak, e.g.
+ *
+ *   UE_RTSServer /Game/DontShip/Maps/Proto_01/PrototypeLevel_01 -StratSoak -SoakUnits=5000 -SoakFrames=18000 -log
+ *
+ * Spawns UStratSoakSettings::NumUnits split between scripted players, orders them to move and attack each other every
+ * OrderInterval, and after NumFrames writes a one row CSV report and exits. The exit code is 1 when the game thread's 99th
+ * percentile is over MaxGameThreadP99Ms, so a build step can gate on it.
+ *
+ * The report has frame and game thread time percentiles, bytes sent by the net driver, actor counts, peak memory and each
+ * system's total game thread time (StratSystemTiming). Per frame timings go to a CSV profiler capture next to it.
+ * Connect clients to include replication.
+ *
+ * Other overrides: -SoakPlayers= -SoakSeed= -SoakMaxP99Ms= -SoakCsv=<report path>.
+ */
+UCLASS()
+class UE_RTS_API UStratSoakSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	//~ End USubsystem interface
+
+	//~ Begin UWorldSubsystem interface
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	//~ End UWorldSubsystem interface
+
+	//~ Begin UTickableWorldSubsystem interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~ End UTickableWorldSubsystem interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** UStratSoakSettings with the command line applied. */
+	struct FOptions
+	{
+		int32 NumUnits{0};
+		int32 NumPlayers{0};
+		int32 NumFrames{0};
+		int32 Seed{0};
+		float MaxGameThreadP99Ms{0.f};
+		FString ReportPath;
+	};
+
+	struct FPlayer
+	{
+		uint8 Faction{0};
+		FVector Base{ForceInit};
+		TArray<FStratUnitHandle> Units;
+	};
+
+	void ReadOptions();
+	void SpawnArmies();
+	void IssueOrders();
+	void Finish();
+	bool WriteReport(const TArray<float>& SortedFrameMs, const TArray<float>& SortedGameThreadMs, bool bPassed) const;
+
+	/** Ground point near Center, within Radius. */
+	FVector RandomPointNear(const FVector& Center, float Radius);
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratUnitSimSubsystem> UnitSim;
+
+	FOptions Options;
+	TArray<FPlayer> Players;
+	FRandomStream Random;
+
+	/** Per frame samples, in milliseconds. */
+	TArray<float> FrameMs;
+	TArray<float> GameThreadMs;
+
+	double StartTime{0.0};
+	double NextOrderTime{0.0};
+	uint64 StartOutBytes{0};
+	int32 PeakActorCount{0};
+	FString DetailCsvPath;
+	bool bRunning{false};
+};
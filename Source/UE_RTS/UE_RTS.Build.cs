@@ -8,9 +8,9 @@ public class UE_RTS : ModuleRules
 	{
 		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 	
-		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "EnhancedInput" });
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "EnhancedInput", "DeveloperSettings" });
 
-		PrivateDependencyModuleNames.AddRange(new string[] { "ModularGameplayActors", "SandCoreLogTools" });
+		PrivateDependencyModuleNames.AddRange(new string[] { "ModularGameplay", "ModularGameplayActors", "NavigationSystem", "NetCore", "SandCoreLogTools", "StateTreeModule" });
 
 		// Uncomment if you are using Slate UI
 		// PrivateDependencyModuleNames.AddRange(new string[] { "Slate", "SlateCore" });
@@ -0,0 +1,184 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratRosterListModel.h"
+
+#include "Algo/BinarySearch.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Player/StratPlayerState.h"
+#include "Units/StratUnitRosterComponent.h"
+
+namespace
+{
+	bool RowLess(const FStratRosterRow& A, const FStratRosterRow& B)
+	{
+		return A.TypeId != B.TypeId ? A.TypeId < B.TypeId : A.Unit.GetValue() < B.Unit.GetValue();
+	}
+
+	FStratRosterRow MakeRow(const FStratRosterEntry& Entry)
+	{
+		FStratRosterRow Row;
+		Row.Unit = Entry.Unit;
+		Row.TypeId = Entry.TypeId;
+		Row.HealthFraction = Entry.GetHealthFraction();
+		return Row;
+	}
+}
+
+UStratRosterListModel* UStratRosterListModel::CreateRosterListModel(UObject* WorldContextObject, const uint8 Faction)
+{
+	UStratRosterListModel* Model = NewObject<UStratRosterListModel>(WorldContextObject);
+	Model->Faction = Faction;
+	Model->TryBindRoster();
+	return Model;
+}
+
+void UStratRosterListModel::BeginDestroy()
+{
+	if (UStratUnitRosterComponent* RosterComp = Roster.Get())
+	{
+		RosterComp->OnRosterChanged.Remove(RosterChangedHandle);
+	}
+
+	Super::BeginDestroy();
+}
+
+void UStratRosterListModel::SetVisibleRange(const int32 FirstRow, const int32 NumRows)
+{
+	VisibleFirst = FMath::Max(FirstRow, 0);
+	VisibleNum = FMath::Max(NumRows, 0);
+
+	if (!Roster.IsValid())
+	{
+		TryBindRoster();
+	}
+}
+
+FStratRosterRow UStratRosterListModel::GetRow(const int32 Index) const
+{
+	return Rows.IsValidIndex(Index) ? Rows[Index] : FStratRosterRow();
+}
+
+bool UStratRosterListModel::TryBindRoster()
+{
+	const UWorld* World = GetWorld();
+	const APlayerController* PC = World ? World->GetFirstPlayerController() : nullptr;
+	const AStratPlayerState* Player = PC ? PC->GetPlayerState<AStratPlayerState>() : nullptr;
+	UStratUnitRosterComponent* RosterComp = Player ? Player->GetUnitRoster() : nullptr;
+	if (!RosterComp)
+	{
+		return false;
+	}
+
+	Roster = RosterComp;
+	RosterChangedHandle = RosterComp->OnRosterChanged.AddUObject(this, &ThisClass::OnRosterChanged);
+
+	//~ Everything already in the roster, as one sort instead of an insert per row.
+	Rows.Reset();
+	for (const FStratRosterEntry& Entry : RosterComp->GetEntries())
+	{
+		if (Entry.Faction == Faction)
+		{
+			Rows.Add(MakeRow(Entry));
+		}
+	}
+	Rows.Sort(RowLess);
+
+	OnNumRowsChanged.Broadcast(Rows.Num());
+	OnVisibleRowsChanged.Broadcast(VisibleFirst, FMath::Max(FMath::Min(VisibleNum, Rows.Num() - VisibleFirst), 0));
+	return true;
+}
+
+void UStratRosterListModel::OnRosterChanged(const FStratRosterChangeSet& Changes)
+{
+	const int32 OldNumRows = Rows.Num();
+
+	//~ Inserts and removes shift every row after them. Health changes only touch their own row.
+	int32 ShiftedFrom = MAX_int32;
+	int32 ChangedMin = MAX_int32;
+	int32 ChangedMax = INDEX_NONE;
+
+	const auto RemoveRow = [this, &ShiftedFrom](const FStratRosterEntry& Entry)
+	{
+		const int32 Index = FindRow(Entry.Unit, Entry.TypeId);
+		if (Index != INDEX_NONE)
+		{
+			Rows.RemoveAt(Index, EAllowShrinking::No);
+			ShiftedFrom = FMath::Min(ShiftedFrom, Index);
+		}
+	};
+
+	const auto InsertRow = [this, &ShiftedFrom](const FStratRosterEntry& Entry)
+	{
+		const int32 Index = FindInsertIndex(Entry.Unit, Entry.TypeId);
+		Rows.Insert(MakeRow(Entry), Index);
+		ShiftedFrom = FMath::Min(ShiftedFrom, Index);
+	};
+
+	for (const FStratRosterEntry& Entry : Changes.Removed)
+	{
+		if (Entry.Faction == Faction)
+		{
+			RemoveRow(Entry);
+		}
+	}
+
+	for (const FStratRosterEntry& Entry : Changes.Added)
+	{
+		if (Entry.Faction == Faction)
+		{
+			InsertRow(Entry);
+		}
+	}
+
+	for (const FStratRosterEntry& Entry : Changes.Changed)
+	{
+		const int32 Index = FindRow(Entry.Unit, Entry.TypeId);
+		if (Index == INDEX_NONE)
+		{
+			//~ Changed hands to this faction.
+			if (Entry.Faction == Faction)
+			{
+				InsertRow(Entry);
+			}
+		}
+		else if (Entry.Faction != Faction)
+		{
+			RemoveRow(Entry);
+		}
+		else
+		{
+			Rows[Index].HealthFraction = Entry.GetHealthFraction();
+			ChangedMin = FMath::Min(ChangedMin, Index);
+			ChangedMax = FMath::Max(ChangedMax, Index);
+		}
+	}
+
+	if (Rows.Num() != OldNumRows)
+	{
+		OnNumRowsChanged.Broadcast(Rows.Num());
+	}
+
+	//~ Row indices above are from different moments of the batch, so this can over report but never misses a row.
+	const int32 VisibleEnd = FMath::Min(VisibleFirst + VisibleNum, FMath::Max(Rows.Num(), OldNumRows));
+	const int32 DirtyFirst = FMath::Max(FMath::Min(ShiftedFrom, ChangedMin), VisibleFirst);
+	const int32 DirtyEnd = FMath::Min(ShiftedFrom != MAX_int32 ? VisibleEnd : ChangedMax + 1, VisibleEnd);
+	if (DirtyFirst < DirtyEnd)
+	{
+		OnVisibleRowsChanged.Broadcast(DirtyFirst, DirtyEnd - DirtyFirst);
+	}
+}
+
+int32 UStratRosterListModel::FindRow(const FStratUnitHandle& Unit, const int32 TypeId) const
+{
+	const int32 Index = FindInsertIndex(Unit, TypeId);
+	return Rows.IsValidIndex(Index) && Rows[Index].Unit == Unit ? Index : INDEX_NONE;
+}
+
+int32 UStratRosterListModel::FindInsertIndex(const FStratUnitHandle& Unit, const int32 TypeId) const
+{
+	FStratRosterRow Key;
+	Key.Unit = Unit;
+	Key.TypeId = TypeId;
+	return Algo::LowerBound(Rows, Key, RowLess);
+}
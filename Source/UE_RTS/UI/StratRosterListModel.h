@@ -0,0 +1,87 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "Units/StratUnitTypes.h"
+#include "StratRosterListModel.generated.h"
+
+class UStratUnitRosterComponent;
+struct FStratRosterChangeSet;
+
+USTRUCT(BlueprintType)
+struct FStratRosterRow
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category=StratRoster)
+	FStratUnitHandle Unit;
+
+	/** Index in UStratUnitSettings::UnitDefinitions. */
+	UPROPERTY(BlueprintReadOnly, Category=StratRoster)
+	int32 TypeId{0};
+
+	/** Coarse, in FStratRosterEntry::NumHealthBuckets steps. */
+	UPROPERTY(BlueprintReadOnly, Category=StratRoster)
+	float HealthFraction{1.f};
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnStratRosterRowsChanged, int32, FirstRow, int32, NumRows);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnStratRosterNumRowsChanged, int32, NumRows);
+
+/**
+ * One faction's roster as a list for UI, grouped by unit type. The local player's roster only holds factions they command. Widgets tell the model which rows are on screen and only hear
+ * about changes to those, so a roster list or portrait grid only rebuilds the few widgets that show a changed unit.
+ *
+ * Follows UStratUnitRosterComponent, one update per roster batch.
+ */
+UCLASS(BlueprintType)
+class UE_RTS_API UStratRosterListModel : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	UFUNCTION(BlueprintCallable, Category=StratRoster, meta=(WorldContext="WorldContextObject"))
+	static UStratRosterListModel* CreateRosterListModel(UObject* WorldContextObject, uint8 Faction);
+
+	//~ Begin UObject interface
+	virtual void BeginDestroy() override;
+	//~ End UObject interface
+
+	/** The rows on screen. Row changes outside of them aren't broadcast. */
+	UFUNCTION(BlueprintCallable, Category=StratRoster)
+	void SetVisibleRange(int32 FirstRow, int32 NumRows);
+
+	UFUNCTION(BlueprintPure, Category=StratRoster)
+	int32 GetNumRows() const { return Rows.Num(); }
+
+	UFUNCTION(BlueprintPure, Category=StratRoster)
+	FStratRosterRow GetRow(int32 Index) const;
+
+	/** Rows on screen that now show something else. Already clipped to the visible range. */
+	UPROPERTY(BlueprintAssignable, Category=StratRoster)
+	FOnStratRosterRowsChanged OnVisibleRowsChanged;
+
+	/** For sizing the scroll area. */
+	UPROPERTY(BlueprintAssignable, Category=StratRoster)
+	FOnStratRosterNumRowsChanged OnNumRowsChanged;
+
+protected:
+	/** Hooks up to the local player's roster. The player state can replicate after the UI is made, so this is retried. */
+	bool TryBindRoster();
+	void OnRosterChanged(const FStratRosterChangeSet& Changes);
+
+	int32 FindRow(const FStratUnitHandle& Unit, int32 TypeId) const;
+	int32 FindInsertIndex(const FStratUnitHandle& Unit, int32 TypeId) const;
+
+	TWeakObjectPtr<UStratUnitRosterComponent> Roster;
+	FDelegateHandle RosterChangedHandle;
+
+	/** Sorted by type, then handle. */
+	TArray<FStratRosterRow> Rows;
+
+	int32 VisibleFirst{0};
+	int32 VisibleNum{0};
+	uint8 Faction{0};
+};
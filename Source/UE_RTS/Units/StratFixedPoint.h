@@ -0,0 +1,101 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * 24.8 fixed point number. Integer math gives the same result on every CPU and compiler, which floats don't,
+ * so the lockstep simulation runs on these. Covers +-83 km at 1/256 cm.
+ */
+struct FStratFixed
+{
+	static constexpr int32 FractionBits = 8;
+	static constexpr int32 One = 1 << FractionBits;
+
+	int32 Raw{0};
+
+	static FStratFixed FromRaw(const int64 InRaw) { FStratFixed Result; Result.Raw = static_cast<int32>(InRaw); return Result; }
+	static FStratFixed FromInt(const int32 Value) { return FromRaw(static_cast<int64>(Value) << FractionBits); }
+
+	/** Only for converting config and input once. Never feed simulation results back through floats. */
+	static FStratFixed FromFloat(const float Value) { return FromRaw(FMath::RoundToInt64(static_cast<double>(Value) * One)); }
+
+	float ToFloat() const { return static_cast<float>(Raw) / One; }
+
+	FStratFixed operator+(const FStratFixed Other) const { return FromRaw(static_cast<int64>(Raw) + Other.Raw); }
+	FStratFixed operator-(const FStratFixed Other) const { return FromRaw(static_cast<int64>(Raw) - Other.Raw); }
+	FStratFixed operator-() const { return FromRaw(-static_cast<int64>(Raw)); }
+	FStratFixed operator*(const FStratFixed Other) const { return FromRaw((static_cast<int64>(Raw) * Other.Raw) >> FractionBits); }
+	FStratFixed operator/(const FStratFixed Other) const { return FromRaw((static_cast<int64>(Raw) << FractionBits) / Other.Raw); }
+
+	bool operator==(const FStratFixed Other) const { return Raw == Other.Raw; }
+	bool operator!=(const FStratFixed Other) const { return Raw != Other.Raw; }
+	bool operator<(const FStratFixed Other) const { return Raw < Other.Raw; }
+	bool operator<=(const FStratFixed Other) const { return Raw <= Other.Raw; }
+	bool operator>(const FStratFixed Other) const { return Raw > Other.Raw; }
+	bool operator>=(const FStratFixed Other) const { return Raw >= Other.Raw; }
+};
+
+namespace StratFixed
+{
+	/** Floor of the square root. Bit by bit, so it's exact and identical everywhere. */
+	inline uint64 SqrtInt(uint64 Value)
+	{
+		uint64 Result = 0;
+		uint64 Bit = 1ull << 62;
+		while (Bit > Value)
+		{
+			Bit >>= 2;
+		}
+
+		while (Bit != 0)
+		{
+			if (Value >= Result + Bit)
+			{
+				Value -= Result + Bit;
+				Result = (Result >> 1) + Bit;
+			}
+			else
+			{
+				Result >>= 1;
+			}
+			Bit >>= 2;
+		}
+		return Result;
+	}
+}
+
+struct FStratFixedVector
+{
+	FStratFixed X;
+	FStratFixed Y;
+	FStratFixed Z;
+
+	static FStratFixedVector FromIntCm(const FIntVector& Cm) { return {FStratFixed::FromInt(Cm.X), FStratFixed::FromInt(Cm.Y), FStratFixed::FromInt(Cm.Z)}; }
+	static FStratFixedVector FromVector(const FVector3f& V) { return {FStratFixed::FromFloat(V.X), FStratFixed::FromFloat(V.Y), FStratFixed::FromFloat(V.Z)}; }
+	FVector3f ToVector3f() const { return FVector3f(X.ToFloat(), Y.ToFloat(), Z.ToFloat()); }
+
+	FStratFixedVector operator+(const FStratFixedVector& Other) const { return {X + Other.X, Y + Other.Y, Z + Other.Z}; }
+	FStratFixedVector operator-(const FStratFixedVector& Other) const { return {X - Other.X, Y - Other.Y, Z - Other.Z}; }
+	bool operator==(const FStratFixedVector& Other) const { return X == Other.X && Y == Other.Y && Z == Other.Z; }
+
+	/** Length in raw units. Squares are summed in 64 bits so map sized distances don't overflow. */
+	FStratFixed Size() const
+	{
+		const uint64 SizeSquared = static_cast<uint64>(static_cast<int64>(X.Raw) * X.Raw)
+			+ static_cast<uint64>(static_cast<int64>(Y.Raw) * Y.Raw)
+			+ static_cast<uint64>(static_cast<int64>(Z.Raw) * Z.Raw);
+		return FStratFixed::FromRaw(static_cast<int64>(StratFixed::SqrtInt(SizeSquared)));
+	}
+
+	/** Scales to Length along this direction, given this vector's own length. Rounds toward zero. */
+	FStratFixedVector ScaledTo(const FStratFixed Length, const FStratFixed CurrentSize) const
+	{
+		auto Scale = [Length, CurrentSize](const FStratFixed Component)
+		{
+			return FStratFixed::FromRaw(static_cast<int64>(Component.Raw) * Length.Raw / CurrentSize.Raw);
+		};
+		return {Scale(X), Scale(Y), Scale(Z)};
+	}
+};
@@ -0,0 +1,136 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratJoinSnapshotComponent.h"
+
+#include "StratJoinSnapshotSettings.h"
+#include "StratJoinSnapshotSubsystem.h"
+#include "StratUnitTypes.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Player/StratPlayerState.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Join Snapshot Bytes Sent"), STAT_StratUnits_JoinSnapshotBytesSent, STATGROUP_StratUnits);
+
+UStratJoinSnapshotComponent::UStratJoinSnapshotComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	SetIsReplicatedByDefault(true);
+}
+
+void UStratJoinSnapshotComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	//~ Only the server sends, and only when the subsystem exists, i.e. join snapshots are on and this isn't lockstep.
+	//~ Regions are held from the start, so none replicate to the player before the snapshot does.
+	UStratJoinSnapshotSubsystem* JoinSnapshot = GetWorld()->GetSubsystem<UStratJoinSnapshotSubsystem>();
+	const bool bSends = GetOwner()->HasAuthority() && JoinSnapshot;
+	if (bSends)
+	{
+		JoinSnapshot->HoldRegions(GetPlayerState<APlayerState>());
+	}
+	SetComponentTickEnabled(bSends);
+}
+
+void UStratJoinSnapshotComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (GetOwner()->HasAuthority())
+	{
+		FinishSnapshot();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UStratJoinSnapshotComponent::FinishSnapshot()
+{
+	//~ Letting go lets the subsystem's cached copy be the only one left.
+	Snapshot.Reset();
+	SetComponentTickEnabled(false);
+
+	if (UStratJoinSnapshotSubsystem* JoinSnapshot = GetWorld()->GetSubsystem<UStratJoinSnapshotSubsystem>())
+	{
+		JoinSnapshot->ReleaseRegions(GetPlayerState<APlayerState>());
+	}
+}
+
+void UStratJoinSnapshotComponent::TickComponent(const float DeltaTime, const ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	//~ The controller shows up a few frames after the player state. A listen server's own player already has every unit.
+	const AStratPlayerState* PS = GetPlayerState<AStratPlayerState>();
+	const APlayerController* PC = PS ? PS->GetPlayerController() : nullptr;
+	if (!PC)
+	{
+		return;
+	}
+	if (PC->IsLocalController())
+	{
+		FinishSnapshot();
+		return;
+	}
+
+	if (!Snapshot)
+	{
+		UStratJoinSnapshotSubsystem* JoinSnapshot = GetWorld()->GetSubsystem<UStratJoinSnapshotSubsystem>();
+		Snapshot = JoinSnapshot ? JoinSnapshot->GetSnapshot() : nullptr;
+		if (!Snapshot || Snapshot->IsEmpty())
+		{
+			FinishSnapshot();
+			return;
+		}
+	}
+
+	const UStratJoinSnapshotSettings* Settings = GetDefault<UStratJoinSnapshotSettings>();
+	const int32 TotalBytes = Snapshot->Num();
+	while (SentBytes < TotalBytes && SentBytes - AckedBytes < Settings->MaxBytesInFlight)
+	{
+		const int32 PieceBytes = FMath::Min(Settings->PieceSize, TotalBytes - SentBytes);
+		Client_ReceiveSnapshotPiece(TotalBytes, SentBytes, TArray<uint8>(Snapshot->GetData() + SentBytes, PieceBytes));
+		SentBytes += PieceBytes;
+
+		INC_DWORD_STAT_BY(STAT_StratUnits_JoinSnapshotBytesSent, PieceBytes);
+	}
+}
+
+void UStratJoinSnapshotComponent::Client_ReceiveSnapshotPiece_Implementation(const int32 TotalBytes, const int32 Offset, const TArray<uint8>& Piece)
+{
+	//~ Reliable RPCs arrive in order, so a gap means a new snapshot started. Take it from its first piece.
+	if (Offset == 0)
+	{
+		Received.Reset(TotalBytes);
+	}
+	if (Offset != Received.Num() || TotalBytes <= 0 || Offset + Piece.Num() > TotalBytes)
+	{
+		return;
+	}
+
+	Received.Append(Piece);
+	Server_AckSnapshot(Received.Num());
+
+	if (Received.Num() == TotalBytes)
+	{
+		if (UStratJoinSnapshotSubsystem* JoinSnapshot = GetWorld()->GetSubsystem<UStratJoinSnapshotSubsystem>())
+		{
+			JoinSnapshot->ApplySnapshot(MoveTemp(Received));
+		}
+		Received.Empty();
+	}
+}
+
+void UStratJoinSnapshotComponent::Server_AckSnapshot_Implementation(const int32 BytesReceived)
+{
+	if (!Snapshot)
+	{
+		return;
+	}
+
+	AckedBytes = FMath::Clamp(BytesReceived, AckedBytes, SentBytes);
+	if (AckedBytes == Snapshot->Num())
+	{
+		FinishSnapshot();
+	}
+}
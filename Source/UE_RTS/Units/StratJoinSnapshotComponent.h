@@ -0,0 +1,45 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/PlayerStateComponent.h"
+#include "StratJoinSnapshotComponent.generated.h"
+
+/**
+ * Streams a join snapshot from UStratJoinSnapshotSubsystem to the owning player when they join or reconnect.
+ * The snapshot goes in reliable pieces, with at most UStratJoinSnapshotSettings::MaxBytesInFlight unacknowledged at once,
+ * so a join can't flood the connection. Region proxies are held back from the player until it's all acknowledged.
+ * Lives on AStratPlayerState, so client RPCs reach exactly the one joining player.
+ */
+UCLASS(ClassGroup=(Strat), meta=(BlueprintSpawnableComponent, PrioritizeCategories="User"))
+class UE_RTS_API UStratJoinSnapshotComponent : public UPlayerStateComponent
+{
+	GENERATED_BODY()
+
+public:
+	UStratJoinSnapshotComponent(const FObjectInitializer& ObjectInitializer);
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Server. Done sending, or nothing to send. The region proxies can replicate to the player. */
+	void FinishSnapshot();
+
+	UFUNCTION(Client, Reliable)
+	void Client_ReceiveSnapshotPiece(int32 TotalBytes, int32 Offset, const TArray<uint8>& Piece);
+
+	/** BytesReceived is everything the client has so far, so a lost ack is covered by the next one. */
+	UFUNCTION(Server, Reliable)
+	void Server_AckSnapshot(int32 BytesReceived);
+
+	/** Server. The snapshot being sent. Shared with every other player that joined within the reuse window. */
+	TSharedPtr<const TArray<uint8>> Snapshot;
+	int32 SentBytes{0};
+	int32 AckedBytes{0};
+
+	/** Client. The pieces so far. */
+	TArray<uint8> Received;
+};
@@ -0,0 +1,8 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratJoinSnapshotSettings.h"
+
+UStratJoinSnapshotSettings::UStratJoinSnapshotSettings()
+{
+	CategoryName = TEXT("Game");
+}
@@ -0,0 +1,37 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "StratJoinSnapshotSettings.generated.h"
+
+/** How joining and reconnecting players get the match. Found under Project Settings > Game > Strat Join Snapshot. */
+UCLASS(Config=Game, DefaultConfig, meta=(DisplayName="Strat Join Snapshot"))
+class UE_RTS_API UStratJoinSnapshotSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UStratJoinSnapshotSettings();
+
+	/** Streams every unit to a joining player as one compressed snapshot, instead of waiting for each region to replicate. */
+	UPROPERTY(Config, EditAnywhere, Category="Join")
+	bool bEnabled{true};
+
+	/** A snapshot is reused for every player that joins within this long of it being built. Older ones are rebuilt. */
+	UPROPERTY(Config, EditAnywhere, Category="Join", meta=(ClampMin="0.0", Units="s"))
+	float ReuseWindow{2.f};
+
+	/** Bytes per RPC. Reliable RPCs this size are split by the net driver, so keep it well under its limits. */
+	UPROPERTY(Config, EditAnywhere, Category="Join", meta=(ClampMin="256", ClampMax="65536", Units="Bytes"))
+	int32 PieceSize{8192};
+
+	/** Bytes sent but not yet acknowledged, per joining player. Caps how hard one join pushes the server's upstream. */
+	UPROPERTY(Config, EditAnywhere, Category="Join", meta=(ClampMin="256", Units="Bytes"))
+	int32 MaxBytesInFlight{65536};
+
+	/** Units from the snapshot that no region has claimed this long after it was applied died on the way, and are dropped. */
+	UPROPERTY(Config, EditAnywhere, Category="Join", meta=(ClampMin="1.0", Units="s"))
+	float OrphanTimeout{10.f};
+};
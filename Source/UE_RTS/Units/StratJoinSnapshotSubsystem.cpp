@@ -0,0 +1,142 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratJoinSnapshotSubsystem.h"
+
+#include "EngineUtils.h"
+#include "StratJoinSnapshotSettings.h"
+#include "StratUnitRegionProxy.h"
+#include "StratUnitReplicationSubsystem.h"
+#include "StratUnitSimSubsystem.h"
+#include "StratUnitSnapshot.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "Lockstep/StratLockstepSettings.h"
+#include "Memory/StratMemoryTags.h"
+#include "Save/StratSaveFile.h"
+#include "TimerManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Join Snapshot Build"), STAT_StratUnits_JoinSnapshotBuild, STATGROUP_StratUnits);
+DECLARE_CYCLE_STAT(TEXT("Join Snapshot Apply"), STAT_StratUnits_JoinSnapshotApply, STATGROUP_StratUnits);
+
+bool UStratJoinSnapshotSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	//~ Lockstep peers build their units from the command stream, and unit replication doesn't exist there.
+	return Super::ShouldCreateSubsystem(Outer) && GetDefault<UStratJoinSnapshotSettings>()->bEnabled && !GetDefault<UStratLockstepSettings>()->bEnabled;
+}
+
+void UStratJoinSnapshotSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UnitSim = Collection.InitializeDependency<UStratUnitSimSubsystem>();
+	Replication = Collection.InitializeDependency<UStratUnitReplicationSubsystem>();
+}
+
+void UStratJoinSnapshotSubsystem::Deinitialize()
+{
+	if (const UWorld* World = GetWorld())
+	{
+		World->GetTimerManager().ClearTimer(OrphanTimer);
+	}
+
+	Snapshot.Reset();
+	HeldPlayers.Reset();
+	SeededUnits.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UStratJoinSnapshotSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TSharedPtr<const TArray<uint8>> UStratJoinSnapshotSubsystem::GetSnapshot()
+{
+	const double Now = GetWorld()->GetTimeSeconds();
+	if (Snapshot && Now - SnapshotTime <= GetDefault<UStratJoinSnapshotSettings>()->ReuseWindow)
+	{
+		return Snapshot;
+	}
+
+	LLM_SCOPE_BYTAG(StratReplication);
+	SCOPE_CYCLE_COUNTER(STAT_StratUnits_JoinSnapshotBuild);
+
+	FStratUnitSnapshot Units;
+	UnitSim->WriteSnapshot(Units);
+
+	FStratSaveWriter Writer;
+	StratSave::AddUnitColumns(Writer, Units);
+
+	TSharedPtr<TArray<uint8>> Bytes = MakeShared<TArray<uint8>>();
+	Writer.Finish(*Bytes);
+
+	Snapshot = Bytes;
+	SnapshotTime = Now;
+	UE_LOG(LogStratUnits, Log, TEXT("Built a join snapshot of %d units, %.1f KB."), Units.Num(), Bytes->Num() / 1024.0);
+	return Snapshot;
+}
+
+void UStratJoinSnapshotSubsystem::HoldRegions(const APlayerState* Player)
+{
+	if (Player)
+	{
+		HeldPlayers.Add(Player);
+	}
+}
+
+void UStratJoinSnapshotSubsystem::ReleaseRegions(const APlayerState* Player)
+{
+	HeldPlayers.Remove(Player);
+}
+
+bool UStratJoinSnapshotSubsystem::AreRegionsHeldFor(const AActor* Viewer) const
+{
+	const APlayerController* PC = Cast<APlayerController>(Viewer);
+	return PC && PC->PlayerState && HeldPlayers.Contains(PC->PlayerState.Get());
+}
+
+bool UStratJoinSnapshotSubsystem::ApplySnapshot(TArray<uint8>&& Bytes)
+{
+	LLM_SCOPE_BYTAG(StratReplication);
+	SCOPE_CYCLE_COUNTER(STAT_StratUnits_JoinSnapshotApply);
+
+	FStratSaveReader Reader;
+	FStratUnitSnapshot Units;
+	if (!Reader.OpenBytes(MoveTemp(Bytes)) || !StratSave::BindUnitColumns(Reader, Units) || !Reader.Decompress() || !UnitSim->ReadSnapshot(Units))
+	{
+		UE_LOG(LogStratUnits, Error, TEXT("Join snapshot didn't decode. Units will arrive region by region instead."));
+		return false;
+	}
+
+	//~ Regions are held back until the snapshot is acknowledged, but any that got here first are newer than it.
+	for (TActorIterator<AStratUnitRegionProxy> It(GetWorld()); It; ++It)
+	{
+		It->ReapplyUnitStates();
+	}
+
+	SeededUnits = MoveTemp(Units.Handles);
+	GetWorld()->GetTimerManager().SetTimer(OrphanTimer, this, &ThisClass::DropOrphans, GetDefault<UStratJoinSnapshotSettings>()->OrphanTimeout);
+
+	UE_LOG(LogStratUnits, Log, TEXT("Applied a join snapshot of %d units."), UnitSim->GetNumUnits());
+	return true;
+}
+
+void UStratJoinSnapshotSubsystem::DropOrphans()
+{
+	//~ Every region is relevant once the snapshot is acknowledged, so by now each unit still alive on the server has been
+	//~ claimed by one.
+	int32 NumDropped = 0;
+	for (const FStratUnitHandle& Unit : SeededUnits)
+	{
+		if (UnitSim->IsUnitValid(Unit) && Replication && !Replication->IsClaimedByRegion(Unit))
+		{
+			UnitSim->DestroyUnit(Unit);
+			++NumDropped;
+		}
+	}
+	SeededUnits.Reset();
+
+	UE_CLOG(NumDropped > 0, LogStratUnits, Log, TEXT("Dropped %d units from the join snapshot that died before their region replicated."), NumDropped);
+}
@@ -0,0 +1,67 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StratUnitTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "StratJoinSnapshotSubsystem.generated.h"
+
+class APlayerState;
+class UStratUnitReplicationSubsystem;
+class UStratUnitSimSubsystem;
+
+/**
+ * Builds and applies join snapshots: every unit of the simulation in the save file's chunked, compressed format, see
+ * StratSaveFile.h. The server builds one and reuses it for everyone who joins within UStratJoinSnapshotSettings::ReuseWindow.
+ * UStratJoinSnapshotComponent streams it to each joining player.
+ *
+ * Region proxies aren't relevant to a joining player until their snapshot is acknowledged, so the units don't also arrive
+ * region by region. The client applies it as soon as it's whole, and from then on regions only move the units it made.
+ */
+UCLASS()
+class UE_RTS_API UStratJoinSnapshotSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	/** Server. The current snapshot, rebuilt when the last one is older than the reuse window. */
+	TSharedPtr<const TArray<uint8>> GetSnapshot();
+
+	/** Server. Keeps every region proxy from replicating to the player until ReleaseRegions. */
+	void HoldRegions(const APlayerState* Player);
+	void ReleaseRegions(const APlayerState* Player);
+
+	/** Server. True while the viewing player's snapshot is still on its way. */
+	bool AreRegionsHeldFor(const AActor* Viewer) const;
+
+	/** Client. Replaces the local units with the snapshot's. False if it doesn't decode, which leaves them as they were. */
+	bool ApplySnapshot(TArray<uint8>&& Bytes);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void DropOrphans();
+
+	TSharedPtr<const TArray<uint8>> Snapshot;
+	double SnapshotTime{0.0};
+
+	/** Server. Players whose snapshot hasn't been acknowledged yet. */
+	TSet<TObjectKey<APlayerState>> HeldPlayers;
+
+	/** Client. Units the last snapshot made, until the orphan timeout checks them. */
+	TArray<FStratUnitHandle> SeededUnits;
+	FTimerHandle OrphanTimer;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratUnitSimSubsystem> UnitSim;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratUnitReplicationSubsystem> Replication;
+};
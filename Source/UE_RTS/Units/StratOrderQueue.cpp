@@ -0,0 +1,88 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratOrderQueue.h"
+
+void FStratOrderQueuePool::Reserve(const int32 NumSlots)
+{
+	if (NumFree >= NumSlots)
+	{
+		return;
+	}
+
+	//~ New slots go on the free list as one run, linked in index order.
+	const int32 NumNew = NumSlots - NumFree;
+	const int32 First = Slots.Num();
+	Slots.SetNum(First + NumNew);
+	for (int32 Index = First; Index < Slots.Num() - 1; ++Index)
+	{
+		Slots[Index].Next = Index + 1;
+	}
+	Slots.Last().Next = FreeHead;
+	FreeHead = First;
+	NumFree += NumNew;
+}
+
+void FStratOrderQueuePool::Append(FStratOrderQueue& Queue, const FStratUnitOrder& Order)
+{
+	if (FreeHead == INDEX_NONE)
+	{
+		Reserve(FMath::Max(Slots.Num(), 64));
+	}
+
+	const int32 Index = FreeHead;
+	FSlot& Slot = Slots[Index];
+	FreeHead = Slot.Next;
+	--NumFree;
+
+	Slot.Order = Order;
+	Slot.Next = INDEX_NONE;
+
+	if (Queue.IsEmpty())
+	{
+		Queue.Head = Index;
+	}
+	else
+	{
+		Slots[Queue.Tail].Next = Index;
+	}
+	Queue.Tail = Index;
+	++Queue.Num;
+}
+
+bool FStratOrderQueuePool::Pop(FStratOrderQueue& Queue, FStratUnitOrder& OutOrder)
+{
+	if (Queue.IsEmpty())
+	{
+		return false;
+	}
+
+	const int32 Index = Queue.Head;
+	FSlot& Slot = Slots[Index];
+	OutOrder = Slot.Order;
+
+	Queue.Head = Slot.Next;
+	if (Queue.Head == INDEX_NONE)
+	{
+		Queue.Tail = INDEX_NONE;
+	}
+	--Queue.Num;
+
+	Slot.Next = FreeHead;
+	FreeHead = Index;
+	++NumFree;
+	return true;
+}
+
+void FStratOrderQueuePool::Release(FStratOrderQueue& Queue)
+{
+	if (Queue.IsEmpty())
+	{
+		return;
+	}
+
+	//~ The queue is already a linked run of slots. Splice all of it onto the free list.
+	Slots[Queue.Tail].Next = FreeHead;
+	FreeHead = Queue.Head;
+	NumFree += Queue.Num;
+	Queue = FStratOrderQueue();
+}
@@ -0,0 +1,65 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StratUnitTypes.h"
+
+/**
+ * A unit's shift-queued orders, oldest first. Only the ends of an intrusive list in FStratOrderQueuePool, so it lives in a
+ * chunk column and a unit with nothing queued costs a few bytes and no allocation.
+ */
+struct FStratOrderQueue
+{
+	int32 Head{INDEX_NONE};
+	int32 Tail{INDEX_NONE};
+	int32 Num{0};
+
+	bool IsEmpty() const { return Head == INDEX_NONE; }
+};
+
+/**
+ * Fixed size order slots shared by every unit's FStratOrderQueue. Freed slots go on a free list and are reused, so queuing a
+ * waypoint for a whole selection doesn't allocate once the pool is warm. Slots are addressed by index, growing never
+ * invalidates a queue.
+ */
+class UE_RTS_API FStratOrderQueuePool
+{
+public:
+	/** Makes sure the next NumSlots appends don't grow the pool. */
+	void Reserve(int32 NumSlots);
+
+	void Append(FStratOrderQueue& Queue, const FStratUnitOrder& Order);
+
+	/** Takes the oldest order off the queue. False if it was empty. */
+	bool Pop(FStratOrderQueue& Queue, FStratUnitOrder& OutOrder);
+
+	/** Returns every slot of the queue to the pool at once and empties it. */
+	void Release(FStratOrderQueue& Queue);
+
+	/** Visits the queued orders, oldest first. */
+	template <typename FuncType>
+	void ForEach(const FStratOrderQueue& Queue, FuncType&& Func) const
+	{
+		for (int32 Index = Queue.Head; Index != INDEX_NONE; Index = Slots[Index].Next)
+		{
+			Func(Slots[Index].Order);
+		}
+	}
+
+	int32 GetNumUsed() const { return Slots.Num() - NumFree; }
+	SIZE_T GetAllocatedSize() const { return Slots.GetAllocatedSize(); }
+
+private:
+	struct FSlot
+	{
+		FStratUnitOrder Order;
+
+		/** Next slot in the owning queue, or in the free list. */
+		int32 Next{INDEX_NONE};
+	};
+
+	TArray<FSlot> Slots;
+	int32 FreeHead{INDEX_NONE};
+	int32 NumFree{0};
+};
@@ -0,0 +1,99 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StratUnitActions.generated.h"
+
+/**
+ * Everything a unit can be told to do. Values are bit indices, masks hold 1 << value.
+ * Append only, masks are saved in unit definitions.
+ */
+UENUM(BlueprintType, meta=(Bitflags))
+enum class EStratUnitAction : uint8
+{
+	Move,
+	Attack,
+	Hold,
+	Patrol,
+	Gather,
+	Build,
+	Repair,
+	Garrison,
+
+	MAX UMETA(Hidden)
+};
+
+static_assert(static_cast<int32>(EStratUnitAction::MAX) <= 32, "Action masks are 32 bit.");
+
+/** Action bitmask helpers. Masks are plain uint32 so they can sit in type infos and be combined without branching. */
+namespace StratActions
+{
+	constexpr uint32 Bit(const EStratUnitAction Action) { return 1u << static_cast<uint32>(Action); }
+
+	constexpr bool HasAction(const uint32 Mask, const EStratUnitAction Action) { return (Mask & Bit(Action)) != 0; }
+
+	/** What a mobile unit can do when its definition doesn't say. */
+	constexpr uint32 DefaultUnitActions = Bit(EStratUnitAction::Move) | Bit(EStratUnitAction::Attack) | Bit(EStratUnitAction::Hold) | Bit(EStratUnitAction::Patrol);
+
+	/** What can be done to a unit when its definition doesn't say. */
+	constexpr uint32 DefaultTargetActions = Bit(EStratUnitAction::Attack);
+
+	/** Orders on open ground, when the cursor isn't over a unit. */
+	constexpr uint32 GroundTargetActions = Bit(EStratUnitAction::Move) | Bit(EStratUnitAction::Patrol) | Bit(EStratUnitAction::Build);
+
+	/** Only offered on other factions' units. */
+	constexpr uint32 HostileActions = Bit(EStratUnitAction::Attack);
+
+	/** Only offered on the local player's own units. */
+	constexpr uint32 FriendlyActions = Bit(EStratUnitAction::Repair) | Bit(EStratUnitAction::Garrison);
+
+	/** Structures never walk, whatever their definition says. */
+	constexpr uint32 MobileActions = Bit(EStratUnitAction::Move) | Bit(EStratUnitAction::Patrol);
+}
+
+/**
+ * Counts how many members of a group can perform each action, so the group's union and intersection follow single adds and
+ * removes instead of being rebuilt from every member.
+ */
+struct FStratActionTally
+{
+	void Add(const uint32 Mask) { Apply(Mask, 1); }
+	void Remove(const uint32 Mask) { Apply(Mask, -1); }
+
+	void Reset()
+	{
+		*this = FStratActionTally();
+	}
+
+	/** Actions at least one member can perform. */
+	uint32 GetUnion() const { return Union; }
+
+	/** Actions every member can perform. Zero for an empty group. */
+	uint32 GetIntersection() const { return Intersection; }
+
+	int32 Num() const { return NumMembers; }
+
+private:
+	void Apply(const uint32 Mask, const int32 Delta)
+	{
+		NumMembers += Delta;
+		Union = 0;
+		Intersection = 0;
+		for (int32 Action = 0; Action < Counts.Num(); ++Action)
+		{
+			const uint32 Bit = 1u << Action;
+			if (Mask & Bit)
+			{
+				Counts[Action] += Delta;
+			}
+			Union |= Counts[Action] > 0 ? Bit : 0;
+			Intersection |= NumMembers > 0 && Counts[Action] == NumMembers ? Bit : 0;
+		}
+	}
+
+	TStaticArray<int32, static_cast<int32>(EStratUnitAction::MAX)> Counts{InPlace, 0};
+	int32 NumMembers{0};
+	uint32 Union{0};
+	uint32 Intersection{0};
+};
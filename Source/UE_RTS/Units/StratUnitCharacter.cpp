@@ -0,0 +1,43 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratUnitCharacter.h"
+
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/CharacterMovementComponent.h"
+
+AStratUnitCharacter::AStratUnitCharacter()
+{
+	PrimaryActorTick.bCanEverTick = false;
+	bReplicates = false;
+	SetReplicatingMovement(false);
+	AutoPossessAI = EAutoPossessAI::Disabled;
+
+	//~ The simulation owns movement. The CMC stays for anim BPs and AI tooling that expect a character, but never ticks.
+	GetCharacterMovement()->PrimaryComponentTick.bStartWithTickEnabled = false;
+	GetCharacterMovement()->SetMovementMode(MOVE_None);
+
+	//~ The simulation owns spacing, so the capsule only needs to answer visibility traces.
+	GetCapsuleComponent()->SetCollisionProfileName(UCollisionProfile::CustomCollisionProfileName);
+	GetCapsuleComponent()->SetCollisionResponseToAllChannels(ECR_Ignore);
+	GetCapsuleComponent()->SetCollisionResponseToChannel(ECC_Visibility, ECR_Block);
+}
+
+void AStratUnitCharacter::BindUnit(const FStratUnitHandle& InUnit)
+{
+	Unit = InUnit;
+	PresentedVelocity = FVector::ZeroVector;
+	OnUnitBound();
+}
+
+void AStratUnitCharacter::SyncFromUnit(const FVector& UnitLocation, const FVector& UnitVelocity, const float UnitYaw, const float DeltaTime)
+{
+	PresentedVelocity = UnitVelocity;
+
+	//~ The sim tracks the feet, the actor origin is the capsule center.
+	const FVector TargetLoc = UnitLocation + FVector::UpVector * GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	const FVector NewLoc = FMath::VInterpTo(GetActorLocation(), TargetLoc, DeltaTime, LocationLagSpeed);
+
+	const FRotator NewRot = FMath::RInterpTo(GetActorRotation(), FRotator(0.f, UnitYaw, 0.f), DeltaTime, RotationLagSpeed);
+
+	SetActorLocationAndRotation(NewLoc, NewRot);
+}
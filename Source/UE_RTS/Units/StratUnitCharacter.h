@@ -0,0 +1,52 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ModularCharacter.h"
+#include "StratUnitTypes.h"
+#include "StratUnitCharacter.generated.h"
+
+/**
+ * Presentation of a simulated unit. Owns no gameplay state, it only follows its unit in UStratUnitSimSubsystem.
+ * Spawned locally on each machine when the unit is near a camera or selected, so it never replicates.
+ */
+UCLASS(meta=(PrioritizeCategories="User"))
+class UE_RTS_API AStratUnitCharacter : public AModularCharacter
+{
+	GENERATED_BODY()
+
+public:
+	AStratUnitCharacter();
+
+	/** Called by the sim subsystem when this actor starts representing a unit. */
+	virtual void BindUnit(const FStratUnitHandle& InUnit);
+
+	/** Called by the sim subsystem every frame with the unit's latest simulated state. */
+	virtual void SyncFromUnit(const FVector& UnitLocation, const FVector& UnitVelocity, float UnitYaw, float DeltaTime);
+
+	UFUNCTION(BlueprintPure, Category=StratUnit)
+	FStratUnitHandle GetUnit() const { return Unit; }
+
+	/** The simulated velocity. Use this in anim BPs instead of the (disabled) movement component velocity. */
+	UFUNCTION(BlueprintPure, Category=StratUnit)
+	FVector GetPresentedVelocity() const { return PresentedVelocity; }
+
+	UFUNCTION(BlueprintImplementableEvent, Category=StratUnit)
+	void OnUnitBound();
+
+protected:
+	UPROPERTY(VisibleInstanceOnly, Category="User|Info")
+	FStratUnitHandle Unit;
+
+	UPROPERTY(VisibleInstanceOnly, Category="User|Info", meta=(Units="cm/s"))
+	FVector PresentedVelocity{FVector::ZeroVector};
+
+	/** Controls how quickly the actor catches up to the simulated position. Zero snaps. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="User|Options", meta=(ClampMin="0.0", UIMin="0.0", UIMax="30.0"))
+	float LocationLagSpeed{12.f};
+
+	/** Controls how quickly the actor turns to face the unit's heading. Zero snaps. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="User|Options", meta=(ClampMin="0.0", UIMin="0.0", UIMax="30.0"))
+	float RotationLagSpeed{8.f};
+};
@@ -0,0 +1,69 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StratOrderQueue.h"
+#include "StratUnitTypes.h"
+
+/**
+ * Fixed capacity block of units of one archetype, stored struct-of-arrays.
+ * Units are always packed at [0, Num). Removing a unit moves the last unit into the hole, so iteration never skips.
+ */
+struct FStratUnitChunk
+{
+	static constexpr int32 Capacity = 128;
+
+	explicit FStratUnitChunk(const EStratUnitArchetype InArchetype) : Archetype(InArchetype) {}
+
+	bool IsFull() const { return Num >= Capacity; }
+	bool IsEmpty() const { return Num == 0; }
+
+	/** Moves the unit at FromIndex into ToIndex. Used to fill holes. The caller fixes up the slot table. */
+	void MoveUnit(const int32 FromIndex, const int32 ToIndex)
+	{
+		Handles[ToIndex] = Handles[FromIndex];
+		Positions[ToIndex] = Positions[FromIndex];
+		Velocities[ToIndex] = Velocities[FromIndex];
+		Yaws[ToIndex] = Yaws[FromIndex];
+		FixedPositions[ToIndex] = FixedPositions[FromIndex];
+		Orders[ToIndex] = Orders[FromIndex];
+		QueuedOrders[ToIndex] = QueuedOrders[FromIndex];
+		Health[ToIndex] = Health[FromIndex];
+		TypeIds[ToIndex] = TypeIds[FromIndex];
+		Factions[ToIndex] = Factions[FromIndex];
+		Flags[ToIndex] = Flags[FromIndex];
+	}
+
+	int32 Num{0};
+	EStratUnitArchetype Archetype;
+
+	TStaticArray<FStratUnitHandle, Capacity> Handles;
+	TStaticArray<FVector3f, Capacity> Positions;
+	TStaticArray<FVector3f, Capacity> Velocities;
+
+	/** Facing in degrees. Follows the velocity while moving and keeps the last facing when stopped. */
+	TStaticArray<float, Capacity> Yaws;
+
+	/** The authoritative position in lockstep. Positions is then only its float copy for presentation and queries. */
+	TStaticArray<FStratFixedVector, Capacity> FixedPositions;
+
+	TStaticArray<FStratUnitOrder, Capacity> Orders;
+
+	/** Shift-queued orders after the current one. Slots live in the simulation's FStratOrderQueuePool. */
+	TStaticArray<FStratOrderQueue, Capacity> QueuedOrders;
+
+	TStaticArray<float, Capacity> Health;
+	TStaticArray<uint16, Capacity> TypeIds;
+	TStaticArray<uint8, Capacity> Factions;
+	TStaticArray<EStratUnitFlags, Capacity> Flags;
+};
+
+/** All chunks of one archetype. Chunks are heap allocated so growing the list never moves unit data. */
+struct FStratUnitArchetypeStorage
+{
+	TArray<TUniquePtr<FStratUnitChunk>> Chunks;
+
+	/** Index of the first chunk that may have room. Everything before it is full. */
+	int32 FirstFreeChunk{0};
+};
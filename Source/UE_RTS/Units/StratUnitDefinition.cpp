@@ -0,0 +1,23 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratUnitDefinition.h"
+
+FStratUnitTypeInfo UStratUnitDefinition::MakeTypeInfo() const
+{
+	FStratUnitTypeInfo Result;
+	Result.MaxHealth = MaxHealth;
+	Result.MoveSpeed = Archetype == EStratUnitArchetype::Structure ? 0.f : MoveSpeed;
+	Result.Radius = Radius;
+	Result.VisionRadius = VisionRadius;
+	Result.EyeHeight = EyeHeight;
+	Result.AcquireRange = StratActions::HasAction(static_cast<uint32>(Actions), EStratUnitAction::Attack) ? AcquireRange : 0.f;
+	Result.AttackRange = AttackRange;
+	Result.Archetype = Archetype;
+	Result.Actions = static_cast<uint32>(Actions);
+	if (Archetype == EStratUnitArchetype::Structure)
+	{
+		Result.Actions &= ~StratActions::MobileActions;
+	}
+	Result.TargetActions = static_cast<uint32>(TargetActions);
+	return Result;
+}
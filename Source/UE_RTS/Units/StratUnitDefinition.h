@@ -0,0 +1,88 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "StratUnitTypes.h"
+#include "Economy/StratEconomyTypes.h"
+#include "StratUnitDefinition.generated.h"
+
+class AStratUnitCharacter;
+class UStateTree;
+class UStratProjectileDefinition;
+
+/** Designer facing description of a kind of unit. The simulation copies what it needs into FStratUnitTypeInfo. */
+UCLASS(BlueprintType, meta=(PrioritizeCategories="User"))
+class UE_RTS_API UStratUnitDefinition : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	FStratUnitTypeInfo MakeTypeInfo() const;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Options")
+	EStratUnitArchetype Archetype{EStratUnitArchetype::Ground};
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Options", meta=(ClampMin="1.0"))
+	float MaxHealth{100.f};
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Options", meta=(ClampMin="0.0", Units="cm/s"))
+	float MoveSpeed{400.f};
+
+	/** Footprint used for arrival and, later, spacing. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Options", meta=(ClampMin="1.0", Units="cm"))
+	float Radius{40.f};
+
+	/** How far the unit reveals fog of war. Zero means the unit doesn't reveal anything. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Options", meta=(ClampMin="0.0", Units="cm"))
+	float VisionRadius{1500.f};
+
+	/** Height of the unit's eyes above the ground for line of sight. Tall units see over more hills. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Options", meta=(ClampMin="0.0", Units="cm"))
+	float EyeHeight{180.f};
+
+	/** Idle or holding units pick the nearest enemy within this range on their own. Zero means the unit only attacks when told. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Options", meta=(ClampMin="0.0", Units="cm"))
+	float AcquireRange{0.f};
+
+	/** Fired at the target of an Attack order. Leave empty for units that don't fight. Must be listed in Strat Projectiles settings. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Combat")
+	TSoftObjectPtr<UStratProjectileDefinition> Projectile;
+
+	/** Attackers close to this range and fire from it. Below twice the Radius they close to that instead. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Combat", meta=(ClampMin="0.0", Units="cm"))
+	float AttackRange{1000.f};
+
+	/** Time between shots, rounded to whole sim steps. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Combat", meta=(ClampMin="0.0", Units="s"))
+	float FireInterval{1.f};
+
+	/** Actions the unit can perform. Drives which orders and buttons the UI offers. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Actions", meta=(Bitmask, BitmaskEnum="/Script/UE_RTS.EStratUnitAction"))
+	int32 Actions{static_cast<int32>(StratActions::DefaultUnitActions)};
+
+	/** Actions other units can perform with this unit as the target, like Attack, Repair or Garrison. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Actions", meta=(Bitmask, BitmaskEnum="/Script/UE_RTS.EStratUnitAction"))
+	int32 TargetActions{static_cast<int32>(StratActions::DefaultTargetActions)};
+
+	/** Paid when the unit is queued for production, refunded if it's cancelled. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Economy")
+	FStratResourceAmounts Cost;
+
+	/** Time in a production queue, rounded up to whole economy steps. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Economy", meta=(ClampMin="0.0", Units="s"))
+	float BuildTime{10.f};
+
+	/** Supply the unit costs its faction while it lives. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Economy", meta=(ClampMin="0.0"))
+	float UpkeepPerMinute{0.f};
+
+	/** Spawned when the unit is near a player's camera or selected. Never replicated, every machine presents its own units. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Options")
+	TSoftClassPtr<AStratUnitCharacter> PresentationClass;
+
+	/** Run by UStratAISchedulerSubsystem for every unit of this type. Leave empty for units that only follow orders. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="User|Options", meta=(RequiredAssetDataTags="Schema=/Script/UE_RTS.StratUnitStateTreeSchema"))
+	TSoftObjectPtr<UStateTree> Behavior;
+};
@@ -0,0 +1,64 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratUnitGrid.h"
+
+#include "StratUnitSimSubsystem.h"
+
+void FStratUnitGrid::Build(const UStratUnitSimSubsystem& UnitSim, const float InCellSize)
+{
+	check(InCellSize > 0.f);
+
+	Gathered.Reset();
+	MaxRadius = 0.f;
+	FBox2D Bounds(ForceInit);
+	UnitSim.ForEachChunk([this, &UnitSim, &Bounds](const FStratUnitChunk& Chunk)
+	{
+		for (int32 Row = 0; Row < Chunk.Num; ++Row)
+		{
+			const FStratUnitTypeInfo& Type = UnitSim.GetTypeInfo(Chunk.TypeIds[Row]);
+			Gathered.Add({Chunk.Handles[Row], Chunk.Positions[Row], Type.Radius, Type.EyeHeight, Chunk.TypeIds[Row], Chunk.Factions[Row]});
+			Bounds += FVector2D(Chunk.Positions[Row].X, Chunk.Positions[Row].Y);
+			MaxRadius = FMath::Max(MaxRadius, Type.Radius);
+		}
+	});
+
+	Entries.Reset();
+	CellStarts.Reset();
+	if (Gathered.IsEmpty())
+	{
+		SizeX = SizeY = 0;
+		return;
+	}
+
+	//~ Units spread over a huge area get coarser cells rather than a huge, mostly empty grid.
+	const FVector2D Extent = Bounds.GetSize();
+	CellSize = FMath::Max3(InCellSize, static_cast<float>(Extent.X) / MaxCellsPerSide, static_cast<float>(Extent.Y) / MaxCellsPerSide);
+	Origin = Bounds.Min;
+	SizeX = FMath::FloorToInt32(Extent.X / CellSize) + 1;
+	SizeY = FMath::FloorToInt32(Extent.Y / CellSize) + 1;
+
+	//~ Counting sort. Count per cell, sum the counts into each cell's end, then place entries walking every end back to its start.
+	const int32 NumCells = SizeX * SizeY;
+	CellStarts.SetNumZeroed(NumCells + 1);
+	GatheredCells.Reset();
+	for (const FEntry& Entry : Gathered)
+	{
+		const FIntPoint Cell = WorldToCell(FVector2D(Entry.Position.X, Entry.Position.Y));
+		const int32 CellIndex = ToIndex(Cell.X, Cell.Y);
+		GatheredCells.Add(CellIndex);
+		++CellStarts[CellIndex];
+	}
+
+	for (int32 Index = 1; Index < NumCells; ++Index)
+	{
+		CellStarts[Index] += CellStarts[Index - 1];
+	}
+	CellStarts[NumCells] = Gathered.Num();
+
+	//~ From the back, so each cell keeps chunk order.
+	Entries.SetNumUninitialized(Gathered.Num());
+	for (int32 Index = Gathered.Num() - 1; Index >= 0; --Index)
+	{
+		Entries[--CellStarts[GatheredCells[Index]]] = Gathered[Index];
+	}
+}
@@ -0,0 +1,93 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StratUnitTypes.h"
+
+class UStratUnitSimSubsystem;
+
+/**
+ * Snapshot of every unit bucketed into a uniform 2D grid, for "who is near here" queries. Built in one pass with a counting
+ * sort, so each cell's units are contiguous and a rebuild never allocates once the arrays have grown.
+ *
+ * It's a copy. Positions are from the moment of the last Build, and destroyed units stay in until the next one.
+ */
+struct UE_RTS_API FStratUnitGrid
+{
+	struct FEntry
+	{
+		FStratUnitHandle Unit;
+		FVector3f Position{FVector3f::ZeroVector};
+		float Radius{0.f};
+		float Height{0.f};
+		uint16 TypeId{0};
+		uint8 Faction{0};
+	};
+
+	/** Grids bigger than this per side get larger cells instead. */
+	static constexpr int32 MaxCellsPerSide = 512;
+
+	/** Re-buckets every unit. The grid covers the units' bounds, with cells at least InCellSize wide. */
+	void Build(const UStratUnitSimSubsystem& UnitSim, float InCellSize);
+
+	bool IsEmpty() const { return Entries.IsEmpty(); }
+	int32 ToIndex(const int32 X, const int32 Y) const { return Y * SizeX + X; }
+
+	/** Cell containing a location, clamped to the grid. */
+	FIntPoint WorldToCell(const FVector2D& WorldXY) const
+	{
+		return FIntPoint(
+			FMath::Clamp(FMath::FloorToInt32((WorldXY.X - Origin.X) / CellSize), 0, SizeX - 1),
+			FMath::Clamp(FMath::FloorToInt32((WorldXY.Y - Origin.Y) / CellSize), 0, SizeY - 1));
+	}
+
+	TConstArrayView<FEntry> GetCellEntries(const int32 CellIndex) const
+	{
+		return TConstArrayView<FEntry>(Entries.GetData() + CellStarts[CellIndex], CellStarts[CellIndex + 1] - CellStarts[CellIndex]);
+	}
+
+	/** Visits every entry in cells overlapping WorldBox. Entries near the box but outside it are visited too. */
+	template <typename FuncType>
+	void ForEachInBox(const FBox2D& WorldBox, FuncType&& Func) const
+	{
+		if (IsEmpty())
+		{
+			return;
+		}
+
+		const FIntPoint Min = WorldToCell(WorldBox.Min);
+		const FIntPoint Max = WorldToCell(WorldBox.Max);
+		for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+		{
+			for (int32 X = Min.X; X <= Max.X; ++X)
+			{
+				for (const FEntry& Entry : GetCellEntries(ToIndex(X, Y)))
+				{
+					Func(Entry);
+				}
+			}
+		}
+	}
+
+	SIZE_T GetAllocatedSize() const { return Entries.GetAllocatedSize() + CellStarts.GetAllocatedSize() + Gathered.GetAllocatedSize() + GatheredCells.GetAllocatedSize(); }
+
+	FVector2D Origin{FVector2D::ZeroVector};
+	float CellSize{1000.f};
+	int32 SizeX{0};
+	int32 SizeY{0};
+
+	/** Largest Radius of any entry. Queries widen by it so units whose center is in the next cell still count. */
+	float MaxRadius{0.f};
+
+	/** Sorted by cell. */
+	TArray<FEntry> Entries;
+
+	/** Where each cell's entries start in Entries, plus one past the end. */
+	TArray<int32> CellStarts;
+
+private:
+	/** Scratch for Build, kept so rebuilds don't allocate. */
+	TArray<FEntry> Gathered;
+	TArray<int32> GatheredCells;
+};
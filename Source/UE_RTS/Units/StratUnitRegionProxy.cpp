@@ -0,0 +1,189 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratUnitRegionProxy.h"
+
+#include "StratJoinSnapshotSubsystem.h"
+#include "StratUnitReplicationSubsystem.h"
+#include "StratUnitSettings.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Memory/StratMemoryTags.h"
+#include "Net/UnrealNetwork.h"
+#include "Player/StratPlayerCameraPawn.h"
+
+void FStratUnitNetState::SetLocation(const FVector& Location)
+{
+	const FVector Quantized = (Location / PositionQuantum).RoundToVector();
+	X = static_cast<int16>(FMath::Clamp<double>(Quantized.X, MIN_int16, MAX_int16));
+	Y = static_cast<int16>(FMath::Clamp<double>(Quantized.Y, MIN_int16, MAX_int16));
+	Z = static_cast<int16>(FMath::Clamp<double>(Quantized.Z, MIN_int16, MAX_int16));
+}
+
+void FStratUnitNetState::SetYaw(const float Yaw)
+{
+	Heading = static_cast<uint8>(FMath::RoundToInt(FRotator::ClampAxis(Yaw) * (256.f / 360.f)) & 0xFF);
+}
+
+void FStratUnitNetState::PreReplicatedRemove(const FStratUnitNetArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnUnitStateRemoved(*this);
+	}
+}
+
+void FStratUnitNetState::PostReplicatedAdd(const FStratUnitNetArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnUnitStateReplicated(*this);
+	}
+}
+
+void FStratUnitNetState::PostReplicatedChange(const FStratUnitNetArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnUnitStateReplicated(*this);
+	}
+}
+
+AStratUnitRegionProxy::AStratUnitRegionProxy()
+{
+	PrimaryActorTick.bCanEverTick = false;
+	bReplicates = true;
+	bAlwaysRelevant = true;
+	SetReplicatingMovement(false);
+	UnitStates.Owner = this;
+}
+
+void AStratUnitRegionProxy::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AStratUnitRegionProxy, UnitStates);
+}
+
+void AStratUnitRegionProxy::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	//~ The channel closed on a client. Nothing else will tell the sim these units are gone.
+	if (!HasAuthority())
+	{
+		for (const FStratUnitNetState& State : UnitStates.Items)
+		{
+			OnUnitStateRemoved(State);
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+bool AStratUnitRegionProxy::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	const UStratJoinSnapshotSubsystem* JoinSnapshot = GetWorld()->GetSubsystem<UStratJoinSnapshotSubsystem>();
+	if (JoinSnapshot && JoinSnapshot->AreRegionsHeldFor(RealViewer))
+	{
+		return false;
+	}
+
+	return Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+}
+
+float AStratUnitRegionProxy::GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, const float Time, const bool bLowBandwidth)
+{
+	//~ The server's copy of a remote camera pawn doesn't move. Where the player looks only lives in SimpleRepMovement.
+	const AStratPlayerCameraPawn* Camera = Cast<AStratPlayerCameraPawn>(ViewTarget);
+	if (!Camera)
+	{
+		if (const APlayerController* PC = Cast<APlayerController>(Viewer))
+		{
+			Camera = Cast<AStratPlayerCameraPawn>(PC->GetPawn());
+		}
+	}
+
+	const FVector2D CameraLoc(Camera ? Camera->GetSimpleRepMovement().Location : ViewPos);
+	const double Distance = RegionBounds.bIsValid ? FMath::Sqrt(RegionBounds.ComputeSquaredDistanceToPoint(CameraLoc)) : 0.0;
+
+	const UStratUnitSettings* Settings = GetDefault<UStratUnitSettings>();
+	const float Alpha = FMath::Clamp(FMath::GetRangePct(Settings->NearCameraDistance, Settings->FarCameraDistance, static_cast<float>(Distance)), 0.f, 1.f);
+	const float Scale = FMath::Lerp(1.f, Settings->FarPriorityScale, Alpha);
+
+	//~ Same time weighting as AActor, without its actor location terms. The proxy's location means nothing.
+	return NetPriority * Time * Scale;
+}
+
+void AStratUnitRegionProxy::WriteUnit(const FStratUnitHandle& Unit, const uint16 TypeId, const uint8 Faction, const FVector& Location, const float Yaw)
+{
+	LLM_SCOPE_BYTAG(StratReplication);
+
+	FStratUnitNetState NewState;
+	NewState.Unit = Unit;
+	NewState.TypeId = TypeId;
+	NewState.Faction = Faction;
+	NewState.SetLocation(Location);
+	NewState.SetYaw(Yaw);
+
+	if (const int32* Index = ItemIndices.Find(Unit))
+	{
+		FStratUnitNetState& State = UnitStates.Items[*Index];
+		if (State.DiffersFrom(NewState))
+		{
+			State.Faction = NewState.Faction;
+			State.Heading = NewState.Heading;
+			State.X = NewState.X;
+			State.Y = NewState.Y;
+			State.Z = NewState.Z;
+			UnitStates.MarkItemDirty(State);
+		}
+		return;
+	}
+
+	ItemIndices.Add(Unit, UnitStates.Items.Num());
+	UnitStates.MarkItemDirty(UnitStates.Items.Add_GetRef(NewState));
+}
+
+void AStratUnitRegionProxy::RemoveUnit(const FStratUnitHandle& Unit)
+{
+	int32 Index;
+	if (!ItemIndices.RemoveAndCopyValue(Unit, Index))
+	{
+		return;
+	}
+
+	UnitStates.Items.RemoveAtSwap(Index, EAllowShrinking::No);
+	if (UnitStates.Items.IsValidIndex(Index))
+	{
+		ItemIndices[UnitStates.Items[Index].Unit] = Index;
+	}
+	UnitStates.MarkArrayDirty();
+}
+
+void AStratUnitRegionProxy::SetRegion(const FIntPoint& InRegion, const FBox2D& InBounds)
+{
+	Region = InRegion;
+	RegionBounds = InBounds;
+}
+
+void AStratUnitRegionProxy::OnUnitStateReplicated(const FStratUnitNetState& State)
+{
+	if (UStratUnitReplicationSubsystem* Replication = GetWorld()->GetSubsystem<UStratUnitReplicationSubsystem>())
+	{
+		Replication->ApplyUnitState(*this, State);
+	}
+}
+
+void AStratUnitRegionProxy::OnUnitStateRemoved(const FStratUnitNetState& State)
+{
+	if (UStratUnitReplicationSubsystem* Replication = GetWorld()->GetSubsystem<UStratUnitReplicationSubsystem>())
+	{
+		Replication->RemoveUnitState(*this, State);
+	}
+}
+
+void AStratUnitRegionProxy::ReapplyUnitStates()
+{
+	for (const FStratUnitNetState& State : UnitStates.Items)
+	{
+		OnUnitStateReplicated(State);
+	}
+}
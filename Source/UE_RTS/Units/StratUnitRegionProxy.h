@@ -0,0 +1,135 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "StratUnitTypes.h"
+#include "StratUnitRegionProxy.generated.h"
+
+class AStratUnitRegionProxy;
+
+/** Replicated state of one unit. Positions are stored quantized so the server only dirties units that visibly moved. */
+USTRUCT()
+struct FStratUnitNetState : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	/** Quantization step of the replicated position. 16 bits at this step covers a map of +-1.3 km. */
+	static constexpr float PositionQuantum = 4.f;
+
+	void SetLocation(const FVector& Location);
+	FVector GetLocation() const { return FVector(X, Y, Z) * PositionQuantum; }
+
+	void SetYaw(float Yaw);
+	float GetYaw() const { return Heading * (360.f / 256.f); }
+
+	/** True if the quantized values differ, i.e. replicating this would change something on the client. */
+	bool DiffersFrom(const FStratUnitNetState& Other) const
+	{
+		return X != Other.X || Y != Other.Y || Z != Other.Z || Heading != Other.Heading || Faction != Other.Faction;
+	}
+
+	void PreReplicatedRemove(const struct FStratUnitNetArray& InArraySerializer);
+	void PostReplicatedAdd(const struct FStratUnitNetArray& InArraySerializer);
+	void PostReplicatedChange(const struct FStratUnitNetArray& InArraySerializer);
+
+	UPROPERTY()
+	FStratUnitHandle Unit;
+
+	UPROPERTY()
+	uint16 TypeId{0};
+
+	UPROPERTY()
+	uint8 Faction{0};
+
+	/** Yaw in 256ths of a turn. */
+	UPROPERTY()
+	uint8 Heading{0};
+
+	UPROPERTY()
+	int16 X{0};
+
+	UPROPERTY()
+	int16 Y{0};
+
+	UPROPERTY()
+	int16 Z{0};
+};
+
+USTRUCT()
+struct FStratUnitNetArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FastArrayDeltaSerialize<FStratUnitNetState, FStratUnitNetArray>(Items, DeltaParms, *this);
+	}
+
+	UPROPERTY()
+	TArray<FStratUnitNetState> Items;
+
+	UPROPERTY(NotReplicated)
+	TObjectPtr<AStratUnitRegionProxy> Owner;
+};
+
+template<>
+struct TStructOpsTypeTraits<FStratUnitNetArray> : public TStructOpsTypeTraitsBase2<FStratUnitNetArray>
+{
+	enum { WithNetDeltaSerializer = true };
+};
+
+/**
+ * Replicates the units in one square region of the map. Spawned by the server's UStratUnitReplicationSubsystem.
+ * Grouping units by region lets one actor channel carry hundreds of them, and lets net priority follow each player's camera.
+ */
+UCLASS(NotPlaceable, Transient)
+class UE_RTS_API AStratUnitRegionProxy : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AStratUnitRegionProxy();
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Always relevant, except to a player whose join snapshot is still on its way. It carries these units already. */
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
+	/** Scales priority down with the distance from the region to the viewing player's camera. */
+	virtual float GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, float Time, bool bLowBandwidth) override;
+
+	/** Server. Adds or updates a unit. Only marks it dirty when its quantized state changed. */
+	void WriteUnit(const FStratUnitHandle& Unit, uint16 TypeId, uint8 Faction, const FVector& Location, float Yaw);
+
+	/** Server. */
+	void RemoveUnit(const FStratUnitHandle& Unit);
+
+	int32 GetNumUnits() const { return UnitStates.Items.Num(); }
+
+	SIZE_T GetAllocatedSize() const { return UnitStates.Items.GetAllocatedSize() + ItemIndices.GetAllocatedSize(); }
+
+	void SetRegion(const FIntPoint& InRegion, const FBox2D& InBounds);
+	const FBox2D& GetRegionBounds() const { return RegionBounds; }
+
+	//~ Client callbacks from the fast array.
+	void OnUnitStateReplicated(const FStratUnitNetState& State);
+	void OnUnitStateRemoved(const FStratUnitNetState& State);
+
+	/** Client. Applies every unit this region holds again, e.g. over an older join snapshot. */
+	void ReapplyUnitStates();
+
+protected:
+	UPROPERTY(Replicated)
+	FStratUnitNetArray UnitStates;
+
+	/** Server only. Index of each unit in UnitStates.Items. */
+	TMap<FStratUnitHandle, int32> ItemIndices;
+
+	UPROPERTY(VisibleInstanceOnly, Category="User|Info")
+	FIntPoint Region{FIntPoint::ZeroValue};
+
+	FBox2D RegionBounds{ForceInit};
+};
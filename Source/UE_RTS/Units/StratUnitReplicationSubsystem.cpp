@@ -0,0 +1,251 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratUnitReplicationSubsystem.h"
+
+#include "StratUnitRegionProxy.h"
+#include "StratUnitSettings.h"
+#include "StratUnitSimSubsystem.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Lockstep/StratLockstepSettings.h"
+#include "Memory/StratMemoryTags.h"
+#include "Player/StratPlayerCameraPawn.h"
+
+DECLARE_CYCLE_STAT(TEXT("Sync Regions"), STAT_StratUnits_SyncRegions, STATGROUP_StratUnits);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Num Regions"), STAT_StratUnits_NumRegions, STATGROUP_StratUnits);
+
+bool UStratUnitReplicationSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	//~ In lockstep every peer simulates every unit. Only commands travel.
+	return Super::ShouldCreateSubsystem(Outer) && !GetDefault<UStratLockstepSettings>()->bEnabled;
+}
+
+void UStratUnitReplicationSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	LLM_SCOPE_BYTAG(StratReplication);
+
+	Super::Initialize(Collection);
+
+	UnitSim = Collection.InitializeDependency<UStratUnitSimSubsystem>();
+	if (UnitSim)
+	{
+		UnitSim->OnPostSimStep.AddUObject(this, &ThisClass::OnSimStepped);
+	}
+}
+
+void UStratUnitReplicationSubsystem::Deinitialize()
+{
+	if (UnitSim)
+	{
+		UnitSim->OnPostSimStep.RemoveAll(this);
+	}
+
+	Super::Deinitialize();
+}
+
+void UStratUnitReplicationSubsystem::ApplyUnitState(const AStratUnitRegionProxy& Proxy, const FStratUnitNetState& State)
+{
+	LLM_SCOPE_BYTAG(StratReplication);
+
+	if (!UnitSim)
+	{
+		return;
+	}
+
+	ClientOwners.Add(State.Unit, &Proxy);
+
+	const FVector Location = State.GetLocation();
+	int32 Row;
+	FStratUnitChunk* Chunk = UnitSim->FindUnit(State.Unit, Row);
+	if (!Chunk)
+	{
+		UnitSim->SpawnReplicatedUnit(State.Unit, State.TypeId, Location, State.GetYaw(), State.Faction);
+		return;
+	}
+
+	Chunk->Factions[Row] = State.Faction;
+	Chunk->Yaws[Row] = State.GetYaw();
+
+	//~ Walking to the replicated position at the unit's own speed hides the update rate. Far off means we missed a lot, so snap.
+	const FVector3f Target(Location);
+	const float ClientSnapDistance = GetDefault<UStratUnitSettings>()->ClientSnapDistance;
+	if (FVector3f::DistSquared(Chunk->Positions[Row], Target) > FMath::Square(ClientSnapDistance))
+	{
+		Chunk->Positions[Row] = Target;
+		Chunk->Velocities[Row] = FVector3f::ZeroVector;
+		Chunk->Orders[Row] = FStratUnitOrder();
+	}
+	else if (!Chunk->Positions[Row].Equals(Target, FStratUnitNetState::PositionQuantum))
+	{
+		Chunk->Orders[Row].Type = EStratUnitOrderType::Move;
+		Chunk->Orders[Row].TargetLocation = Target;
+	}
+}
+
+void UStratUnitReplicationSubsystem::RemoveUnitState(const AStratUnitRegionProxy& Proxy, const FStratUnitNetState& State)
+{
+	const TWeakObjectPtr<const AStratUnitRegionProxy>* Owner = ClientOwners.Find(State.Unit);
+	if (!Owner || Owner->Get() != &Proxy)
+	{
+		return;
+	}
+
+	ClientOwners.Remove(State.Unit);
+	if (UnitSim)
+	{
+		UnitSim->DestroyUnit(State.Unit);
+	}
+}
+
+FIntPoint UStratUnitReplicationSubsystem::GetRegionCoord(const FVector& Location) const
+{
+	const float RegionSize = GetDefault<UStratUnitSettings>()->ReplicationRegionSize;
+	return FIntPoint(FMath::FloorToInt32(Location.X / RegionSize), FMath::FloorToInt32(Location.Y / RegionSize));
+}
+
+SIZE_T UStratUnitReplicationSubsystem::GetAllocatedSize() const
+{
+	SIZE_T Result = ReplicatedUnits.GetAllocatedSize() + Proxies.GetAllocatedSize() + ClientOwners.GetAllocatedSize();
+	for (const TPair<FIntPoint, TObjectPtr<AStratUnitRegionProxy>>& Pair : Proxies)
+	{
+		Result += Pair.Value ? Pair.Value->GetAllocatedSize() : 0;
+	}
+	return Result;
+}
+
+bool UStratUnitReplicationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UStratUnitReplicationSubsystem::OnSimStepped(const float FixedDeltaTime)
+{
+	LLM_SCOPE_BYTAG(StratReplication);
+
+	const ENetMode NetMode = GetWorld()->GetNetMode();
+	if (NetMode != NM_DedicatedServer && NetMode != NM_ListenServer)
+	{
+		return;
+	}
+
+	const int32 ReplicateEveryNSteps = FMath::Max(GetDefault<UStratUnitSettings>()->ReplicateEveryNSteps, 1);
+	if (UnitSim->GetSimFrame() % ReplicateEveryNSteps == 0)
+	{
+		SyncRegions();
+		UpdateRegionFrequencies();
+	}
+}
+
+void UStratUnitReplicationSubsystem::SyncRegions()
+{
+	SCOPE_CYCLE_COUNTER(STAT_StratUnits_SyncRegions);
+	STRAT_SCOPED_SYSTEM_TIMING(UnitReplication);
+
+	++SyncPass;
+
+	UnitSim->ForEachChunk([this](const FStratUnitChunk& Chunk)
+	{
+		for (int32 Row = 0; Row < Chunk.Num; ++Row)
+		{
+			const FStratUnitHandle Unit = Chunk.Handles[Row];
+			const FVector Location(Chunk.Positions[Row]);
+			const FIntPoint Region = GetRegionCoord(Location);
+
+			if (!ReplicatedUnits.IsValidIndex(Unit.GetIndex()))
+			{
+				ReplicatedUnits.SetNum(Unit.GetIndex() + 1);
+			}
+
+			//~ A different serial means the old unit died and the slot was reused before we noticed.
+			FReplicatedUnit& Replicated = ReplicatedUnits[Unit.GetIndex()];
+			if (Replicated.bInRegion && (Replicated.Unit != Unit || Replicated.Region != Region))
+			{
+				if (const TObjectPtr<AStratUnitRegionProxy>* OldProxy = Proxies.Find(Replicated.Region))
+				{
+					(*OldProxy)->RemoveUnit(Replicated.Unit);
+				}
+				Replicated.bInRegion = false;
+			}
+
+			AStratUnitRegionProxy* Proxy = FindOrSpawnProxy(Region);
+			if (!Proxy)
+			{
+				continue;
+			}
+
+			Proxy->WriteUnit(Unit, Chunk.TypeIds[Row], Chunk.Factions[Row], Location, Chunk.Yaws[Row]);
+			Replicated.Unit = Unit;
+			Replicated.Region = Region;
+			Replicated.LastSyncPass = SyncPass;
+			Replicated.bInRegion = true;
+		}
+	});
+
+	//~ Anything not visited this pass was destroyed.
+	for (FReplicatedUnit& Replicated : ReplicatedUnits)
+	{
+		if (Replicated.bInRegion && Replicated.LastSyncPass != SyncPass)
+		{
+			if (const TObjectPtr<AStratUnitRegionProxy>* Proxy = Proxies.Find(Replicated.Region))
+			{
+				(*Proxy)->RemoveUnit(Replicated.Unit);
+			}
+			Replicated.bInRegion = false;
+		}
+	}
+
+	SET_DWORD_STAT(STAT_StratUnits_NumRegions, Proxies.Num());
+}
+
+void UStratUnitReplicationSubsystem::UpdateRegionFrequencies()
+{
+	TArray<FVector2D, TInlineAllocator<16>> CameraLocations;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PC = It->Get();
+		if (const AStratPlayerCameraPawn* Camera = PC ? Cast<AStratPlayerCameraPawn>(PC->GetPawn()) : nullptr)
+		{
+			CameraLocations.Add(FVector2D(Camera->GetSimpleRepMovement().Location));
+		}
+	}
+
+	//~ Per connection priority is in AStratUnitRegionProxy::GetNetPriority. This only saves the server from
+	//~ diffing regions nobody is looking at.
+	const UStratUnitSettings* Settings = GetDefault<UStratUnitSettings>();
+	for (const TPair<FIntPoint, TObjectPtr<AStratUnitRegionProxy>>& Pair : Proxies)
+	{
+		AStratUnitRegionProxy* Proxy = Pair.Value;
+		double NearestDistSq = CameraLocations.IsEmpty() ? 0.0 : UE_BIG_NUMBER;
+		for (const FVector2D& CameraLoc : CameraLocations)
+		{
+			NearestDistSq = FMath::Min(NearestDistSq, Proxy->GetRegionBounds().ComputeSquaredDistanceToPoint(CameraLoc));
+		}
+
+		const float Alpha = FMath::Clamp(FMath::GetRangePct(Settings->NearCameraDistance, Settings->FarCameraDistance, static_cast<float>(FMath::Sqrt(NearestDistSq))), 0.f, 1.f);
+		Proxy->SetNetUpdateFrequency(FMath::Lerp(Settings->NearNetUpdateFrequency, Settings->FarNetUpdateFrequency, Alpha));
+	}
+}
+
+AStratUnitRegionProxy* UStratUnitReplicationSubsystem::FindOrSpawnProxy(const FIntPoint& Region)
+{
+	if (const TObjectPtr<AStratUnitRegionProxy>* Existing = Proxies.Find(Region))
+	{
+		return *Existing;
+	}
+
+	const float RegionSize = GetDefault<UStratUnitSettings>()->ReplicationRegionSize;
+	const FBox2D Bounds(FVector2D(Region) * RegionSize, FVector2D(Region + FIntPoint(1, 1)) * RegionSize);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+
+	AStratUnitRegionProxy* Proxy = GetWorld()->SpawnActor<AStratUnitRegionProxy>(FVector(Bounds.GetCenter(), 0.0), FRotator::ZeroRotator, SpawnParams);
+	if (Proxy)
+	{
+		//~ Empty regions stay around. Destroying them would only churn actor channels as units cross back and forth.
+		Proxy->SetRegion(Region, Bounds);
+		Proxies.Add(Region, Proxy);
+	}
+	return Proxy;
+}
@@ -0,0 +1,79 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StratUnitTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "StratUnitReplicationSubsystem.generated.h"
+
+class AStratUnitRegionProxy;
+class UStratUnitSimSubsystem;
+struct FStratUnitNetState;
+
+/**
+ * Replicates the unit simulation. Units are data, not actors, so instead of one actor channel per unit the server
+ * buckets them into map regions, each an AStratUnitRegionProxy carrying a fast array of quantized unit states.
+ *
+ * Server: copies sim state into the regions every few steps. Regions far from every camera update less often.
+ * Client: feeds replicated states back into its own UStratUnitSimSubsystem, which walks units toward them.
+ */
+UCLASS()
+class UE_RTS_API UStratUnitReplicationSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	/** Client. A region added or changed a unit. */
+	void ApplyUnitState(const AStratUnitRegionProxy& Proxy, const FStratUnitNetState& State);
+
+	/** Client. A region dropped a unit. Ignored if the unit already moved to another region. */
+	void RemoveUnitState(const AStratUnitRegionProxy& Proxy, const FStratUnitNetState& State);
+
+	/** Client. True while a live region holds the unit. */
+	bool IsClaimedByRegion(const FStratUnitHandle& Unit) const
+	{
+		const TWeakObjectPtr<const AStratUnitRegionProxy>* Owner = ClientOwners.Find(Unit);
+		return Owner && Owner->IsValid();
+	}
+
+	FIntPoint GetRegionCoord(const FVector& Location) const;
+
+	/** On the server this includes the unit arrays of every region proxy it spawned. */
+	SIZE_T GetAllocatedSize() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void OnSimStepped(float FixedDeltaTime);
+	void SyncRegions();
+	void UpdateRegionFrequencies();
+	AStratUnitRegionProxy* FindOrSpawnProxy(const FIntPoint& Region);
+
+	/** Server. Which region each unit was last written to. Indexed by handle index. */
+	struct FReplicatedUnit
+	{
+		FStratUnitHandle Unit;
+		FIntPoint Region{FIntPoint::ZeroValue};
+		uint32 LastSyncPass{0};
+		bool bInRegion{false};
+	};
+	TArray<FReplicatedUnit> ReplicatedUnits;
+
+	UPROPERTY(Transient)
+	TMap<FIntPoint, TObjectPtr<AStratUnitRegionProxy>> Proxies;
+
+	/** Client. The region each unit was last replicated by, so a late remove from the old region is ignored. */
+	TMap<FStratUnitHandle, TWeakObjectPtr<const AStratUnitRegionProxy>> ClientOwners;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratUnitSimSubsystem> UnitSim;
+
+	uint32 SyncPass{0};
+};
@@ -0,0 +1,216 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratUnitRosterComponent.h"
+
+#include "StratUnitSettings.h"
+#include "StratUnitSimSubsystem.h"
+#include "Engine/World.h"
+#include "Faction/StratFactionSubsystem.h"
+#include "GameFramework/PlayerController.h"
+#include "Memory/StratMemoryTags.h"
+#include "Net/UnrealNetwork.h"
+#include "Player/StratPlayerState.h"
+
+DECLARE_CYCLE_STAT(TEXT("Roster Sync"), STAT_StratUnits_RosterSync, STATGROUP_StratUnits);
+
+uint8 FStratRosterEntry::ToHealthBucket(const float Health, const float MaxHealth)
+{
+	const float Fraction = MaxHealth > 0.f ? FMath::Clamp(Health / MaxHealth, 0.f, 1.f) : 1.f;
+	return static_cast<uint8>(FMath::Max(FMath::CeilToInt32(Fraction * NumHealthBuckets), 1));
+}
+
+void FStratRosterEntry::PreReplicatedRemove(const FStratRosterArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnEntryRemoved(*this);
+	}
+}
+
+void FStratRosterEntry::PostReplicatedAdd(const FStratRosterArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnEntryAdded(*this);
+	}
+}
+
+void FStratRosterEntry::PostReplicatedChange(const FStratRosterArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnEntryChanged(*this);
+	}
+}
+
+void FStratRosterArray::PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters)
+{
+	if (Owner)
+	{
+		Owner->FlushPendingChanges();
+	}
+}
+
+UStratUnitRosterComponent::UStratUnitRosterComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	SetIsReplicatedByDefault(true);
+	Roster.Owner = this;
+}
+
+void UStratUnitRosterComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME_CONDITION(UStratUnitRosterComponent, Roster, COND_OwnerOnly);
+}
+
+void UStratUnitRosterComponent::BeginPlay()
+{
+	LLM_SCOPE_BYTAG(StratReplication);
+
+	Super::BeginPlay();
+
+	Roster.Owner = this;
+	UnitSim = GetWorld()->GetSubsystem<UStratUnitSimSubsystem>();
+	Factions = GetWorld()->GetSubsystem<UStratFactionSubsystem>();
+	if (!UnitSim)
+	{
+		return;
+	}
+
+	//~ Lockstep peers all run the simulation, so each builds its own roster.
+	if (UnitSim->IsLockstep())
+	{
+		SetIsReplicated(false);
+	}
+
+	if (GetOwner()->HasAuthority() || UnitSim->IsLockstep())
+	{
+		UnitSim->OnPostSimStep.AddUObject(this, &ThisClass::OnSimStepped);
+	}
+}
+
+void UStratUnitRosterComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UnitSim)
+	{
+		UnitSim->OnPostSimStep.RemoveAll(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UStratUnitRosterComponent::FlushPendingChanges()
+{
+	if (!PendingChanges.IsEmpty())
+	{
+		OnRosterChanged.Broadcast(PendingChanges);
+		PendingChanges.Reset();
+	}
+}
+
+void UStratUnitRosterComponent::OnSimStepped(const float FixedDeltaTime)
+{
+	//~ Lockstep peers only need their own roster. The controller can arrive after BeginPlay, so this asks every time.
+	const APlayerController* PC = GetPlayerStateChecked<APlayerState>()->GetPlayerController();
+	if (UnitSim->IsLockstep() && (!PC || !PC->IsLocalController()))
+	{
+		return;
+	}
+
+	if (++StepsSinceSync < GetDefault<UStratUnitSettings>()->RosterSyncEveryNSteps)
+	{
+		return;
+	}
+
+	StepsSinceSync = 0;
+	SyncRoster();
+	FlushPendingChanges();
+}
+
+void UStratUnitRosterComponent::SyncRoster()
+{
+	LLM_SCOPE_BYTAG(StratReplication);
+
+	SCOPE_CYCLE_COUNTER(STAT_StratUnits_RosterSync);
+	STRAT_SCOPED_SYSTEM_TIMING(RosterSync);
+
+	++SyncPass;
+
+	//~ Units of factions the player no longer commands aren't seen, so they're removed below like dead ones.
+	const AStratPlayerState* Player = GetPlayerState<AStratPlayerState>();
+	const uint8 Faction = Player ? Player->GetFactionId() : 0;
+	const uint64 ControlMask = Factions ? Factions->GetControlMask(Faction) : StratFaction::Bit(Faction);
+
+	UnitSim->ForEachChunk([this, ControlMask](const FStratUnitChunk& Chunk)
+	{
+		for (int32 Row = 0; Row < Chunk.Num; ++Row)
+		{
+			if ((ControlMask & StratFaction::Bit(Chunk.Factions[Row])) == 0)
+			{
+				continue;
+			}
+
+			const FStratUnitHandle Unit = Chunk.Handles[Row];
+			const uint16 TypeId = Chunk.TypeIds[Row];
+			const uint8 HealthBucket = FStratRosterEntry::ToHealthBucket(Chunk.Health[Row], UnitSim->GetTypeInfo(TypeId).MaxHealth);
+
+			const int32 SlotIndex = Unit.GetIndex();
+			while (SlotIndex >= EntryIndices.Num())
+			{
+				EntryIndices.Add(INDEX_NONE);
+			}
+
+			//~ A recycled slot still points at the old unit's entry until that one is removed below.
+			int32& EntryIndex = EntryIndices[SlotIndex];
+			if (Roster.Items.IsValidIndex(EntryIndex) && Roster.Items[EntryIndex].Unit == Unit)
+			{
+				FStratRosterEntry& Entry = Roster.Items[EntryIndex];
+				Entry.SeenPass = SyncPass;
+				if (Entry.HealthBucket != HealthBucket || Entry.Faction != Chunk.Factions[Row])
+				{
+					Entry.HealthBucket = HealthBucket;
+					Entry.Faction = Chunk.Factions[Row];
+					Roster.MarkItemDirty(Entry);
+					PendingChanges.Changed.Add(Entry);
+				}
+				continue;
+			}
+
+			FStratRosterEntry& Entry = Roster.Items.AddDefaulted_GetRef();
+			Entry.Unit = Unit;
+			Entry.TypeId = TypeId;
+			Entry.Faction = Chunk.Factions[Row];
+			Entry.HealthBucket = HealthBucket;
+			Entry.SeenPass = SyncPass;
+			Roster.MarkItemDirty(Entry);
+			PendingChanges.Added.Add(Entry);
+			EntryIndex = Roster.Items.Num() - 1;
+		}
+	});
+
+	bool bRemovedAny = false;
+	for (int32 Index = Roster.Items.Num() - 1; Index >= 0; --Index)
+	{
+		if (Roster.Items[Index].SeenPass == SyncPass)
+		{
+			continue;
+		}
+
+		PendingChanges.Removed.Add(Roster.Items[Index]);
+		Roster.Items.RemoveAtSwap(Index, EAllowShrinking::No);
+		bRemovedAny = true;
+
+		//~ The swapped in entry was already visited, only its index moved.
+		if (Roster.Items.IsValidIndex(Index))
+		{
+			EntryIndices[Roster.Items[Index].Unit.GetIndex()] = Index;
+		}
+	}
+
+	if (bRemovedAny)
+	{
+		Roster.MarkArrayDirty();
+	}
+}
@@ -0,0 +1,144 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/PlayerStateComponent.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "StratUnitTypes.h"
+#include "StratUnitRosterComponent.generated.h"
+
+class UStratFactionSubsystem;
+class UStratUnitRosterComponent;
+class UStratUnitSimSubsystem;
+
+/** One roster row. Only what a roster or portrait list shows, so a unit taking damage rarely dirties it. */
+USTRUCT()
+struct FStratRosterEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	static constexpr int32 NumHealthBuckets = 16;
+
+	static uint8 ToHealthBucket(float Health, float MaxHealth);
+	float GetHealthFraction() const { return static_cast<float>(HealthBucket) / NumHealthBuckets; }
+
+	void PreReplicatedRemove(const struct FStratRosterArray& InArraySerializer);
+	void PostReplicatedAdd(const struct FStratRosterArray& InArraySerializer);
+	void PostReplicatedChange(const struct FStratRosterArray& InArraySerializer);
+
+	UPROPERTY()
+	FStratUnitHandle Unit;
+
+	UPROPERTY()
+	uint16 TypeId{0};
+
+	UPROPERTY()
+	uint8 Faction{0};
+
+	/** Health in NumHealthBuckets steps, rounded up so a living unit is never at zero. */
+	UPROPERTY()
+	uint8 HealthBucket{0};
+
+	/** Server. Last sync that found the unit alive. */
+	uint32 SeenPass{0};
+};
+
+USTRUCT()
+struct FStratRosterArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FastArrayDeltaSerialize<FStratRosterEntry, FStratRosterArray>(Items, DeltaParms, *this);
+	}
+
+	void PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters);
+
+	UPROPERTY()
+	TArray<FStratRosterEntry> Items;
+
+	UPROPERTY(NotReplicated)
+	TObjectPtr<UStratUnitRosterComponent> Owner;
+};
+
+template<>
+struct TStructOpsTypeTraits<FStratRosterArray> : public TStructOpsTypeTraitsBase2<FStratRosterArray>
+{
+	enum { WithNetDeltaSerializer = true };
+};
+
+/** Everything that changed in one roster update. Removed entries are gone from the roster by the time listeners run. */
+struct FStratRosterChangeSet
+{
+	TArray<FStratRosterEntry> Added;
+	TArray<FStratRosterEntry> Changed;
+	TArray<FStratRosterEntry> Removed;
+
+	bool IsEmpty() const { return Added.IsEmpty() && Changed.IsEmpty() && Removed.IsEmpty(); }
+
+	void Reset()
+	{
+		Added.Reset();
+		Changed.Reset();
+		Removed.Reset();
+	}
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnStratRosterChanged, const FStratRosterChangeSet& /*Changes*/);
+
+/**
+ * Every living unit of the factions the owning player commands, for rosters and portrait lists. Lives on AStratPlayerState
+ * and replicates to that player only, so no client learns about units it can't see from it.
+ *
+ * The server copies the simulation into each player's roster every UStratUnitSettings::RosterSyncEveryNSteps and replicates
+ * it as a fast array, so clients get one batch of adds, changes and removes per update instead of an event per unit. Units
+ * leave it when control of their faction is lost. In lockstep every peer has the simulation, so each builds only its local
+ * player's roster and nothing is replicated.
+ */
+UCLASS(ClassGroup=(Strat), meta=(BlueprintSpawnableComponent))
+class UE_RTS_API UStratUnitRosterComponent : public UPlayerStateComponent
+{
+	GENERATED_BODY()
+
+public:
+	UStratUnitRosterComponent(const FObjectInitializer& ObjectInitializer);
+
+	//~ Begin UActorComponent interface
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	//~ End UActorComponent interface
+
+	TConstArrayView<FStratRosterEntry> GetEntries() const { return Roster.Items; }
+
+	/** Broadcast once per roster update with the whole batch. */
+	FOnStratRosterChanged OnRosterChanged;
+
+	/** Client. Called by replication. */
+	void OnEntryAdded(const FStratRosterEntry& Entry) { PendingChanges.Added.Add(Entry); }
+	void OnEntryChanged(const FStratRosterEntry& Entry) { PendingChanges.Changed.Add(Entry); }
+	void OnEntryRemoved(const FStratRosterEntry& Entry) { PendingChanges.Removed.Add(Entry); }
+	void FlushPendingChanges();
+
+protected:
+	void OnSimStepped(float FixedDeltaTime);
+	void SyncRoster();
+
+	UPROPERTY(Replicated)
+	FStratRosterArray Roster;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratUnitSimSubsystem> UnitSim;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratFactionSubsystem> Factions;
+
+	/** Where each unit's entry is in Roster.Items, indexed by handle index. Only valid while the handle matches. */
+	TArray<int32> EntryIndices;
+
+	FStratRosterChangeSet PendingChanges;
+	uint32 SyncPass{0};
+	int32 StepsSinceSync{0};
+};
@@ -0,0 +1,8 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratUnitSettings.h"
+
+UStratUnitSettings::UStratUnitSettings()
+{
+	CategoryName = TEXT("Game");
+}
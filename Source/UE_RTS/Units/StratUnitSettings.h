@@ -0,0 +1,90 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "StratUnitSettings.generated.h"
+
+class UStratUnitDefinition;
+
+/** Project settings for the unit simulation. Found under Project Settings > Game > Strat Units. */
+UCLASS(Config=Game, DefaultConfig, meta=(DisplayName="Strat Units"))
+class UE_RTS_API UStratUnitSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UStratUnitSettings();
+
+	/** Every unit type that can exist in a match. The array index is the unit's type id, so keep the order stable between server and clients. */
+	UPROPERTY(Config, EditAnywhere, Category="Units")
+	TArray<TSoftObjectPtr<UStratUnitDefinition>> UnitDefinitions;
+
+	/** Simulation steps per second. The simulation always runs at a fixed step regardless of frame rate. */
+	UPROPERTY(Config, EditAnywhere, Category="Simulation", meta=(ClampMin="1", ClampMax="120", UIMin="10", UIMax="60"))
+	int32 SimTickRate{20};
+
+	/** Caps catch-up after a hitch so a long frame can't snowball into more long frames. */
+	UPROPERTY(Config, EditAnywhere, Category="Simulation", meta=(ClampMin="1", ClampMax="16"))
+	int32 MaxStepsPerFrame{4};
+
+	/** Orders a unit can have queued after its current one. Further queued orders are dropped. */
+	UPROPERTY(Config, EditAnywhere, Category="Orders", meta=(ClampMin="1", ClampMax="256"))
+	int32 MaxQueuedOrders{32};
+
+	/** Queued order slots allocated up front, shared by every unit. The pool grows past this when needed. */
+	UPROPERTY(Config, EditAnywhere, Category="Orders", meta=(ClampMin="0"))
+	int32 InitialQueuedOrderSlots{4096};
+
+	/** Units closer than this to a local camera get a presentation actor. */
+	UPROPERTY(Config, EditAnywhere, Category="Presentation", meta=(ClampMin="0.0", Units="cm"))
+	float PromoteRadius{6000.f};
+
+	/** Presented units further than PromoteRadius * this go back to pure data. Keeps units at the edge from flickering. */
+	UPROPERTY(Config, EditAnywhere, Category="Presentation", meta=(ClampMin="1.0", ClampMax="2.0"))
+	float DemoteHysteresis{1.2f};
+
+	/** Hard cap on presentation actors per machine. Selected units win over nearby ones. */
+	UPROPERTY(Config, EditAnywhere, Category="Presentation", meta=(ClampMin="0"))
+	int32 MaxPresentedUnits{300};
+
+	/** How often promotion and demotion is re-evaluated in seconds. Presented actors still follow their unit every frame. */
+	UPROPERTY(Config, EditAnywhere, Category="Presentation", meta=(ClampMin="0.0", Units="s"))
+	float PresentationUpdateInterval{0.25f};
+
+	/** Units replicate in square regions of this size, one AStratUnitRegionProxy each. Smaller regions prioritize more precisely but cost more channels. */
+	UPROPERTY(Config, EditAnywhere, Category="Replication", meta=(ClampMin="2000.0", Units="cm"))
+	float ReplicationRegionSize{16000.f};
+
+	/** The server copies unit state into the replicated regions every this many sim steps. */
+	UPROPERTY(Config, EditAnywhere, Category="Replication", meta=(ClampMin="1", ClampMax="20"))
+	int32 ReplicateEveryNSteps{2};
+
+	/** The unit roster on the game state is refreshed every this many sim steps. Rosters only show coarse health, so slow is fine. */
+	UPROPERTY(Config, EditAnywhere, Category="Replication", meta=(ClampMin="1", ClampMax="200"))
+	int32 RosterSyncEveryNSteps{10};
+
+	/** Regions within this distance of a player's camera replicate to that player at full priority. */
+	UPROPERTY(Config, EditAnywhere, Category="Replication", meta=(ClampMin="0.0", Units="cm"))
+	float NearCameraDistance{10000.f};
+
+	/** Regions at or beyond this distance of a player's camera replicate to that player at FarPriorityScale. */
+	UPROPERTY(Config, EditAnywhere, Category="Replication", meta=(ClampMin="0.0", Units="cm"))
+	float FarCameraDistance{50000.f};
+
+	/** Net priority multiplier for regions far from the viewer's camera. */
+	UPROPERTY(Config, EditAnywhere, Category="Replication", meta=(ClampMin="0.01", ClampMax="1.0"))
+	float FarPriorityScale{0.1f};
+
+	/** Net update frequency of regions near any camera. Regions lerp down to FarNetUpdateFrequency as the nearest camera gets further away. */
+	UPROPERTY(Config, EditAnywhere, Category="Replication", meta=(ClampMin="1.0", ClampMax="60.0"))
+	float NearNetUpdateFrequency{10.f};
+
+	UPROPERTY(Config, EditAnywhere, Category="Replication", meta=(ClampMin="0.1", ClampMax="60.0"))
+	float FarNetUpdateFrequency{1.f};
+
+	/** Clients walk units to their replicated position, but teleport them when they're further off than this. */
+	UPROPERTY(Config, EditAnywhere, Category="Replication", meta=(ClampMin="0.0", Units="cm"))
+	float ClientSnapDistance{1500.f};
+};
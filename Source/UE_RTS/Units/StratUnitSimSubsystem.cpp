@@ -0,0 +1,1232 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratUnitSimSubsystem.h"
+
+#include "StratUnitCharacter.h"
+#include "StratUnitDefinition.h"
+#include "StratUnitSettings.h"
+#include "StratUnitSnapshot.h"
+#include "Async/ParallelFor.h"
+#include "Events/StratEventBusSubsystem.h"
+#include "Faction/StratFactionTypes.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Memory/StratMemoryTags.h"
+
+DEFINE_LOG_CATEGORY(LogStratUnits);
+
+CSV_DEFINE_CATEGORY_MODULE(UE_RTS_API, StratUnits, true);
+
+uint64 StratSystemTiming::TotalCycles[static_cast<int32>(EStratTimedSystem::Count)] = {};
+
+const TCHAR* StratSystemTiming::GetName(const EStratTimedSystem System)
+{
+	static const TCHAR* Names[] = {TEXT("SimStep"), TEXT("Presentation"), TEXT("UnitReplication"), TEXT("RosterSync"), TEXT("FogOfWar"),
+		TEXT("Targeting"), TEXT("Projectiles"), TEXT("PathRequests"), TEXT("AIBehaviors"), TEXT("EventDispatch")};
+	static_assert(UE_ARRAY_COUNT(Names) == static_cast<int32>(EStratTimedSystem::Count), "A name per timed system.");
+	return Names[static_cast<int32>(System)];
+}
+
+double StratSystemTiming::GetTotalMs(const EStratTimedSystem System)
+{
+	return FPlatformTime::ToMilliseconds64(TotalCycles[static_cast<int32>(System)]);
+}
+
+void StratSystemTiming::Reset()
+{
+	FMemory::Memzero(TotalCycles);
+}
+
+DECLARE_CYCLE_STAT(TEXT("Sim Step"), STAT_StratUnits_SimStep, STATGROUP_StratUnits);
+DECLARE_CYCLE_STAT(TEXT("Order System"), STAT_StratUnits_OrderSystem, STATGROUP_StratUnits);
+DECLARE_CYCLE_STAT(TEXT("Movement System"), STAT_StratUnits_MovementSystem, STATGROUP_StratUnits);
+DECLARE_CYCLE_STAT(TEXT("Presentation"), STAT_StratUnits_Presentation, STATGROUP_StratUnits);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Num Units"), STAT_StratUnits_NumUnits, STATGROUP_StratUnits);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Num Presented"), STAT_StratUnits_NumPresented, STATGROUP_StratUnits);
+DECLARE_CYCLE_STAT(TEXT("Write Snapshot"), STAT_StratUnits_WriteSnapshot, STATGROUP_StratUnits);
+DECLARE_CYCLE_STAT(TEXT("Read Snapshot"), STAT_StratUnits_ReadSnapshot, STATGROUP_StratUnits);
+
+namespace
+{
+	template <typename ElementType, uint32 Capacity>
+	void CopyToColumn(TArray<ElementType>& Column, const int32 FirstRow, const TStaticArray<ElementType, Capacity>& ChunkColumn, const int32 Num)
+	{
+		FMemory::Memcpy(Column.GetData() + FirstRow, ChunkColumn.GetData(), Num * sizeof(ElementType));
+	}
+
+	template <typename ElementType, uint32 Capacity>
+	void CopyFromColumn(TStaticArray<ElementType, Capacity>& ChunkColumn, const int32 ChunkRow, const TArray<ElementType>& Column, const int32 FirstRow, const int32 Num)
+	{
+		FMemory::Memcpy(ChunkColumn.GetData() + ChunkRow, Column.GetData() + FirstRow, Num * sizeof(ElementType));
+	}
+}
+
+void UStratUnitSimSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	LLM_SCOPE_BYTAG(StratUnits);
+
+	Super::Initialize(Collection);
+
+	EventBus = Collection.InitializeDependency<UStratEventBusSubsystem>();
+
+	const UStratUnitSettings* Settings = GetDefault<UStratUnitSettings>();
+	bPresentationEnabled = !IsRunningDedicatedServer();
+
+	//~ Definitions are tiny data assets. Loading them up front keeps hitches out of spawning.
+	for (const TSoftObjectPtr<UStratUnitDefinition>& SoftDefinition : Settings->UnitDefinitions)
+	{
+		const UStratUnitDefinition* Definition = SoftDefinition.LoadSynchronous();
+		UE_CLOG(!Definition, LogStratUnits, Error, TEXT("Unit definition %s failed to load. Its type id will spawn default units."), *SoftDefinition.ToString());
+
+		Definitions.Add(Definition);
+		TypeInfos.Add(Definition ? Definition->MakeTypeInfo() : FStratUnitTypeInfo());
+		PresentationClasses.Add(bPresentationEnabled && Definition ? Definition->PresentationClass.LoadSynchronous() : nullptr);
+	}
+
+	OrderQueuePool.Reserve(Settings->InitialQueuedOrderSlots);
+
+	UE_CLOG(TypeInfos.Num() > MAX_uint16, LogStratUnits, Error, TEXT("Too many unit definitions (%d). Type ids are 16 bit."), TypeInfos.Num());
+}
+
+void UStratUnitSimSubsystem::Deinitialize()
+{
+	for (const TPair<FStratUnitHandle, TObjectPtr<AStratUnitCharacter>>& Pair : PresentedActors)
+	{
+		if (IsValid(Pair.Value))
+		{
+			Pair.Value->Destroy();
+		}
+	}
+	PresentedActors.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UStratUnitSimSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UStratUnitSimSubsystem::Tick(const float DeltaTime)
+{
+	LLM_SCOPE_BYTAG(StratUnits);
+
+	Super::Tick(DeltaTime);
+
+	//~ In lockstep the lockstep subsystem decides when to step. Presentation still runs every frame.
+	if (!bLockstep)
+	{
+		const float FixedDeltaTime = GetFixedDeltaTime();
+		StepAccumulator += DeltaTime;
+		int32 NumSteps = 0;
+		while (StepAccumulator >= FixedDeltaTime && NumSteps < GetDefault<UStratUnitSettings>()->MaxStepsPerFrame)
+		{
+			StepSimulation(FixedDeltaTime);
+			StepAccumulator -= FixedDeltaTime;
+			++NumSteps;
+		}
+
+		//~ Drop the backlog after a hitch rather than trying to catch up over several frames.
+		StepAccumulator = FMath::Min(StepAccumulator, FixedDeltaTime);
+	}
+
+	if (bPresentationEnabled && GetWorld()->GetNetMode() != NM_DedicatedServer)
+	{
+		UpdatePresentation(DeltaTime);
+	}
+
+	SET_DWORD_STAT(STAT_StratUnits_NumUnits, NumUnits);
+	SET_DWORD_STAT(STAT_StratUnits_NumPresented, PresentedActors.Num());
+}
+
+TStatId UStratUnitSimSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UStratUnitSimSubsystem, STATGROUP_StratUnits);
+}
+
+void UStratUnitSimSubsystem::EnableLockstep()
+{
+	ensureMsgf(NumUnits == 0, TEXT("Lockstep has to start from an empty simulation."));
+	bLockstep = true;
+	StepAccumulator = 0.f;
+}
+
+void UStratUnitSimSubsystem::StepOnce()
+{
+	LLM_SCOPE_BYTAG(StratUnits);
+
+	check(bLockstep);
+	StepSimulation(GetFixedDeltaTime());
+}
+
+float UStratUnitSimSubsystem::GetFixedDeltaTime() const
+{
+	return 1.f / FMath::Max(GetDefault<UStratUnitSettings>()->SimTickRate, 1);
+}
+
+uint32 UStratUnitSimSubsystem::ComputeStateHash() const
+{
+	//~ Chunk and row order only depend on the order of spawns and destroys, which lockstep makes identical on every peer.
+	uint32 Hash = FCrc::MemCrc32(&SimFrame, sizeof(SimFrame));
+
+	//~ Which handles and chunks the next spawns get. Differences here only show in the units later, so catch them now.
+	Hash = FCrc::MemCrc32(FreeSlots.GetData(), FreeSlots.Num() * sizeof(int32), Hash);
+	for (const FStratUnitArchetypeStorage& Storage : Archetypes)
+	{
+		//~ Empty chunks past the last unit never change what happens, and a read may leave more of them.
+		for (int32 ChunkIndex = 0; ChunkIndex < Storage.Chunks.Num(); ++ChunkIndex)
+		{
+			if (!Storage.Chunks[ChunkIndex]->IsEmpty())
+			{
+				const int32 ChunkNum = Storage.Chunks[ChunkIndex]->Num;
+				Hash = FCrc::MemCrc32(&ChunkIndex, sizeof(int32), Hash);
+				Hash = FCrc::MemCrc32(&ChunkNum, sizeof(int32), Hash);
+			}
+		}
+	}
+
+	//~ Field by field, FStratUnitOrder has padding.
+	const auto HashOrder = [&Hash](const FStratUnitOrder& Order)
+	{
+		const uint8 OrderType = static_cast<uint8>(Order.Type);
+		Hash = FCrc::MemCrc32(&OrderType, sizeof(OrderType), Hash);
+		Hash = FCrc::MemCrc32(&Order.FixedTargetLocation, sizeof(FStratFixedVector), Hash);
+		Hash = FCrc::MemCrc32(&Order.TargetLocation, sizeof(FVector3f), Hash);
+		Hash = FCrc::MemCrc32(&Order.TargetUnit, sizeof(FStratUnitHandle), Hash);
+	};
+
+	//~ Every column the simulation decides with. Positions, Velocities and Yaws are float copies for presentation and
+	//~ queries, and Selected and Presented are local, so they'd only report machines that agree as out of sync.
+	constexpr EStratUnitFlags SimFlags = EStratUnitFlags::OrderCompleted | EStratUnitFlags::InCombat;
+	ForEachChunk([this, &Hash, &HashOrder, SimFlags](const FStratUnitChunk& Chunk)
+	{
+		Hash = FCrc::MemCrc32(Chunk.Handles.GetData(), Chunk.Num * sizeof(FStratUnitHandle), Hash);
+		Hash = FCrc::MemCrc32(Chunk.FixedPositions.GetData(), Chunk.Num * sizeof(FStratFixedVector), Hash);
+		Hash = FCrc::MemCrc32(Chunk.Health.GetData(), Chunk.Num * sizeof(float), Hash);
+		Hash = FCrc::MemCrc32(Chunk.TypeIds.GetData(), Chunk.Num * sizeof(uint16), Hash);
+		Hash = FCrc::MemCrc32(Chunk.Factions.GetData(), Chunk.Num * sizeof(uint8), Hash);
+		for (int32 Row = 0; Row < Chunk.Num; ++Row)
+		{
+			const uint8 Flags = static_cast<uint8>(Chunk.Flags[Row] & SimFlags);
+			Hash = FCrc::MemCrc32(&Flags, sizeof(Flags), Hash);
+			HashOrder(Chunk.Orders[Row]);
+			Hash = FCrc::MemCrc32(&Chunk.QueuedOrders[Row].Num, sizeof(int32), Hash);
+			OrderQueuePool.ForEach(Chunk.QueuedOrders[Row], HashOrder);
+		}
+	});
+	return Hash;
+}
+
+SIZE_T UStratUnitSimSubsystem::GetAllocatedSize() const
+{
+	SIZE_T Result = Slots.GetAllocatedSize() + FreeSlots.GetAllocatedSize() + TypeInfos.GetAllocatedSize() + CompletedOrders.GetAllocatedSize()
+		+ OrderQueuePool.GetAllocatedSize() + Definitions.GetAllocatedSize() + PresentationClasses.GetAllocatedSize() + PresentedActors.GetAllocatedSize();
+	for (const FStratUnitArchetypeStorage& Storage : Archetypes)
+	{
+		//~ Chunks are fixed size, so a chunk costs the same whether it holds one unit or a full block.
+		Result += Storage.Chunks.GetAllocatedSize() + Storage.Chunks.Num() * sizeof(FStratUnitChunk);
+	}
+	return Result;
+}
+
+void UStratUnitSimSubsystem::WriteSnapshot(FStratUnitSnapshot& Out) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_StratUnits_WriteSnapshot);
+
+	Out.Reset();
+	Out.SimFrame = SimFrame;
+
+	Out.SlotSerials.SetNumUninitialized(Slots.Num());
+	for (int32 Index = 0; Index < Slots.Num(); ++Index)
+	{
+		Out.SlotSerials[Index] = Slots[Index].Serial;
+	}
+
+	Out.FreeSlots = FreeSlots;
+	for (int32 ArchetypeIndex = 0; ArchetypeIndex < Archetypes.Num(); ++ArchetypeIndex)
+	{
+		for (const TUniquePtr<FStratUnitChunk>& Chunk : Archetypes[ArchetypeIndex].Chunks)
+		{
+			Out.ChunkArchetypes.Add(static_cast<uint8>(ArchetypeIndex));
+			Out.ChunkSizes.Add(static_cast<uint8>(Chunk->Num));
+		}
+	}
+
+	Out.SetNumUnitsUninitialized(NumUnits);
+	Out.QueuedOrders.Reserve(OrderQueuePool.GetNumUsed());
+
+	int32 FirstRow = 0;
+	ForEachChunk([this, &Out, &FirstRow](const FStratUnitChunk& Chunk)
+	{
+		CopyToColumn(Out.Handles, FirstRow, Chunk.Handles, Chunk.Num);
+		CopyToColumn(Out.TypeIds, FirstRow, Chunk.TypeIds, Chunk.Num);
+		CopyToColumn(Out.Factions, FirstRow, Chunk.Factions, Chunk.Num);
+		CopyToColumn(Out.Positions, FirstRow, Chunk.Positions, Chunk.Num);
+		CopyToColumn(Out.FixedPositions, FirstRow, Chunk.FixedPositions, Chunk.Num);
+		CopyToColumn(Out.Velocities, FirstRow, Chunk.Velocities, Chunk.Num);
+		CopyToColumn(Out.Yaws, FirstRow, Chunk.Yaws, Chunk.Num);
+		CopyToColumn(Out.Health, FirstRow, Chunk.Health, Chunk.Num);
+
+		for (int32 Row = 0; Row < Chunk.Num; ++Row)
+		{
+			Out.Orders[FirstRow + Row] = FStratSavedOrder::FromOrder(Chunk.Orders[Row]);
+			Out.NumQueuedOrders[FirstRow + Row] = static_cast<uint16>(Chunk.QueuedOrders[Row].Num);
+			OrderQueuePool.ForEach(Chunk.QueuedOrders[Row], [&Out](const FStratUnitOrder& Order)
+			{
+				Out.QueuedOrders.Add(FStratSavedOrder::FromOrder(Order));
+			});
+		}
+
+		FirstRow += Chunk.Num;
+	});
+}
+
+bool UStratUnitSimSubsystem::ReadSnapshot(const FStratUnitSnapshot& Snapshot)
+{
+	LLM_SCOPE_BYTAG(StratUnits);
+	SCOPE_CYCLE_COUNTER(STAT_StratUnits_ReadSnapshot);
+
+	if (!Snapshot.IsConsistent() || Snapshot.SlotSerials.Num() > static_cast<int32>(FStratUnitHandle::IndexMask) + 1)
+	{
+		UE_LOG(LogStratUnits, Error, TEXT("Unit snapshot is malformed. Nothing was read."));
+		return false;
+	}
+
+	RemoveAllUnits();
+
+	SimFrame = Snapshot.SimFrame;
+	Slots.SetNum(Snapshot.SlotSerials.Num());
+	for (int32 Index = 0; Index < Slots.Num(); ++Index)
+	{
+		Slots[Index].Serial = FMath::Max(Snapshot.SlotSerials[Index], 1u);
+	}
+	OrderQueuePool.Reserve(Snapshot.QueuedOrders.Num());
+
+	//~ Claims the row's slot. A handle that's stale or already read is dropped, so a bad row can't alias another unit.
+	TBitArray<> ClaimedSlots(false, Slots.Num());
+	const auto TryClaimRow = [this, &Snapshot, &ClaimedSlots](const int32 Row)
+	{
+		const FStratUnitHandle Unit = Snapshot.Handles[Row];
+		if (!TypeInfos.IsValidIndex(Snapshot.TypeIds[Row]) || !Unit.IsValid() || !Slots.IsValidIndex(Unit.GetIndex())
+			|| Slots[Unit.GetIndex()].Serial != Unit.GetSerial() || ClaimedSlots[Unit.GetIndex()])
+		{
+			return false;
+		}
+		ClaimedSlots[Unit.GetIndex()] = true;
+		return true;
+	};
+
+	//~ Copies a run of claimed rows onto the end of a chunk, a column at a time.
+	int32 QueuedRow = 0;
+	const auto CopyRun = [this, &Snapshot, &QueuedRow](FStratUnitChunk& Chunk, const int32 ChunkIndex, const int32 Row, const int32 RunLength)
+	{
+		const int32 FirstChunkRow = Chunk.Num;
+		CopyFromColumn(Chunk.Handles, FirstChunkRow, Snapshot.Handles, Row, RunLength);
+		CopyFromColumn(Chunk.TypeIds, FirstChunkRow, Snapshot.TypeIds, Row, RunLength);
+		CopyFromColumn(Chunk.Factions, FirstChunkRow, Snapshot.Factions, Row, RunLength);
+		CopyFromColumn(Chunk.Positions, FirstChunkRow, Snapshot.Positions, Row, RunLength);
+		CopyFromColumn(Chunk.FixedPositions, FirstChunkRow, Snapshot.FixedPositions, Row, RunLength);
+		CopyFromColumn(Chunk.Velocities, FirstChunkRow, Snapshot.Velocities, Row, RunLength);
+		CopyFromColumn(Chunk.Yaws, FirstChunkRow, Snapshot.Yaws, Row, RunLength);
+		CopyFromColumn(Chunk.Health, FirstChunkRow, Snapshot.Health, Row, RunLength);
+
+		for (int32 RunRow = 0; RunRow < RunLength; ++RunRow)
+		{
+			const int32 ChunkRow = FirstChunkRow + RunRow;
+			Chunk.Orders[ChunkRow] = Snapshot.Orders[Row + RunRow].ToOrder();
+			Chunk.Flags[ChunkRow] = EStratUnitFlags::None;
+
+			Chunk.QueuedOrders[ChunkRow] = FStratOrderQueue();
+			for (int32 Queued = 0; Queued < Snapshot.NumQueuedOrders[Row + RunRow]; ++Queued)
+			{
+				OrderQueuePool.Append(Chunk.QueuedOrders[ChunkRow], Snapshot.QueuedOrders[QueuedRow++].ToOrder());
+			}
+
+			FUnitSlot& Slot = Slots[Chunk.Handles[ChunkRow].GetIndex()];
+			Slot.Archetype = Chunk.Archetype;
+			Slot.ChunkIndex = ChunkIndex;
+			Slot.IndexInChunk = ChunkRow;
+		}
+
+		Chunk.Num += RunLength;
+		NumUnits += RunLength;
+	};
+
+	int32 NumDropped = 0;
+	const auto DropRow = [&Snapshot, &QueuedRow, &NumDropped](const int32 Row)
+	{
+		QueuedRow += Snapshot.NumQueuedOrders[Row];
+		++NumDropped;
+	};
+
+	if (HasChunkLayout(Snapshot))
+	{
+		//~ Chunk for chunk as they were written, empty ones too, so spawns and iteration after the read go exactly as they would have.
+		TStaticArray<int32, static_cast<int32>(EStratUnitArchetype::MAX)> NextChunks(InPlace, 0);
+		int32 Row = 0;
+		for (int32 LayoutIndex = 0; LayoutIndex < Snapshot.ChunkSizes.Num(); ++LayoutIndex)
+		{
+			const EStratUnitArchetype Archetype = static_cast<EStratUnitArchetype>(Snapshot.ChunkArchetypes[LayoutIndex]);
+			FStratUnitArchetypeStorage& Storage = Archetypes[Snapshot.ChunkArchetypes[LayoutIndex]];
+			const int32 ChunkIndex = NextChunks[Snapshot.ChunkArchetypes[LayoutIndex]]++;
+			if (!Storage.Chunks.IsValidIndex(ChunkIndex))
+			{
+				Storage.Chunks.Add(MakeUnique<FStratUnitChunk>(Archetype));
+			}
+
+			const int32 ChunkEnd = Row + Snapshot.ChunkSizes[LayoutIndex];
+			while (Row < ChunkEnd)
+			{
+				if (!TryClaimRow(Row))
+				{
+					DropRow(Row++);
+					continue;
+				}
+
+				int32 RunEnd = Row + 1;
+				while (RunEnd < ChunkEnd && TryClaimRow(RunEnd))
+				{
+					++RunEnd;
+				}
+				CopyRun(*Storage.Chunks[ChunkIndex], ChunkIndex, Row, RunEnd - Row);
+				Row = RunEnd;
+			}
+		}
+	}
+	else
+	{
+		int32 Row = 0;
+		while (Row < Snapshot.Num())
+		{
+			if (!TryClaimRow(Row))
+			{
+				DropRow(Row++);
+				continue;
+			}
+
+			//~ A run of rows that fit the same chunk. Rows come in chunk order, so runs are usually whole chunks.
+			const EStratUnitArchetype Archetype = TypeInfos[Snapshot.TypeIds[Row]].Archetype;
+			int32 ChunkIndex;
+			FStratUnitChunk& Chunk = GetChunkWithRoom(Archetype, ChunkIndex);
+			const int32 MaxRunEnd = Row + (FStratUnitChunk::Capacity - Chunk.Num);
+			int32 RunEnd = Row + 1;
+			while (RunEnd < Snapshot.Num() && RunEnd < MaxRunEnd && TypeInfos.IsValidIndex(Snapshot.TypeIds[RunEnd])
+				&& TypeInfos[Snapshot.TypeIds[RunEnd]].Archetype == Archetype && TryClaimRow(RunEnd))
+			{
+				++RunEnd;
+			}
+
+			CopyRun(Chunk, ChunkIndex, Row, RunEnd - Row);
+			Row = RunEnd;
+		}
+	}
+
+	//~ Replicated clients never hand out handles, their units come with the server's. They keep no free list.
+	if (AllocatesHandles())
+	{
+		//~ In the order they were freed, so spawns after the read get the handles they would have. Rebuilt lowest first, like a
+		//~ fresh simulation, when the snapshot doesn't have them or they don't match the slots that ended up free.
+		TBitArray<> ListedSlots(false, Slots.Num());
+		bool bFreeSlotsMatch = Snapshot.FreeSlots.Num() == Slots.Num() - NumUnits;
+		for (int32 Index = 0; Index < Snapshot.FreeSlots.Num() && bFreeSlotsMatch; ++Index)
+		{
+			const int32 SlotIndex = Snapshot.FreeSlots[Index];
+			bFreeSlotsMatch = Slots.IsValidIndex(SlotIndex) && Slots[SlotIndex].ChunkIndex == INDEX_NONE && !ListedSlots[SlotIndex];
+			if (bFreeSlotsMatch)
+			{
+				ListedSlots[SlotIndex] = true;
+			}
+		}
+
+		if (bFreeSlotsMatch)
+		{
+			FreeSlots = Snapshot.FreeSlots;
+		}
+		else
+		{
+			for (int32 Index = Slots.Num() - 1; Index >= 0; --Index)
+			{
+				if (Slots[Index].ChunkIndex == INDEX_NONE)
+				{
+					FreeSlots.Add(Index);
+				}
+			}
+		}
+	}
+
+	UE_CLOG(NumDropped > 0, LogStratUnits, Warning, TEXT("Dropped %d units from a snapshot whose type or handle didn't fit this simulation."), NumDropped);
+	OnSnapshotRead.Broadcast();
+	return true;
+}
+
+bool UStratUnitSimSubsystem::HasChunkLayout(const FStratUnitSnapshot& Snapshot) const
+{
+	//~ Chunks go archetype after archetype and have to hold exactly the rows, each of its own archetype.
+	int32 Row = 0;
+	uint8 LastArchetype = 0;
+	for (int32 LayoutIndex = 0; LayoutIndex < Snapshot.ChunkSizes.Num(); ++LayoutIndex)
+	{
+		const uint8 Archetype = Snapshot.ChunkArchetypes[LayoutIndex];
+		const int32 ChunkEnd = Row + Snapshot.ChunkSizes[LayoutIndex];
+		if (Archetype >= static_cast<uint8>(EStratUnitArchetype::MAX) || Archetype < LastArchetype
+			|| Snapshot.ChunkSizes[LayoutIndex] > FStratUnitChunk::Capacity || ChunkEnd > Snapshot.Num())
+		{
+			return false;
+		}
+		LastArchetype = Archetype;
+
+		for (; Row < ChunkEnd; ++Row)
+		{
+			const uint16 TypeId = Snapshot.TypeIds[Row];
+			if (TypeInfos.IsValidIndex(TypeId) && TypeInfos[TypeId].Archetype != static_cast<EStratUnitArchetype>(Archetype))
+			{
+				return false;
+			}
+		}
+	}
+	return Row == Snapshot.Num();
+}
+
+void UStratUnitSimSubsystem::RemoveAllUnits()
+{
+	TArray<FStratUnitHandle> Presented;
+	PresentedActors.GenerateKeyArray(Presented);
+	for (const FStratUnitHandle& Unit : Presented)
+	{
+		DemoteUnit(Unit);
+	}
+
+	for (FStratUnitArchetypeStorage& Storage : Archetypes)
+	{
+		for (const TUniquePtr<FStratUnitChunk>& Chunk : Storage.Chunks)
+		{
+			for (int32 Row = 0; Row < Chunk->Num; ++Row)
+			{
+				OrderQueuePool.Release(Chunk->QueuedOrders[Row]);
+			}
+			Chunk->Num = 0;
+		}
+		Storage.FirstFreeChunk = 0;
+	}
+
+	Slots.Reset();
+	FreeSlots.Reset();
+	CompletedOrders.Reset();
+	NumUnits = 0;
+}
+
+FStratUnitHandle UStratUnitSimSubsystem::SpawnUnit(const UStratUnitDefinition* Definition, const FVector& Location, const uint8 Faction)
+{
+	const int32 TypeId = FindTypeId(Definition);
+	if (!ensureMsgf(TypeId != INDEX_NONE, TEXT("%s isn't listed in UStratUnitSettings::UnitDefinitions."), *GetNameSafe(Definition)))
+	{
+		return FStratUnitHandle();
+	}
+
+	return SpawnUnitOfType(static_cast<uint16>(TypeId), Location, Faction);
+}
+
+FStratUnitHandle UStratUnitSimSubsystem::SpawnUnitOfType(const uint16 TypeId, const FVector& Location, const uint8 Faction)
+{
+	if (!ensure(TypeInfos.IsValidIndex(TypeId)) || !ensureMsgf(StratFaction::IsValidId(Faction), TEXT("Faction ids go up to %d."), StratFaction::MaxFactions - 1))
+	{
+		return FStratUnitHandle();
+	}
+
+	const FStratUnitHandle Unit = AllocateHandle();
+	AddUnit(Unit, TypeId, Location, 0.f, Faction);
+	return Unit;
+}
+
+bool UStratUnitSimSubsystem::SpawnReplicatedUnit(const FStratUnitHandle Unit, const uint16 TypeId, const FVector& Location, const float Yaw, const uint8 Faction)
+{
+	if (!Unit.IsValid() || !TypeInfos.IsValidIndex(TypeId))
+	{
+		return false;
+	}
+
+	//~ The server reused the slot and the remove for the old unit hasn't arrived yet. The new one wins.
+	const int32 Index = Unit.GetIndex();
+	if (Slots.IsValidIndex(Index) && Slots[Index].ChunkIndex != INDEX_NONE)
+	{
+		DestroyUnit(FStratUnitHandle(Index, Slots[Index].Serial));
+	}
+
+	if (!Slots.IsValidIndex(Index))
+	{
+		Slots.SetNum(Index + 1);
+	}
+
+	Slots[Index].Serial = Unit.GetSerial();
+	AddUnit(Unit, TypeId, Location, Yaw, Faction);
+	return true;
+}
+
+void UStratUnitSimSubsystem::DestroyUnit(const FStratUnitHandle Unit)
+{
+	int32 Row;
+	const FStratUnitChunk* Chunk = FindUnit(Unit, Row);
+	if (!Chunk)
+	{
+		return;
+	}
+
+	//~ Clients lose units to replication, which isn't a death.
+	if (EventBus && (bLockstep || GetWorld()->GetNetMode() != NM_Client))
+	{
+		FStratUnitDiedEvent Event;
+		Event.Unit = Unit;
+		Event.Location = Chunk->Positions[Row];
+		Event.TypeId = Chunk->TypeIds[Row];
+		Event.Faction = Chunk->Factions[Row];
+		EventBus->Raise(Event);
+	}
+
+	OrderQueuePool.Release(Chunk->QueuedOrders[Row]);
+	DemoteUnit(Unit);
+
+	FUnitSlot& Slot = Slots[Unit.GetIndex()];
+	RemoveFromChunk(Slot);
+
+	//~ Bumping the serial invalidates every outstanding handle to this slot.
+	Slot.Serial = Slot.Serial >= FStratUnitHandle::MaxSerial ? 1 : Slot.Serial + 1;
+	if (AllocatesHandles())
+	{
+		FreeSlots.Add(Unit.GetIndex());
+	}
+	--NumUnits;
+}
+
+bool UStratUnitSimSubsystem::ApplyDamage(const FStratUnitHandle& Unit, const float Damage)
+{
+	int32 Row;
+	FStratUnitChunk* Chunk = FindUnit(Unit, Row);
+	if (!Chunk)
+	{
+		return false;
+	}
+
+	Chunk->Health[Row] -= Damage;
+	if (Chunk->Health[Row] > 0.f)
+	{
+		return false;
+	}
+
+	DestroyUnit(Unit);
+	return true;
+}
+
+void UStratUnitSimSubsystem::IssueMoveOrder(const FStratUnitHandle Unit, const FVector& Location)
+{
+	IssueOrder(Unit, FStratUnitOrder::MakeMove(Location));
+}
+
+void UStratUnitSimSubsystem::IssueOrder(const FStratUnitHandle& Unit, const FStratUnitOrder& Order)
+{
+	int32 Row;
+	if (FStratUnitChunk* Chunk = FindUnit(Unit, Row))
+	{
+		OrderQueuePool.Release(Chunk->QueuedOrders[Row]);
+		StartOrder(*Chunk, Row, Order);
+	}
+}
+
+void UStratUnitSimSubsystem::SetCurrentOrder(const FStratUnitHandle& Unit, const FStratUnitOrder& Order)
+{
+	int32 Row;
+	if (FStratUnitChunk* Chunk = FindUnit(Unit, Row))
+	{
+		StartOrder(*Chunk, Row, Order);
+	}
+}
+
+void UStratUnitSimSubsystem::QueueMoveOrder(const FStratUnitHandle Unit, const FVector& Location)
+{
+	QueueOrder(Unit, FStratUnitOrder::MakeMove(Location));
+}
+
+void UStratUnitSimSubsystem::QueueOrder(const FStratUnitHandle& Unit, const FStratUnitOrder& Order)
+{
+	QueueOrders(MakeArrayView(&Unit, 1), Order);
+}
+
+void UStratUnitSimSubsystem::QueueOrders(const TConstArrayView<FStratUnitHandle> Units, const FStratUnitOrder& Order)
+{
+	LLM_SCOPE_BYTAG(StratUnits);
+
+	//~ One reserve for the whole group, so a waypoint for a big selection grows the pool at most once.
+	OrderQueuePool.Reserve(Units.Num());
+
+	const int32 MaxQueuedOrders = GetDefault<UStratUnitSettings>()->MaxQueuedOrders;
+	for (const FStratUnitHandle& Unit : Units)
+	{
+		int32 Row;
+		FStratUnitChunk* Chunk = FindUnit(Unit, Row);
+		if (!Chunk)
+		{
+			continue;
+		}
+
+		//~ Idle units have nothing to queue behind and start right away.
+		FStratOrderQueue& Queue = Chunk->QueuedOrders[Row];
+		if (Chunk->Orders[Row].Type == EStratUnitOrderType::None && Queue.IsEmpty())
+		{
+			StartOrder(*Chunk, Row, Order);
+		}
+		else if (Queue.Num < MaxQueuedOrders)
+		{
+			OrderQueuePool.Append(Queue, Order);
+		}
+	}
+}
+
+void UStratUnitSimSubsystem::ClearQueuedOrders(const FStratUnitHandle Unit)
+{
+	int32 Row;
+	if (FStratUnitChunk* Chunk = FindUnit(Unit, Row))
+	{
+		OrderQueuePool.Release(Chunk->QueuedOrders[Row]);
+	}
+}
+
+int32 UStratUnitSimSubsystem::GetNumQueuedOrders(const FStratUnitHandle Unit) const
+{
+	int32 Row;
+	const FStratUnitChunk* Chunk = FindUnit(Unit, Row);
+	return Chunk ? Chunk->QueuedOrders[Row].Num : 0;
+}
+
+void UStratUnitSimSubsystem::GetQueuedOrders(const FStratUnitHandle& Unit, TArray<FStratUnitOrder>& OutOrders) const
+{
+	OutOrders.Reset();
+
+	int32 Row;
+	if (const FStratUnitChunk* Chunk = FindUnit(Unit, Row))
+	{
+		OutOrders.Reserve(Chunk->QueuedOrders[Row].Num);
+		OrderQueuePool.ForEach(Chunk->QueuedOrders[Row], [&OutOrders](const FStratUnitOrder& Order) { OutOrders.Add(Order); });
+	}
+}
+
+void UStratUnitSimSubsystem::StartOrder(FStratUnitChunk& Chunk, const int32 Row, const FStratUnitOrder& Order)
+{
+	Chunk.Orders[Row] = Order;
+
+	if (EventBus && (bLockstep || GetWorld()->GetNetMode() != NM_Client))
+	{
+		FStratOrderIssuedEvent Event;
+		Event.Unit = Chunk.Handles[Row];
+		Event.TargetUnit = Order.TargetUnit;
+		Event.TargetLocation = Order.TargetLocation;
+		Event.Type = Order.Type;
+		EventBus->Raise(Event);
+	}
+}
+
+void UStratUnitSimSubsystem::SetUnitSelected(const FStratUnitHandle Unit, const bool bSelected)
+{
+	int32 Row;
+	if (FStratUnitChunk* Chunk = FindUnit(Unit, Row))
+	{
+		if (bSelected)
+		{
+			EnumAddFlags(Chunk->Flags[Row], EStratUnitFlags::Selected);
+			if (bPresentationEnabled && !EnumHasAnyFlags(Chunk->Flags[Row], EStratUnitFlags::Presented))
+			{
+				PromoteUnit(*Chunk, Row);
+			}
+		}
+		else
+		{
+			EnumRemoveFlags(Chunk->Flags[Row], EStratUnitFlags::Selected);
+		}
+	}
+}
+
+FVector UStratUnitSimSubsystem::GetUnitLocation(const FStratUnitHandle Unit) const
+{
+	int32 Row;
+	const FStratUnitChunk* Chunk = FindUnit(Unit, Row);
+	return Chunk ? FVector(Chunk->Positions[Row]) : FVector::ZeroVector;
+}
+
+AStratUnitCharacter* UStratUnitSimSubsystem::GetPresentationActor(const FStratUnitHandle Unit) const
+{
+	const TObjectPtr<AStratUnitCharacter>* Actor = PresentedActors.Find(Unit);
+	return Actor ? Actor->Get() : nullptr;
+}
+
+FStratUnitChunk* UStratUnitSimSubsystem::FindUnit(const FStratUnitHandle& Unit, int32& OutIndexInChunk) const
+{
+	if (const FUnitSlot* Slot = ResolveSlot(Unit))
+	{
+		OutIndexInChunk = Slot->IndexInChunk;
+		return Archetypes[static_cast<int32>(Slot->Archetype)].Chunks[Slot->ChunkIndex].Get();
+	}
+
+	OutIndexInChunk = INDEX_NONE;
+	return nullptr;
+}
+
+void UStratUnitSimSubsystem::GatherChunks(TArray<FStratUnitChunk*>& OutChunks, const bool bIncludeStructures) const
+{
+	for (int32 ArchetypeIndex = 0; ArchetypeIndex < Archetypes.Num(); ++ArchetypeIndex)
+	{
+		if (!bIncludeStructures && ArchetypeIndex == static_cast<int32>(EStratUnitArchetype::Structure))
+		{
+			continue;
+		}
+
+		for (const TUniquePtr<FStratUnitChunk>& Chunk : Archetypes[ArchetypeIndex].Chunks)
+		{
+			if (!Chunk->IsEmpty())
+			{
+				OutChunks.Add(Chunk.Get());
+			}
+		}
+	}
+}
+
+const UStratUnitSimSubsystem::FUnitSlot* UStratUnitSimSubsystem::ResolveSlot(const FStratUnitHandle& Unit) const
+{
+	if (!Unit.IsValid() || !Slots.IsValidIndex(Unit.GetIndex()))
+	{
+		return nullptr;
+	}
+
+	const FUnitSlot& Slot = Slots[Unit.GetIndex()];
+	return Slot.Serial == Unit.GetSerial() && Slot.ChunkIndex != INDEX_NONE ? &Slot : nullptr;
+}
+
+bool UStratUnitSimSubsystem::AllocatesHandles() const
+{
+	return bLockstep || GetWorld()->GetNetMode() != NM_Client;
+}
+
+FStratUnitHandle UStratUnitSimSubsystem::AllocateHandle()
+{
+	if (!FreeSlots.IsEmpty())
+	{
+		const int32 Index = FreeSlots.Pop(EAllowShrinking::No);
+		return FStratUnitHandle(Index, Slots[Index].Serial);
+	}
+
+	check(Slots.Num() <= static_cast<int32>(FStratUnitHandle::IndexMask));
+	const int32 Index = Slots.AddDefaulted();
+	Slots[Index].Serial = 1;
+	return FStratUnitHandle(Index, 1);
+}
+
+void UStratUnitSimSubsystem::AddUnit(const FStratUnitHandle& Unit, const uint16 TypeId, const FVector& Location, const float Yaw, const uint8 Faction)
+{
+	const FStratUnitTypeInfo& TypeInfo = TypeInfos[TypeId];
+	FUnitSlot& Slot = Slots[Unit.GetIndex()];
+	AddToChunk(Unit, TypeInfo.Archetype, Slot);
+
+	FStratUnitChunk& Chunk = *Archetypes[static_cast<int32>(Slot.Archetype)].Chunks[Slot.ChunkIndex];
+	const int32 Row = Slot.IndexInChunk;
+	Chunk.Positions[Row] = FVector3f(Location);
+	Chunk.FixedPositions[Row] = FStratFixedVector::FromVector(Chunk.Positions[Row]);
+	Chunk.Velocities[Row] = FVector3f::ZeroVector;
+	Chunk.Yaws[Row] = Yaw;
+	Chunk.Orders[Row] = FStratUnitOrder();
+	Chunk.QueuedOrders[Row] = FStratOrderQueue();
+	Chunk.Health[Row] = TypeInfo.MaxHealth;
+	Chunk.TypeIds[Row] = TypeId;
+	Chunk.Factions[Row] = Faction;
+	Chunk.Flags[Row] = EStratUnitFlags::None;
+
+	++NumUnits;
+}
+
+void UStratUnitSimSubsystem::AddToChunk(const FStratUnitHandle& Unit, const EStratUnitArchetype Archetype, FUnitSlot& Slot)
+{
+	LLM_SCOPE_BYTAG(StratUnits);
+
+	int32 ChunkIndex;
+	FStratUnitChunk& Chunk = GetChunkWithRoom(Archetype, ChunkIndex);
+	const int32 Row = Chunk.Num++;
+	Chunk.Handles[Row] = Unit;
+
+	Slot.Archetype = Archetype;
+	Slot.ChunkIndex = ChunkIndex;
+	Slot.IndexInChunk = Row;
+}
+
+FStratUnitChunk& UStratUnitSimSubsystem::GetChunkWithRoom(const EStratUnitArchetype Archetype, int32& OutChunkIndex)
+{
+	FStratUnitArchetypeStorage& Storage = Archetypes[static_cast<int32>(Archetype)];
+	while (Storage.Chunks.IsValidIndex(Storage.FirstFreeChunk) && Storage.Chunks[Storage.FirstFreeChunk]->IsFull())
+	{
+		++Storage.FirstFreeChunk;
+	}
+
+	if (!Storage.Chunks.IsValidIndex(Storage.FirstFreeChunk))
+	{
+		Storage.FirstFreeChunk = Storage.Chunks.Add(MakeUnique<FStratUnitChunk>(Archetype));
+	}
+
+	OutChunkIndex = Storage.FirstFreeChunk;
+	return *Storage.Chunks[Storage.FirstFreeChunk];
+}
+
+void UStratUnitSimSubsystem::RemoveFromChunk(FUnitSlot& Slot)
+{
+	FStratUnitArchetypeStorage& Storage = Archetypes[static_cast<int32>(Slot.Archetype)];
+	FStratUnitChunk& Chunk = *Storage.Chunks[Slot.ChunkIndex];
+
+	const int32 LastRow = Chunk.Num - 1;
+	if (Slot.IndexInChunk != LastRow)
+	{
+		Chunk.MoveUnit(LastRow, Slot.IndexInChunk);
+		Slots[Chunk.Handles[Slot.IndexInChunk].GetIndex()].IndexInChunk = Slot.IndexInChunk;
+	}
+	--Chunk.Num;
+
+	Storage.FirstFreeChunk = FMath::Min(Storage.FirstFreeChunk, Slot.ChunkIndex);
+	Slot.ChunkIndex = INDEX_NONE;
+	Slot.IndexInChunk = INDEX_NONE;
+}
+
+void UStratUnitSimSubsystem::StepSimulation(const float FixedDeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_StratUnits_SimStep);
+	STRAT_SCOPED_SYSTEM_TIMING(SimStep);
+
+	RunOrderSystem();
+	RunMovementSystem(FixedDeltaTime);
+
+	CompletedOrders.Reset();
+	ForEachChunk([this](const FStratUnitChunk& Chunk)
+	{
+		for (int32 Row = 0; Row < Chunk.Num; ++Row)
+		{
+			if (EnumHasAnyFlags(Chunk.Flags[Row], EStratUnitFlags::OrderCompleted))
+			{
+				CompletedOrders.Add(Chunk.Handles[Row]);
+			}
+		}
+	});
+
+	++SimFrame;
+	OnPostSimStep.Broadcast(FixedDeltaTime);
+}
+
+void UStratUnitSimSubsystem::RunOrderSystem()
+{
+	SCOPE_CYCLE_COUNTER(STAT_StratUnits_OrderSystem);
+
+	//~ Serial on purpose. It reads other units' rows, which the parallel movement system is about to write.
+	//~ Also the one place that clears last step's OrderCompleted, so every system after it sees only this step's.
+	ForEachChunk([this](FStratUnitChunk& Chunk)
+	{
+		for (int32 Row = 0; Row < Chunk.Num; ++Row)
+		{
+			EnumRemoveFlags(Chunk.Flags[Row], EStratUnitFlags::OrderCompleted);
+
+			//~ The unit finished its order last step. Start the next queued one.
+			FStratUnitOrder& Order = Chunk.Orders[Row];
+			FStratUnitOrder NextOrder;
+			if (Order.Type == EStratUnitOrderType::None && OrderQueuePool.Pop(Chunk.QueuedOrders[Row], NextOrder))
+			{
+				StartOrder(Chunk, Row, NextOrder);
+			}
+
+			if (Order.Type != EStratUnitOrderType::Attack)
+			{
+				continue;
+			}
+
+			int32 TargetRow;
+			if (const FStratUnitChunk* TargetChunk = FindUnit(Order.TargetUnit, TargetRow))
+			{
+				Order.TargetLocation = TargetChunk->Positions[TargetRow];
+				Order.FixedTargetLocation = TargetChunk->FixedPositions[TargetRow];
+			}
+			else
+			{
+				Order = FStratUnitOrder();
+				EnumAddFlags(Chunk.Flags[Row], EStratUnitFlags::OrderCompleted);
+			}
+		}
+	});
+}
+
+void UStratUnitSimSubsystem::RunMovementSystem(const float FixedDeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_StratUnits_MovementSystem);
+
+	if (bLockstep)
+	{
+		RunLockstepMovementSystem();
+		return;
+	}
+
+	TArray<FStratUnitChunk*> MovingChunks;
+	GatherChunks(MovingChunks, false);
+
+	const TConstArrayView<FStratUnitTypeInfo> Types = TypeInfos;
+	ParallelFor(MovingChunks.Num(), [&MovingChunks, Types, FixedDeltaTime](const int32 ChunkIndex)
+	{
+		FStratUnitChunk& Chunk = *MovingChunks[ChunkIndex];
+		const bool bIsFlying = Chunk.Archetype == EStratUnitArchetype::Flying;
+
+		for (int32 Row = 0; Row < Chunk.Num; ++Row)
+		{
+			FStratUnitOrder& Order = Chunk.Orders[Row];
+			if (Order.Type != EStratUnitOrderType::Move && Order.Type != EStratUnitOrderType::Attack)
+			{
+				Chunk.Velocities[Row] = FVector3f::ZeroVector;
+				continue;
+			}
+
+			const FStratUnitTypeInfo& Type = Types[Chunk.TypeIds[Row]];
+			FVector3f ToTarget = Order.TargetLocation - Chunk.Positions[Row];
+			if (bIsFlying)
+			{
+				//~ Flying units keep their altitude. Only the ground position of the order matters.
+				ToTarget.Z = 0.f;
+			}
+
+			const float Distance = ToTarget.Size();
+			const float StepDistance = Type.MoveSpeed * FixedDeltaTime;
+
+			//~ Attackers stop within range, at least at arm's length. Firing is up to UStratWeaponSubsystem.
+			const float ArriveDistance = Order.Type == EStratUnitOrderType::Attack ? FMath::Max(Type.Radius * 2.f, Type.AttackRange) : FMath::Max(StepDistance, Type.Radius * 0.5f);
+			if (Distance <= ArriveDistance)
+			{
+				Chunk.Velocities[Row] = FVector3f::ZeroVector;
+				if (Order.Type == EStratUnitOrderType::Move)
+				{
+					Chunk.Positions[Row] += ToTarget;
+					Order = FStratUnitOrder();
+					EnumAddFlags(Chunk.Flags[Row], EStratUnitFlags::OrderCompleted);
+				}
+				continue;
+			}
+
+			const FVector3f Velocity = ToTarget / Distance * Type.MoveSpeed;
+			Chunk.Velocities[Row] = Velocity;
+			Chunk.Yaws[Row] = FMath::RadiansToDegrees(FMath::Atan2(Velocity.Y, Velocity.X));
+			Chunk.Positions[Row] += Velocity * FixedDeltaTime;
+		}
+	});
+}
+
+void UStratUnitSimSubsystem::RunLockstepMovementSystem()
+{
+	TArray<FStratUnitChunk*> MovingChunks;
+	GatherChunks(MovingChunks, false);
+
+	//~ Same rules as RunMovementSystem, in fixed point. Floats are only written out for presentation and never read back.
+	const TConstArrayView<FStratUnitTypeInfo> Types = TypeInfos;
+	const int32 TickRate = FMath::Max(GetDefault<UStratUnitSettings>()->SimTickRate, 1);
+	ParallelFor(MovingChunks.Num(), [&MovingChunks, Types, TickRate](const int32 ChunkIndex)
+	{
+		FStratUnitChunk& Chunk = *MovingChunks[ChunkIndex];
+		const bool bIsFlying = Chunk.Archetype == EStratUnitArchetype::Flying;
+
+		for (int32 Row = 0; Row < Chunk.Num; ++Row)
+		{
+			FStratUnitOrder& Order = Chunk.Orders[Row];
+			if (Order.Type != EStratUnitOrderType::Move && Order.Type != EStratUnitOrderType::Attack)
+			{
+				Chunk.Velocities[Row] = FVector3f::ZeroVector;
+				continue;
+			}
+
+			const FStratUnitTypeInfo& Type = Types[Chunk.TypeIds[Row]];
+			FStratFixedVector ToTarget = Order.FixedTargetLocation - Chunk.FixedPositions[Row];
+			if (bIsFlying)
+			{
+				ToTarget.Z = FStratFixed();
+			}
+
+			const FStratFixed Distance = ToTarget.Size();
+			const FStratFixed Radius = FStratFixed::FromFloat(Type.Radius);
+			const FStratFixed StepDistance = FStratFixed::FromFloat(Type.MoveSpeed) / FStratFixed::FromInt(TickRate);
+			const FStratFixed HalfRadius = FStratFixed::FromRaw(Radius.Raw / 2);
+			const FStratFixed AttackRange = FStratFixed::FromFloat(FMath::Max(Type.Radius * 2.f, Type.AttackRange));
+			const FStratFixed ArriveDistance = Order.Type == EStratUnitOrderType::Attack ? AttackRange : (StepDistance > HalfRadius ? StepDistance : HalfRadius);
+
+			FStratFixedVector Step;
+			if (Distance <= ArriveDistance)
+			{
+				if (Order.Type == EStratUnitOrderType::Move)
+				{
+					Step = ToTarget;
+					Order = FStratUnitOrder();
+					EnumAddFlags(Chunk.Flags[Row], EStratUnitFlags::OrderCompleted);
+				}
+				Chunk.Velocities[Row] = FVector3f::ZeroVector;
+			}
+			else
+			{
+				Step = ToTarget.ScaledTo(StepDistance, Distance);
+				Chunk.Velocities[Row] = Step.ToVector3f() * TickRate;
+				Chunk.Yaws[Row] = FMath::RadiansToDegrees(FMath::Atan2(Chunk.Velocities[Row].Y, Chunk.Velocities[Row].X));
+			}
+
+			Chunk.FixedPositions[Row] = Chunk.FixedPositions[Row] + Step;
+			Chunk.Positions[Row] = Chunk.FixedPositions[Row].ToVector3f();
+		}
+	});
+}
+
+void UStratUnitSimSubsystem::UpdatePresentation(const float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_StratUnits_Presentation);
+	STRAT_SCOPED_SYSTEM_TIMING(Presentation);
+
+	PresentationTimer -= DeltaTime;
+	if (PresentationTimer <= 0.f)
+	{
+		PresentationTimer = GetDefault<UStratUnitSettings>()->PresentationUpdateInterval;
+		RefreshPresentedUnits();
+	}
+
+	for (const TPair<FStratUnitHandle, TObjectPtr<AStratUnitCharacter>>& Pair : PresentedActors)
+	{
+		int32 Row;
+		const FStratUnitChunk* Chunk = FindUnit(Pair.Key, Row);
+		if (Chunk && IsValid(Pair.Value))
+		{
+			Pair.Value->SyncFromUnit(FVector(Chunk->Positions[Row]), FVector(Chunk->Velocities[Row]), Chunk->Yaws[Row], DeltaTime);
+		}
+	}
+}
+
+void UStratUnitSimSubsystem::RefreshPresentedUnits()
+{
+	const UStratUnitSettings* Settings = GetDefault<UStratUnitSettings>();
+
+	TArray<FVector, TInlineAllocator<4>> ViewLocations;
+	GatherLocalViewLocations(ViewLocations);
+
+	const double PromoteDistSq = FMath::Square(Settings->PromoteRadius);
+	const double DemoteDistSq = FMath::Square(Settings->PromoteRadius * Settings->DemoteHysteresis);
+
+	struct FCandidate
+	{
+		FStratUnitChunk* Chunk;
+		int32 Row;
+		double DistSq;
+	};
+	TArray<FCandidate> Candidates;
+	TArray<FStratUnitHandle> ToDemote;
+
+	ForEachChunk([&](FStratUnitChunk& Chunk)
+	{
+		for (int32 Row = 0; Row < Chunk.Num; ++Row)
+		{
+			double NearestDistSq = UE_BIG_NUMBER;
+			const FVector2D UnitLoc(Chunk.Positions[Row].X, Chunk.Positions[Row].Y);
+			for (const FVector& ViewLoc : ViewLocations)
+			{
+				NearestDistSq = FMath::Min(NearestDistSq, FVector2D::DistSquared(UnitLoc, FVector2D(ViewLoc)));
+			}
+
+			const bool bSelected = EnumHasAnyFlags(Chunk.Flags[Row], EStratUnitFlags::Selected);
+			if (EnumHasAnyFlags(Chunk.Flags[Row], EStratUnitFlags::Presented))
+			{
+				if (!bSelected && NearestDistSq > DemoteDistSq)
+				{
+					ToDemote.Add(Chunk.Handles[Row]);
+				}
+			}
+			else if (bSelected || NearestDistSq <= PromoteDistSq)
+			{
+				//~ Selected units sort first by pretending to be on top of the camera.
+				Candidates.Add({&Chunk, Row, bSelected ? -1.0 : NearestDistSq});
+			}
+		}
+	});
+
+	for (const FStratUnitHandle& Unit : ToDemote)
+	{
+		DemoteUnit(Unit);
+	}
+
+	const int32 Budget = Settings->MaxPresentedUnits - PresentedActors.Num();
+	if (Candidates.Num() > Budget)
+	{
+		Candidates.Sort([](const FCandidate& A, const FCandidate& B) { return A.DistSq < B.DistSq; });
+	}
+
+	for (int32 Index = 0; Index < FMath::Min(Budget, Candidates.Num()); ++Index)
+	{
+		PromoteUnit(*Candidates[Index].Chunk, Candidates[Index].Row);
+	}
+}
+
+void UStratUnitSimSubsystem::PromoteUnit(FStratUnitChunk& Chunk, const int32 IndexInChunk)
+{
+	UWorld* World = GetWorld();
+	const TSubclassOf<AStratUnitCharacter> PresentationClass = PresentationClasses.IsValidIndex(Chunk.TypeIds[IndexInChunk]) ? PresentationClasses[Chunk.TypeIds[IndexInChunk]] : nullptr;
+	if (!World || !PresentationClass)
+	{
+		return;
+	}
+
+	const FStratUnitHandle Unit = Chunk.Handles[IndexInChunk];
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+
+	const FTransform SpawnTransform(FVector(Chunk.Positions[IndexInChunk]));
+	AStratUnitCharacter* Actor = World->SpawnActor<AStratUnitCharacter>(PresentationClass, SpawnTransform, SpawnParams);
+	if (!Actor)
+	{
+		return;
+	}
+
+	Actor->BindUnit(Unit);
+	PresentedActors.Add(Unit, Actor);
+	EnumAddFlags(Chunk.Flags[IndexInChunk], EStratUnitFlags::Presented);
+}
+
+void UStratUnitSimSubsystem::DemoteUnit(const FStratUnitHandle& Unit)
+{
+	TObjectPtr<AStratUnitCharacter> Actor;
+	if (PresentedActors.RemoveAndCopyValue(Unit, Actor) && IsValid(Actor))
+	{
+		Actor->Destroy();
+	}
+
+	int32 Row;
+	if (FStratUnitChunk* Chunk = FindUnit(Unit, Row))
+	{
+		EnumRemoveFlags(Chunk->Flags[Row], EStratUnitFlags::Presented);
+	}
+}
+
+void UStratUnitSimSubsystem::GatherLocalViewLocations(TArray<FVector, TInlineAllocator<4>>& OutLocations) const
+{
+	const UWorld* World = GetWorld();
+	if (!World)
+	{
+		return;
+	}
+
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PC = It->Get();
+		if (!PC || !PC->IsLocalController())
+		{
+			continue;
+		}
+
+		//~ The camera pawn sits on the ground where the player is looking, which is a better focus point than the camera itself.
+		if (const APawn* Pawn = PC->GetPawn())
+		{
+			OutLocations.Add(Pawn->GetActorLocation());
+		}
+		else
+		{
+			FVector ViewLoc;
+			FRotator ViewRot;
+			PC->GetPlayerViewPoint(ViewLoc, ViewRot);
+			OutLocations.Add(ViewLoc);
+		}
+	}
+}
@@ -0,0 +1,263 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StratUnitChunk.h"
+#include "StratUnitTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "StratUnitSimSubsystem.generated.h"
+
+class AStratUnitCharacter;
+class UStratEventBusSubsystem;
+class UStratUnitDefinition;
+struct FStratUnitSnapshot;
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnStratUnitSimStepped, float /*FixedDeltaTime*/);
+DECLARE_MULTICAST_DELEGATE(FOnStratUnitSimRestored);
+
+/**
+ * Data-oriented unit simulation. Units are rows in archetype chunks, not actors, and systems process whole chunks in parallel.
+ * Only units near a local camera or selected get an AStratUnitCharacter for presentation.
+ *
+ * Spawning, destroying and ordering are game thread only and must not happen from inside OnPostSimStep's parallel work.
+ */
+UCLASS()
+class UE_RTS_API UStratUnitSimSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	//~ Begin UTickableWorldSubsystem interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~ End UTickableWorldSubsystem interface
+
+	UFUNCTION(BlueprintCallable, Category=StratUnits)
+	FStratUnitHandle SpawnUnit(const UStratUnitDefinition* Definition, const FVector& Location, uint8 Faction);
+
+	/** Same as SpawnUnit, by type id. */
+	FStratUnitHandle SpawnUnitOfType(uint16 TypeId, const FVector& Location, uint8 Faction);
+
+	/**
+	 * Client only. Adds a unit the server replicated, under the server's handle so both sides agree on the id.
+	 * Never mix with SpawnUnit in the same world, the client doesn't track free slots.
+	 */
+	bool SpawnReplicatedUnit(FStratUnitHandle Unit, uint16 TypeId, const FVector& Location, float Yaw, uint8 Faction);
+
+	UFUNCTION(BlueprintCallable, Category=StratUnits)
+	void DestroyUnit(FStratUnitHandle Unit);
+
+	/** Takes Damage off the unit's health and destroys it at zero. Returns true if this killed it. Authority, or every peer in lockstep. */
+	bool ApplyDamage(const FStratUnitHandle& Unit, float Damage);
+
+	UFUNCTION(BlueprintCallable, Category=StratUnits)
+	void IssueMoveOrder(FStratUnitHandle Unit, const FVector& Location);
+
+	/** Replaces the unit's current order and drops its queued ones. */
+	void IssueOrder(const FStratUnitHandle& Unit, const FStratUnitOrder& Order);
+
+	/** Replaces only the current order and keeps the queue. For systems that run one order as several legs. */
+	void SetCurrentOrder(const FStratUnitHandle& Unit, const FStratUnitOrder& Order);
+
+	/** Shift-queues a move after the unit's current and queued orders. */
+	UFUNCTION(BlueprintCallable, Category=StratUnits)
+	void QueueMoveOrder(FStratUnitHandle Unit, const FVector& Location);
+
+	/** Idle units start the order right away. Dropped once a unit has UStratUnitSettings::MaxQueuedOrders queued. */
+	void QueueOrder(const FStratUnitHandle& Unit, const FStratUnitOrder& Order);
+
+	/** QueueOrder for a whole group, like a waypoint for every selected unit. */
+	void QueueOrders(TConstArrayView<FStratUnitHandle> Units, const FStratUnitOrder& Order);
+
+	UFUNCTION(BlueprintCallable, Category=StratUnits)
+	void ClearQueuedOrders(FStratUnitHandle Unit);
+
+	/** Orders waiting after the current one. */
+	UFUNCTION(BlueprintPure, Category=StratUnits)
+	int32 GetNumQueuedOrders(FStratUnitHandle Unit) const;
+
+	/** Copies the queued orders, oldest first. For waypoint markers. */
+	void GetQueuedOrders(const FStratUnitHandle& Unit, TArray<FStratUnitOrder>& OutOrders) const;
+
+	const FStratOrderQueuePool& GetOrderQueuePool() const { return OrderQueuePool; }
+
+	/** Selected units are always presented, regardless of distance to a camera. */
+	UFUNCTION(BlueprintCallable, Category=StratUnits)
+	void SetUnitSelected(FStratUnitHandle Unit, bool bSelected);
+
+	UFUNCTION(BlueprintPure, Category=StratUnits)
+	bool IsUnitValid(FStratUnitHandle Unit) const { return ResolveSlot(Unit) != nullptr; }
+
+	UFUNCTION(BlueprintPure, Category=StratUnits)
+	FVector GetUnitLocation(FStratUnitHandle Unit) const;
+
+	UFUNCTION(BlueprintPure, Category=StratUnits)
+	int32 GetNumUnits() const { return NumUnits; }
+
+	/** Null when the unit is only data right now. */
+	UFUNCTION(BlueprintPure, Category=StratUnits)
+	AStratUnitCharacter* GetPresentationActor(FStratUnitHandle Unit) const;
+
+	/** Finds the chunk row of a unit. Returns null for stale or invalid handles. The pointer is only good until the next spawn or destroy. */
+	FStratUnitChunk* FindUnit(const FStratUnitHandle& Unit, int32& OutIndexInChunk) const;
+
+	/** Type id of a definition, the index in UStratUnitSettings::UnitDefinitions. INDEX_NONE if it isn't registered there. */
+	int32 FindTypeId(const UStratUnitDefinition* Definition) const { return Definitions.IndexOfByKey(Definition); }
+
+	const UStratUnitDefinition* GetDefinition(const uint16 TypeId) const { return Definitions.IsValidIndex(TypeId) ? Definitions[TypeId].Get() : nullptr; }
+	const FStratUnitTypeInfo& GetTypeInfo(const uint16 TypeId) const { return TypeInfos[TypeId]; }
+	TConstArrayView<FStratUnitTypeInfo> GetTypeInfos() const { return TypeInfos; }
+
+	/** Units whose order finished during the last step. */
+	TConstArrayView<FStratUnitHandle> GetUnitsWithCompletedOrders() const { return CompletedOrders; }
+
+	/** Number of simulation steps run so far. */
+	uint32 GetSimFrame() const { return SimFrame; }
+
+	/** Collects every non-empty chunk, so systems can ParallelFor over them. */
+	void GatherChunks(TArray<FStratUnitChunk*>& OutChunks, bool bIncludeStructures = true) const;
+
+	/** Visits every non-empty chunk on the calling thread. */
+	template <typename FuncType>
+	void ForEachChunk(FuncType&& Func) const
+	{
+		for (const FStratUnitArchetypeStorage& Storage : Archetypes)
+		{
+			for (const TUniquePtr<FStratUnitChunk>& Chunk : Storage.Chunks)
+			{
+				if (!Chunk->IsEmpty())
+				{
+					Func(static_cast<const FStratUnitChunk&>(*Chunk));
+				}
+			}
+		}
+	}
+
+	template <typename FuncType>
+	void ForEachChunk(FuncType&& Func)
+	{
+		for (FStratUnitArchetypeStorage& Storage : Archetypes)
+		{
+			for (const TUniquePtr<FStratUnitChunk>& Chunk : Storage.Chunks)
+			{
+				if (!Chunk->IsEmpty())
+				{
+					Func(*Chunk);
+				}
+			}
+		}
+	}
+
+	/**
+	 * Switches to lockstep. Positions move in fixed point, and Tick stops stepping on its own so the caller can StepOnce
+	 * exactly when every peer does. Call before any unit exists.
+	 */
+	void EnableLockstep();
+	bool IsLockstep() const { return bLockstep; }
+
+	/** Runs one fixed step now. Only for lockstep, otherwise Tick steps. */
+	void StepOnce();
+
+	float GetFixedDeltaTime() const;
+
+	/** Hash of the deterministic state, for desync checks. Equal on every peer after the same steps with the same commands. */
+	uint32 ComputeStateHash() const;
+
+	/** Copies every unit into Out, a column at a time. */
+	void WriteSnapshot(FStratUnitSnapshot& Out) const;
+
+	/**
+	 * Replaces every unit with the snapshot's, handles, slots and sim frame included, without raising deaths. Rows of type
+	 * ids that aren't registered are dropped. Returns false and changes nothing if the snapshot is malformed.
+	 * With the snapshot's chunk layout and free slot order, the simulation carries on exactly as the written one would.
+	 */
+	bool ReadSnapshot(const FStratUnitSnapshot& Snapshot);
+
+	/** Heap memory of the simulation's own storage. Presentation actors aren't counted. */
+	SIZE_T GetAllocatedSize() const;
+
+	/** Broadcast on the game thread after every fixed step. Other systems hook in here instead of ticking on their own. */
+	FOnStratUnitSimStepped OnPostSimStep;
+
+	/** Broadcast after ReadSnapshot replaced every unit, by a load or a replay seek. Systems drop state that pointed at the old ones. */
+	FOnStratUnitSimRestored OnSnapshotRead;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	struct FUnitSlot
+	{
+		uint32 Serial{0};
+		EStratUnitArchetype Archetype{EStratUnitArchetype::Ground};
+		int32 ChunkIndex{INDEX_NONE};
+		int32 IndexInChunk{INDEX_NONE};
+	};
+
+	const FUnitSlot* ResolveSlot(const FStratUnitHandle& Unit) const;
+
+	/** The authority and lockstep peers. A replicated client's handles all come from the server. */
+	bool AllocatesHandles() const;
+	FStratUnitHandle AllocateHandle();
+
+	/** Fills a fresh row for an allocated handle. */
+	void AddUnit(const FStratUnitHandle& Unit, uint16 TypeId, const FVector& Location, float Yaw, uint8 Faction);
+	void AddToChunk(const FStratUnitHandle& Unit, EStratUnitArchetype Archetype, FUnitSlot& Slot);
+
+	/** First chunk of the archetype with room for another unit. Adds one if they're all full. */
+	FStratUnitChunk& GetChunkWithRoom(EStratUnitArchetype Archetype, int32& OutChunkIndex);
+
+	/** The snapshot's chunk layout is there and fits its rows. */
+	bool HasChunkLayout(const FStratUnitSnapshot& Snapshot) const;
+
+	/** Drops every unit and handle slot. Keeps the chunks for reuse. No deaths are raised. */
+	void RemoveAllUnits();
+	void RemoveFromChunk(FUnitSlot& Slot);
+
+	/** Sets the row's current order and raises FStratOrderIssuedEvent. */
+	void StartOrder(FStratUnitChunk& Chunk, int32 Row, const FStratUnitOrder& Order);
+
+	void StepSimulation(float FixedDeltaTime);
+	void RunOrderSystem();
+	void RunMovementSystem(float FixedDeltaTime);
+	void RunLockstepMovementSystem();
+
+	void UpdatePresentation(float DeltaTime);
+	void RefreshPresentedUnits();
+	void PromoteUnit(FStratUnitChunk& Chunk, int32 IndexInChunk);
+	void DemoteUnit(const FStratUnitHandle& Unit);
+	void GatherLocalViewLocations(TArray<FVector, TInlineAllocator<4>>& OutLocations) const;
+
+	TStaticArray<FStratUnitArchetypeStorage, static_cast<int32>(EStratUnitArchetype::MAX)> Archetypes;
+	TArray<FUnitSlot> Slots;
+	TArray<int32> FreeSlots;
+	TArray<FStratUnitTypeInfo> TypeInfos;
+	TArray<FStratUnitHandle> CompletedOrders;
+	FStratOrderQueuePool OrderQueuePool;
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<const UStratUnitDefinition>> Definitions;
+
+	/** Resolved UStratUnitDefinition::PresentationClass per type id. Null on dedicated servers. */
+	UPROPERTY(Transient)
+	TArray<TSubclassOf<AStratUnitCharacter>> PresentationClasses;
+
+	UPROPERTY(Transient)
+	TMap<FStratUnitHandle, TObjectPtr<AStratUnitCharacter>> PresentedActors;
+
+	/** Unit deaths and orders are raised here. */
+	UPROPERTY(Transient)
+	TObjectPtr<UStratEventBusSubsystem> EventBus;
+
+	int32 NumUnits{0};
+	uint32 SimFrame{0};
+	float StepAccumulator{0.f};
+	float PresentationTimer{0.f};
+	bool bPresentationEnabled{false};
+	bool bLockstep{false};
+};
@@ -0,0 +1,136 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StratUnitTypes.h"
+
+/** A unit's order as stored in snapshots. Fixed layout with the padding zeroed, so a column of them is plain bytes. */
+struct FStratSavedOrder
+{
+	static FStratSavedOrder FromOrder(const FStratUnitOrder& Order)
+	{
+		FStratSavedOrder Result;
+		Result.TargetLocation = Order.TargetLocation;
+		Result.FixedTargetLocation = Order.FixedTargetLocation;
+		Result.TargetUnit = Order.TargetUnit.GetValue();
+		Result.Type = static_cast<uint8>(Order.Type);
+		return Result;
+	}
+
+	FStratUnitOrder ToOrder() const
+	{
+		FStratUnitOrder Result;
+		Result.TargetLocation = TargetLocation;
+		Result.FixedTargetLocation = FixedTargetLocation;
+		Result.TargetUnit = FStratUnitHandle::FromValue(TargetUnit);
+		Result.Type = static_cast<EStratUnitOrderType>(Type);
+		return Result;
+	}
+
+	FVector3f TargetLocation{FVector3f::ZeroVector};
+	FStratFixedVector FixedTargetLocation;
+	uint32 TargetUnit{0};
+	uint8 Type{0};
+	uint8 Padding[3]{};
+};
+static_assert(sizeof(FStratSavedOrder) == 32, "FStratSavedOrder is written as raw bytes. Bump the save version when its layout changes.");
+
+/**
+ * Every unit of a simulation as columns, one row per unit, in chunk order. Rows of one archetype are contiguous, so
+ * UStratUnitSimSubsystem::ReadSnapshot copies them back into chunks a column at a time.
+ *
+ * Only the simulation's own state. Selection and presentation are local and start over after a read.
+ */
+struct FStratUnitSnapshot
+{
+	uint32 SimFrame{0};
+
+	/** Serial of every handle slot, live or free, so units keep their handles and old handles stay stale. */
+	TArray<uint32> SlotSerials;
+
+	/** Free handle slots in the simulation's own order, last taken first, so spawns after a read get the same handles. */
+	TArray<int32> FreeSlots;
+
+	/** Archetype and unit count of every chunk, empty ones too, in storage order. Rows fill them in order. */
+	TArray<uint8> ChunkArchetypes;
+	TArray<uint8> ChunkSizes;
+
+	TArray<FStratUnitHandle> Handles;
+	TArray<uint16> TypeIds;
+	TArray<uint8> Factions;
+	TArray<FVector3f> Positions;
+	TArray<FStratFixedVector> FixedPositions;
+	TArray<FVector3f> Velocities;
+	TArray<float> Yaws;
+	TArray<float> Health;
+	TArray<FStratSavedOrder> Orders;
+
+	/** Shift-queued orders per unit. The orders themselves are in QueuedOrders, unit after unit, oldest first. */
+	TArray<uint16> NumQueuedOrders;
+	TArray<FStratSavedOrder> QueuedOrders;
+
+	int32 Num() const { return Handles.Num(); }
+
+	/** Every column has a row per unit and the queued orders add up. */
+	bool IsConsistent() const
+	{
+		const int32 NumRows = Handles.Num();
+		if (TypeIds.Num() != NumRows || Factions.Num() != NumRows || Positions.Num() != NumRows || FixedPositions.Num() != NumRows
+			|| Velocities.Num() != NumRows || Yaws.Num() != NumRows || Health.Num() != NumRows || Orders.Num() != NumRows
+			|| NumQueuedOrders.Num() != NumRows || ChunkArchetypes.Num() != ChunkSizes.Num())
+		{
+			return false;
+		}
+
+		int32 TotalQueued = 0;
+		for (const uint16 NumQueued : NumQueuedOrders)
+		{
+			TotalQueued += NumQueued;
+		}
+		return TotalQueued == QueuedOrders.Num();
+	}
+
+	void Reset()
+	{
+		SimFrame = 0;
+		SlotSerials.Reset();
+		FreeSlots.Reset();
+		ChunkArchetypes.Reset();
+		ChunkSizes.Reset();
+		Handles.Reset();
+		TypeIds.Reset();
+		Factions.Reset();
+		Positions.Reset();
+		FixedPositions.Reset();
+		Velocities.Reset();
+		Yaws.Reset();
+		Health.Reset();
+		Orders.Reset();
+		NumQueuedOrders.Reset();
+		QueuedOrders.Reset();
+	}
+
+	/** Sizes every unit column without initializing it, for bulk writes. */
+	void SetNumUnitsUninitialized(const int32 NumRows)
+	{
+		Handles.SetNumUninitialized(NumRows);
+		TypeIds.SetNumUninitialized(NumRows);
+		Factions.SetNumUninitialized(NumRows);
+		Positions.SetNumUninitialized(NumRows);
+		FixedPositions.SetNumUninitialized(NumRows);
+		Velocities.SetNumUninitialized(NumRows);
+		Yaws.SetNumUninitialized(NumRows);
+		Health.SetNumUninitialized(NumRows);
+		Orders.SetNumUninitialized(NumRows);
+		NumQueuedOrders.SetNumUninitialized(NumRows);
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return SlotSerials.GetAllocatedSize() + FreeSlots.GetAllocatedSize() + ChunkArchetypes.GetAllocatedSize() + ChunkSizes.GetAllocatedSize()
+			+ Handles.GetAllocatedSize() + TypeIds.GetAllocatedSize() + Factions.GetAllocatedSize()
+			+ Positions.GetAllocatedSize() + FixedPositions.GetAllocatedSize() + Velocities.GetAllocatedSize() + Yaws.GetAllocatedSize()
+			+ Health.GetAllocatedSize() + Orders.GetAllocatedSize() + NumQueuedOrders.GetAllocatedSize() + QueuedOrders.GetAllocatedSize();
+	}
+};
@@ -0,0 +1,182 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StratFixedPoint.h"
+#include "StratUnitActions.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "StratUnitTypes.generated.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogStratUnits, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("StratUnits"), STATGROUP_StratUnits, STATCAT_Advanced);
+
+/** Top level timings of the game's systems, one column each in CSV profiler captures such as the soak run's. */
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(UE_RTS_API, StratUnits);
+
+/** The systems timed with STRAT_SCOPED_SYSTEM_TIMING. Each name is also its StratUnits CSV stat. */
+enum class EStratTimedSystem : uint8
+{
+	SimStep,
+	Presentation,
+	UnitReplication,
+	RosterSync,
+	FogOfWar,
+	Targeting,
+	Projectiles,
+	PathRequests,
+	AIBehaviors,
+	EventDispatch,
+	Count
+};
+
+/** Game thread time summed per system, in every build configuration. The CSV profiler has it per frame, this is for totals. */
+namespace StratSystemTiming
+{
+	UE_RTS_API extern uint64 TotalCycles[static_cast<int32>(EStratTimedSystem::Count)];
+
+	UE_RTS_API const TCHAR* GetName(EStratTimedSystem System);
+	UE_RTS_API double GetTotalMs(EStratTimedSystem System);
+	UE_RTS_API void Reset();
+
+	struct FScope
+	{
+		explicit FScope(const EStratTimedSystem InSystem) : System(InSystem), StartCycles(FPlatformTime::Cycles64()) {}
+		~FScope() { TotalCycles[static_cast<int32>(System)] += FPlatformTime::Cycles64() - StartCycles; }
+
+		EStratTimedSystem System;
+		uint64 StartCycles;
+	};
+}
+
+/** CSV_SCOPED_TIMING_STAT(StratUnits, System) that also adds to the system's StratSystemTiming total. Game thread only. */
+#define STRAT_SCOPED_SYSTEM_TIMING(System) \
+	CSV_SCOPED_TIMING_STAT(StratUnits, System); \
+	const StratSystemTiming::FScope StratSystemTimingScope_##System(EStratTimedSystem::System)
+
+/**
+ * Stable id of a simulated unit. Packs the slot index and a serial so a stale handle never resolves to a recycled slot.
+ * The same value is used on every net role, so it doubles as the unit's network id.
+ */
+USTRUCT(BlueprintType)
+struct FStratUnitHandle
+{
+	GENERATED_BODY()
+
+	static constexpr uint32 IndexBits = 20;
+	static constexpr uint32 IndexMask = (1u << IndexBits) - 1;
+	static constexpr uint32 MaxSerial = (1u << (32 - IndexBits)) - 1;
+
+	FStratUnitHandle() = default;
+	FStratUnitHandle(const int32 InIndex, const uint32 InSerial) : Value((InSerial << IndexBits) | (static_cast<uint32>(InIndex) & IndexMask)) {}
+
+	static FStratUnitHandle FromValue(const uint32 InValue)
+	{
+		FStratUnitHandle Result;
+		Result.Value = InValue;
+		return Result;
+	}
+
+	int32 GetIndex() const { return static_cast<int32>(Value & IndexMask); }
+	uint32 GetSerial() const { return Value >> IndexBits; }
+	uint32 GetValue() const { return Value; }
+
+	/** Serial 0 is never handed out, so a zero value is always invalid. */
+	bool IsValid() const { return Value != 0; }
+
+	bool operator==(const FStratUnitHandle& Other) const { return Value == Other.Value; }
+	bool operator!=(const FStratUnitHandle& Other) const { return Value != Other.Value; }
+	friend uint32 GetTypeHash(const FStratUnitHandle& Handle) { return ::GetTypeHash(Handle.Value); }
+	friend FArchive& operator<<(FArchive& Ar, FStratUnitHandle& Handle) { return Ar << Handle.Value; }
+
+	FString ToString() const { return FString::Printf(TEXT("Unit[%d:%u]"), GetIndex(), GetSerial()); }
+
+private:
+	UPROPERTY(VisibleInstanceOnly)
+	uint32 Value{0};
+};
+
+/** Chunks only ever hold units of one archetype so every system can stream a chunk without branching on unit kind. */
+UENUM(BlueprintType)
+enum class EStratUnitArchetype : uint8
+{
+	/** Walks on terrain. People, animals, vehicles. */
+	Ground,
+
+	/** Ignores ground obstacles. Helicopters, drones. */
+	Flying,
+
+	/** Never moves. Buildings, turrets, resource nodes. */
+	Structure,
+
+	MAX UMETA(Hidden)
+};
+
+UENUM(BlueprintType)
+enum class EStratUnitOrderType : uint8
+{
+	None,
+	Move,
+	Attack,
+	Hold,
+};
+
+/** Per unit state bits. Kept in one byte per unit so systems can filter a whole chunk cheaply. */
+enum class EStratUnitFlags : uint8
+{
+	None = 0,
+
+	/** A local player has this unit selected. Selected units are always presented. */
+	Selected = 1 << 0,
+
+	/** A presentation actor currently represents this unit. */
+	Presented = 1 << 1,
+
+	/** Set by the movement system when the current order finished this step. Cleared at the start of the next step. */
+	OrderCompleted = 1 << 2,
+
+	/** The unit is fighting. Combat units get priority in other systems. */
+	InCombat = 1 << 3,
+};
+ENUM_CLASS_FLAGS(EStratUnitFlags)
+
+/** The order a unit is currently executing. Plain data so it can live in a chunk. */
+struct FStratUnitOrder
+{
+	static FStratUnitOrder MakeMove(const FVector& Location)
+	{
+		FStratUnitOrder Order;
+		Order.Type = EStratUnitOrderType::Move;
+		Order.TargetLocation = FVector3f(Location);
+		Order.FixedTargetLocation = FStratFixedVector::FromVector(Order.TargetLocation);
+		return Order;
+	}
+
+	FVector3f TargetLocation{FVector3f::ZeroVector};
+
+	/** TargetLocation for the deterministic simulation. Only read in lockstep. */
+	FStratFixedVector FixedTargetLocation;
+
+	FStratUnitHandle TargetUnit;
+	EStratUnitOrderType Type{EStratUnitOrderType::None};
+};
+
+/** Read-only per type data the systems need every step. Flattened out of UStratUnitDefinition so workers never touch UObjects. */
+struct FStratUnitTypeInfo
+{
+	float MaxHealth{100.f};
+	float MoveSpeed{400.f};
+	float Radius{40.f};
+	float VisionRadius{1500.f};
+	float EyeHeight{180.f};
+	float AcquireRange{0.f};
+	float AttackRange{0.f};
+	EStratUnitArchetype Archetype{EStratUnitArchetype::Ground};
+
+	/** EStratUnitAction bits the unit can perform. */
+	uint32 Actions{StratActions::DefaultUnitActions};
+
+	/** EStratUnitAction bits other units can perform on this one. */
+	uint32 TargetActions{StratActions::DefaultTargetActions};
+};
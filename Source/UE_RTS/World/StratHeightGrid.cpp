@@ -0,0 +1,57 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratHeightGrid.h"
+
+void FStratHeightGrid::Init(const FBox2D& Bounds, const float InCellSize, const float DefaultHeight)
+{
+	check(InCellSize > 0.f);
+	CellSize = InCellSize;
+	Origin = Bounds.Min;
+
+	const FVector2D Size = Bounds.GetSize();
+	SizeX = FMath::Max(1, FMath::CeilToInt32(Size.X / CellSize));
+	SizeY = FMath::Max(1, FMath::CeilToInt32(Size.Y / CellSize));
+
+	Heights.Reset();
+	Heights.Init(DefaultHeight, SizeX * SizeY);
+}
+
+float FStratHeightGrid::GetCellHeight(const int32 X, const int32 Y) const
+{
+	const int32 ClampedX = FMath::Clamp(X, 0, SizeX - 1);
+	const int32 ClampedY = FMath::Clamp(Y, 0, SizeY - 1);
+	return Heights[ToIndex(ClampedX, ClampedY)];
+}
+
+float FStratHeightGrid::SampleHeight(const FVector2D& WorldXY) const
+{
+	if (!IsValid())
+	{
+		return 0.f;
+	}
+
+	//~ Shift by half a cell so the integer part lands on the cell center to the lower left.
+	const float GridX = (WorldXY.X - Origin.X) / CellSize - 0.5f;
+	const float GridY = (WorldXY.Y - Origin.Y) / CellSize - 0.5f;
+	const int32 X0 = FMath::FloorToInt32(GridX);
+	const int32 Y0 = FMath::FloorToInt32(GridY);
+	const float AlphaX = GridX - X0;
+	const float AlphaY = GridY - Y0;
+
+	const float H00 = GetCellHeight(X0, Y0);
+	const float H10 = GetCellHeight(X0 + 1, Y0);
+	const float H01 = GetCellHeight(X0, Y0 + 1);
+	const float H11 = GetCellHeight(X0 + 1, Y0 + 1);
+	return FMath::BiLerp(H00, H10, H01, H11, AlphaX, AlphaY);
+}
+
+FIntRect FStratHeightGrid::GetCellRect(const FBox2D& WorldBox) const
+{
+	const FIntPoint Min = WorldToCell(WorldBox.Min);
+	const FIntPoint Max = WorldToCell(WorldBox.Max) + FIntPoint(1, 1);
+
+	FIntRect Result(
+		FIntPoint(FMath::Clamp(Min.X, 0, SizeX), FMath::Clamp(Min.Y, 0, SizeY)),
+		FIntPoint(FMath::Clamp(Max.X, 0, SizeX), FMath::Clamp(Max.Y, 0, SizeY)));
+	return Result;
+}
@@ -0,0 +1,45 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Regular 2D grid of heights over the map. Cell (0,0) starts at Origin, which is the min corner of the map bounds. */
+struct UE_RTS_API FStratHeightGrid
+{
+	void Init(const FBox2D& Bounds, float InCellSize, float DefaultHeight = 0.f);
+
+	bool IsValid() const { return SizeX > 0 && SizeY > 0 && Heights.Num() == SizeX * SizeY; }
+	bool IsValidCell(const int32 X, const int32 Y) const { return X >= 0 && Y >= 0 && X < SizeX && Y < SizeY; }
+	int32 ToIndex(const int32 X, const int32 Y) const { return Y * SizeX + X; }
+
+	FIntPoint WorldToCell(const FVector2D& WorldXY) const
+	{
+		return FIntPoint(FMath::FloorToInt32((WorldXY.X - Origin.X) / CellSize), FMath::FloorToInt32((WorldXY.Y - Origin.Y) / CellSize));
+	}
+
+	/** Center of the cell in world space. */
+	FVector2D CellToWorld(const FIntPoint& Cell) const
+	{
+		return Origin + FVector2D((Cell.X + 0.5) * CellSize, (Cell.Y + 0.5) * CellSize);
+	}
+
+	/** Height of a cell. Cells outside the grid clamp to the nearest edge. */
+	float GetCellHeight(int32 X, int32 Y) const;
+
+	/** Bilinear height between cell centers. */
+	float SampleHeight(const FVector2D& WorldXY) const;
+
+	/** Cells overlapping a world box, clamped to the grid. Max is exclusive. Empty if the box misses the grid. */
+	FIntRect GetCellRect(const FBox2D& WorldBox) const;
+
+	FBox2D GetBounds() const { return FBox2D(Origin, Origin + FVector2D(SizeX * CellSize, SizeY * CellSize)); }
+
+	SIZE_T GetAllocatedSize() const { return Heights.GetAllocatedSize(); }
+
+	FVector2D Origin{FVector2D::ZeroVector};
+	float CellSize{400.f};
+	int32 SizeX{0};
+	int32 SizeY{0};
+	TArray<float> Heights;
+};
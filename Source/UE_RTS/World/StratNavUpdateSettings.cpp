@@ -0,0 +1,8 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratNavUpdateSettings.h"
+
+UStratNavUpdateSettings::UStratNavUpdateSettings()
+{
+	CategoryName = TEXT("Game");
+}
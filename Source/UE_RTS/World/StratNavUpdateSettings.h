@@ -0,0 +1,32 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "StratNavUpdateSettings.generated.h"
+
+/** Project settings for runtime nav mesh updates. Found under Project Settings > Game > Strat Nav Updates. */
+UCLASS(Config=Game, DefaultConfig, meta=(DisplayName="Strat Nav Updates"))
+class UE_RTS_API UStratNavUpdateSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UStratNavUpdateSettings();
+
+	/**
+	 * Game thread time per frame for handing queued obstacles to the navigation system. Registering an obstacle exports its
+	 * collision, which is the part that hitches. At least one obstacle goes through every frame regardless.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category="Nav Updates", meta=(ClampMin="0.05", ClampMax="16.0", Units="ms"))
+	float FrameBudgetMs{1.f};
+
+	/** Nothing new is handed over while the nav mesh has more tile builds than this waiting on worker threads. */
+	UPROPERTY(Config, EditAnywhere, Category="Nav Updates", meta=(ClampMin="1"))
+	int32 MaxPendingTileBuilds{32};
+
+	/** Dirty areas snap to this grid before merging. Match the nav mesh's Tile Size UU so areas sharing a tile merge. */
+	UPROPERTY(Config, EditAnywhere, Category="Nav Updates", meta=(ClampMin="100.0", Units="cm"))
+	float TileSize{1000.f};
+};
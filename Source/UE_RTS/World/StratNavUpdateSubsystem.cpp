@@ -0,0 +1,196 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratNavUpdateSubsystem.h"
+
+#include "NavigationSystem.h"
+#include "StratNavUpdateSettings.h"
+#include "StratTerrainSubsystem.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "Memory/StratMemoryTags.h"
+
+DEFINE_LOG_CATEGORY(LogStratNav);
+
+DECLARE_CYCLE_STAT(TEXT("Nav Update Scheduler"), STAT_StratNav_Scheduler, STATGROUP_StratNav);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pending Obstacles"), STAT_StratNav_PendingObstacles, STATGROUP_StratNav);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pending Tile Builds"), STAT_StratNav_PendingTileBuilds, STATGROUP_StratNav);
+
+void UStratNavUpdateSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	Terrain = Collection.InitializeDependency<UStratTerrainSubsystem>();
+}
+
+void UStratNavUpdateSubsystem::Tick(const float DeltaTime)
+{
+	LLM_SCOPE_BYTAG(StratNav);
+
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_StratNav_Scheduler);
+	SET_DWORD_STAT(STAT_StratNav_PendingObstacles, PendingObstacles.Num());
+
+	if (PendingObstacles.IsEmpty() && PendingAreas.IsEmpty())
+	{
+		return;
+	}
+
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (NavSys)
+	{
+		//~ The workers are behind. Units path on the current tiles meanwhile, so waiting costs nothing but freshness.
+		const int32 PendingTileBuilds = NavSys->GetNumRemainingBuildTasks();
+		SET_DWORD_STAT(STAT_StratNav_PendingTileBuilds, PendingTileBuilds);
+		if (PendingTileBuilds > GetDefault<UStratNavUpdateSettings>()->MaxPendingTileBuilds)
+		{
+			return;
+		}
+
+		for (const FBox& Area : PendingAreas)
+		{
+			NavSys->AddDirtyArea(Area, ENavigationDirtyFlag::All);
+			OnAreaDirtied.Broadcast(Area);
+		}
+	}
+	PendingAreas.Reset();
+
+	const double EndTime = FPlatformTime::Seconds() + GetDefault<UStratNavUpdateSettings>()->FrameBudgetMs / 1000.0;
+	do
+	{
+		if (PendingObstacles.IsEmpty())
+		{
+			break;
+		}
+
+		const FPendingObstacle Obstacle = PendingObstacles[0];
+		PendingObstacles.RemoveAt(0, EAllowShrinking::No);
+		ApplyObstacle(Obstacle);
+
+		//~ Anything sharing tiles with it goes now too, so those tiles are built once instead of once per obstacle.
+		for (int32 Index = 0; Index < PendingObstacles.Num();)
+		{
+			if (PendingObstacles[Index].Bounds.Intersect(Obstacle.Bounds))
+			{
+				const FPendingObstacle Overlapping = PendingObstacles[Index];
+				PendingObstacles.RemoveAt(Index, EAllowShrinking::No);
+				ApplyObstacle(Overlapping);
+			}
+			else
+			{
+				++Index;
+			}
+		}
+	}
+	while (FPlatformTime::Seconds() < EndTime);
+}
+
+TStatId UStratNavUpdateSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UStratNavUpdateSubsystem, STATGROUP_StratNav);
+}
+
+bool UStratNavUpdateSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UStratNavUpdateSubsystem::AddObstacle(AActor* Obstacle)
+{
+	LLM_SCOPE_BYTAG(StratNav);
+
+	if (!Obstacle)
+	{
+		return;
+	}
+
+	bool bAlreadyAffectsNavigation = false;
+	Obstacle->ForEachComponent<UPrimitiveComponent>(false, [&bAlreadyAffectsNavigation](const UPrimitiveComponent* Comp)
+	{
+		bAlreadyAffectsNavigation |= Comp->IsCollisionEnabled() && Comp->CanEverAffectNavigation();
+	});
+	UE_CLOG(bAlreadyAffectsNavigation, LogStratNav, Warning, TEXT("%s already affects navigation, so it dirtied its tiles when it spawned. Turn off Can Ever Affect Navigation on its class."), *GetNameSafe(Obstacle));
+
+	PendingObstacles.Add({Obstacle, Obstacle->GetComponentsBoundingBox(true), true, false});
+}
+
+void UStratNavUpdateSubsystem::RemoveObstacle(AActor* Obstacle, const bool bDestroy)
+{
+	LLM_SCOPE_BYTAG(StratNav);
+
+	if (!Obstacle)
+	{
+		return;
+	}
+
+	//~ Placed and removed before its turn came. Nothing to rebuild.
+	const int32 QueuedAdd = PendingObstacles.IndexOfByPredicate([Obstacle](const FPendingObstacle& Pending) { return Pending.Actor == Obstacle && Pending.bAffectsNavigation; });
+	if (QueuedAdd != INDEX_NONE)
+	{
+		PendingObstacles.RemoveAt(QueuedAdd);
+		if (bDestroy)
+		{
+			Obstacle->Destroy();
+		}
+		return;
+	}
+
+	PendingObstacles.Add({Obstacle, Obstacle->GetComponentsBoundingBox(true), false, bDestroy});
+}
+
+void UStratNavUpdateSubsystem::QueueDirtyArea(const FBox& Area)
+{
+	LLM_SCOPE_BYTAG(StratNav);
+
+	if (!Area.IsValid)
+	{
+		return;
+	}
+
+	const double TileSize = GetDefault<UStratNavUpdateSettings>()->TileSize;
+	FBox Snapped(
+		FVector(FMath::FloorToDouble(Area.Min.X / TileSize) * TileSize, FMath::FloorToDouble(Area.Min.Y / TileSize) * TileSize, Area.Min.Z),
+		FVector(FMath::CeilToDouble(Area.Max.X / TileSize) * TileSize, FMath::CeilToDouble(Area.Max.Y / TileSize) * TileSize, Area.Max.Z));
+
+	//~ Merging can grow the box into others, so start over after every merge. Boxes that only touch stay apart.
+	for (int32 Index = PendingAreas.Num() - 1; Index >= 0; --Index)
+	{
+		const FBox& Pending = PendingAreas[Index];
+		const bool bOverlaps = Pending.Min.X < Snapped.Max.X && Snapped.Min.X < Pending.Max.X && Pending.Min.Y < Snapped.Max.Y && Snapped.Min.Y < Pending.Max.Y;
+		if (bOverlaps)
+		{
+			Snapped += Pending;
+			PendingAreas.RemoveAtSwap(Index, EAllowShrinking::No);
+			Index = PendingAreas.Num();
+		}
+	}
+
+	PendingAreas.Add(Snapped);
+}
+
+void UStratNavUpdateSubsystem::ApplyObstacle(const FPendingObstacle& Obstacle)
+{
+	AActor* Actor = Obstacle.Actor.Get();
+	if (!Actor)
+	{
+		return;
+	}
+
+	//~ Registering with the nav octree exports the collision and dirties the bounds. Unregistering dirties them too.
+	Actor->ForEachComponent<UPrimitiveComponent>(false, [&Obstacle](UPrimitiveComponent* Comp)
+	{
+		if (Comp->IsCollisionEnabled())
+		{
+			Comp->SetCanEverAffectNavigation(Obstacle.bAffectsNavigation);
+		}
+	});
+
+	if (Obstacle.bDestroy)
+	{
+		Actor->Destroy();
+	}
+
+	Terrain->RebuildRegion(Obstacle.Bounds);
+	OnAreaDirtied.Broadcast(Obstacle.Bounds);
+}
@@ -0,0 +1,83 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "StratNavUpdateSubsystem.generated.h"
+
+class UStratTerrainSubsystem;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogStratNav, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("StratNav"), STATGROUP_StratNav, STATCAT_Advanced);
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnStratNavAreaDirtied, const FBox& /*Area*/);
+
+/**
+ * Spreads nav mesh updates from placed and removed obstacles (buildings, resource nodes) over frames.
+ *
+ * Obstacle classes keep their collision from affecting navigation by default. AddObstacle queues the actor, and a later frame
+ * turns nav relevance on within UStratNavUpdateSettings::FrameBudgetMs, which dirties only its tiles. The nav mesh rebuilds
+ * those tiles on worker threads and swaps each one in when it's done, so paths keep using the old tiles until then.
+ * Obstacles that overlap go through in the same frame so their shared tiles rebuild once.
+ *
+ * Needs the nav mesh's Runtime Generation set to Dynamic.
+ */
+UCLASS()
+class UE_RTS_API UStratNavUpdateSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	//~ End USubsystem interface
+
+	//~ Begin UTickableWorldSubsystem interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~ End UTickableWorldSubsystem interface
+
+	/** A placed obstacle. Its collision starts affecting navigation in a later frame. */
+	UFUNCTION(BlueprintCallable, Category=StratNav)
+	void AddObstacle(AActor* Obstacle);
+
+	/** A removed obstacle. Its collision stops affecting navigation in a later frame, then it's destroyed if bDestroy. */
+	UFUNCTION(BlueprintCallable, Category=StratNav)
+	void RemoveObstacle(AActor* Obstacle, bool bDestroy = true);
+
+	/** Rebuilds the nav mesh under Area in a later frame. Overlapping areas merge. */
+	UFUNCTION(BlueprintCallable, Category=StratNav)
+	void QueueDirtyArea(const FBox& Area);
+
+	UFUNCTION(BlueprintPure, Category=StratNav)
+	int32 GetNumPendingUpdates() const { return PendingObstacles.Num() + PendingAreas.Num(); }
+
+	SIZE_T GetAllocatedSize() const { return PendingObstacles.GetAllocatedSize() + PendingAreas.GetAllocatedSize(); }
+
+	/** The nav mesh under Area was just dirtied and its tiles will rebuild. Paths found across it before are out of date. */
+	FOnStratNavAreaDirtied OnAreaDirtied;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	struct FPendingObstacle
+	{
+		TWeakObjectPtr<AActor> Actor;
+		FBox Bounds{ForceInit};
+		bool bAffectsNavigation{true};
+		bool bDestroy{false};
+	};
+
+	void ApplyObstacle(const FPendingObstacle& Obstacle);
+
+	/** In queue order. */
+	TArray<FPendingObstacle> PendingObstacles;
+
+	/** Snapped to tiles, none overlapping. */
+	TArray<FBox> PendingAreas;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratTerrainSubsystem> Terrain;
+};
@@ -0,0 +1,8 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratPathSettings.h"
+
+UStratPathSettings::UStratPathSettings()
+{
+	CategoryName = TEXT("Game");
+}
@@ -0,0 +1,36 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "StratPathSettings.generated.h"
+
+/** Project settings for ground unit path requests. Found under Project Settings > Game > Strat Paths. */
+UCLASS(Config=Game, DefaultConfig, meta=(DisplayName="Strat Paths"))
+class UE_RTS_API UStratPathSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UStratPathSettings();
+
+	/**
+	 * Requests starting in the same cell and ending in the same cell share one search. Larger cells share more, at the cost
+	 * of units walking a path planned from a few meters away. Each unit still ends at its own goal.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category="Paths", meta=(ClampMin="50.0", Units="cm"))
+	float CoalesceCellSize{400.f};
+
+	/** Searches handed to the navigation system's worker threads and not back yet. The rest wait their turn in order. */
+	UPROPERTY(Config, EditAnywhere, Category="Paths", meta=(ClampMin="1"))
+	int32 MaxQueriesInFlight{32};
+
+	/** A search not back after this long is aborted and its units keep their straight moves, so it stops holding a slot. */
+	UPROPERTY(Config, EditAnywhere, Category="Paths", meta=(ClampMin="0.1", Units="s"))
+	float QueryTimeout{5.f};
+
+	/** Finished paths are kept this long, so re-plans toward the same cells right after reuse them without a search. */
+	UPROPERTY(Config, EditAnywhere, Category="Paths", meta=(ClampMin="0.0", Units="s"))
+	float ResultLifetime{1.f};
+};
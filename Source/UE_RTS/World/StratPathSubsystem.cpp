@@ -0,0 +1,426 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratPathSubsystem.h"
+
+#include "NavigationData.h"
+#include "NavigationSystem.h"
+#include "StratNavUpdateSubsystem.h"
+#include "StratPathSettings.h"
+#include "Engine/World.h"
+#include "Memory/StratMemoryTags.h"
+#include "Units/StratUnitSimSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Path Requests"), STAT_StratNav_PathRequests, STATGROUP_StratNav);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Paths Requested"), STAT_StratNav_NumRequested, STATGROUP_StratNav);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Paths Shared"), STAT_StratNav_NumShared, STATGROUP_StratNav);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Path Searches Submitted"), STAT_StratNav_NumSubmitted, STATGROUP_StratNav);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Path Searches Queued"), STAT_StratNav_NumQueued, STATGROUP_StratNav);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Path Searches In Flight"), STAT_StratNav_NumInFlight, STATGROUP_StratNav);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Path Routes"), STAT_StratNav_Routes, STATGROUP_StratNav);
+
+void UStratPathSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UnitSim = Collection.InitializeDependency<UStratUnitSimSubsystem>();
+	NavUpdate = Collection.InitializeDependency<UStratNavUpdateSubsystem>();
+
+	if (UnitSim)
+	{
+		UnitSim->OnPostSimStep.AddUObject(this, &ThisClass::OnSimStepped);
+	}
+	if (NavUpdate)
+	{
+		NavUpdate->OnAreaDirtied.AddUObject(this, &ThisClass::OnNavAreaDirtied);
+	}
+}
+
+void UStratPathSubsystem::Deinitialize()
+{
+	if (UnitSim)
+	{
+		UnitSim->OnPostSimStep.RemoveAll(this);
+	}
+	if (NavUpdate)
+	{
+		NavUpdate->OnAreaDirtied.RemoveAll(this);
+	}
+
+	if (UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld()))
+	{
+		for (const TPair<uint32, FInFlightQuery>& Pair : InFlightQueries)
+		{
+			NavSys->AbortAsyncFindPathRequest(Pair.Key);
+		}
+	}
+
+	Queries.Reset();
+	QueuedKeys.Reset();
+	FinishedPaths.Reset();
+	Cache.Reset();
+	WaitingUnits.Reset();
+	Routes.Reset();
+	InFlightQueries.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UStratPathSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UStratPathSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UStratPathSubsystem, STATGROUP_StratNav);
+}
+
+void UStratPathSubsystem::IssuePathedMove(const FStratUnitHandle Unit, const FVector& Location)
+{
+	if (GetWorld()->GetNetMode() == NM_Client || UnitSim->IsLockstep())
+	{
+		UE_LOG(LogStratNav, Warning, TEXT("IssuePathedMove is authority only and not for lockstep. %s wasn't ordered."), *Unit.ToString());
+		return;
+	}
+
+	int32 Row;
+	const FStratUnitChunk* Chunk = UnitSim->FindUnit(Unit, Row);
+	if (!Chunk)
+	{
+		return;
+	}
+
+	//~ Walk straight meanwhile. The path replaces this leg when it arrives, usually a frame or two later.
+	Routes.Remove(Unit);
+	UnitSim->IssueMoveOrder(Unit, Location);
+
+	if (Chunk->Archetype != EStratUnitArchetype::Ground)
+	{
+		WaitingUnits.Remove(Unit);
+		return;
+	}
+
+	RequestPath(Unit, FVector(Chunk->Positions[Row]), Location);
+}
+
+void UStratPathSubsystem::IssuePathedMoves(const TArray<FStratUnitHandle>& Units, const FVector& Location)
+{
+	for (const FStratUnitHandle& Unit : Units)
+	{
+		IssuePathedMove(Unit, Location);
+	}
+}
+
+SIZE_T UStratPathSubsystem::GetAllocatedSize() const
+{
+	SIZE_T Result = Queries.GetAllocatedSize() + QueuedKeys.GetAllocatedSize() + InFlightQueries.GetAllocatedSize() + FinishedPaths.GetAllocatedSize()
+		+ Cache.GetAllocatedSize() + WaitingUnits.GetAllocatedSize() + Routes.GetAllocatedSize();
+	for (const TPair<FStratPathKey, FPathQuery>& Pair : Queries)
+	{
+		Result += Pair.Value.Units.GetAllocatedSize() + Pair.Value.Goals.GetAllocatedSize();
+	}
+	for (const TPair<FStratPathKey, FCachedPath>& Pair : Cache)
+	{
+		Result += Pair.Value.Path ? Pair.Value.Path->GetAllocatedSize() : 0;
+	}
+	for (const TPair<FStratUnitHandle, FPathRoute>& Pair : Routes)
+	{
+		Result += Pair.Value.Path ? Pair.Value.Path->GetAllocatedSize() : 0;
+	}
+	return Result;
+}
+
+FStratPathKey UStratPathSubsystem::MakeKey(const FVector& Start, const FVector& Goal) const
+{
+	const double CellSize = GetDefault<UStratPathSettings>()->CoalesceCellSize;
+	FStratPathKey Key;
+	Key.StartCell = FIntPoint(FMath::FloorToInt32(Start.X / CellSize), FMath::FloorToInt32(Start.Y / CellSize));
+	Key.GoalCell = FIntPoint(FMath::FloorToInt32(Goal.X / CellSize), FMath::FloorToInt32(Goal.Y / CellSize));
+	return Key;
+}
+
+void UStratPathSubsystem::RequestPath(const FStratUnitHandle Unit, const FVector& Start, const FVector& Goal)
+{
+	LLM_SCOPE_BYTAG(StratNav);
+
+	INC_DWORD_STAT(STAT_StratNav_NumRequested);
+
+	const FStratPathKey Key = MakeKey(Start, Goal);
+
+	if (const FCachedPath* Cached = Cache.Find(Key); Cached && Cached->ExpireTime > GetWorld()->GetTimeSeconds())
+	{
+		INC_DWORD_STAT(STAT_StratNav_NumShared);
+		WaitingUnits.Remove(Unit);
+		FollowPath(Unit, Cached->Path, Goal);
+		return;
+	}
+
+	WaitingUnits.Add(Unit, Key);
+
+	FPathQuery* Query = Queries.Find(Key);
+	if (Query)
+	{
+		INC_DWORD_STAT(STAT_StratNav_NumShared);
+	}
+	else
+	{
+		//~ The first request plans for the whole group. Later ones only add their goal.
+		Query = &Queries.Add(Key);
+		Query->Start = Start;
+		Query->Goal = Goal;
+		QueuedKeys.Add(Key);
+	}
+
+	Query->Units.Add(Unit);
+	Query->Goals.Add(Goal);
+}
+
+void UStratPathSubsystem::Tick(const float DeltaTime)
+{
+	LLM_SCOPE_BYTAG(StratNav);
+
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_StratNav_PathRequests);
+	STRAT_SCOPED_SYSTEM_TIMING(PathRequests);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	AbortTimedOutQueries(Now);
+	DeliverPaths(Now);
+	SubmitQueries();
+
+	for (auto It = Cache.CreateIterator(); It; ++It)
+	{
+		if (It.Value().ExpireTime <= Now)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	SET_DWORD_STAT(STAT_StratNav_NumQueued, QueuedKeys.Num());
+	SET_DWORD_STAT(STAT_StratNav_NumInFlight, InFlightQueries.Num());
+}
+
+void UStratPathSubsystem::SubmitQueries()
+{
+	if (QueuedKeys.IsEmpty())
+	{
+		return;
+	}
+
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	const ANavigationData* NavData = NavSys ? NavSys->GetDefaultNavDataInstance(FNavigationSystem::DontCreate) : nullptr;
+
+	const int32 MaxInFlight = GetDefault<UStratPathSettings>()->MaxQueriesInFlight;
+	int32 NumTaken = 0;
+	for (; NumTaken < QueuedKeys.Num() && InFlightQueries.Num() < MaxInFlight; ++NumTaken)
+	{
+		const FStratPathKey& Key = QueuedKeys[NumTaken];
+		FPathQuery& Query = Queries.FindChecked(Key);
+
+		if (NavData)
+		{
+			FPathFindingQuery NavQuery(this, *NavData, Query.Start, Query.Goal);
+			NavQuery.SetAllowPartialPaths(true);
+			Query.NavQueryId = NavSys->FindPathAsync(NavData->GetConfig(), NavQuery, FNavPathQueryDelegate::CreateUObject(this, &ThisClass::OnPathFound, Key));
+		}
+
+		//~ No nav mesh. The units keep their straight moves.
+		if (Query.NavQueryId == 0)
+		{
+			FinishedPaths.Emplace(Key, nullptr);
+			continue;
+		}
+
+		InFlightQueries.Add(Query.NavQueryId, {Key, GetWorld()->GetTimeSeconds()});
+		INC_DWORD_STAT(STAT_StratNav_NumSubmitted);
+	}
+
+	QueuedKeys.RemoveAt(0, NumTaken, EAllowShrinking::No);
+}
+
+void UStratPathSubsystem::OnPathFound(const uint32 NavQueryId, const ENavigationQueryResult::Type Result, const FNavPathSharedPtr NavPath, const FStratPathKey Key)
+{
+	LLM_SCOPE_BYTAG(StratNav);
+
+	//~ Timed out and aborted, but already done on the worker. Its units were let go.
+	if (InFlightQueries.Remove(NavQueryId) == 0)
+	{
+		return;
+	}
+
+	FStratSharedPath Path;
+	if (Result == ENavigationQueryResult::Success && NavPath.IsValid() && NavPath->GetPathPoints().Num() > 1)
+	{
+		TArray<FVector> Waypoints;
+		Waypoints.Reserve(NavPath->GetPathPoints().Num() - 1);
+		for (int32 Index = 1; Index < NavPath->GetPathPoints().Num(); ++Index)
+		{
+			Waypoints.Add(NavPath->GetPathPoints()[Index].Location);
+		}
+		Path = MakeShared<TArray<FVector>, ESPMode::NotThreadSafe>(MoveTemp(Waypoints));
+	}
+
+	//~ Called from the navigation system's tick. Delivery waits for ours, so units change orders at one point in the frame.
+	FinishedPaths.Emplace(Key, MoveTemp(Path));
+}
+
+void UStratPathSubsystem::AbortTimedOutQueries(const double Now)
+{
+	const double Timeout = GetDefault<UStratPathSettings>()->QueryTimeout;
+	UNavigationSystemV1* NavSys = nullptr;
+	for (auto It = InFlightQueries.CreateIterator(); It; ++It)
+	{
+		if (Now - It.Value().SubmitTime < Timeout)
+		{
+			continue;
+		}
+
+		NavSys = NavSys ? NavSys : FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+		if (NavSys)
+		{
+			NavSys->AbortAsyncFindPathRequest(It.Key());
+		}
+
+		UE_LOG(LogStratNav, Verbose, TEXT("Path search %u timed out after %.1f s."), It.Key(), Now - It.Value().SubmitTime);
+		FinishedPaths.Emplace(It.Value().Key, nullptr);
+		It.RemoveCurrent();
+	}
+}
+
+void UStratPathSubsystem::DeliverPaths(const double Now)
+{
+	const float ResultLifetime = GetDefault<UStratPathSettings>()->ResultLifetime;
+
+	for (const TPair<FStratPathKey, FStratSharedPath>& Finished : FinishedPaths)
+	{
+		FPathQuery Query;
+		if (!Queries.RemoveAndCopyValue(Finished.Key, Query))
+		{
+			continue;
+		}
+
+		for (int32 Index = 0; Index < Query.Units.Num(); ++Index)
+		{
+			const FStratPathKey* WaitingKey = WaitingUnits.Find(Query.Units[Index]);
+			if (!WaitingKey || !(*WaitingKey == Finished.Key))
+			{
+				continue;
+			}
+
+			WaitingUnits.Remove(Query.Units[Index]);
+			if (Finished.Value.IsValid())
+			{
+				FollowPath(Query.Units[Index], Finished.Value, Query.Goals[Index]);
+			}
+		}
+
+		if (Finished.Value.IsValid() && ResultLifetime > 0.f)
+		{
+			Cache.Add(Finished.Key, {Finished.Value, Query.Start, Now + ResultLifetime});
+		}
+	}
+	FinishedPaths.Reset();
+}
+
+void UStratPathSubsystem::OnNavAreaDirtied(const FBox& Area)
+{
+	for (auto It = Cache.CreateIterator(); It; ++It)
+	{
+		if (It.Value().Crosses(Area))
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+bool UStratPathSubsystem::FCachedPath::Crosses(const FBox& Area) const
+{
+	const FBox Flat(FVector(Area.Min.X, Area.Min.Y, -1.0), FVector(Area.Max.X, Area.Max.Y, 1.0));
+	FVector From(Start.X, Start.Y, 0.0);
+	for (const FVector& Waypoint : *Path)
+	{
+		const FVector To(Waypoint.X, Waypoint.Y, 0.0);
+		if (FMath::LineBoxIntersection(Flat, From, To, To - From))
+		{
+			return true;
+		}
+		From = To;
+	}
+	return false;
+}
+
+void UStratPathSubsystem::FollowPath(const FStratUnitHandle Unit, const FStratSharedPath& Path, const FVector& Goal)
+{
+	int32 Row;
+	const FStratUnitChunk* Chunk = UnitSim->FindUnit(Unit, Row);
+	if (!Chunk)
+	{
+		return;
+	}
+
+	//~ Ordered somewhere else while waiting. That order wins.
+	const FStratUnitOrder& Order = Chunk->Orders[Row];
+	if (Order.Type != EStratUnitOrderType::Move || !FVector2D(Order.TargetLocation.X, Order.TargetLocation.Y).Equals(FVector2D(Goal), 1.0))
+	{
+		return;
+	}
+
+	//~ A straight line already. The current move is the whole path.
+	if (Path->Num() <= 1)
+	{
+		return;
+	}
+
+	FPathRoute& Route = Routes.Add(Unit, {Path, Goal, 0});
+	UnitSim->SetCurrentOrder(Unit, FStratUnitOrder::MakeMove(Route.GetWaypoint(0)));
+}
+
+void UStratPathSubsystem::OnSimStepped(const float FixedDeltaTime)
+{
+	LLM_SCOPE_BYTAG(StratNav);
+
+	if (GetWorld()->GetNetMode() != NM_Client && !UnitSim->IsLockstep())
+	{
+		AdvanceRoutes();
+	}
+
+	SET_DWORD_STAT(STAT_StratNav_Routes, Routes.Num());
+}
+
+void UStratPathSubsystem::AdvanceRoutes()
+{
+	for (auto It = Routes.CreateIterator(); It; ++It)
+	{
+		const FStratUnitHandle Unit = It.Key();
+		FPathRoute& Route = It.Value();
+
+		int32 Row;
+		const FStratUnitChunk* Chunk = UnitSim->FindUnit(Unit, Row);
+		if (!Chunk)
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		if (EnumHasAnyFlags(Chunk->Flags[Row], EStratUnitFlags::OrderCompleted))
+		{
+			if (++Route.NextWaypoint >= Route.Path->Num())
+			{
+				It.RemoveCurrent();
+				continue;
+			}
+
+			UnitSim->SetCurrentOrder(Unit, FStratUnitOrder::MakeMove(Route.GetWaypoint(Route.NextWaypoint)));
+			continue;
+		}
+
+		//~ Something else gave the unit a new order. The path is no longer the plan.
+		const FStratUnitOrder& Order = Chunk->Orders[Row];
+		const FVector Waypoint = Route.GetWaypoint(Route.NextWaypoint);
+		if (Order.Type != EStratUnitOrderType::Move || !FVector2D(Order.TargetLocation.X, Order.TargetLocation.Y).Equals(FVector2D(Waypoint), 1.0))
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
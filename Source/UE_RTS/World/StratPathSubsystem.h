@@ -0,0 +1,155 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI/Navigation/NavigationTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Units/StratUnitTypes.h"
+#include "StratPathSubsystem.generated.h"
+
+class UStratNavUpdateSubsystem;
+class UStratUnitSimSubsystem;
+
+/** Start and goal cell of a path request. Requests with the same key share one search. */
+struct FStratPathKey
+{
+	FIntPoint StartCell{0, 0};
+	FIntPoint GoalCell{0, 0};
+
+	bool operator==(const FStratPathKey& Other) const { return StartCell == Other.StartCell && GoalCell == Other.GoalCell; }
+	friend uint32 GetTypeHash(const FStratPathKey& Key) { return HashCombineFast(GetTypeHash(Key.StartCell), GetTypeHash(Key.GoalCell)); }
+};
+
+/** Waypoints of a finished search, without the start. Every unit that shared the search shares this one array. */
+using FStratSharedPath = TSharedPtr<const TArray<FVector>, ESPMode::NotThreadSafe>;
+
+/**
+ * Nav mesh paths for ground units. Requests are keyed by start and goal cell (UStratPathSettings::CoalesceCellSize), so a
+ * group move or a burst of re-plans from one area becomes a single search whose result fans out to every unit that asked.
+ * Searches run on the navigation system's worker threads, at most MaxQueriesInFlight at a time, and finished paths are
+ * handed to their units once per frame. A search the navigation system doesn't answer within UStratPathSettings::QueryTimeout
+ * is aborted. Finished paths are cached briefly, and dropped early when UStratNavUpdateSubsystem rebuilds tiles they cross.
+ *
+ * A pathed move starts as a straight move right away, so units don't stand still waiting. When the path arrives the unit
+ * follows it one leg at a time and ends at its own goal. Giving the unit any other order in between drops the path.
+ *
+ * Authority only and not for lockstep, where nav mesh queries aren't deterministic. Flying units go through
+ * UStratFlightSubsystem instead.
+ */
+UCLASS()
+class UE_RTS_API UStratPathSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	//~ Begin UTickableWorldSubsystem interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~ End UTickableWorldSubsystem interface
+
+	/** Moves a ground unit along a nav mesh path. Flying units and structures get a plain move order. */
+	UFUNCTION(BlueprintCallable, Category=StratPath)
+	void IssuePathedMove(FStratUnitHandle Unit, const FVector& Location);
+
+	/** Moves every unit along a nav mesh path to Location. Units starting close together share a search. */
+	UFUNCTION(BlueprintCallable, Category=StratPath)
+	void IssuePathedMoves(const TArray<FStratUnitHandle>& Units, const FVector& Location);
+
+	/** Searches queued or running. */
+	UFUNCTION(BlueprintPure, Category=StratPath)
+	int32 GetNumPendingQueries() const { return Queries.Num(); }
+
+	/** Shared paths are counted once per holder, so a path many units follow counts more than once. */
+	SIZE_T GetAllocatedSize() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** One search and everyone waiting on it. Goals line up with Units. */
+	struct FPathQuery
+	{
+		FVector Start{ForceInit};
+		FVector Goal{ForceInit};
+		TArray<FStratUnitHandle> Units;
+		TArray<FVector> Goals;
+
+		/** The navigation system's id once submitted. 0 while queued. */
+		uint32 NavQueryId{0};
+	};
+
+	struct FCachedPath
+	{
+		FStratSharedPath Path;
+		FVector Start{ForceInit};
+		double ExpireTime{0.0};
+
+		/** True if a leg of the path passes over Area, ignoring height. */
+		bool Crosses(const FBox& Area) const;
+	};
+
+	/** A search handed to the navigation system. */
+	struct FInFlightQuery
+	{
+		FStratPathKey Key;
+		double SubmitTime{0.0};
+	};
+
+	/** Remaining legs of a pathed move. The unit's current move order is to GetWaypoint(NextWaypoint). */
+	struct FPathRoute
+	{
+		FStratSharedPath Path;
+		FVector Goal{ForceInit};
+		int32 NextWaypoint{0};
+
+		/** The path's last point is swapped for the unit's own goal, which may differ within the goal cell. */
+		FVector GetWaypoint(const int32 Index) const { return Index == Path->Num() - 1 ? Goal : (*Path)[Index]; }
+	};
+
+	FStratPathKey MakeKey(const FVector& Start, const FVector& Goal) const;
+
+	void RequestPath(FStratUnitHandle Unit, const FVector& Start, const FVector& Goal);
+	void SubmitQueries();
+	void OnPathFound(uint32 NavQueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr NavPath, FStratPathKey Key);
+
+	/** Aborts searches older than UStratPathSettings::QueryTimeout. Their units keep their straight moves. */
+	void AbortTimedOutQueries(double Now);
+
+	void DeliverPaths(double Now);
+	void OnNavAreaDirtied(const FBox& Area);
+
+	/** Starts the unit on the path, unless it got another order while waiting. */
+	void FollowPath(FStratUnitHandle Unit, const FStratSharedPath& Path, const FVector& Goal);
+
+	void OnSimStepped(float FixedDeltaTime);
+	void AdvanceRoutes();
+
+	TMap<FStratPathKey, FPathQuery> Queries;
+
+	/** Queries not submitted yet, oldest first. */
+	TArray<FStratPathKey> QueuedKeys;
+
+	/** Submitted and not answered, by the navigation system's id. An answer for an id not in here was aborted and is ignored. */
+	TMap<uint32, FInFlightQuery> InFlightQueries;
+
+	/** Back from the workers, waiting for this frame's delivery. A null path means the search failed. */
+	TArray<TPair<FStratPathKey, FStratSharedPath>> FinishedPaths;
+
+	TMap<FStratPathKey, FCachedPath> Cache;
+
+	/** Each waiting unit's latest request. A unit that asked again only gets the newer path. */
+	TMap<FStratUnitHandle, FStratPathKey> WaitingUnits;
+
+	TMap<FStratUnitHandle, FPathRoute> Routes;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratUnitSimSubsystem> UnitSim;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStratNavUpdateSubsystem> NavUpdate;
+};
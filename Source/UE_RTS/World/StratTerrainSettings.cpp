@@ -0,0 +1,9 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratTerrainSettings.h"
+
+UStratTerrainSettings::UStratTerrainSettings()
+{
+	CategoryName = TEXT("Game");
+	MapBounds.bIsValid = true;
+}
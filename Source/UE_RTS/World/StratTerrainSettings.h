@@ -0,0 +1,33 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "StratTerrainSettings.generated.h"
+
+/** Project settings for the cached terrain height grid. Found under Project Settings > Game > Strat Terrain. */
+UCLASS(Config=Game, DefaultConfig, meta=(DisplayName="Strat Terrain"))
+class UE_RTS_API UStratTerrainSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UStratTerrainSettings();
+
+	/** The playable area. Should match the camera pawn's MapBounds. */
+	UPROPERTY(Config, EditAnywhere, Category="Terrain")
+	FBox2D MapBounds{FVector2D(-80000.f, -80000.f), FVector2D(80000.f, 80000.f)};
+
+	/** Size of a height grid cell. Smaller is more accurate, but the grid is traced cell by cell when the match starts. */
+	UPROPERTY(Config, EditAnywhere, Category="Terrain", meta=(ClampMin="50.0", UIMin="100.0", UIMax="1000.0", Units="cm"))
+	float HeightCellSize{400.f};
+
+	/** The channel used to sample heights. Should hit terrain and building roofs, like the camera's TerrainHeightTraceChannel. */
+	UPROPERTY(Config, EditAnywhere, Category="Terrain")
+	TEnumAsByte<ECollisionChannel> TraceChannel{ECC_Visibility};
+
+	/** Traces start this far above zero and end this far below. Just basing this on 16bit height maps. */
+	UPROPERTY(Config, EditAnywhere, Category="Terrain", AdvancedDisplay, meta=(Units="cm"))
+	float TraceHalfHeight{32'500.f};
+};
@@ -0,0 +1,71 @@
+﻿// Copyright Cody McCarty.
+
+#include "StratTerrainSubsystem.h"
+
+#include "StratTerrainSettings.h"
+#include "Engine/World.h"
+
+DEFINE_LOG_CATEGORY(LogStratTerrain);
+
+void UStratTerrainSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	const UStratTerrainSettings* Settings = GetDefault<UStratTerrainSettings>();
+	HeightGrid.Init(Settings->MapBounds, Settings->HeightCellSize);
+
+	const double StartTime = FPlatformTime::Seconds();
+	TraceCells(FIntRect(0, 0, HeightGrid.SizeX, HeightGrid.SizeY));
+	UE_LOG(LogStratTerrain, Log, TEXT("Built %dx%d height grid in %.1f ms."), HeightGrid.SizeX, HeightGrid.SizeY, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+
+	OnHeightsChanged.Broadcast(HeightGrid.GetBounds());
+}
+
+void UStratTerrainSubsystem::RebuildRegion(const FBox& WorldBox)
+{
+	if (!HeightGrid.IsValid())
+	{
+		return;
+	}
+
+	const FBox2D WorldBox2D(FVector2D(WorldBox.Min), FVector2D(WorldBox.Max));
+	const FIntRect CellRect = HeightGrid.GetCellRect(WorldBox2D);
+	if (CellRect.Area() <= 0)
+	{
+		return;
+	}
+
+	TraceCells(CellRect);
+	OnHeightsChanged.Broadcast(WorldBox2D);
+}
+
+bool UStratTerrainSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UStratTerrainSubsystem::TraceCells(const FIntRect& CellRect)
+{
+	const UWorld* World = GetWorld();
+	if (!World)
+	{
+		return;
+	}
+
+	const UStratTerrainSettings* Settings = GetDefault<UStratTerrainSettings>();
+	const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(StratTerrain_TraceCells), false);
+
+	for (int32 Y = CellRect.Min.Y; Y < CellRect.Max.Y; ++Y)
+	{
+		for (int32 X = CellRect.Min.X; X < CellRect.Max.X; ++X)
+		{
+			const FVector2D CellCenter = HeightGrid.CellToWorld(FIntPoint(X, Y));
+			const FVector Start(CellCenter, Settings->TraceHalfHeight);
+			const FVector End(CellCenter, -Settings->TraceHalfHeight);
+
+			FHitResult Hit;
+			const bool bHit = World->LineTraceSingleByChannel(Hit, Start, End, Settings->TraceChannel, QueryParams);
+			HeightGrid.Heights[HeightGrid.ToIndex(X, Y)] = bHit ? Hit.ImpactPoint.Z : 0.f;
+		}
+	}
+}
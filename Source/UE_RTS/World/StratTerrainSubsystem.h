@@ -0,0 +1,50 @@
+﻿// Copyright Cody McCarty.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StratHeightGrid.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "StratTerrainSubsystem.generated.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogStratTerrain, Log, All);
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnStratTerrainHeightsChanged, const FBox2D& /*ChangedArea*/);
+
+/**
+ * Owns the cached terrain height grid. The grid is traced once when play begins, then only the regions that change are re-traced.
+ * Systems that need ground heights every frame (fog line of sight, picking, flying clearance) read the grid instead of tracing.
+ */
+UCLASS()
+class UE_RTS_API UStratTerrainSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin UWorldSubsystem interface
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	//~ End UWorldSubsystem interface
+
+	const FStratHeightGrid& GetHeightGrid() const { return HeightGrid; }
+
+	UFUNCTION(BlueprintPure, Category=StratTerrain)
+	bool IsReady() const { return HeightGrid.IsValid(); }
+
+	/** Cached ground height under a location. Doesn't trace. */
+	UFUNCTION(BlueprintPure, Category=StratTerrain)
+	float GetTerrainHeight(const FVector& Location) const { return HeightGrid.SampleHeight(FVector2D(Location)); }
+
+	/** Re-traces the cells under a box, e.g. after a building was placed or removed. */
+	UFUNCTION(BlueprintCallable, Category=StratTerrain)
+	void RebuildRegion(const FBox& WorldBox);
+
+	/** Broadcast after the whole grid was built, and after every RebuildRegion. */
+	FOnStratTerrainHeightsChanged OnHeightsChanged;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void TraceCells(const FIntRect& CellRect);
+
+	FStratHeightGrid HeightGrid;
+};